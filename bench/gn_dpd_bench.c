@@ -0,0 +1,220 @@
+/*
+ * @file gn_dpd_bench.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the duplicate packet detection of GeoNetworking. A stream of
+ * packets from many sources is generated beforehand, with some of them
+ * repeated a few packets after the original (as when heard from several
+ * forwarders), and then checked against the location table: the source is
+ * found through the hash table and its sequence number through its window.
+ * The rate, the cost per packet and the duplicates detected are printed; the
+ * run fails if the duplicates detected are not the ones injected.
+ */
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "core/gn_loct.h"
+
+#include <time.h>
+#include <getopt.h>
+
+/**************************************************************** DATA TYPES */
+
+#define BENCH_SOURCES		20000		/*!< Default number of sources. */
+#define BENCH_PACKETS		4000000		/*!< Default packets per run. */
+#define BENCH_DUP_PERCENT	10			/*!< Default duplicates (%). */
+#define BENCH_MAX_LAG		16			/*!< Default lag of a duplicate. */
+#define BENCH_LIFETIME		3600.0		/*!< Entries do not expire (s). */
+#define BENCH_BASE_ADDRESS	0x9C00000000000000ULL	/*!< GN address. */
+
+/*!
+ * \struct bench_packet
+ * \brief Packet of the stream.
+ */
+typedef struct bench_packet
+{
+
+	uint32_t source;			/*!< Index of the source. */
+	uint16_t sn;				/*!< Sequence number. */
+	bool is_duplicate;			/*!< Injected as a duplicate. */
+
+} bench_packet_t;
+
+static uint64_t __seed = 0x2545F4914F6CDD1DULL;
+
+/* __random */
+static inline uint32_t __random()
+{
+
+	// xorshift64*, rand() would cost more than the detection itself
+	__seed ^= __seed >> 12;
+	__seed ^= __seed << 25;
+	__seed ^= __seed >> 27;
+
+	return( (uint32_t)( ( __seed * 0x2545F4914F6CDD1DULL ) >> 32 ) );
+
+}
+
+/* __ns */
+static inline uint64_t __ns()
+{
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return( (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec );
+
+}
+
+/* __generate */
+static uint64_t __generate
+	(	bench_packet_t *packets, const int no_packets, const int no_sources,
+		const int dup_percent, const int max_lag	)
+{
+
+	uint16_t *last = (uint16_t *)calloc(no_sources, sizeof(uint16_t));
+	uint64_t duplicates = 0;
+	uint32_t source = 0, lag = 0;
+
+	for ( int i = 0; i < no_packets; i++ )
+	{
+
+		source = __random() % no_sources;
+		packets[i].source = source;
+
+		// repeats a packet already sent, still within the window
+		if ( ( last[source] > max_lag )
+				&& ( (int)( __random() % 100 ) < dup_percent ) )
+		{
+			lag = __random() % ( max_lag + 1 );
+			packets[i].sn = last[source] - lag;
+			packets[i].is_duplicate = true;
+			duplicates++;
+			continue;
+		}
+
+		packets[i].sn = ++last[source];
+		packets[i].is_duplicate = false;
+
+	}
+
+	free(last);
+	return(duplicates);
+
+}
+
+/* __print_usage */
+static void __print_usage(const char *name)
+{
+	fprintf(stdout,
+"Usage: %s [-n SOURCES] [-p PACKETS] [-d DUPLICATES_%%] [-l MAX_LAG]\n"
+"Checks a stream of GN packets from SOURCES stations against the duplicate\n"
+"packet detection of the location table.\n"
+		, name);
+}
+
+/* main */
+int main(int argc, char **argv)
+{
+
+	int no_sources = BENCH_SOURCES, no_packets = BENCH_PACKETS;
+	int dup_percent = BENCH_DUP_PERCENT, max_lag = BENCH_MAX_LAG, opt = 0;
+	gn_timer_wheel_t *wheel = NULL;
+	gn_loct_t *loct = NULL;
+	gn_loct_entry_t **entries = NULL, *e = NULL;
+	bench_packet_t *packets = NULL;
+	gn_lpv_t pv;
+	uint64_t injected = 0, detected = 0, missed = 0, start = 0, ns = 0;
+
+	while ( ( opt = getopt(argc, argv, "hn:p:d:l:") ) > -1 )
+	{
+		switch ( opt )
+		{
+			case 'n':	no_sources = atoi(optarg);		break;
+			case 'p':	no_packets = atoi(optarg);		break;
+			case 'd':	dup_percent = atoi(optarg);		break;
+			case 'l':	max_lag = atoi(optarg);			break;
+
+			case 'h':
+			default:
+
+				__print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+		}
+	}
+
+	if ( ( no_sources <= 0 ) || ( no_packets <= 0 )
+			|| ( dup_percent < 0 ) || ( dup_percent > 100 )
+			|| ( max_lag < 0 ) || ( max_lag >= GN_DPD_WINDOW ) )
+	{
+		handle_app_error("Wrong parameters, the lag must be < %d.\n"
+							, GN_DPD_WINDOW);
+	}
+
+	// 1) every source is in the table before the run
+	if ( ( wheel = init_gn_timer_wheel(EV_DEFAULT, GN_WHEEL_TICK) ) == NULL )
+		{ handle_app_error("Could not create timer wheel.\n"); }
+	if ( ( loct = init_gn_loct(wheel, no_sources, BENCH_LIFETIME) ) == NULL )
+		{ handle_app_error("Could not create location table.\n"); }
+
+	memset(&pv, 0, LEN__GN_LPV);
+	entries = (gn_loct_entry_t **)calloc(no_sources, sizeof(*entries));
+	for ( int i = 0; i < no_sources; i++ )
+	{
+		pv.address = BENCH_BASE_ADDRESS | ( (uint64_t)i * 2654435761ULL );
+		entries[i] = update_gn_loct(loct, &pv, false);
+	}
+
+	packets = (bench_packet_t *)malloc(no_packets * sizeof(bench_packet_t));
+	injected = __generate(	packets, no_packets, no_sources,
+							dup_percent, max_lag	);
+
+	// 2) sources are found by address, as for packets off the air
+	start = __ns();
+	for ( int i = 0; i < no_packets; i++ )
+	{
+		e = find_gn_loct(loct, entries[packets[i].source]->pv.address);
+		if ( is_duplicate_gn_loct(loct, e, packets[i].sn) == true )
+		{
+			detected++;
+			missed += ( packets[i].is_duplicate == false );
+		}
+		else
+			{ missed += ( packets[i].is_duplicate == true ); }
+	}
+	ns = __ns() - start;
+
+	fprintf(stdout, "sources = %d, packets = %d, state = %zu B/source\n"
+				, no_sources, no_packets, LEN__GN_DPD);
+	fprintf(stdout, "time = %.3f ms, %.1f ns/packet, %.2f Mpackets/s\n"
+				, ns / 1e6, (double)ns / no_packets
+				, no_packets / ( ns / 1e9 ) / 1e6);
+	fprintf(stdout, "duplicates: injected = %lu, detected = %lu, wrong = %lu\n"
+				, injected, detected, missed);
+
+	close_gn_loct(loct);
+	close_gn_timer_wheel(wheel);
+	free(entries);
+	free(packets);
+
+	exit( ( missed == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE );
+
+}
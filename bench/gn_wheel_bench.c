@@ -0,0 +1,202 @@
+/*
+ * @file gn_wheel_bench.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the timer wheel of GeoNetworking. A set of timers with random
+ * delays is added to the wheel and then cancelled, and the cost per operation
+ * is printed. A second set is left to expire within the loop and the time
+ * each timer actually fires is compared with the one it was due, both on
+ * CLOCK_MONOTONIC as the wheel itself; the lateness is printed and the run
+ * fails if any of them expires before its delay.
+ */
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "core/gn_timer_wheel.h"
+
+#include <time.h>
+#include <getopt.h>
+
+/**************************************************************** DATA TYPES */
+
+#define BENCH_TIMERS		100000		/*!< Default timers added. */
+#define BENCH_EXPIRING		10000		/*!< Default timers expired. */
+#define BENCH_MAX_DELAY		3600.0		/*!< Delays of the added ones (s). */
+#define BENCH_MAX_EXPIRY	0.5			/*!< Delays of the expired ones (s). */
+
+/*!
+ * \struct bench_timer
+ * \brief Timer of the benchmark, the one of the wheel first.
+ */
+typedef struct bench_timer
+{
+
+	gn_timer_t timer;			/*!< Timer of the wheel. */
+	uint64_t due;				/*!< Time when it is due (ns). */
+
+} bench_timer_t;
+
+static uint64_t __seed = 0x2545F4914F6CDD1DULL;
+
+static uint64_t __expired = 0;		/*!< Timers expired. */
+static uint64_t __early = 0;		/*!< Timers expired before due. */
+static double __late_sum = 0;		/*!< Total lateness (ns). */
+static double __late_max = 0;		/*!< Maximum lateness (ns). */
+
+/* __random */
+static inline uint32_t __random()
+{
+
+	// xorshift64*, rand() would cost more than adding a timer
+	__seed ^= __seed >> 12;
+	__seed ^= __seed << 25;
+	__seed ^= __seed >> 27;
+
+	return( (uint32_t)( ( __seed * 0x2545F4914F6CDD1DULL ) >> 32 ) );
+
+}
+
+/* __delay */
+static inline double __delay(const double max)
+	{ return( max * __random() / 4294967296.0 ); }
+
+/* __ns */
+static inline uint64_t __ns()
+{
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return( (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec );
+
+}
+
+/* __cb_expired */
+static void __cb_expired(gn_timer_t *timer)
+{
+
+	bench_timer_t *t = (bench_timer_t *)timer;
+	double late = (double)__ns() - (double)t->due;
+
+	__expired++;
+
+	if ( late < 0 )
+		{ __early++; return; }
+
+	__late_sum += late;
+	if ( late > __late_max )
+		{ __late_max = late; }
+
+}
+
+/* __print_usage */
+static void __print_usage(const char *name)
+{
+	fprintf(stdout,
+"Usage: %s [-t TIMERS] [-e EXPIRING]\n"
+"Adds and cancels TIMERS timers of the GN timer wheel and lets EXPIRING\n"
+"timers expire within the loop, checking that none expires early.\n"
+		, name);
+}
+
+/* main */
+int main(int argc, char **argv)
+{
+
+	int no_timers = BENCH_TIMERS, no_expiring = BENCH_EXPIRING, opt = 0;
+	gn_timer_wheel_t *wheel = NULL;
+	bench_timer_t *timers = NULL;
+	double *delays = NULL;
+	uint64_t start = 0, ns_add = 0, ns_cancel = 0;
+
+	while ( ( opt = getopt(argc, argv, "ht:e:") ) > -1 )
+	{
+		switch ( opt )
+		{
+			case 't':	no_timers = atoi(optarg);		break;
+			case 'e':	no_expiring = atoi(optarg);		break;
+
+			case 'h':
+			default:
+
+				__print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+		}
+	}
+
+	if ( ( no_timers <= 0 ) || ( no_expiring < 0 ) )
+		{ handle_app_error("Wrong parameters.\n"); }
+
+	if ( ( wheel = init_gn_timer_wheel(EV_DEFAULT, GN_WHEEL_TICK) ) == NULL )
+		{ handle_app_error("Could not create timer wheel.\n"); }
+
+	timers = (bench_timer_t *)calloc(no_timers, sizeof(bench_timer_t));
+	delays = (double *)malloc(no_timers * sizeof(double));
+	for ( int i = 0; i < no_timers; i++ )
+	{
+		init_gn_timer(&timers[i].timer, __cb_expired);
+		delays[i] = __delay(BENCH_MAX_DELAY);
+	}
+
+	// 1) timers spread over every level of the wheel
+	start = __ns();
+	for ( int i = 0; i < no_timers; i++ )
+		{ add_gn_timer(wheel, &timers[i].timer, delays[i]); }
+	ns_add = __ns() - start;
+
+	// 2) cancelled in the same order, as a retransmission acknowledged
+	start = __ns();
+	for ( int i = 0; i < no_timers; i++ )
+		{ cancel_gn_timer(wheel, &timers[i].timer); }
+	ns_cancel = __ns() - start;
+
+	fprintf(stdout, "timers = %d, wheel = %zu B\n"
+				, no_timers, LEN__GN_TIMER_WHEEL);
+	fprintf(stdout, "add = %.1f ns/timer, cancel = %.1f ns/timer\n"
+				, (double)ns_add / no_timers, (double)ns_cancel / no_timers);
+
+	// 3) timers left to expire, due from the time they are added
+	if ( no_expiring > no_timers )
+		{ no_expiring = no_timers; }
+
+	for ( int i = 0; i < no_expiring; i++ )
+	{
+		delays[i] = __delay(BENCH_MAX_EXPIRY);
+		timers[i].due = __ns() + (uint64_t)ceil(delays[i] * 1e9);
+		add_gn_timer(wheel, &timers[i].timer, delays[i]);
+	}
+
+	ev_run(EV_DEFAULT, 0);
+
+	fprintf(stdout, "expired = %lu, early = %lu, late: avg = %.1f us, "
+					"max = %.1f us\n"
+				, __expired, __early
+				, ( __expired > 0 ) ? __late_sum / __expired / 1e3 : 0.
+				, __late_max / 1e3);
+
+	close_gn_timer_wheel(wheel);
+	free(timers);
+	free(delays);
+
+	exit( ( __early == 0 && __expired == (uint64_t)no_expiring ) ?
+			EXIT_SUCCESS : EXIT_FAILURE );
+
+}
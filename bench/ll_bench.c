@@ -0,0 +1,828 @@
+/*
+ * @file ll_bench.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmark of the frame I/O paths of ll_library. A TX thread sends test
+ * frames through one interface with one of the TX paths (sendto, sendmmsg
+ * or TX ring) while an RX thread receives them from another interface with
+ * one of the RX paths (read, recvmmsg or RX ring). Both interfaces are
+ * meant to be the ends of a veth pair, see run_bench.sh. For each frame
+ * size and pair of paths, the rates, the CPU cost per frame of each thread
+ * and the frames lost are printed as a row of a table.
+ */
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_frame.h"
+#include "ll_library/ll_ring.h"
+
+#include <poll.h>
+#include <time.h>
+#include <getopt.h>
+#include <sched.h>
+#include <pthread.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/**************************************************************** DATA TYPES */
+
+#define BENCH_ETHERTYPE			0x88B5		/*!< Local experimental type. */
+#define BENCH_MIN_FRAME			64			/*!< Smallest frame (B). */
+#define BENCH_MAX_FRAME			2343		/*!< Largest frame, 802.11 (B). */
+#define BENCH_MAX_SIZES			16			/*!< Frame sizes per run. */
+#define BENCH_BATCH				64			/*!< Default frames per batch. */
+#define BENCH_SECS				2			/*!< Default length of a run. */
+#define BENCH_DRAIN_NSECS		100000000	/*!< Wait for frames in flight. */
+#define BENCH_POLL_MSECS		10			/*!< Wait of an idle thread. */
+
+#define BENCH_MARK_DATA			0x00		/*!< First payload byte, data. */
+#define BENCH_MARK_STOP			0xFF		/*!< First payload byte, stop. */
+
+#define BENCH_RX_READ			0			/*!< recvmsg(), one frame. */
+#define BENCH_RX_RECVMMSG		1			/*!< recvmmsg(), batches. */
+#define BENCH_RX_RING			2			/*!< TPACKET_V3 RX ring. */
+#define BENCH_TX_SENDTO			0			/*!< sendto(), one frame. */
+#define BENCH_TX_SENDMMSG		1			/*!< sendmmsg(), batches. */
+#define BENCH_TX_RING			2			/*!< TPACKET_V2 TX ring. */
+#define BENCH_NO_PATHS			3			/*!< Paths per direction. */
+
+static const char *__rx_paths[] = { "read", "recvmmsg", "rx_ring" };
+static const char *__tx_paths[] = { "sendto", "sendmmsg", "tx_ring" };
+
+static const int __default_sizes[]
+	= { 64, 128, 256, 512, 1024, 1518, 2343 };
+
+/*!
+ * \struct bench_frame
+ * \brief Frame of the recvmmsg()/sendmmsg() batches.
+ */
+typedef struct bench_frame
+{
+
+	ll_frame_t info;						/*!< Info of the frame. */
+	uint8_t buffer[BENCH_MAX_FRAME];		/*!< Contents of the frame. */
+
+} bench_frame_t;
+
+#define LEN__BENCH_FRAME sizeof(bench_frame_t)
+
+/*!
+ * \struct bench_cpu
+ * \brief CPU consumed by a thread.
+ */
+typedef struct bench_cpu
+{
+
+	int perf_fd;					/*!< Cycles counter, <0 if none. */
+	uint64_t cycles;				/*!< Cycles consumed. */
+	uint64_t nsecs;					/*!< CPU time consumed (nsecs). */
+
+} bench_cpu_t;
+
+/*!
+ * \struct bench_run
+ * \brief Configuration and results of a single run.
+ */
+typedef struct bench_run
+{
+
+	int tx_index;					/*!< Index of the TX interface. */
+	int rx_index;					/*!< Index of the RX interface. */
+	int size;						/*!< Length of the frames (B). */
+	int tx_path;					/*!< BENCH_TX_*. */
+	int rx_path;					/*!< BENCH_RX_*. */
+	int batch;						/*!< Frames per batch. */
+	int secs;						/*!< Length of the run (s). */
+
+	uint8_t frame[BENCH_MAX_FRAME];	/*!< Test frame. */
+
+	volatile bool rx_ready;			/*!< RX socket bound. */
+	volatile bool tx_done;			/*!< TX thread finished. */
+	volatile bool rx_done;			/*!< RX thread finished. */
+
+	uint64_t tx_frames;				/*!< Frames sent. */
+	uint64_t tx_errors;				/*!< Frames the kernel did not take. */
+	uint64_t rx_frames;				/*!< Frames received. */
+	uint64_t rx_bytes;				/*!< Bytes received. */
+	uint64_t rx_drops;				/*!< Drops reported by the kernel. */
+	double tx_elapsed;				/*!< Length of the transmission (s). */
+	bench_cpu_t tx_cpu;				/*!< CPU of the TX thread. */
+	bench_cpu_t rx_cpu;				/*!< CPU of the RX thread. */
+
+} bench_run_t;
+
+/************************************************************ CPU ACCOUNTING */
+
+/* __now */
+static double __now()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return(t.tv_sec + t.tv_nsec / 1e9);
+}
+
+/* __thread_nsecs */
+static uint64_t __thread_nsecs()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+	return(t.tv_sec * 1000000000ULL + t.tv_nsec);
+}
+
+/* __start_cpu */
+static void __start_cpu(bench_cpu_t *cpu)
+{
+
+	struct perf_event_attr attr;
+
+	// cycles are counted for the calling thread only, kernel included,
+	// virtual machines usually lack the counter
+	memset(&attr, 0, sizeof(struct perf_event_attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(struct perf_event_attr);
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+
+	cpu->perf_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	cpu->nsecs = __thread_nsecs();
+
+}
+
+/* __stop_cpu */
+static void __stop_cpu(bench_cpu_t *cpu)
+{
+
+	cpu->nsecs = __thread_nsecs() - cpu->nsecs;
+
+	if ( cpu->perf_fd < 0 )
+		{ return; }
+	if ( read(cpu->perf_fd, &cpu->cycles, sizeof(uint64_t))
+			!= sizeof(uint64_t) )
+		{ cpu->cycles = 0; }
+	close(cpu->perf_fd);
+
+}
+
+/******************************************************************* SOCKETS */
+
+/* __open_socket */
+static int __open_socket(const int protocol)
+{
+
+	int fd = -1;
+
+	if ( ( fd = socket(AF_PACKET, SOCK_RAW, htons(protocol)) ) < 0 )
+	{
+		log_sys_error("Could not open socket");
+		return(EX_SYS);
+	}
+
+	return(fd);
+
+}
+
+/* __bind_socket */
+static int __bind_socket(const int fd, const int if_index, const int protocol)
+{
+
+	struct sockaddr_ll sll;
+
+	memset(&sll, 0, sizeof(struct sockaddr_ll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_ifindex = if_index;
+	sll.sll_protocol = htons(protocol);
+
+	if ( bind(fd, (struct sockaddr *)&sll, sizeof(struct sockaddr_ll)) < 0 )
+	{
+		log_sys_error("Could not bind socket");
+		return(EX_SYS);
+	}
+
+	return(EX_OK);
+
+}
+
+/* __init_frame */
+static void __init_frame(bench_run_t *run, const uint8_t mark)
+{
+
+	struct ether_header *h = (struct ether_header *)run->frame;
+
+	memset(run->frame, 0, BENCH_MAX_FRAME);
+	memset(h->ether_dhost, 0xFF, ETH_ALEN);
+	h->ether_shost[0] = 0x02;
+	h->ether_type = htons(BENCH_ETHERTYPE);
+	run->frame[ETH_HLEN] = mark;
+
+}
+
+/* __is_stop_frame */
+static inline bool __is_stop_frame(const uint8_t *data, const int len)
+	{ return( ( len > ETH_HLEN ) && ( data[ETH_HLEN] == BENCH_MARK_STOP ) ); }
+
+/***************************************************************** RX THREAD */
+
+/* __account_rx */
+static inline void __account_rx(bench_run_t *run, const int len)
+{
+	run->rx_frames++;
+	run->rx_bytes += len;
+}
+
+/* __rx_read */
+static void __rx_read(bench_run_t *run, const int fd)
+{
+
+	uint8_t buffer[BENCH_MAX_FRAME];
+	struct pollfd p = { .fd = fd, .events = POLLIN };
+	ll_frame_t info;
+	int len = 0;
+
+	for ( ;; )
+	{
+		if ( ( len = recv_ll_frame(fd, buffer, BENCH_MAX_FRAME, &info,
+									TYPE_IEEE_8023) ) < 0 )
+			{ return; }
+		if ( len == 0 )
+		{
+			poll(&p, 1, BENCH_POLL_MSECS);
+			continue;
+		}
+		if ( __is_stop_frame(buffer, len) == true )
+			{ return; }
+		__account_rx(run, len);
+	}
+
+}
+
+/* __rx_recvmmsg */
+static void __rx_recvmmsg(bench_run_t *run, const int fd)
+{
+
+	ll_frame_batch_t *batch = init_ll_frame_batch
+								(	run->batch, LEN__BENCH_FRAME,
+									offsetof(bench_frame_t, buffer),
+									BENCH_MAX_FRAME	);
+	struct pollfd p = { .fd = fd, .events = POLLIN };
+	bench_frame_t *f = NULL;
+	int n = 0;
+
+	for ( ;; )
+	{
+
+		if ( ( n = read_ll_frame_batch(fd, batch, TYPE_IEEE_8023) ) < 0 )
+			{ break; }
+
+		// as the event loop does, an empty socket waits for readiness
+		if ( n == 0 )
+		{
+			poll(&p, 1, BENCH_POLL_MSECS);
+			continue;
+		}
+
+		for ( int i = 0; i < n; i++ )
+		{
+			f = (bench_frame_t *)get_ll_frame_batch(batch, i);
+			if ( __is_stop_frame(f->buffer, f->info.frame_len) == true )
+				{ goto done; }
+			__account_rx(run, f->info.frame_len);
+		}
+
+	}
+
+done:
+
+	free(batch->frames);
+	free(batch->msgs);
+	free(batch->iovs);
+	free(batch->controls);
+	free(batch);
+
+}
+
+/* __rx_ring */
+static void __rx_ring(bench_run_t *run, rx_ring_t *ring)
+{
+
+	struct pollfd p = { .fd = ring->socket_fd, .events = POLLIN };
+	tpacket3_hdr_t *frame = NULL;
+
+	for ( ;; )
+	{
+
+		if ( ( frame = rx_ring_next_frame(ring) ) == NULL )
+		{
+			poll(&p, 1, BENCH_POLL_MSECS);
+			continue;
+		}
+
+		if ( __is_stop_frame(rx_ring_frame_data(frame), frame->tp_snaplen)
+				== true )
+			{ return; }
+		__account_rx(run, frame->tp_len);
+
+	}
+
+}
+
+/* __rx_thread */
+static void *__rx_thread(void *arg)
+{
+
+	bench_run_t *run = (bench_run_t *)arg;
+	rx_ring_t *ring = NULL;
+	struct tpacket_stats_v3 stats;
+	socklen_t len = sizeof(struct tpacket_stats_v3);
+	int fd = -1, one = 1;
+
+	if ( ( fd = __open_socket(BENCH_ETHERTYPE) ) < 0 )
+		{ run->rx_done = true; return(NULL); }
+
+	// frames sent by this host would be received twice on lo
+	setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(int));
+
+	if ( ( run->rx_path == BENCH_RX_RING )
+			&& ( ( ring = init_rx_ring(	fd, RX_RING_BLOCK_SIZE,
+										RX_RING_NO_BLOCKS,
+										RX_RING_FRAME_SIZE << 1,
+										RX_RING_BLOCK_TMO >> 4	) ) == NULL ) )
+		{ close(fd); run->rx_done = true; return(NULL); }
+
+	if ( __bind_socket(fd, run->rx_index, BENCH_ETHERTYPE) < 0 )
+		{ close(fd); run->rx_done = true; return(NULL); }
+
+	// statistics are reset by reading them
+	getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len);
+
+	__start_cpu(&run->rx_cpu);
+	run->rx_ready = true;
+
+	switch ( run->rx_path )
+	{
+		case BENCH_RX_READ:		__rx_read(run, fd);			break;
+		case BENCH_RX_RECVMMSG:	__rx_recvmmsg(run, fd);		break;
+		case BENCH_RX_RING:		__rx_ring(run, ring);		break;
+	}
+
+	__stop_cpu(&run->rx_cpu);
+
+	len = sizeof(struct tpacket_stats_v3);
+	if ( getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0 )
+		{ run->rx_drops = stats.tp_drops; }
+
+	if ( ring != NULL )
+		{ close_rx_ring(ring); }
+	close(fd);
+
+	run->rx_done = true;
+	return(NULL);
+
+}
+
+/***************************************************************** TX THREAD */
+
+/* __tx_sendto */
+static void __tx_sendto(bench_run_t *run, const int fd, const double end)
+{
+
+	struct sockaddr_ll sll;
+
+	memset(&sll, 0, sizeof(struct sockaddr_ll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_ifindex = run->tx_index;
+	sll.sll_halen = ETH_ALEN;
+	memset(sll.sll_addr, 0xFF, ETH_ALEN);
+
+	// the clock is read once per batch of frames, not once per frame
+	while ( __now() < end )
+	{
+		for ( int i = 0; i < run->batch; i++ )
+		{
+			if ( sendto(	fd, run->frame, run->size, 0,
+							(struct sockaddr *)&sll, sizeof(struct sockaddr_ll) )
+					< 0 )
+				{ run->tx_errors++; }
+			else
+				{ run->tx_frames++; }
+		}
+	}
+
+}
+
+/* __tx_sendmmsg */
+static void __tx_sendmmsg(bench_run_t *run, const int fd, const double end)
+{
+
+	ll_frame_batch_t *batch = init_ll_frame_batch
+								(	run->batch, LEN__BENCH_FRAME,
+									offsetof(bench_frame_t, buffer),
+									BENCH_MAX_FRAME	);
+	struct pollfd p = { .fd = fd, .events = POLLOUT };
+	struct sockaddr_ll sll;
+	bench_frame_t *f = NULL;
+	int sent = 0;
+
+	memset(&sll, 0, sizeof(struct sockaddr_ll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_ifindex = run->tx_index;
+	sll.sll_halen = ETH_ALEN;
+	memset(sll.sll_addr, 0xFF, ETH_ALEN);
+
+	for ( int i = 0; i < run->batch; i++ )
+	{
+		f = (bench_frame_t *)get_ll_frame_batch(batch, i);
+		memcpy(f->buffer, run->frame, run->size);
+		f->info.frame_len = run->size;
+	}
+	batch->no_frames = run->batch;
+
+	while ( __now() < end )
+	{
+
+		batch->next_frame = 0;
+		while ( batch->next_frame < batch->no_frames )
+		{
+			if ( ( sent = send_ll_frame_batch(fd, batch, &sll) ) < 0 )
+			{
+				run->tx_errors += batch->no_frames - batch->next_frame;
+				break;
+			}
+			run->tx_frames += sent;
+			if ( batch->next_frame < batch->no_frames )
+				{ poll(&p, 1, BENCH_POLL_MSECS); }
+		}
+
+	}
+
+	free(batch->frames);
+	free(batch->msgs);
+	free(batch->iovs);
+	free(batch->controls);
+	free(batch);
+
+}
+
+/* __tx_ring */
+static void __tx_ring(bench_run_t *run, tx_ring_t *ring, const double end)
+{
+
+	struct pollfd p = { .fd = ring->socket_fd, .events = POLLOUT };
+	void *slot = NULL;
+	int max_len = 0;
+
+	while ( __now() < end )
+	{
+
+		tx_ring_reclaim(ring);
+
+		for ( int i = 0; i < run->batch; i++ )
+		{
+			// frames are built within the slots, as the library does
+			if ( ( slot = tx_ring_get_slot(ring, &max_len) ) == NULL )
+				{ break; }
+			memcpy(slot, run->frame, run->size);
+			tx_ring_commit(ring, run->size);
+		}
+
+		if ( tx_ring_flush(ring) < 0 )
+			{ poll(&p, 1, BENCH_POLL_MSECS); }
+
+	}
+
+	// frames still queued are sent before the counters are read
+	while ( ( ring->queued > 0 ) || ( ring->pending > 0 ) )
+	{
+		tx_ring_flush(ring);
+		tx_ring_reclaim(ring);
+	}
+
+	run->tx_frames = ring->sent;
+	run->tx_errors = ring->wrong_format;
+
+}
+
+/* __tx_thread */
+static void *__tx_thread(void *arg)
+{
+
+	bench_run_t *run = (bench_run_t *)arg;
+	tx_ring_t *ring = NULL;
+	double start = 0.;
+	int fd = -1;
+
+	if ( ( fd = __open_socket(0) ) < 0 )
+		{ run->tx_done = true; return(NULL); }
+
+	if ( ( run->tx_path == BENCH_TX_RING )
+			&& ( ( ring = init_tx_ring(	fd, TX_RING_FRAME_SIZE,
+										TX_RING_NO_FRAMES	) ) == NULL ) )
+		{ close(fd); run->tx_done = true; return(NULL); }
+
+	// protocol 0: the socket does not receive any frame
+	if ( __bind_socket(fd, run->tx_index, 0) < 0 )
+		{ close(fd); run->tx_done = true; return(NULL); }
+
+	__start_cpu(&run->tx_cpu);
+	start = __now();
+
+	switch ( run->tx_path )
+	{
+		case BENCH_TX_SENDTO:	__tx_sendto(run, fd, start + run->secs);	break;
+		case BENCH_TX_SENDMMSG:	__tx_sendmmsg(run, fd, start + run->secs);	break;
+		case BENCH_TX_RING:		__tx_ring(run, ring, start + run->secs);	break;
+	}
+
+	run->tx_elapsed = __now() - start;
+	__stop_cpu(&run->tx_cpu);
+
+	if ( ring != NULL )
+		{ close_tx_ring(ring); }
+	close(fd);
+
+	run->tx_done = true;
+	return(NULL);
+
+}
+
+/* __stop_rx */
+static void __stop_rx(bench_run_t *run)
+{
+
+	struct timespec drain = { 0, BENCH_DRAIN_NSECS };
+	struct sockaddr_ll sll;
+	int fd = -1;
+
+	// frames still in flight are given some time to arrive
+	nanosleep(&drain, NULL);
+
+	if ( ( fd = __open_socket(0) ) < 0 )
+		{ return; }
+
+	memset(&sll, 0, sizeof(struct sockaddr_ll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_ifindex = run->tx_index;
+	sll.sll_halen = ETH_ALEN;
+
+	__init_frame(run, BENCH_MARK_STOP);
+
+	// stop frames might be dropped too, so they are sent until it stops
+	while ( run->rx_done == false )
+	{
+		sendto(	fd, run->frame, BENCH_MIN_FRAME, 0,
+				(struct sockaddr *)&sll, sizeof(struct sockaddr_ll) );
+		drain.tv_nsec = BENCH_POLL_MSECS * 1000000;
+		nanosleep(&drain, NULL);
+	}
+
+	close(fd);
+
+}
+
+/******************************************************************** REPORT */
+
+/* __print_header */
+static void __print_header()
+{
+	fprintf(stdout, "#%5s %-9s %-9s %10s %10s %8s %9s %9s %9s %9s %8s %8s\n",
+			"size", "tx_path", "rx_path", "tx_kpps", "rx_kpps", "rx_gbps",
+			"tx_cyc/f", "rx_cyc/f", "tx_ns/f", "rx_ns/f", "drops", "lost");
+}
+
+/* __per_frame */
+static double __per_frame(const uint64_t total, const uint64_t frames)
+	{ return( ( frames > 0 ) ? (double)total / frames : 0. ); }
+
+/* __format_cycles */
+static const char *__format_cycles
+	(char *buffer, const bench_cpu_t *cpu, const uint64_t frames)
+{
+	if ( cpu->perf_fd < 0 )
+		{ return("-"); }
+	snprintf(buffer, 16, "%.0f", __per_frame(cpu->cycles, frames));
+	return(buffer);
+}
+
+/* __print_run */
+static void __print_run(const bench_run_t *run)
+{
+
+	// frames are received within the window of the transmission, the few
+	// that arrive while draining do not change the rates
+	double secs = ( run->tx_elapsed > 0 ) ? run->tx_elapsed : 1.;
+	uint64_t lost = ( run->tx_frames > run->rx_frames )
+						? run->tx_frames - run->rx_frames : 0;
+	char tx_cycles[16], rx_cycles[16];
+
+	fprintf(stdout,
+			" %5d %-9s %-9s %10.1f %10.1f %8.3f %9s %9s %9.0f %9.0f"
+			" %8lu %8lu\n",
+			run->size, __tx_paths[run->tx_path], __rx_paths[run->rx_path],
+			run->tx_frames / secs / 1e3,
+			run->rx_frames / secs / 1e3,
+			run->rx_bytes * 8. / secs / 1e9,
+			__format_cycles(tx_cycles, &run->tx_cpu, run->tx_frames),
+			__format_cycles(rx_cycles, &run->rx_cpu, run->rx_frames),
+			__per_frame(run->tx_cpu.nsecs, run->tx_frames),
+			__per_frame(run->rx_cpu.nsecs, run->rx_frames),
+			run->rx_drops, lost);
+	fflush(stdout);
+
+}
+
+/*********************************************************************** RUN */
+
+/* bench_run */
+int bench_run(bench_run_t *run)
+{
+
+	pthread_t tx, rx;
+
+	run->rx_done = false;
+	run->tx_done = false;
+
+	if ( pthread_create(&rx, NULL, __rx_thread, run) != 0 )
+		{ return(EX_ERR); }
+
+	// the RX socket must be bound before the first frame is sent
+	while ( ( run->rx_done == false ) && ( run->rx_ready == false ) )
+		{ sched_yield(); }
+
+	__init_frame(run, BENCH_MARK_DATA);
+	if ( pthread_create(&tx, NULL, __tx_thread, run) != 0 )
+		{ return(EX_ERR); }
+
+	pthread_join(tx, NULL);
+	__stop_rx(run);
+	pthread_join(rx, NULL);
+
+	return(EX_OK);
+
+}
+
+/* __parse_paths */
+static int __parse_paths(const char *arg, const char **names, bool *selected)
+{
+
+	char copy[128], *token = NULL, *save = NULL;
+	bool found = false;
+
+	memset(selected, 0, BENCH_NO_PATHS * sizeof(bool));
+	strncpy(copy, arg, sizeof(copy) - 1);
+	copy[sizeof(copy) - 1] = '\0';
+
+	for (	token = strtok_r(copy, ",", &save); token != NULL;
+			token = strtok_r(NULL, ",", &save)	)
+	{
+		found = false;
+		for ( int i = 0; i < BENCH_NO_PATHS; i++ )
+		{
+			if ( strcmp(token, names[i]) == 0 )
+				{ selected[i] = found = true; }
+		}
+		if ( found == false )
+			{ return(EX_WRONG_PARAM); }
+	}
+
+	return(EX_OK);
+
+}
+
+/* __print_usage */
+static void __print_usage(const char *name)
+{
+	fprintf(stdout,
+"Usage: %s -t TX_IF -r RX_IF [-d SECS] [-b BATCH] [-s SIZE,...]\n"
+"          [-T sendto,sendmmsg,tx_ring] [-R read,recvmmsg,rx_ring]\n"
+"Sends frames through TX_IF and receives them through RX_IF (ends of a\n"
+"veth pair, or lo for both) for every frame size and pair of paths.\n"
+		, name);
+}
+
+/* main */
+int main(int argc, char **argv)
+{
+
+	int sizes[BENCH_MAX_SIZES], no_sizes = 0, opt = 0;
+	bool tx_paths[BENCH_NO_PATHS] = { true, true, true };
+	bool rx_paths[BENCH_NO_PATHS] = { true, true, true };
+	const char *tx_if = NULL, *rx_if = NULL;
+	char *token = NULL, *save = NULL;
+	bench_run_t *run = NULL;
+	int batch = BENCH_BATCH, secs = BENCH_SECS;
+
+	while ( ( opt = getopt(argc, argv, "ht:r:d:b:s:T:R:") ) > -1 )
+	{
+		switch ( opt )
+		{
+			case 't':	tx_if = optarg;				break;
+			case 'r':	rx_if = optarg;				break;
+			case 'd':	secs = atoi(optarg);		break;
+			case 'b':	batch = atoi(optarg);		break;
+
+			case 's':
+
+				for (	token = strtok_r(optarg, ",", &save);
+						( token != NULL ) && ( no_sizes < BENCH_MAX_SIZES );
+						token = strtok_r(NULL, ",", &save)	)
+					{ sizes[no_sizes++] = atoi(token); }
+				break;
+
+			case 'T':
+
+				if ( __parse_paths(optarg, __tx_paths, tx_paths) < 0 )
+					{ handle_app_error("Unknown TX path in %s\n", optarg); }
+				break;
+
+			case 'R':
+
+				if ( __parse_paths(optarg, __rx_paths, rx_paths) < 0 )
+					{ handle_app_error("Unknown RX path in %s\n", optarg); }
+				break;
+
+			case 'h':
+			default:
+
+				__print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+		}
+	}
+
+	if ( ( tx_if == NULL ) || ( rx_if == NULL ) )
+	{
+		__print_usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if ( ( secs <= 0 ) || ( batch <= 0 ) || ( batch > TX_RING_NO_FRAMES ) )
+		{ handle_app_error("Wrong length of the runs or batch.\n"); }
+
+	if ( no_sizes == 0 )
+	{
+		no_sizes = sizeof(__default_sizes) / sizeof(int);
+		memcpy(sizes, __default_sizes, sizeof(__default_sizes));
+	}
+
+	for ( int i = 0; i < no_sizes; i++ )
+	{
+		if ( ( sizes[i] < BENCH_MIN_FRAME ) || ( sizes[i] > BENCH_MAX_FRAME ) )
+		{
+			handle_app_error("Frame sizes must be between %d and %d B.\n"
+								, BENCH_MIN_FRAME, BENCH_MAX_FRAME);
+		}
+	}
+
+	run = (bench_run_t *)malloc(sizeof(bench_run_t));
+	__print_header();
+
+	for ( int s = 0; s < no_sizes; s++ )
+	for ( int t = 0; t < BENCH_NO_PATHS; t++ )
+	for ( int r = 0; r < BENCH_NO_PATHS; r++ )
+	{
+
+		if ( ( tx_paths[t] == false ) || ( rx_paths[r] == false ) )
+			{ continue; }
+
+		memset(run, 0, sizeof(bench_run_t));
+		run->tx_index = if_nametoindex(tx_if);
+		run->rx_index = if_nametoindex(rx_if);
+		run->size = sizes[s];
+		run->tx_path = t;
+		run->rx_path = r;
+		run->batch = batch;
+		run->secs = secs;
+
+		if ( ( run->tx_index == 0 ) || ( run->rx_index == 0 ) )
+			{ handle_app_error("Unknown interface %s or %s\n", tx_if, rx_if); }
+
+		if ( bench_run(run) < 0 )
+			{ handle_app_error("Could not start the threads of a run.\n"); }
+		__print_run(run);
+
+	}
+
+	free(run);
+	exit(EXIT_SUCCESS);
+
+}
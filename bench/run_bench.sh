@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# @file run_bench.sh
+# @author Ricardo Tubío (rtpardavila[at]gmail.com)
+#
+# Runs ll_bench over a veth pair created within a throwaway network
+# namespace, so that no real interface is touched. With -l, the benchmark
+# runs over lo instead. Any other argument is handed over to ll_bench
+# (frame sizes, paths, length of the runs...). Requires root.
+#
+# LL_BENCH is the path of the ll_bench binary, as set by `make bench` for
+# out-of-tree builds; by default it is taken from the script directory.
+#
+# Usage: run_bench.sh [-l] [ll_bench options]
+#
+
+NETNS="llbench$$"
+TX_IF="llb0"
+RX_IF="llb1"
+MTU=2400	# 2343 B frames (802.11 maximum) must fit
+
+BENCH="${LL_BENCH:-$(dirname "$0")/ll_bench}"
+
+if [ "$1" = "-l" ]; then
+	shift
+	exec "$BENCH" -t lo -r lo "$@"
+fi
+
+cleanup()
+{
+	ip netns del "$NETNS" 2>/dev/null
+}
+trap cleanup EXIT INT TERM
+
+ip netns add "$NETNS" || exit 1
+ip -n "$NETNS" link add "$TX_IF" type veth peer name "$RX_IF" || exit 1
+for i in "$TX_IF" "$RX_IF"; do
+	ip -n "$NETNS" link set "$i" mtu "$MTU" up || exit 1
+done
+
+ip netns exec "$NETNS" "$BENCH" -t "$TX_IF" -r "$RX_IF" "$@"
@@ -21,6 +21,12 @@
  */
 
 #include "configuration.h"
+#include "ll_library/ll_fanout.h"
+#include "ll_library/ll_pacer.h"
+#include "ll_library/ll_capture.h"
+#include "ll_library/ll_backend.h"
+#include "ll_library/ll_probe.h"
+#include "ll_library/ll_ring.h"
 
 /* new_configuration */
 configuration_t *new_configuration()
@@ -28,6 +34,7 @@ configuration_t *new_configuration()
 
 	configuration_t *cfg = NULL;
 	cfg = (configuration_t *)malloc(LEN__T_CONFIGURATION);
+	memset(cfg, 0, LEN__T_CONFIGURATION);
 	return(cfg);
 
 }
@@ -61,11 +68,47 @@ int read_configuration(int argc, char** argv, configuration_t* cfg)
 		{"lsap", 	required_argument,	NULL, 	'l'	},
 		{"if",		required_argument,	NULL,	'i'	},
 		{"frame", 	required_argument, 	NULL,	'f'	},
+		{"workers",	required_argument,	NULL,	'w'	},
+		{"fanout",	required_argument,	NULL,	'o'	},
+		{"batch",	required_argument,	NULL,	'b'	},
+		{"ring-blocks",		required_argument,	NULL,	'n'	},
+		{"ring-block-size",	required_argument,	NULL,	'N'	},
+		{"rate",	required_argument,	NULL,	'R'	},
+		{"bitrate",	required_argument,	NULL,	'B'	},
+		{"burst",	required_argument,	NULL,	'u'	},
+		{"filter",	required_argument,	NULL,	'F'	},
+		{"capture",	required_argument,	NULL,	'c'	},
+		{"capture-format",	required_argument,	NULL,	'g'	},
+		{"rotate-size",		required_argument,	NULL,	'z'	},
+		{"rotate-time",		required_argument,	NULL,	'T'	},
+		{"replay",	required_argument,	NULL,	'p'	},
+		{"speed",	required_argument,	NULL,	's'	},
+		{"backend",	required_argument,	NULL,	'k'	},
+		{"backend-file",	required_argument,	NULL,	'K'	},
+		{"ping",	required_argument,	NULL,	'P'	},
+		{"reflect",	no_argument,		NULL,	'E'	},
+		{"stats",	required_argument,	NULL,	'S'	},
+		{"metrics",	required_argument,	NULL,	'M'	},
 		{0,0,0,0}
 	};
+
+	cfg->no_workers = 1;
+	cfg->fanout_mode = FANOUT_MODE_HASH;
+	cfg->batch = 1;
+	cfg->ring_blocks = RX_RING_NO_BLOCKS;
+	cfg->ring_block_kbytes = RX_RING_BLOCK_SIZE >> 10;
+	cfg->tx_rate_unit = PACER_UNIT_FRAMES;
+	cfg->tx_burst = PACER_MIN_BURST;
+	cfg->capture_format = CAPTURE_FORMAT_PCAP;
+	cfg->replay_speed = 1.0;
+	cfg->backend = LL_BACKEND_PACKET;
+	cfg->probe_mode = PROBE_MODE_NONE;
 	
 	while
-		( ( read = getopt_long(argc, argv, "ehvt:rl:i:f:", args, &index) )
+		( ( read = getopt_long(	argc, argv,
+								"ehvt:rl:i:f:w:o:b:n:N:R:B:u:F:c:g:z:T:p:s:k:K:"
+								"P:ES:M:",
+								args, &index) )
 				> -1 )
 	{
 		
@@ -91,7 +134,7 @@ int read_configuration(int argc, char** argv, configuration_t* cfg)
 			
 				if ( strlen(optarg) > IF_NAMESIZE )
 				{
-					log_app_msg("[WARNING] if_name length = %d, maximum = %d.\
+					log_warning_msg("if_name length = %d, maximum = %d.\
 								TRUNCATING!\n", (int)strlen(optarg), \
 								IF_NAMESIZE);
 				}
@@ -105,6 +148,130 @@ int read_configuration(int argc, char** argv, configuration_t* cfg)
 				log_app_msg("cfg->frame_type = %d\n", cfg->frame_type);
 				break;
 
+			case 'w':
+
+				cfg->no_workers = atoi(optarg);
+				break;
+
+			case 'o':
+
+				if ( ( cfg->fanout_mode = fanout_mode_from_name(optarg) ) < 0 )
+				{
+					handle_app_error("Unknown fanout mode = %s, shall be one \
+of: hash, lb, cpu, rollover.\n", optarg);
+				}
+				break;
+
+			case 'b':
+
+				cfg->batch = atoi(optarg);
+				break;
+
+			case 'n':
+
+				cfg->ring_blocks = atoi(optarg);
+				break;
+
+			case 'N':
+
+				cfg->ring_block_kbytes = atoi(optarg);
+				break;
+
+			case 'R':
+
+				cfg->tx_rate = atof(optarg);
+				cfg->tx_rate_unit = PACER_UNIT_FRAMES;
+				break;
+
+			case 'B':
+
+				cfg->tx_rate = atof(optarg);
+				cfg->tx_rate_unit = PACER_UNIT_BITS;
+				break;
+
+			case 'u':
+
+				cfg->tx_burst = atoi(optarg);
+				break;
+
+			case 'F':
+
+				cfg->filter = optarg;
+				break;
+
+			case 'c':
+
+				cfg->capture = optarg;
+				break;
+
+			case 'g':
+
+				if ( ( cfg->capture_format = capture_format_from_name(optarg) )
+						< 0 )
+				{
+					handle_app_error("Unknown capture format = %s, shall be \
+one of: pcap, pcapng.\n", optarg);
+				}
+				break;
+
+			case 'z':
+
+				cfg->rotate_mbytes = atoi(optarg);
+				break;
+
+			case 'T':
+
+				cfg->rotate_secs = atoi(optarg);
+				break;
+
+			case 'p':
+
+				cfg->is_transmitter = true;
+				cfg->replay = optarg;
+				break;
+
+			case 's':
+
+				cfg->replay_speed = atof(optarg);
+				break;
+
+			case 'k':
+
+				if ( ( cfg->backend = backend_type_from_name(optarg) ) < 0 )
+				{
+					handle_app_error("Unknown backend = %s, shall be one of: \
+packet, pcap, loop.\n", optarg);
+				}
+				break;
+
+			case 'K':
+
+				cfg->backend_file = optarg;
+				break;
+
+			case 'P':
+
+				cfg->is_transmitter = true;
+				cfg->probe_mode = PROBE_MODE_PING;
+				cfg->probe_count = strtoull(optarg, NULL, 10);
+				break;
+
+			case 'E':
+
+				cfg->is_receiver = true;
+				cfg->probe_mode = PROBE_MODE_REFLECT;
+				break;
+
+			case 'S':
+
+				cfg->stats_interval = atof(optarg);
+				break;
+
+			case 'M':
+
+				cfg->metrics = optarg;
+				break;
+
 			case 'e':
 				
 				__verbose = true;
@@ -139,21 +306,59 @@ int check_configuration(configuration_t *cfg)
 		handle_app_error("Configuration to be checked is NULL\n");
 	}
 
-	if ( ! ( cfg->is_transmitter != cfg->is_receiver ) )
+	if ( ( cfg->is_transmitter == false ) && ( cfg->is_receiver == false ) )
 	{
-		handle_app_error("Only TX or RX can be activated at a time.\n");
+		handle_app_error("Either TX, RX or both must be activated.\n");
 	}
 
+	// both at once share a single socket and event loop
+	if ( ( cfg->is_transmitter == true ) && ( cfg->is_receiver == true ) )
+	{
+		if ( cfg->backend != LL_BACKEND_PACKET )
+		{
+			handle_app_error("Full-duplex needs the packet backend.\n");
+		}
+		if ( cfg->probe_mode != PROBE_MODE_NONE )
+		{
+			handle_app_error("Probes are either sent or reflected.\n");
+		}
+	}
+
+	// probes are sent every few ms unless another rate is given
+	if ( ( cfg->probe_mode == PROBE_MODE_PING ) && ( cfg->tx_delay <= 0 ) )
+		{ cfg->tx_delay = PROBE_DELAY_MS; }
+
 	if ( cfg->is_transmitter == true )
 	{
-		if ( ( cfg->tx_delay <= 0 ) || ( cfg->tx_delay > __MAX_TX_DELAY ) )
+		if ( cfg->tx_rate < 0 )
+		{
+			handle_app_error("TX rate must be bigger than 0.\n");
+		}
+
+		// tx_delay (ms) only sets the rate when no explicit rate is given
+		if ( ( cfg->tx_rate == 0 ) && ( cfg->replay == NULL )
+				&& ( ( cfg->tx_delay <= 0 )
+						|| ( cfg->tx_delay > __MAX_TX_DELAY ) ) )
 		{
 			handle_app_error
 				("tx_delay must be bigger than 0 and smaller than %d.\n"
 						, __MAX_TX_DELAY);
 		}
 
-		cfg->tx_delay = __USECS_2_MSECS * cfg->tx_delay;
+		if ( ( cfg->tx_burst < PACER_MIN_BURST )
+				|| ( cfg->tx_burst > __MAX_TX_BURST ) )
+		{
+			handle_app_error("TX burst must be between %d and %d frames.\n"
+						, PACER_MIN_BURST, __MAX_TX_BURST);
+		}
+
+		if ( cfg->replay_speed < 0 )
+		{
+			handle_app_error("Replay speed cannot be < 0.\n");
+		}
+
+		if ( cfg->tx_delay <= 0 )
+			{ cfg->tx_delay = __MAX_TX_DELAY; }
 
 	}
 
@@ -163,11 +368,95 @@ int check_configuration(configuration_t *cfg)
 						, cfg->lsap);
 	}
 	
+	// virtual backends only use the name of the interface for the logs
+	if ( ( cfg->backend == LL_BACKEND_PCAP ) && ( strlen(cfg->if_name) <= 0 ) )
+		{ strncpy(cfg->if_name, "pcap", IF_NAMESIZE); }
+	if ( ( cfg->backend == LL_BACKEND_LOOPBACK )
+			&& ( strlen(cfg->if_name) <= 0 ) )
+		{ strncpy(cfg->if_name, "loop", IF_NAMESIZE); }
+
 	if ( strlen(cfg->if_name) <= 0  )
 	{
 		handle_app_error("Link Layer interface name must be provided.\n");
 	}
 
+	if ( ( cfg->backend == LL_BACKEND_PCAP ) && ( cfg->backend_file == NULL ) )
+	{
+		handle_app_error("pcap backend needs a file (--backend-file).\n");
+	}
+
+	if ( ( cfg->backend == LL_BACKEND_LOOPBACK )
+			&& ( cfg->is_transmitter == false ) )
+	{
+		handle_app_error("loop backend can only be used in TX mode.\n");
+	}
+
+	if ( ( cfg->no_workers <= 0 ) || ( cfg->no_workers > FANOUT_MAX_WORKERS ) )
+	{
+		handle_app_error("Number of workers must be between 1 and %d.\n"
+						, FANOUT_MAX_WORKERS);
+	}
+
+	if ( ( cfg->no_workers > 1 ) && ( cfg->is_transmitter == true ) )
+	{
+		handle_app_error("Several workers are only supported for RX.\n");
+	}
+
+	if ( ( cfg->no_workers > 1 ) && ( cfg->backend != LL_BACKEND_PACKET ) )
+	{
+		handle_app_error("Several workers need the packet backend.\n");
+	}
+
+	if ( ( cfg->capture != NULL ) && ( cfg->is_receiver == false ) )
+	{
+		handle_app_error("Frames can only be captured in RX mode.\n");
+	}
+
+	if ( ( cfg->rotate_mbytes < 0 ) || ( cfg->rotate_secs < 0 ) )
+	{
+		handle_app_error("Capture rotation size and time cannot be < 0.\n");
+	}
+
+	if ( cfg->batch <= 0 )
+	{
+		handle_app_error("Frames per batch must be bigger than 0.\n");
+	}
+
+	if ( ( cfg->ring_blocks <= 0 ) || ( cfg->ring_block_kbytes <= 0 ) )
+	{
+		handle_app_error("RX ring blocks and block size must be > 0.\n");
+	}
+
+	if ( cfg->stats_interval < 0 )
+	{
+		handle_app_error("Statistics interval cannot be < 0.\n");
+	}
+
+	if ( ( cfg->probe_mode == PROBE_MODE_PING ) && ( cfg->probe_count == 0 ) )
+	{
+		handle_app_error("Number of probes must be bigger than 0.\n");
+	}
+
+	if ( cfg->probe_mode != PROBE_MODE_NONE )
+	{
+		// latencies are measured frame by frame, on a live interface
+		if ( ( cfg->batch > 1 ) || ( cfg->replay != NULL )
+				|| ( cfg->capture != NULL ) )
+		{
+			handle_app_error("Probes cannot be batched, replayed or \
+captured.\n");
+		}
+		if ( cfg->backend != LL_BACKEND_PACKET )
+		{
+			handle_app_error("Probes need the packet backend.\n");
+		}
+		if ( cfg->frame_type != IEEE_8023_FRAME )
+		{
+			handle_app_error("Probes are IEEE 802.3 frames (-f %d).\n"
+						, IEEE_8023_FRAME);
+		}
+	}
+
 	if ( cfg->frame_type <= 0  )
 	{
 		log_app_msg("A single type of frame must be selected:\n");
@@ -193,6 +482,36 @@ void print_configuration(const configuration_t *cfg)
 	log_app_msg("\t.is_receiver = %d\n", cfg->is_receiver);
 	log_app_msg("\t.lsap = %d\n", cfg->lsap);
 	log_app_msg("\t.if_name = %s\n", cfg->if_name);
+	log_app_msg("\t.no_workers = %d\n", cfg->no_workers);
+	log_app_msg("\t.fanout_mode = %d\n", cfg->fanout_mode);
+	log_app_msg("\t.batch = %d\n", cfg->batch);
+	log_app_msg("\t.ring = %d x %d kB\n"
+				, cfg->ring_blocks, cfg->ring_block_kbytes);
+	log_app_msg("\t.tx_delay (ms) = %d\n", cfg->tx_delay);
+	log_app_msg("\t.tx_rate = %f %s\n", cfg->tx_rate,
+				( cfg->tx_rate_unit == PACER_UNIT_BITS ) ? "bit/s" : "frames/s");
+	log_app_msg("\t.tx_burst = %d\n", cfg->tx_burst);
+	log_app_msg("\t.filter = %s\n"
+				, ( cfg->filter != NULL ) ? cfg->filter : "(none)");
+	log_app_msg("\t.capture = %s (%s)\n"
+				, ( cfg->capture != NULL ) ? cfg->capture : "(none)"
+				, ( cfg->capture_format == CAPTURE_FORMAT_PCAPNG )
+					? "pcapng" : "pcap");
+	log_app_msg("\t.rotate = %d MB, %d s\n"
+				, cfg->rotate_mbytes, cfg->rotate_secs);
+	log_app_msg("\t.backend = %d (%s)\n", cfg->backend
+				, ( cfg->backend_file != NULL ) ? cfg->backend_file : "-");
+	log_app_msg("\t.replay = %s (x%f)\n"
+				, ( cfg->replay != NULL ) ? cfg->replay : "(none)"
+				, cfg->replay_speed);
+	log_app_msg("\t.probe = %s (%lu)\n"
+				, ( cfg->probe_mode == PROBE_MODE_PING ) ? "ping"
+					: ( cfg->probe_mode == PROBE_MODE_REFLECT ) ? "reflect"
+						: "(none)"
+				, cfg->probe_count);
+	log_app_msg("\t.stats_interval (s) = %f\n", cfg->stats_interval);
+	log_app_msg("\t.metrics = %s\n"
+				, ( cfg->metrics != NULL ) ? cfg->metrics : "(none)");
 	log_app_msg("}\n");
 	
 }
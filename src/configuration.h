@@ -45,6 +45,7 @@ bool __verbose;
 #define __USECS_2_MSECS 		1000	/*!< From msecs to usecs. */
 #define __USECS_2_SECS			1000000	/*!< From usecs to secs. */
 #define __MAX_TX_DELAY			1000	/*!< Maximum ammount of msecs. */
+#define __MAX_TX_BURST			65536	/*!< Maximum burst of frames. */
 
 #define RAW_FRAME				0	/*!< RAW frame is to be read. */
 #define IEEE_8023_FRAME 		1	/*!< IEEE 802.3 frame is to be read. */
@@ -69,6 +70,37 @@ typedef struct configuration
 
 	int frame_type;							/*!< Type of frame to be read. */
 
+	int no_workers;							/*!< Number of RX workers. */
+	int fanout_mode;						/*!< Fanout mode for workers. */
+
+	int batch;								/*!< Frames per RX/TX batch. */
+
+	int ring_blocks;						/*!< Blocks of each RX ring. */
+	int ring_block_kbytes;					/*!< Size of the RX blocks (kB). */
+
+	double tx_rate;							/*!< Target TX rate, 0 = delay. */
+	int tx_rate_unit;						/*!< Unit of the rate (fps/bps). */
+	int tx_burst;							/*!< Frames sent back to back. */
+
+	const char *filter;						/*!< RX filter expression. */
+
+	const char *capture;					/*!< Capture file for RX frames. */
+	int capture_format;						/*!< Format of the capture file. */
+	int rotate_mbytes;						/*!< Capture rotation size (MB). */
+	int rotate_secs;						/*!< Capture rotation age (s). */
+
+	const char *replay;						/*!< Capture file to be sent. */
+	double replay_speed;					/*!< Replay speed, 0 = maximum. */
+
+	int backend;							/*!< I/O backend of the socket. */
+	const char *backend_file;				/*!< Capture file of the backend. */
+
+	int probe_mode;							/*!< Latency probes, pinger/refl. */
+	uint64_t probe_count;					/*!< Probes sent by the pinger. */
+
+	double stats_interval;					/*!< Statistics period (s), 0 off. */
+	const char *metrics;					/*!< Unix socket for the metrics. */
+
 } configuration_t;
 
 #define LEN__T_CONFIGURATION sizeof(configuration_t)	/*!< configuration_t */
@@ -0,0 +1,406 @@
+/*
+ * @file gn_buffer.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/gn_buffer.h"
+
+/* __release_frame */
+static inline void __release_frame(void *frame)
+{
+	if ( frame != NULL )
+		{ release_ll_frame(frame); }
+}
+
+/* __age_unlink */
+static void __age_unlink(gn_buffer_t *b, gn_buffer_entry_t *e)
+{
+
+	cancel_gn_timer(b->wheel, &e->expiry);
+
+	if ( e->prev != GN_BUFFER_NONE )
+		{ b->entries[e->prev].next = e->next; }
+	else
+		{ b->oldest = e->next; }
+	if ( e->next != GN_BUFFER_NONE )
+		{ b->entries[e->next].prev = e->prev; }
+	else
+		{ b->newest = e->prev; }
+
+	b->count--;
+	b->bytes -= e->len;
+
+}
+
+/* __dest_free */
+static void __dest_free(gn_buffer_t *b, const int32_t dest)
+{
+
+	gn_buffer_dest_t *d = &b->dests[dest];
+
+	remove_gn_hash_slot
+		(	b->slots, b->no_slots - 1,
+			find_gn_hash_slot(b->slots, b->no_slots - 1, d->address)	);
+
+	// destinations not in use are chained through their head
+	d->head = b->free_dest;
+	b->free_dest = dest;
+
+}
+
+/* __dest_unlink */
+static void __dest_unlink(gn_buffer_t *b, gn_buffer_entry_t *e)
+{
+
+	gn_buffer_dest_t *d = &b->dests[e->dest];
+
+	if ( e->dest_prev != GN_BUFFER_NONE )
+		{ b->entries[e->dest_prev].dest_next = e->dest_next; }
+	else
+		{ d->head = e->dest_next; }
+	if ( e->dest_next != GN_BUFFER_NONE )
+		{ b->entries[e->dest_next].dest_prev = e->dest_prev; }
+	else
+		{ d->tail = e->dest_prev; }
+
+	if ( d->head == GN_BUFFER_NONE )
+		{ __dest_free(b, e->dest); }
+
+}
+
+/* __entry_free */
+static inline void __entry_free(gn_buffer_t *b, gn_buffer_entry_t *e)
+{
+	// packets not in use are chained through their age links
+	e->next = b->free;
+	b->free = e - b->entries;
+}
+
+/* __drop */
+static void __drop(gn_buffer_t *b, gn_buffer_entry_t *e)
+{
+
+	void *frame = e->frame;
+
+	__age_unlink(b, e);
+	__dest_unlink(b, e);
+	__entry_free(b, e);
+
+	__release_frame(frame);
+
+}
+
+/* __cb_expire */
+static void __cb_expire(gn_timer_t *timer)
+{
+
+	gn_buffer_entry_t *e = (gn_buffer_entry_t *)timer;
+
+	e->buffer->stats.expired++;
+	__drop(e->buffer, e);
+
+}
+
+/* __deliver */
+static int __deliver
+	(gn_buffer_t *b, int32_t i, gn_buffer_cb_t cb, void *arg)
+{
+
+	gn_buffer_entry_t *e = NULL;
+	void *frame = NULL;
+	const void *data = NULL;
+	gn_address_t destination = 0;
+	double now = ev_now(b->wheel->loop), lifetime = 0;
+	int len = 0, flushed = 0;
+
+	// the packets were already taken out and are chained through their age
+	// links, so the function may store packets again while they are given
+	while ( i != GN_BUFFER_NONE )
+	{
+
+		e = &b->entries[i];
+		i = e->next;
+
+		frame = e->frame;
+		data = e->data;
+		len = e->len;
+		destination = e->destination;
+		lifetime = e->expires - now;
+		__entry_free(b, e);
+
+		if ( lifetime <= 0 )
+		{
+			b->stats.expired++;
+			__release_frame(frame);
+			continue;
+		}
+
+		b->stats.flushed++;
+		flushed++;
+		cb(frame, data, len, destination, lifetime, arg);
+
+	}
+
+	return(flushed);
+
+}
+
+/* new_gn_buffer */
+gn_buffer_t *new_gn_buffer()
+{
+
+	gn_buffer_t *b = NULL;
+	b = (gn_buffer_t *)malloc(LEN__GN_BUFFER);
+	memset(b, 0, LEN__GN_BUFFER);
+	return(b);
+
+}
+
+/* init_gn_buffer */
+gn_buffer_t *init_gn_buffer
+	(gn_timer_wheel_t *wheel, const int len, const int size)
+{
+
+	gn_buffer_t *b = NULL;
+	uint32_t no_slots = 1;
+
+	if ( wheel == NULL )
+		{ return(NULL); }
+
+	if ( ( len <= 0 ) || ( size <= 0 ) )
+	{
+		log_app_msg("Wrong packet buffer, len = %d, size = %d.\n"
+						, len, size);
+		return(NULL);
+	}
+
+	// hash table kept at most half full, one destination per packet at most
+	while ( no_slots < 2 * (uint32_t)len )
+		{ no_slots <<= 1; }
+
+	b = new_gn_buffer();
+	b->wheel = wheel;
+	b->len = len;
+	b->size = size;
+	b->no_slots = no_slots;
+	b->oldest = b->newest = GN_BUFFER_NONE;
+
+	b->entries = (gn_buffer_entry_t *)calloc(len, LEN__GN_BUFFER_ENTRY);
+	b->dests = (gn_buffer_dest_t *)calloc(len, LEN__GN_BUFFER_DEST);
+	b->slots = (gn_hash_slot_t *)malloc(no_slots * LEN__GN_HASH_SLOT);
+
+	for ( uint32_t i = 0; i < no_slots; i++ )
+		{ b->slots[i].index = GN_HASH_NONE; }
+
+	for ( int i = 0; i < len; i++ )
+	{
+		init_gn_timer(&b->entries[i].expiry, __cb_expire);
+		b->entries[i].buffer = b;
+		b->entries[i].next = ( i + 1 < len ) ? i + 1 : GN_BUFFER_NONE;
+		b->dests[i].head = ( i + 1 < len ) ? i + 1 : GN_BUFFER_NONE;
+	}
+	b->free = 0;
+	b->free_dest = 0;
+
+	return(b);
+
+}
+
+/* close_gn_buffer */
+int close_gn_buffer(gn_buffer_t *buffer)
+{
+
+	if ( buffer == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	while ( buffer->oldest != GN_BUFFER_NONE )
+		{ __drop(buffer, &buffer->entries[buffer->oldest]); }
+
+	free(buffer->entries);
+	free(buffer->dests);
+	free(buffer->slots);
+	free(buffer);
+
+	return(EX_OK);
+
+}
+
+/* push_gn_buffer */
+int push_gn_buffer
+	(	gn_buffer_t *buffer, const gn_address_t destination,
+		void *frame, const void *data, const int len, const double lifetime	)
+{
+
+	gn_buffer_t *b = buffer;
+	gn_buffer_entry_t *e = NULL;
+	gn_buffer_dest_t *d = NULL;
+	int32_t i = 0, dest = 0, slot = 0;
+
+	if ( ( len > b->size ) || ( lifetime <= 0 ) )
+	{
+		b->stats.dropped_too_long += ( len > b->size );
+		b->stats.expired += ( len <= b->size );
+		__release_frame(frame);
+		return(EX_WRONG_PARAM);
+	}
+
+	// the oldest packets make room for the newest one
+	while (	( b->count >= b->len ) || ( b->bytes + len > b->size )
+			|| ( b->free == GN_BUFFER_NONE ) )
+	{
+
+		// packets still being flushed hold the rest of the block
+		if ( b->oldest == GN_BUFFER_NONE )
+		{
+			b->stats.dropped_oldest++;
+			__release_frame(frame);
+			return(EX_ERR);
+		}
+
+		b->stats.dropped_oldest++;
+		__drop(b, &b->entries[b->oldest]);
+
+	}
+
+	i = b->free;
+	e = &b->entries[i];
+	b->free = e->next;
+
+	e->frame = frame;
+	e->data = data;
+	e->len = len;
+	e->expires = ev_now(b->wheel->loop) + lifetime;
+	e->destination = destination;
+
+	e->next = GN_BUFFER_NONE;
+	e->prev = b->newest;
+	if ( b->newest != GN_BUFFER_NONE )
+		{ b->entries[b->newest].next = i; }
+	else
+		{ b->oldest = i; }
+	b->newest = i;
+
+	if ( ( slot = find_gn_hash_slot(b->slots, b->no_slots - 1, destination) )
+			!= GN_HASH_NONE )
+		{ dest = b->slots[slot].index; }
+	else
+	{
+
+		dest = b->free_dest;
+		d = &b->dests[dest];
+		b->free_dest = d->head;
+
+		d->address = destination;
+		d->head = d->tail = GN_BUFFER_NONE;
+		insert_gn_hash_slot(b->slots, b->no_slots - 1, destination, dest);
+
+	}
+
+	d = &b->dests[dest];
+	e->dest = dest;
+	e->dest_next = GN_BUFFER_NONE;
+	e->dest_prev = d->tail;
+	if ( d->tail != GN_BUFFER_NONE )
+		{ b->entries[d->tail].dest_next = i; }
+	else
+		{ d->head = i; }
+	d->tail = i;
+
+	add_gn_timer(b->wheel, &e->expiry, lifetime);
+
+	b->count++;
+	b->bytes += len;
+	b->stats.buffered++;
+
+	return(EX_OK);
+
+}
+
+/* flush_gn_buffer */
+int flush_gn_buffer
+	(	gn_buffer_t *buffer, const gn_address_t destination,
+		gn_buffer_cb_t cb, void *arg	)
+{
+
+	gn_buffer_t *b = buffer;
+	gn_buffer_entry_t *e = NULL;
+	int32_t slot = 0, dest = 0, head = 0;
+
+	if ( ( slot = find_gn_hash_slot(b->slots, b->no_slots - 1, destination) )
+			== GN_HASH_NONE )
+		{ return(0); }
+
+	dest = b->slots[slot].index;
+	head = b->dests[dest].head;
+
+	// the packets of the destination leave the age order, chained through
+	// their age links instead
+	for ( int32_t i = head; i != GN_BUFFER_NONE; i = e->next )
+	{
+		e = &b->entries[i];
+		__age_unlink(b, e);
+		e->next = e->dest_next;
+	}
+
+	remove_gn_hash_slot(b->slots, b->no_slots - 1, slot);
+	b->dests[dest].head = b->free_dest;
+	b->free_dest = dest;
+
+	return(__deliver(b, head, cb, arg));
+
+}
+
+/* flush_all_gn_buffer */
+int flush_all_gn_buffer(gn_buffer_t *buffer, gn_buffer_cb_t cb, void *arg)
+{
+
+	gn_buffer_t *b = buffer;
+	gn_buffer_entry_t *e = NULL;
+	int32_t head = b->oldest;
+
+	for ( int32_t i = head; i != GN_BUFFER_NONE; i = e->next )
+	{
+		e = &b->entries[i];
+		cancel_gn_timer(b->wheel, &e->expiry);
+		__dest_unlink(b, e);
+	}
+
+	b->oldest = b->newest = GN_BUFFER_NONE;
+	b->count = 0;
+	b->bytes = 0;
+
+	return(__deliver(b, head, cb, arg));
+
+}
+
+/* print_gn_buffer_stats */
+void print_gn_buffer_stats(const gn_buffer_t *buffer, const char *name)
+{
+
+	const gn_buffer_stats_t *s = &buffer->stats;
+
+	log_app_msg(">>> Packet buffer (%s) = \n", name);
+	log_app_msg("\t* packets = %d, bytes = %d\n", buffer->count, buffer->bytes);
+	log_app_msg("\t* buffered = %lu, flushed = %lu, expired = %lu\n"
+				, s->buffered, s->flushed, s->expired);
+	log_app_msg("\t* dropped: oldest = %lu, too_long = %lu\n"
+				, s->dropped_oldest, s->dropped_too_long);
+
+}
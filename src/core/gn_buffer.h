@@ -0,0 +1,247 @@
+/*
+ * @file gn_buffer.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for the GeoNetworking packet buffers
+ * (store-carry-forward): the location service buffer keeps the packets
+ * whose destination has not been located yet, the forwarding buffers the
+ * ones with no neighbour to be forwarded to. Packets are not copied, the
+ * buffers keep the frames of the pool where they were received or built.
+ * The packets are kept within a block of fixed length, chained both in age
+ * order, so that the oldest ones are dropped when the buffer is full, and
+ * per destination, so that all the packets for a station are found at once
+ * when it becomes reachable. Every packet is dropped once its lifetime
+ * expires, through the timer wheel of the protocol.
+ */
+
+#ifndef GN_BUFFER_H_
+#define GN_BUFFER_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "core/gn_position.h"
+#include "core/gn_timer_wheel.h"
+#include "core/gn_hash.h"
+#include "ll_library/ll_frame_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ev.h>
+
+/**************************************************************** DATA TYPES */
+
+#define GN_BUFFER_LEN		256		/*!< Default maximum number of packets. */
+#define GN_LS_BUFFER_SIZE	1048576	/*!< Location service buffer (B). */
+#define GN_UC_BUFFER_SIZE	262144	/*!< Unicast forwarding buffer (B). */
+#define GN_BC_BUFFER_SIZE	1048576	/*!< Broadcast forwarding buffer (B). */
+
+#define GN_BUFFER_NONE		-1		/*!< No packet/destination. */
+
+struct gn_buffer;
+
+/*!
+ * \brief Function that takes a packet flushed from a buffer, together with
+ * 			its frame, which is to be released by it.
+ * \param frame Frame of the pool where the packet is.
+ * \param data First byte of the packet.
+ * \param len Length of the packet (B).
+ * \param destination Destination the packet was buffered for.
+ * \param lifetime Lifetime left to the packet (s).
+ * \param arg Argument given together with this function.
+ */
+typedef void (*gn_buffer_cb_t)
+	(	void *frame, const void *data, const int len,
+		const gn_address_t destination, const double lifetime, void *arg	);
+
+/*!
+ * \struct gn_buffer_entry
+ * \brief Packet within a buffer. The expiry timer is the first field so that
+ * 			its callback gets the packet.
+ */
+typedef struct gn_buffer_entry
+{
+
+	gn_timer_t expiry;				/*!< Drops the packet once expired. */
+	struct gn_buffer *buffer;		/*!< Buffer of the packet. */
+
+	void *frame;					/*!< Frame of the pool, released later. */
+	const void *data;				/*!< First byte of the packet. */
+	int len;						/*!< Length of the packet (B). */
+	double expires;					/*!< End of its lifetime (s, loop time). */
+	gn_address_t destination;		/*!< GN address of its destination. */
+
+	int32_t dest;					/*!< Destination of the packet. */
+	int32_t next;					/*!< Next packet, age order. */
+	int32_t prev;					/*!< Previous packet, age order. */
+	int32_t dest_next;				/*!< Next packet for the destination. */
+	int32_t dest_prev;				/*!< Previous packet for the destination. */
+
+} gn_buffer_entry_t;
+
+#define LEN__GN_BUFFER_ENTRY sizeof(gn_buffer_entry_t)
+
+/*!
+ * \struct gn_buffer_dest
+ * \brief Destination with, at least, one packet within a buffer.
+ */
+typedef struct gn_buffer_dest
+{
+
+	gn_address_t address;			/*!< GN address of the destination. */
+	int32_t head;					/*!< Oldest packet for the destination. */
+	int32_t tail;					/*!< Newest packet for the destination. */
+
+} gn_buffer_dest_t;
+
+#define LEN__GN_BUFFER_DEST sizeof(gn_buffer_dest_t)
+
+/*!
+ * \struct gn_buffer_stats
+ * \brief Counters of the packets that went through a buffer.
+ */
+typedef struct gn_buffer_stats
+{
+
+	uint64_t buffered;				/*!< Packets stored. */
+	uint64_t flushed;				/*!< Packets taken out, reachable. */
+	uint64_t expired;				/*!< Packets dropped, lifetime over. */
+	uint64_t dropped_oldest;		/*!< Packets dropped, room for newer. */
+	uint64_t dropped_too_long;		/*!< Packets longer than the buffer. */
+
+} gn_buffer_stats_t;
+
+/*!
+ * \struct gn_buffer
+ * \brief Packet buffer.
+ */
+typedef struct gn_buffer
+{
+
+	gn_timer_wheel_t *wheel;		/*!< Wheel where packets expire. */
+
+	gn_buffer_entry_t *entries;		/*!< Block with all the packets. */
+	int32_t len;					/*!< Maximum number of packets. */
+	int32_t count;					/*!< Packets stored. */
+	int32_t free;					/*!< First packet not in use. */
+	int32_t oldest;					/*!< Oldest packet stored. */
+	int32_t newest;					/*!< Newest packet stored. */
+	int size;						/*!< Maximum length of all packets (B). */
+	int bytes;						/*!< Length of the packets stored (B). */
+
+	gn_buffer_dest_t *dests;		/*!< Block with all the destinations. */
+	int32_t free_dest;				/*!< First destination not in use. */
+	gn_hash_slot_t *slots;			/*!< Hash table, GN address -> dest. */
+	uint32_t no_slots;				/*!< Slots of the hash table (2^n). */
+
+	gn_buffer_stats_t stats;		/*!< Counters of the buffer. */
+
+} gn_buffer_t;
+
+#define LEN__GN_BUFFER sizeof(gn_buffer_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a packet buffer.
+ * \return A pointer to the newly allocated block of memory.
+ */
+gn_buffer_t *new_gn_buffer();
+
+/*!
+ * \brief Creates an empty packet buffer.
+ * \param wheel Wheel where the packets expire.
+ * \param len Maximum number of packets, bounds the frames of the pool that
+ * 				the buffer may keep.
+ * \param size Maximum length of all the packets together (B).
+ * \return A pointer to the buffer, NULL in case of error.
+ */
+gn_buffer_t *init_gn_buffer
+	(gn_timer_wheel_t *wheel, const int len, const int size);
+
+/*!
+ * \brief Drops all the packets, releasing their frames, and frees the buffer.
+ * \param buffer The buffer to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_gn_buffer(gn_buffer_t *buffer);
+
+/*!
+ * \brief Stores a packet, the buffer takes its frame. If there is no room
+ * 			left, the oldest packets are dropped until there is.
+ * \param buffer The buffer.
+ * \param destination Destination of the packet.
+ * \param frame Frame of the pool where the packet is.
+ * \param data First byte of the packet.
+ * \param len Length of the packet (B).
+ * \param lifetime Lifetime of the packet (s).
+ * \return EX_OK if stored; EX_WRONG_PARAM if the packet is longer than the
+ * 			buffer or its lifetime is over, its frame is released then.
+ */
+int push_gn_buffer
+	(	gn_buffer_t *buffer, const gn_address_t destination,
+		void *frame, const void *data, const int len, const double lifetime	);
+
+/*!
+ * \brief Checks whether there are packets for a destination.
+ * \param buffer The buffer.
+ * \param destination GN address of the destination.
+ * \return true if there is, at least, one packet.
+ */
+static inline bool has_gn_buffer
+	(const gn_buffer_t *buffer, const gn_address_t destination)
+{
+	return( find_gn_hash_slot(	buffer->slots, buffer->no_slots - 1,
+								destination	) != GN_HASH_NONE );
+}
+
+/*!
+ * \brief Takes out all the packets for a destination, oldest first.
+ * \param buffer The buffer.
+ * \param destination GN address of the destination.
+ * \param cb Function that takes each of the packets.
+ * \param arg Argument for that function.
+ * \return Number of packets taken out.
+ */
+int flush_gn_buffer
+	(	gn_buffer_t *buffer, const gn_address_t destination,
+		gn_buffer_cb_t cb, void *arg	);
+
+/*!
+ * \brief Takes out all the packets, oldest first.
+ * \param buffer The buffer.
+ * \param cb Function that takes each of the packets.
+ * \param arg Argument for that function.
+ * \return Number of packets taken out.
+ */
+int flush_all_gn_buffer(gn_buffer_t *buffer, gn_buffer_cb_t cb, void *arg);
+
+/*!
+ * \brief Prints the counters of a buffer.
+ * \param buffer The buffer.
+ * \param name Name of the buffer.
+ */
+void print_gn_buffer_stats(const gn_buffer_t *buffer, const char *name);
+
+#endif /* GN_BUFFER_H_ */
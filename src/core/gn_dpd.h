@@ -0,0 +1,93 @@
+/*
+ * @file gn_dpd.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the duplicate packet detection of GeoNetworking, based
+ * on the sequence numbers of every source: the highest number received and
+ * a bitmap with the ones received right before it. Checking a packet takes
+ * a subtraction, a shift and a mask; the state of each source (16 B) lives
+ * within its entry of the location table, there are no allocations.
+ */
+
+#ifndef GN_DPD_H_
+#define GN_DPD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************************************************************** DATA TYPES */
+
+#define GN_DPD_WINDOW		64		/*!< Sequence numbers remembered. */
+
+/*!
+ * \struct gn_dpd
+ * \brief Sliding window over the sequence numbers of a source.
+ */
+typedef struct gn_dpd
+{
+
+	uint64_t window;				/*!< Bit n, highest - n was received. */
+	uint16_t highest;				/*!< Highest sequence number received. */
+	bool is_set;					/*!< A packet was already received. */
+
+} gn_dpd_t;
+
+#define LEN__GN_DPD sizeof(gn_dpd_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Checks whether a packet of a source was already received and, if
+ * 			not, takes note of it. Sequence numbers wrap around, those older
+ * 			than the window are taken as duplicates.
+ * \param dpd Window of the source.
+ * \param sn Sequence number of the packet.
+ * \return true if the packet is a duplicate.
+ */
+static inline bool check_gn_dpd(gn_dpd_t *dpd, const uint16_t sn)
+{
+
+	int16_t d = (int16_t)( sn - dpd->highest );
+	uint64_t bit = 0;
+
+	if ( ( d > 0 ) || ( dpd->is_set == false ) )
+	{
+		dpd->window = ( ( d > 0 ) && ( d < GN_DPD_WINDOW ) )
+						? ( dpd->window << d ) | 1 : 1;
+		dpd->highest = sn;
+		dpd->is_set = true;
+		return(false);
+	}
+
+	if ( -d >= GN_DPD_WINDOW )
+		{ return(true); }
+
+	bit = 1ULL << -d;
+	if ( dpd->window & bit )
+		{ return(true); }
+
+	dpd->window |= bit;
+	return(false);
+
+}
+
+#endif /* GN_DPD_H_ */
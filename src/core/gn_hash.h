@@ -0,0 +1,151 @@
+/*
+ * @file gn_hash.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the open addressing hash tables shared by the
+ * GeoNetworking tables: 64 bit keys (GN addresses, coordinates) mapped onto
+ * the index of a record within a block, linear probing and deletions that
+ * move the following slots back instead of leaving tombstones.
+ */
+
+#ifndef GN_HASH_H_
+#define GN_HASH_H_
+
+#include <stdint.h>
+
+/**************************************************************** DATA TYPES */
+
+#define GN_HASH_NONE	-1			/*!< Empty slot, key not found. */
+
+/*!
+ * \struct gn_hash_slot
+ * \brief Slot of a hash table.
+ */
+typedef struct gn_hash_slot
+{
+
+	uint64_t key;					/*!< Key of the record. */
+	int32_t index;					/*!< Index of the record, NONE if empty. */
+
+} gn_hash_slot_t;
+
+#define LEN__GN_HASH_SLOT sizeof(gn_hash_slot_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Hashes a key. MAC addresses, and so GN addresses, are far from
+ * 			random, so all the bits of the key are mixed.
+ * \param key The key to be hashed.
+ * \return Hash of the key.
+ */
+static inline uint32_t gn_hash(uint64_t key)
+{
+
+	// finalizer of MurmurHash3
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	key *= 0xC4CEB9FE1A85EC53ULL;
+	key ^= key >> 33;
+
+	return((uint32_t)key);
+
+}
+
+/*!
+ * \brief Finds the slot of a key.
+ * \param slots The table (2^n slots, never full).
+ * \param mask Number of slots minus one.
+ * \param key The key to be found.
+ * \return Slot of the key, NONE if not found.
+ */
+static inline int32_t find_gn_hash_slot
+	(const gn_hash_slot_t *slots, const uint32_t mask, const uint64_t key)
+{
+
+	for ( uint32_t i = gn_hash(key) & mask; ; i = ( i + 1 ) & mask )
+	{
+		if ( slots[i].index == GN_HASH_NONE )
+			{ return(GN_HASH_NONE); }
+		if ( slots[i].key == key )
+			{ return(i); }
+	}
+
+}
+
+/*!
+ * \brief Inserts a key that is not in the table yet.
+ * \param slots The table (2^n slots, never full).
+ * \param mask Number of slots minus one.
+ * \param key The key to be inserted.
+ * \param index Index of its record.
+ */
+static inline void insert_gn_hash_slot
+	(	gn_hash_slot_t *slots, const uint32_t mask,
+		const uint64_t key, const int32_t index	)
+{
+
+	uint32_t i = gn_hash(key) & mask;
+
+	while ( slots[i].index != GN_HASH_NONE )
+		{ i = ( i + 1 ) & mask; }
+
+	slots[i].key = key;
+	slots[i].index = index;
+
+}
+
+/*!
+ * \brief Empties a slot of the table.
+ * \param slots The table (2^n slots, never full).
+ * \param mask Number of slots minus one.
+ * \param i Slot to be emptied, as returned by find_gn_hash_slot.
+ */
+static inline void remove_gn_hash_slot
+	(gn_hash_slot_t *slots, const uint32_t mask, uint32_t i)
+{
+
+	uint32_t j = i, home = 0;
+
+	// no tombstones: the slots that follow are moved back, if allowed
+	for ( ;; )
+	{
+
+		j = ( j + 1 ) & mask;
+		if ( slots[j].index == GN_HASH_NONE )
+			{ break; }
+
+		home = gn_hash(slots[j].key) & mask;
+		if ( ( ( j - home ) & mask ) >= ( ( j - i ) & mask ) )
+		{
+			slots[i] = slots[j];
+			i = j;
+		}
+
+	}
+
+	slots[i].index = GN_HASH_NONE;
+
+}
+
+#endif /* GN_HASH_H_ */
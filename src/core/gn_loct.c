@@ -0,0 +1,476 @@
+/*
+ * @file gn_loct.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/gn_loct.h"
+
+/*!
+ * \struct __cell_bound
+ * \brief Cell of the grid with the distance from a destination to its edge.
+ */
+typedef struct __cell_bound
+{
+	double bound;					/*!< Lower bound of the distance (m). */
+	int32_t cell;					/*!< Cell. */
+} __cell_bound_t;
+
+/* __cell_key */
+static inline uint64_t __cell_key(const int32_t cx, const int32_t cy)
+	{ return( ( (uint64_t)(uint32_t)cx << 32 ) | (uint32_t)cy ); }
+
+/* __grid_remove */
+static void __grid_remove(gn_loct_t *t, gn_loct_entry_t *e)
+{
+
+	gn_loct_cell_t *c = &t->cells[e->cell];
+	int32_t last = 0;
+
+	if ( e->cell_prev != GN_LOCT_NONE )
+		{ t->entries[e->cell_prev].cell_next = e->cell_next; }
+	else
+		{ c->head = e->cell_next; }
+	if ( e->cell_next != GN_LOCT_NONE )
+		{ t->entries[e->cell_next].cell_prev = e->cell_prev; }
+
+	e->cell_next = e->cell_prev = GN_LOCT_NONE;
+
+	if ( --c->count > 0 )
+	{
+		e->cell = GN_LOCT_NONE;
+		return;
+	}
+
+	// empty cells are not visited by the queries
+	remove_gn_hash_slot
+		(	t->cell_slots, t->no_slots - 1,
+			find_gn_hash_slot(	t->cell_slots, t->no_slots - 1,
+								__cell_key(c->cx, c->cy)	)	);
+
+	last = t->active[--t->no_active];
+	t->active[c->active] = last;
+	t->cells[last].active = c->active;
+
+	c->head = t->free_cell;
+	t->free_cell = e->cell;
+	e->cell = GN_LOCT_NONE;
+
+}
+
+/* __grid_update */
+static void __grid_update(gn_loct_t *t, gn_loct_entry_t *e)
+{
+
+	int32_t index = e - t->entries, cx = 0, cy = 0, slot = 0, cell = 0;
+	gn_loct_cell_t *c = NULL;
+
+	// the plane is centered on the first neighbour, stations stay close
+	if ( t->has_ref == false )
+	{
+		t->cos_ref = get_gn_cos_latitude(e->pv.latitude);
+		t->has_ref = true;
+	}
+
+	project_gn_position
+		(t->cos_ref, e->pv.latitude, e->pv.longitude, &e->x, &e->y);
+	cx = (int32_t)floor(e->x / GN_LOCT_CELL);
+	cy = (int32_t)floor(e->y / GN_LOCT_CELL);
+
+	if ( e->cell != GN_LOCT_NONE )
+	{
+		c = &t->cells[e->cell];
+		if ( ( c->cx == cx ) && ( c->cy == cy ) )
+			{ return; }
+		__grid_remove(t, e);
+	}
+
+	if ( ( slot = find_gn_hash_slot
+					(t->cell_slots, t->no_slots - 1, __cell_key(cx, cy)) )
+			!= GN_HASH_NONE )
+		{ cell = t->cell_slots[slot].index; }
+	else
+	{
+
+		// there are never more cells in use than entries
+		cell = t->free_cell;
+		c = &t->cells[cell];
+		t->free_cell = c->head;
+
+		c->cx = cx;
+		c->cy = cy;
+		c->head = GN_LOCT_NONE;
+		c->count = 0;
+		c->active = t->no_active;
+		t->active[t->no_active++] = cell;
+
+		insert_gn_hash_slot
+			(t->cell_slots, t->no_slots - 1, __cell_key(cx, cy), cell);
+
+	}
+
+	c = &t->cells[cell];
+	e->cell = cell;
+	e->cell_prev = GN_LOCT_NONE;
+	e->cell_next = c->head;
+	if ( c->head != GN_LOCT_NONE )
+		{ t->entries[c->head].cell_prev = index; }
+	c->head = index;
+	c->count++;
+
+}
+
+/* __remove_entry */
+static void __remove_entry(gn_loct_t *t, gn_loct_entry_t *e)
+{
+
+	cancel_gn_timer(t->wheel, &e->expiry);
+
+	if ( e->cell != GN_LOCT_NONE )
+		{ __grid_remove(t, e); }
+
+	remove_gn_hash_slot
+		(	t->slots, t->no_slots - 1,
+			find_gn_hash_slot(t->slots, t->no_slots - 1, e->pv.address)	);
+
+	// entries not in use are chained through the links of the grid
+	e->cell_next = t->free;
+	t->free = e - t->entries;
+	t->count--;
+
+}
+
+/* __cb_expire */
+static void __cb_expire(gn_timer_t *timer)
+{
+
+	gn_loct_entry_t *e = (gn_loct_entry_t *)timer;
+	__remove_entry(e->loct, e);
+
+}
+
+/* new_gn_loct */
+gn_loct_t *new_gn_loct()
+{
+
+	gn_loct_t *t = NULL;
+	t = (gn_loct_t *)malloc(LEN__GN_LOCT);
+	memset(t, 0, LEN__GN_LOCT);
+	return(t);
+
+}
+
+/* init_gn_loct */
+gn_loct_t *init_gn_loct
+	(gn_timer_wheel_t *wheel, const int len, const double lifetime)
+{
+
+	gn_loct_t *t = NULL;
+	uint32_t no_slots = 1;
+
+	if ( wheel == NULL )
+		{ return(NULL); }
+
+	if ( ( len <= 0 ) || ( lifetime <= 0 ) )
+	{
+		log_app_msg("Wrong location table, len = %d, lifetime = %f.\n"
+						, len, lifetime);
+		return(NULL);
+	}
+
+	// hash tables are kept at most half full
+	while ( no_slots < 2 * (uint32_t)len )
+		{ no_slots <<= 1; }
+
+	t = new_gn_loct();
+	t->wheel = wheel;
+	t->lifetime = lifetime;
+	t->len = len;
+	t->no_slots = no_slots;
+
+	t->entries = (gn_loct_entry_t *)calloc(len, LEN__GN_LOCT_ENTRY);
+	t->cells = (gn_loct_cell_t *)calloc(len, LEN__GN_LOCT_CELL);
+	t->active = (int32_t *)calloc(len, sizeof(int32_t));
+	t->scratch = calloc(len, sizeof(__cell_bound_t));
+	t->slots = (gn_hash_slot_t *)malloc(no_slots * LEN__GN_HASH_SLOT);
+	t->cell_slots = (gn_hash_slot_t *)malloc(no_slots * LEN__GN_HASH_SLOT);
+
+	for ( uint32_t i = 0; i < no_slots; i++ )
+	{
+		t->slots[i].index = GN_HASH_NONE;
+		t->cell_slots[i].index = GN_HASH_NONE;
+	}
+
+	for ( int i = 0; i < len; i++ )
+	{
+		t->entries[i].cell_next = ( i + 1 < len ) ? i + 1 : GN_LOCT_NONE;
+		t->cells[i].head = ( i + 1 < len ) ? i + 1 : GN_LOCT_NONE;
+	}
+	t->free = 0;
+	t->free_cell = 0;
+
+	return(t);
+
+}
+
+/* close_gn_loct */
+int close_gn_loct(gn_loct_t *loct)
+{
+
+	if ( loct == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	for ( int i = 0; i < loct->len; i++ )
+		{ cancel_gn_timer(loct->wheel, &loct->entries[i].expiry); }
+
+	free(loct->entries);
+	free(loct->cells);
+	free(loct->active);
+	free(loct->scratch);
+	free(loct->slots);
+	free(loct->cell_slots);
+	free(loct);
+
+	return(EX_OK);
+
+}
+
+/* find_gn_loct */
+gn_loct_entry_t *find_gn_loct
+	(const gn_loct_t *loct, const gn_address_t address)
+{
+
+	int32_t slot = find_gn_hash_slot(loct->slots, loct->no_slots - 1, address);
+
+	if ( slot == GN_HASH_NONE )
+		{ return(NULL); }
+
+	return(&loct->entries[loct->slots[slot].index]);
+
+}
+
+/* update_gn_loct */
+gn_loct_entry_t *update_gn_loct
+	(gn_loct_t *loct, const gn_lpv_t *pv, const bool is_neighbour)
+{
+
+	gn_loct_entry_t *e = find_gn_loct(loct, pv->address);
+	bool moved = false;
+
+	if ( e == NULL )
+	{
+
+		if ( loct->free == GN_LOCT_NONE )
+		{
+			loct->overflows++;
+			return(NULL);
+		}
+
+		e = &loct->entries[loct->free];
+		loct->free = e->cell_next;
+		loct->count++;
+
+		memset(e, 0, LEN__GN_LOCT_ENTRY);
+		init_gn_timer(&e->expiry, __cb_expire);
+		e->loct = loct;
+		e->pv = *pv;
+		e->cell = e->cell_next = e->cell_prev = GN_LOCT_NONE;
+		e->pdr_updated = ev_time();
+		get_gn_address_mid(pv->address, e->ll_address);
+
+		insert_gn_hash_slot(	loct->slots, loct->no_slots - 1,
+								pv->address, e - loct->entries	);
+		moved = true;
+
+	}
+	else if ( is_gn_tst_newer(pv->tst, e->pv.tst) == true )
+	{
+		e->pv = *pv;
+		moved = true;
+	}
+
+	if ( ( is_neighbour == true ) && ( e->is_neighbour == false ) )
+	{
+		e->is_neighbour = true;
+		moved = true;
+	}
+
+	if ( ( moved == true ) && ( e->is_neighbour == true ) )
+		{ __grid_update(loct, e); }
+
+	e->updated = ev_now(loct->wheel->loop);
+	add_gn_timer(loct->wheel, &e->expiry, loct->lifetime);
+
+	return(e);
+
+}
+
+/* update_gn_loct_pdr */
+void update_gn_loct_pdr(gn_loct_entry_t *entry, const int len)
+{
+
+	double now = ev_time(), dt = now - entry->pdr_updated;
+
+	// packets of a burst are read within the same instant
+	if ( dt <= 0 )
+		{ return; }
+
+	entry->pdr = GN_LOCT_PDR_BETA * entry->pdr
+					+ ( 1 - GN_LOCT_PDR_BETA ) * ( len / dt );
+	entry->pdr_updated = now;
+
+}
+
+/* is_duplicate_gn_loct */
+bool is_duplicate_gn_loct
+	(gn_loct_t *loct, gn_loct_entry_t *source, const uint16_t sn)
+{
+
+	if ( ( source == NULL ) || ( check_gn_dpd(&source->dpd, sn) == false ) )
+		{ return(false); }
+
+	loct->duplicates++;
+	return(true);
+
+}
+
+/* remove_gn_loct */
+int remove_gn_loct(gn_loct_t *loct, const gn_address_t address)
+{
+
+	gn_loct_entry_t *e = find_gn_loct(loct, address);
+
+	if ( e == NULL )
+		{ return(EX_WRONG_PARAM); }
+
+	__remove_entry(loct, e);
+	return(EX_OK);
+
+}
+
+/* __heap_down */
+static void __heap_down(__cell_bound_t *heap, const int n, int i)
+{
+
+	__cell_bound_t tmp;
+	int child = 0;
+
+	while ( ( child = 2 * i + 1 ) < n )
+	{
+
+		if ( ( child + 1 < n ) && ( heap[child + 1].bound < heap[child].bound ) )
+			{ child++; }
+		if ( heap[i].bound <= heap[child].bound )
+			{ break; }
+
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+
+	}
+
+}
+
+/* __insert_closest */
+static int __insert_closest
+	(	gn_loct_neighbour_t *closest, int found, const int max,
+		gn_loct_entry_t *e, const double distance	)
+{
+
+	int i = found;
+
+	// the farthest one is replaced once the array is full
+	if ( found == max )
+	{
+		if ( distance >= closest[max - 1].distance )
+			{ return(found); }
+		i = max - 1;
+	}
+	else
+		{ found++; }
+
+	for ( ; ( i > 0 ) && ( closest[i - 1].distance > distance ); i-- )
+		{ closest[i] = closest[i - 1]; }
+
+	closest[i].entry = e;
+	closest[i].distance = distance;
+
+	return(found);
+
+}
+
+/* get_closest_gn_loct */
+int get_closest_gn_loct
+	(	gn_loct_t *loct, const int32_t latitude, const int32_t longitude,
+		gn_loct_neighbour_t *closest, const int max	)
+{
+
+	__cell_bound_t *heap = (__cell_bound_t *)loct->scratch;
+	gn_loct_cell_t *c = NULL;
+	gn_loct_entry_t *e = NULL;
+	double x = 0, y = 0, dx = 0, dy = 0;
+	int n = loct->no_active, found = 0;
+
+	if ( ( max <= 0 ) || ( n == 0 ) )
+		{ return(0); }
+
+	project_gn_position(loct->cos_ref, latitude, longitude, &x, &y);
+
+	// 1) distance from the destination to the closest edge of every cell
+	for ( int i = 0; i < n; i++ )
+	{
+
+		c = &loct->cells[loct->active[i]];
+		dx = fmax(	fmax(c->cx * GN_LOCT_CELL - x, 0),
+					x - ( c->cx + 1 ) * GN_LOCT_CELL	);
+		dy = fmax(	fmax(c->cy * GN_LOCT_CELL - y, 0),
+					y - ( c->cy + 1 ) * GN_LOCT_CELL	);
+
+		heap[i].bound = sqrt(dx * dx + dy * dy);
+		heap[i].cell = loct->active[i];
+
+	}
+
+	for ( int i = n / 2 - 1; i >= 0; i-- )
+		{ __heap_down(heap, n, i); }
+
+	// 2) cells are visited closest first, until none can hold a closer one
+	while ( n > 0 )
+	{
+
+		if ( ( found == max ) && ( heap[0].bound >= closest[max - 1].distance ) )
+			{ break; }
+
+		c = &loct->cells[heap[0].cell];
+		for ( int32_t i = c->head; i != GN_LOCT_NONE; i = e->cell_next )
+		{
+			e = &loct->entries[i];
+			found = __insert_closest(	closest, found, max, e,
+										hypot(e->x - x, e->y - y)	);
+		}
+
+		heap[0] = heap[--n];
+		__heap_down(heap, n, 0);
+
+	}
+
+	return(found);
+
+}
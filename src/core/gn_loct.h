@@ -0,0 +1,246 @@
+/*
+ * @file gn_loct.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for the GeoNetworking location table
+ * (LocT): one entry per station heard, with its last position vector. The
+ * entries are kept within a single block, found through an open addressing
+ * hash table on their GN address and expired through a timer wheel. The
+ * neighbours are also indexed by a grid of cells on a local plane, so that
+ * the ones closest to a destination are found visiting the cells closest to
+ * it first, instead of all the neighbours.
+ */
+
+#ifndef GN_LOCT_H_
+#define GN_LOCT_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "core/gn_position.h"
+#include "core/gn_timer_wheel.h"
+#include "core/gn_dpd.h"
+#include "core/gn_hash.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <net/ethernet.h>
+#include <ev.h>
+
+/**************************************************************** DATA TYPES */
+
+#define GN_LOCT_LEN			32768	/*!< Default maximum number of entries. */
+#define GN_LOCT_LIFETIME	20.0	/*!< Lifetime of an entry (s). */
+#define GN_LOCT_CELL		250.0	/*!< Side of the cells of the grid (m). */
+#define GN_LOCT_PDR_BETA	0.9		/*!< Weight of the past within the PDR. */
+
+#define GN_LOCT_NONE		-1		/*!< No entry/cell. */
+
+struct gn_loct;
+
+/*!
+ * \struct gn_loct_entry
+ * \brief Entry of the location table. The expiry timer is the first field
+ * 			so that its callback gets the entry.
+ */
+typedef struct gn_loct_entry
+{
+
+	gn_timer_t expiry;				/*!< Removes the entry once expired. */
+	struct gn_loct *loct;			/*!< Table of the entry. */
+
+	gn_lpv_t pv;					/*!< Last position vector of the station. */
+	uint8_t ll_address[ETH_ALEN];	/*!< Link layer address of the station. */
+	bool is_neighbour;				/*!< Heard directly, within range. */
+	bool ls_pending;				/*!< Location service request pending. */
+
+	double updated;					/*!< Last update (s, loop time). */
+	double pdr;						/*!< Packet data rate (B/s), average. */
+	double pdr_updated;				/*!< Last packet counted by the PDR (s). */
+	gn_dpd_t dpd;					/*!< Duplicate packet detection. */
+
+	double x;						/*!< Position on the plane of the grid. */
+	double y;						/*!< Position on the plane of the grid. */
+	int32_t cell;					/*!< Cell of a neighbour, or NONE. */
+	int32_t cell_next;				/*!< Next neighbour within the cell. */
+	int32_t cell_prev;				/*!< Previous neighbour within the cell. */
+
+} gn_loct_entry_t;
+
+#define LEN__GN_LOCT_ENTRY sizeof(gn_loct_entry_t)
+
+/*!
+ * \struct gn_loct_cell
+ * \brief Cell of the grid with, at least, one neighbour.
+ */
+typedef struct gn_loct_cell
+{
+
+	int32_t cx;						/*!< Column of the cell. */
+	int32_t cy;						/*!< Row of the cell. */
+	int32_t head;					/*!< First neighbour within the cell. */
+	int32_t count;					/*!< Neighbours within the cell. */
+	int32_t active;					/*!< Position within the active cells. */
+
+} gn_loct_cell_t;
+
+#define LEN__GN_LOCT_CELL sizeof(gn_loct_cell_t)
+
+/*!
+ * \struct gn_loct_neighbour
+ * \brief Neighbour found by a query, with its distance to the destination.
+ */
+typedef struct gn_loct_neighbour
+{
+
+	gn_loct_entry_t *entry;			/*!< Entry of the neighbour. */
+	double distance;				/*!< Distance to the destination (m). */
+
+} gn_loct_neighbour_t;
+
+/*!
+ * \struct gn_loct
+ * \brief Location table.
+ */
+typedef struct gn_loct
+{
+
+	gn_timer_wheel_t *wheel;		/*!< Wheel where entries expire. */
+	double lifetime;				/*!< Lifetime of the entries (s). */
+
+	gn_loct_entry_t *entries;		/*!< Block with all the entries. */
+	int32_t len;					/*!< Maximum number of entries. */
+	int32_t count;					/*!< Entries in use. */
+	int32_t free;					/*!< First entry not in use. */
+
+	gn_hash_slot_t *slots;			/*!< Hash table, GN address -> entry. */
+	uint32_t no_slots;				/*!< Slots of the hash tables (2^n). */
+
+	double cos_ref;					/*!< Reference of the plane of the grid. */
+	bool has_ref;					/*!< The reference is set. */
+	gn_loct_cell_t *cells;			/*!< Block with all the cells. */
+	gn_hash_slot_t *cell_slots;		/*!< Hash table, coordinates -> cell. */
+	int32_t *active;				/*!< Cells with neighbours. */
+	int32_t no_active;				/*!< Number of cells with neighbours. */
+	int32_t free_cell;				/*!< First cell not in use. */
+	void *scratch;					/*!< Cells sorted by a query. */
+
+	uint64_t overflows;				/*!< Stations not added, table full. */
+	uint64_t duplicates;			/*!< Duplicate packets detected. */
+
+} gn_loct_t;
+
+#define LEN__GN_LOCT sizeof(gn_loct_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a location table.
+ * \return A pointer to the newly allocated block of memory.
+ */
+gn_loct_t *new_gn_loct();
+
+/*!
+ * \brief Creates an empty location table.
+ * \param wheel Wheel where the entries expire.
+ * \param len Maximum number of entries.
+ * \param lifetime Time an entry is kept after its last update (s).
+ * \return A pointer to the table, NULL in case of error.
+ */
+gn_loct_t *init_gn_loct
+	(gn_timer_wheel_t *wheel, const int len, const double lifetime);
+
+/*!
+ * \brief Removes all the entries from the wheel and frees the table.
+ * \param loct The table to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_gn_loct(gn_loct_t *loct);
+
+/*!
+ * \brief Finds the entry of a station.
+ * \param loct The location table.
+ * \param address GN address of the station.
+ * \return The entry, NULL if the station is not in the table.
+ */
+gn_loct_entry_t *find_gn_loct
+	(const gn_loct_t *loct, const gn_address_t address);
+
+/*!
+ * \brief Adds the station of the position vector to the table, or updates
+ * 			it, restarting the lifetime of its entry. The position vector is
+ * 			only taken if newer than the one of the entry.
+ * \param loct The location table.
+ * \param pv Position vector of the station.
+ * \param is_neighbour The station was heard directly; otherwise, the flag
+ * 						of the entry is kept.
+ * \return The entry of the station, NULL if the table is full.
+ */
+gn_loct_entry_t *update_gn_loct
+	(gn_loct_t *loct, const gn_lpv_t *pv, const bool is_neighbour);
+
+/*!
+ * \brief Counts a packet of the station within its packet data rate.
+ * \param entry Entry of the station.
+ * \param len Length of the packet (B).
+ */
+void update_gn_loct_pdr(gn_loct_entry_t *entry, const int len);
+
+/*!
+ * \brief Checks whether a packet was already received from its source. The
+ * 			entry of the source is to be updated first (update_gn_loct()),
+ * 			so that the first packet of a station is remembered as well.
+ * \param loct The location table.
+ * \param source Entry of the source of the packet, NULL if not added.
+ * \param sn Sequence number of the packet.
+ * \return true if the packet is a duplicate.
+ */
+bool is_duplicate_gn_loct
+	(gn_loct_t *loct, gn_loct_entry_t *source, const uint16_t sn);
+
+/*!
+ * \brief Removes the entry of a station before it expires.
+ * \param loct The location table.
+ * \param address GN address of the station.
+ * \return EX_OK if removed, EX_WRONG_PARAM if not in the table.
+ */
+int remove_gn_loct(gn_loct_t *loct, const gn_address_t address);
+
+/*!
+ * \brief Finds the neighbours closest to a destination, visiting the cells
+ * 			of the grid in order of distance to it until no closer neighbour
+ * 			might be found.
+ * \param loct The location table.
+ * \param latitude Latitude of the destination (1/10 micro-degree).
+ * \param longitude Longitude of the destination (1/10 micro-degree).
+ * \param closest Array where the neighbours are written, closest first.
+ * \param max Maximum number of neighbours to be found.
+ * \return Number of neighbours found.
+ */
+int get_closest_gn_loct
+	(	gn_loct_t *loct, const int32_t latitude, const int32_t longitude,
+		gn_loct_neighbour_t *closest, const int max	);
+
+#endif /* GN_LOCT_H_ */
@@ -0,0 +1,51 @@
+/*
+ * @file gn_position.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/gn_position.h"
+
+/* get_gn_address_mid */
+void get_gn_address_mid(const gn_address_t address, uint8_t *mac)
+{
+
+	const uint64_t mid = address & GN_ADDR_MID_MASK;
+
+	for ( int i = 0; i < 6; i++ )
+		{ mac[i] = ( mid >> ( 8 * ( 5 - i ) ) ) & 0xFF; }
+
+}
+
+/* get_gn_distance */
+double get_gn_distance
+	(	const int32_t lat_a, const int32_t long_a,
+		const int32_t lat_b, const int32_t long_b	)
+{
+
+	const double to_rad = M_PI / 180.0 / GN_DEGREE_UNITS;
+	double d_lat = ( lat_b - (double)lat_a ) * to_rad;
+	double d_long = ( long_b - (double)long_a ) * to_rad;
+	double a = sin(d_lat / 2) * sin(d_lat / 2)
+				+ cos(lat_a * to_rad) * cos(lat_b * to_rad)
+					* sin(d_long / 2) * sin(d_long / 2);
+
+	return( 2 * GN_EARTH_RADIUS * atan2(sqrt(a), sqrt(1 - a)) );
+
+}
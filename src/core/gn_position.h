@@ -0,0 +1,129 @@
+/*
+ * @file gn_position.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the GeoNetworking addresses and position vectors (ETSI
+ * EN 302 636-4-1), in host byte order; and the distances between them.
+ */
+
+#ifndef GN_POSITION_H_
+#define GN_POSITION_H_
+
+#include "execution_codes.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+/**************************************************************** DATA TYPES */
+
+/*!
+ * \brief GN address: M (1 bit), ST (5 bits), reserved (10 bits) and the
+ * 			MID (48 bits, the MAC address), most significant bit first.
+ */
+typedef uint64_t gn_address_t;
+
+#define GN_ADDR_MID_MASK	0x0000FFFFFFFFFFFFULL	/*!< MID of the address. */
+#define GN_ADDR_ST_SHIFT	58						/*!< ST of the address. */
+#define GN_ADDR_ST_MASK		0x1F					/*!< ST, once shifted. */
+
+#define GN_EARTH_RADIUS		6371000.0		/*!< Mean radius (m). */
+#define GN_DEGREE_UNITS		10000000.0		/*!< 1/10 micro-degree units. */
+
+/*!
+ * \brief Meters along a meridian of one unit of latitude (1/10 micro-deg).
+ */
+#define GN_UNIT_METERS		( GN_EARTH_RADIUS * M_PI / 180.0 / GN_DEGREE_UNITS )
+
+/*!
+ * \struct gn_lpv
+ * \brief Long position vector of a station.
+ */
+typedef struct gn_lpv
+{
+
+	gn_address_t address;		/*!< GN address of the station. */
+	uint32_t tst;				/*!< Time of the position (ms, TAI mod 2^32). */
+	int32_t latitude;			/*!< Latitude (1/10 micro-degree). */
+	int32_t longitude;			/*!< Longitude (1/10 micro-degree). */
+	bool pai;					/*!< Position accuracy indicator. */
+	int16_t speed;				/*!< Speed (0.01 m/s), 15 bits. */
+	uint16_t heading;			/*!< Heading (0.1 degree from North). */
+
+} gn_lpv_t;
+
+#define LEN__GN_LPV sizeof(gn_lpv_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Gets the MAC address of the station within a GN address.
+ * \param address The GN address.
+ * \param mac Buffer where the 6 bytes of the MAC are written.
+ */
+void get_gn_address_mid(const gn_address_t address, uint8_t *mac);
+
+/*!
+ * \brief Compares the timestamps of two position vectors, which wrap around
+ * 			every 2^32 ms.
+ * \return true if tst_a is newer than tst_b.
+ */
+static inline bool is_gn_tst_newer(const uint32_t tst_a, const uint32_t tst_b)
+{
+	return(	( tst_a != tst_b )
+			&& ( (uint32_t)( tst_a - tst_b ) < 0x80000000U )	);
+}
+
+/*!
+ * \brief Projects a position to a local plane (m), equirectangular around
+ * 			the given latitude: good enough within the range of a radio.
+ * \param cos_ref Cosine of the reference latitude of the plane.
+ * \param latitude Latitude (1/10 micro-degree).
+ * \param longitude Longitude (1/10 micro-degree).
+ * \param x Set to the distance towards East (m).
+ * \param y Set to the distance towards North (m).
+ */
+static inline void project_gn_position
+	(	const double cos_ref, const int32_t latitude, const int32_t longitude,
+		double *x, double *y	)
+{
+	*x = longitude * GN_UNIT_METERS * cos_ref;
+	*y = latitude * GN_UNIT_METERS;
+}
+
+/*!
+ * \brief Gets the cosine of the given latitude, for project_gn_position().
+ * \param latitude Latitude (1/10 micro-degree).
+ * \return The cosine of the latitude.
+ */
+static inline double get_gn_cos_latitude(const int32_t latitude)
+	{ return(cos(latitude / GN_DEGREE_UNITS * M_PI / 180.0)); }
+
+/*!
+ * \brief Distance between two positions along the surface (haversine).
+ * \return Distance (m).
+ */
+double get_gn_distance
+	(	const int32_t lat_a, const int32_t long_a,
+		const int32_t lat_b, const int32_t long_b	);
+
+#endif /* GN_POSITION_H_ */
@@ -7,9 +7,112 @@
 
 #include "gn_statemachine.h"
 
-int init_statemachine()
+/* new_statemachine */
+gn_statemachine_t *new_statemachine()
 {
 
+	gn_statemachine_t *sm = NULL;
+	sm = (gn_statemachine_t *)malloc(LEN__GN_STATEMACHINE);
+	memset(sm, 0, LEN__GN_STATEMACHINE);
+	return(sm);
+
+}
+
+/* init_statemachine */
+gn_statemachine_t *init_statemachine
+	(struct ev_loop *loop, const gn_address_t address)
+{
+
+	gn_statemachine_t *sm = NULL;
+
+	if ( loop == NULL )
+		{ return(NULL); }
+
+	sm = new_statemachine();
+	sm->address = address;
+	sm->loop = loop;
+
+	if ( ( sm->wheel = init_gn_timer_wheel(loop, GN_WHEEL_TICK) ) == NULL )
+		{ close_statemachine(sm); return(NULL); }
+
+	if ( ( sm->loct = init_gn_loct
+							(sm->wheel, GN_LOCT_LEN, GN_LOCT_LIFETIME) ) == NULL )
+		{ close_statemachine(sm); return(NULL); }
+
+	// all the buffers together keep less frames than a pool has
+	if ( ( sm->ls_buffer = init_gn_buffer
+							(sm->wheel, GN_BUFFER_LEN, GN_LS_BUFFER_SIZE) )
+			== NULL )
+		{ close_statemachine(sm); return(NULL); }
+	if ( ( sm->uc_buffer = init_gn_buffer
+							(sm->wheel, GN_BUFFER_LEN, GN_UC_BUFFER_SIZE) )
+			== NULL )
+		{ close_statemachine(sm); return(NULL); }
+	if ( ( sm->bc_buffer = init_gn_buffer
+							(sm->wheel, GN_BUFFER_LEN, GN_BC_BUFFER_SIZE) )
+			== NULL )
+		{ close_statemachine(sm); return(NULL); }
+
+	return(sm);
+
+}
+
+/* close_statemachine */
+int close_statemachine(gn_statemachine_t *sm)
+{
+
+	if ( sm == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	// entries are taken out of the wheel before it goes away; a state only
+	// partially created by init_statemachine has the rest still NULL
+	close_gn_buffer(sm->ls_buffer);
+	close_gn_buffer(sm->uc_buffer);
+	close_gn_buffer(sm->bc_buffer);
+	close_gn_loct(sm->loct);
+	close_gn_timer_wheel(sm->wheel);
+	free(sm);
+
 	return(EX_OK);
 
 }
+
+/* set_statemachine_flush */
+void set_statemachine_flush
+	(gn_statemachine_t *sm, gn_buffer_cb_t cb, void *arg)
+{
+	sm->cb_flush = cb;
+	sm->cb_arg = arg;
+}
+
+/* update_statemachine_loct */
+gn_loct_entry_t *update_statemachine_loct
+	(gn_statemachine_t *sm, const gn_lpv_t *pv, const bool is_neighbour)
+{
+
+	gn_loct_entry_t *e = find_gn_loct(sm->loct, pv->address);
+	bool was_neighbour = ( e != NULL ) && ( e->is_neighbour == true );
+
+	if ( ( e = update_gn_loct(sm->loct, pv, is_neighbour) ) == NULL )
+		{ return(NULL); }
+
+	if ( sm->cb_flush == NULL )
+		{ return(e); }
+
+	// the buffers are only looked up by destination, never scanned
+	if ( has_gn_buffer(sm->ls_buffer, pv->address) == true )
+	{
+		e->ls_pending = false;
+		flush_gn_buffer(sm->ls_buffer, pv->address, sm->cb_flush, sm->cb_arg);
+	}
+
+	if ( ( e->is_neighbour == false ) || ( was_neighbour == true ) )
+		{ return(e); }
+
+	flush_gn_buffer(sm->uc_buffer, pv->address, sm->cb_flush, sm->cb_arg);
+	if ( sm->bc_buffer->count > 0 )
+		{ flush_all_gn_buffer(sm->bc_buffer, sm->cb_flush, sm->cb_arg); }
+
+	return(e);
+
+}
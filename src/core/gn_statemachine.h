@@ -10,4 +10,81 @@
 
 #include <execution_codes.h>
 
+#include "core/gn_position.h"
+#include "core/gn_timer_wheel.h"
+#include "core/gn_loct.h"
+#include "core/gn_buffer.h"
+
+#include <ev.h>
+
+/*!
+ * \struct gn_statemachine
+ * \brief State of the GeoNetworking protocol of a station.
+ */
+typedef struct gn_statemachine
+{
+
+	gn_address_t address;			/*!< GN address of the station. */
+	struct ev_loop *loop;			/*!< Loop of the socket of the station. */
+
+	gn_timer_wheel_t *wheel;		/*!< Timers of the protocol. */
+	gn_loct_t *loct;				/*!< Location table. */
+
+	gn_buffer_t *ls_buffer;			/*!< Packets waiting for a location. */
+	gn_buffer_t *uc_buffer;			/*!< Unicast packets, no next hop. */
+	gn_buffer_t *bc_buffer;			/*!< Broadcast packets, no neighbour. */
+	gn_buffer_cb_t cb_flush;		/*!< Takes the packets flushed. */
+	void *cb_arg;					/*!< Argument for that function. */
+
+} gn_statemachine_t;
+
+#define LEN__GN_STATEMACHINE sizeof(gn_statemachine_t)
+
+/*!
+ * \brief Allocates memory for the state of the protocol.
+ * \return A pointer to the newly allocated block of memory.
+ */
+gn_statemachine_t *new_statemachine();
+
+/*!
+ * \brief Creates the state of the GeoNetworking protocol of a station, its
+ * 			timers run within the loop of its socket.
+ * \param loop Loop of the socket of the station.
+ * \param address GN address of the station.
+ * \return A pointer to the state, NULL in case of error.
+ */
+gn_statemachine_t *init_statemachine
+	(struct ev_loop *loop, const gn_address_t address);
+
+/*!
+ * \brief Frees the state of the protocol, its timers are cancelled.
+ * \param sm The state to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_statemachine(gn_statemachine_t *sm);
+
+/*!
+ * \brief Sets the function that takes the packets flushed from the buffers
+ * 			once their destinations become reachable; without it, buffered
+ * 			packets are only dropped.
+ * \param sm The state of the protocol.
+ * \param cb Function that takes the packets, and their frames.
+ * \param arg Argument for that function.
+ */
+void set_statemachine_flush
+	(gn_statemachine_t *sm, gn_buffer_cb_t cb, void *arg);
+
+/*!
+ * \brief Updates the location table with a position vector received,
+ * 			flushing the packets that were waiting for the station: the
+ * 			ones for which its location was unknown, and, if it became a
+ * 			neighbour, the unicast ones for it plus all the broadcast ones.
+ * \param sm The state of the protocol.
+ * \param pv Position vector of the station.
+ * \param is_neighbour The station was heard directly.
+ * \return The entry of the station, NULL if the table is full.
+ */
+gn_loct_entry_t *update_statemachine_loct
+	(gn_statemachine_t *sm, const gn_lpv_t *pv, const bool is_neighbour);
+
 #endif /* GN_STATEMACHINE_H_ */
@@ -0,0 +1,359 @@
+/*
+ * @file gn_timer_wheel.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/gn_timer_wheel.h"
+
+#define __MASK		( GN_WHEEL_SLOTS - 1 )		/*!< Slot within a level. */
+
+/* __wheel_time */
+static inline double __wheel_time()
+{
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return( now.tv_sec + now.tv_nsec / 1e9 );
+
+}
+
+/* __wheel_ticks */
+static inline uint64_t __wheel_ticks(const gn_timer_wheel_t *w)
+	{ return( (uint64_t)floor(__wheel_time() / w->tick) ); }
+
+/* __wheel_ticks_ceil */
+static inline uint64_t __wheel_ticks_ceil(const gn_timer_wheel_t *w)
+	{ return( (uint64_t)ceil(__wheel_time() / w->tick) ); }
+
+/* __unlink */
+static inline void __unlink(gn_timer_wheel_t *w, gn_timer_t *t)
+{
+
+	gn_timer_t *head = &w->slots[t->slot];
+
+	t->prev->next = t->next;
+	t->next->prev = t->prev;
+	t->next = t->prev = NULL;
+
+	if ( head->next == head )
+	{
+		w->occupied[t->slot / GN_WHEEL_SLOTS]
+			&= ~( 1ULL << ( t->slot & __MASK ) );
+	}
+
+}
+
+/* __place */
+static void __place(gn_timer_wheel_t *w, gn_timer_t *t)
+{
+
+	gn_timer_t *head = NULL;
+	uint64_t group = t->expires;
+	int level = 0, shift = 0;
+
+	// the lowest level where it is less than a turn away, later ones wait
+	// within the last slot of the highest level and are placed again
+	for ( ; level < GN_WHEEL_LEVELS; level++, shift += GN_WHEEL_BITS )
+	{
+		group = t->expires >> shift;
+		if ( group - ( w->now >> shift ) < GN_WHEEL_SLOTS )
+			{ break; }
+	}
+
+	if ( level == GN_WHEEL_LEVELS )
+	{
+		level = GN_WHEEL_LEVELS - 1;
+		shift -= GN_WHEEL_BITS;
+		group = ( w->now >> shift ) + __MASK;
+	}
+
+	t->slot = level * GN_WHEEL_SLOTS + ( group & __MASK );
+	w->occupied[level] |= 1ULL << ( group & __MASK );
+
+	head = &w->slots[t->slot];
+	t->prev = head->prev;
+	t->next = head;
+	head->prev->next = t;
+	head->prev = t;
+
+}
+
+/* __next_expiration */
+static uint64_t __next_expiration(const gn_timer_wheel_t *w)
+{
+
+	uint64_t next = GN_WHEEL_NEVER, group = 0, occupied = 0, at = 0;
+	int shift = 0, rot = 0;
+
+	// the first occupied slot after the current one, at every level
+	for ( int l = 0; l < GN_WHEEL_LEVELS; l++, shift += GN_WHEEL_BITS )
+	{
+
+		if ( ( occupied = w->occupied[l] ) == 0 )
+			{ continue; }
+
+		group = w->now >> shift;
+		rot = ( group + 1 ) & __MASK;
+		if ( rot != 0 )
+			{ occupied = ( occupied >> rot ) | ( occupied << ( 64 - rot ) ); }
+
+		at = ( group + 1 + __builtin_ctzll(occupied) ) << shift;
+		if ( at < next )
+			{ next = at; }
+
+	}
+
+	return(next);
+
+}
+
+/* __arm */
+static void __arm(gn_timer_wheel_t *w)
+{
+
+	uint64_t next = __next_expiration(w);
+	struct itimerspec its;
+	double at = 0;
+
+	if ( next == w->armed )
+		{ return; }
+
+	w->armed = next;
+
+	// the timerfd is left armed, its count is reset once set again
+	if ( next == GN_WHEEL_NEVER )
+	{
+		ev_io_stop(w->loop, &w->watcher);
+		return;
+	}
+
+	// absolute, rounded up so that it never wakes up before the tick
+	at = next * w->tick;
+	memset(&its, 0, sizeof(struct itimerspec));
+	its.it_value.tv_sec = (time_t)at;
+	its.it_value.tv_nsec = (long)ceil( ( at - its.it_value.tv_sec ) * 1e9 );
+	if ( its.it_value.tv_nsec >= 1000000000L )
+	{
+		its.it_value.tv_sec++;
+		its.it_value.tv_nsec -= 1000000000L;
+	}
+
+	if ( timerfd_settime(w->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0 )
+		{ log_sys_error("Could not arm timer wheel"); }
+	ev_io_start(w->loop, &w->watcher);
+
+}
+
+/* __cascade */
+static void __cascade(gn_timer_wheel_t *w, const int slot)
+{
+
+	gn_timer_t *head = &w->slots[slot], *t = NULL;
+
+	while ( ( t = head->next ) != head )
+	{
+		__unlink(w, t);
+		__place(w, t);
+	}
+
+}
+
+/* __expire */
+static void __expire(gn_timer_wheel_t *w, const int slot)
+{
+
+	gn_timer_t *head = &w->slots[slot], *t = NULL;
+
+	// callbacks might add or cancel any timer, none for this tick though
+	while ( ( t = head->next ) != head )
+	{
+		__unlink(w, t);
+		w->count--;
+		t->cb(t);
+	}
+
+}
+
+/* __advance */
+static void __advance(gn_timer_wheel_t *w, const uint64_t target)
+{
+
+	uint64_t next = 0;
+	int shift = 0;
+
+	while ( ( next = __next_expiration(w) ) <= target )
+	{
+
+		w->now = next;
+
+		// upper levels first, their timers might fall down to this tick
+		for ( int l = GN_WHEEL_LEVELS - 1; l > 0; l-- )
+		{
+			shift = l * GN_WHEEL_BITS;
+			if ( ( next & ( ( 1ULL << shift ) - 1 ) ) == 0 )
+			{
+				__cascade(	w, l * GN_WHEEL_SLOTS
+								+ ( ( next >> shift ) & __MASK )	);
+			}
+		}
+
+		__expire(w, next & __MASK);
+
+	}
+
+	if ( target > w->now )
+		{ w->now = target; }
+
+}
+
+/* __cb_wheel */
+static void __cb_wheel(struct ev_loop *loop, ev_io *watcher, int revents)
+{
+
+	gn_timer_wheel_t *w = (gn_timer_wheel_t *)watcher;
+	uint64_t expirations = 0;
+
+	if ( ( read(w->timer_fd, &expirations, sizeof(uint64_t)) < 0 )
+			&& ( errno != EAGAIN ) )
+		{ log_sys_error("Could not read timer wheel"); }
+
+	// timers added by the callbacks do not re-arm it while advancing, no
+	// expiration is at tick 0 so it is armed (or stopped) afterwards
+	w->armed = 0;
+	__advance(w, __wheel_ticks(w));
+	__arm(w);
+
+}
+
+/* new_gn_timer_wheel */
+gn_timer_wheel_t *new_gn_timer_wheel()
+{
+
+	gn_timer_wheel_t *w = NULL;
+	w = (gn_timer_wheel_t *)malloc(LEN__GN_TIMER_WHEEL);
+	memset(w, 0, LEN__GN_TIMER_WHEEL);
+	return(w);
+
+}
+
+/* init_gn_timer_wheel */
+gn_timer_wheel_t *init_gn_timer_wheel(struct ev_loop *loop, const double tick)
+{
+
+	gn_timer_wheel_t *w = NULL;
+
+	if ( loop == NULL )
+		{ return(NULL); }
+
+	if ( tick <= 0 )
+	{
+		log_app_msg("Wrong timer wheel, tick = %f.\n", tick);
+		return(NULL);
+	}
+
+	w = new_gn_timer_wheel();
+	w->loop = loop;
+	w->tick = tick;
+	w->armed = GN_WHEEL_NEVER;
+
+	if ( ( w->timer_fd = timerfd_create
+							(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC) ) < 0 )
+	{
+		log_sys_error("Could not create timer wheel");
+		free(w);
+		return(NULL);
+	}
+
+	for ( int i = 0; i < GN_WHEEL_LEVELS * GN_WHEEL_SLOTS; i++ )
+		{ w->slots[i].next = w->slots[i].prev = &w->slots[i]; }
+
+	w->now = __wheel_ticks(w);
+	ev_io_init(&w->watcher, __cb_wheel, w->timer_fd, EV_READ);
+
+	return(w);
+
+}
+
+/* close_gn_timer_wheel */
+int close_gn_timer_wheel(gn_timer_wheel_t *wheel)
+{
+
+	int result = EX_OK;
+
+	if ( wheel == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	ev_io_stop(wheel->loop, &wheel->watcher);
+	if ( close(wheel->timer_fd) < 0 )
+	{
+		log_sys_error("Could not close timer wheel");
+		result = EX_SYS;
+	}
+	free(wheel);
+
+	return(result);
+
+}
+
+/* add_gn_timer */
+void add_gn_timer
+	(gn_timer_wheel_t *wheel, gn_timer_t *timer, const double delay)
+{
+
+	uint64_t ticks = ( delay > 0 ) ? (uint64_t)ceil(delay / wheel->tick) : 0;
+	uint64_t base = 0;
+
+	// the wheel might still be behind the clock; the tick in progress is
+	// rounded up so that none expires early
+	if ( ( base = __wheel_ticks_ceil(wheel) ) < wheel->now )
+		{ base = wheel->now; }
+	if ( ( wheel->count == 0 ) && ( __wheel_ticks(wheel) > wheel->now ) )
+		{ wheel->now = __wheel_ticks(wheel); }
+
+	if ( is_gn_timer_pending(timer) == true )
+		{ __unlink(wheel, timer); }
+	else
+		{ wheel->count++; }
+
+	timer->expires = base + ( ( ticks > 0 ) ? ticks : 1 );
+	__place(wheel, timer);
+
+	if ( timer->expires < wheel->armed )
+		{ __arm(wheel); }
+
+}
+
+/* cancel_gn_timer */
+void cancel_gn_timer(gn_timer_wheel_t *wheel, gn_timer_t *timer)
+{
+
+	if ( is_gn_timer_pending(timer) == false )
+		{ return; }
+
+	__unlink(wheel, timer);
+
+	// an early wake-up costs less than finding the next expiration again
+	if ( --wheel->count == 0 )
+	{
+		ev_io_stop(wheel->loop, &wheel->watcher);
+		wheel->armed = GN_WHEEL_NEVER;
+	}
+
+}
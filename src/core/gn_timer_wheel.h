@@ -0,0 +1,174 @@
+/*
+ * @file gn_timer_wheel.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for a hierarchical timer wheel. Timers
+ * are embedded within the structures they expire (no allocations) and kept
+ * in the slot of the level whose span covers their expiration: 64 slots of
+ * one tick at the first level, 64 slots of 64 ticks at the second one and
+ * so on. Adding and cancelling a timer takes O(1); the ones of a slot of an
+ * upper level are moved down once their slot is reached. Occupied slots
+ * are marked within a bitmap per level, so the next expiration is found
+ * without visiting empty slots, and a single CLOCK_MONOTONIC timerfd watched
+ * by the loop is armed for it; there are no periodic wake-ups and an empty
+ * wheel has none. An ev_timer would do instead, but libev rounds its
+ * timeouts to milliseconds with epoll, while a timerfd keeps the tick.
+ */
+
+#ifndef GN_TIMER_WHEEL_H_
+#define GN_TIMER_WHEEL_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <ev.h>
+
+/**************************************************************** DATA TYPES */
+
+#define GN_WHEEL_TICK		0.000001	/*!< Default resolution (s). */
+#define GN_WHEEL_BITS		6			/*!< log2 of the slots per level. */
+#define GN_WHEEL_SLOTS		( 1 << GN_WHEEL_BITS )	/*!< Slots per level. */
+#define GN_WHEEL_LEVELS		6			/*!< 2^36 ticks, 19 h at 1 us. */
+
+#define GN_WHEEL_NEVER		UINT64_MAX	/*!< No timer pending. */
+
+struct gn_timer;
+
+/*!
+ * \brief Function called once a timer expires, the timer is no longer
+ * 			pending and might be added again.
+ */
+typedef void (*gn_timer_cb_t)(struct gn_timer *timer);
+
+/*!
+ * \struct gn_timer
+ * \brief Timer of the wheel, to be embedded within the structure that
+ * 			expires, as its first field so that the callback gets it.
+ */
+typedef struct gn_timer
+{
+
+	struct gn_timer *next;			/*!< Next timer of the slot. */
+	struct gn_timer *prev;			/*!< Previous timer of the slot. */
+	uint64_t expires;				/*!< Tick when the timer expires. */
+	gn_timer_cb_t cb;				/*!< Called once expired. */
+	int32_t slot;					/*!< Slot of the wheel (all levels). */
+
+} gn_timer_t;
+
+#define LEN__GN_TIMER sizeof(gn_timer_t)
+
+/*!
+ * \struct gn_timer_wheel
+ * \brief Hierarchical timer wheel. The watcher is the first field so that
+ * 			its callback gets the wheel.
+ */
+typedef struct gn_timer_wheel
+{
+
+	ev_io watcher;					/*!< Watcher of the timerfd. */
+	struct ev_loop *loop;			/*!< Loop of the wheel. */
+	int timer_fd;					/*!< Armed for the next expiration. */
+
+	double tick;					/*!< Resolution of the wheel (s). */
+	uint64_t now;					/*!< Last tick processed. */
+	uint64_t armed;					/*!< Tick the timerfd is armed for. */
+
+	gn_timer_t slots[GN_WHEEL_LEVELS * GN_WHEEL_SLOTS];	/*!< Lists. */
+	uint64_t occupied[GN_WHEEL_LEVELS];	/*!< Slots with timers, per level. */
+	int count;						/*!< Timers pending. */
+
+} gn_timer_wheel_t;
+
+#define LEN__GN_TIMER_WHEEL sizeof(gn_timer_wheel_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a timer wheel.
+ * \return A pointer to the newly allocated block of memory.
+ */
+gn_timer_wheel_t *new_gn_timer_wheel();
+
+/*!
+ * \brief Creates a timer wheel whose timers expire within the given loop,
+ * 			usually the one of the socket of the station. Delays are counted
+ * 			on CLOCK_MONOTONIC, not on the (cached) time of the loop.
+ * \param loop Loop where the timers expire.
+ * \param tick Resolution of the wheel (s).
+ * \return A pointer to the wheel, NULL in case of error.
+ */
+gn_timer_wheel_t *init_gn_timer_wheel(struct ev_loop *loop, const double tick);
+
+/*!
+ * \brief Stops the wheel; the timers still pending never expire.
+ * \param wheel The wheel to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_gn_timer_wheel(gn_timer_wheel_t *wheel);
+
+/*!
+ * \brief Initializes a timer, not pending.
+ * \param timer The timer to be initialized.
+ * \param cb Function called once the timer expires.
+ */
+static inline void init_gn_timer(gn_timer_t *timer, gn_timer_cb_t cb)
+{
+	timer->next = timer->prev = NULL;
+	timer->expires = 0;
+	timer->cb = cb;
+	timer->slot = -1;
+}
+
+/*!
+ * \brief Checks whether a timer is still to expire.
+ */
+static inline bool is_gn_timer_pending(const gn_timer_t *timer)
+	{ return(timer->next != NULL); }
+
+/*!
+ * \brief Adds a timer to the wheel, or moves it if it is already pending.
+ * \param wheel The wheel.
+ * \param timer The timer to be added.
+ * \param delay Time until the timer expires (s), rounded up to a tick.
+ */
+void add_gn_timer
+	(gn_timer_wheel_t *wheel, gn_timer_t *timer, const double delay);
+
+/*!
+ * \brief Removes a timer from the wheel before it expires, if pending.
+ * \param wheel The wheel.
+ * \param timer The timer to be cancelled.
+ */
+void cancel_gn_timer(gn_timer_wheel_t *wheel, gn_timer_t *timer);
+
+#endif /* GN_TIMER_WHEEL_H_ */
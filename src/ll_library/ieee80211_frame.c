@@ -24,83 +24,143 @@
 const unsigned char AMINHA[ETH_ALEN]={ 0x00, 0x22, 0xfb, 0x8f, 0xe4, 0x9a }; //;00:23:8b:fc:0e:3b
 const unsigned char ANTON[ETH_ALEN]={ 0x00, 0x1E, 0x65, 0x5B, 0xC4, 0x04 }; //;00:23:8b:fc:0e:3b
 /* new_ieee80211_frame */
-ieee80211_frame_t *new_ieee80211_frame()
+ieee80211_frame_t *new_ieee80211_frame(ll_frame_pool_t *pool)
 {
-	printf("ini4\n");
-	ieee80211_frame_t *buffer = NULL;
-	buffer = (ieee80211_frame_t *)malloc(LEN__IEEE80211_FRAME);
-	memset(buffer, 0, LEN__IEEE80211_FRAME);
-	return(buffer);
-
+	return((ieee80211_frame_t *)new_pool_frame(pool, LEN__IEEE80211_FRAME));
 }
 
 /* init_ieee80211_frame */
-/*ieee80211_frame_t *init_ieee80211_frame
-	(	const uint8_t mac_service, const uint8_t flags,
-		const uint16_t duration_id,
-		const unsigned char *bssid,
-		const unsigned char *h_source, const unsigned char *h_dest,
-		const uint16_t sequence_control,
-		const unsigned char *dist_address,
-		const unsigned char *qos)
+ieee80211_frame_t *init_ieee80211_frame
+	(	ll_frame_pool_t *pool, const int ll_sap,
+		const unsigned char *h_dest, const unsigned char *h_source	)
 {
 
-	ieee80211_frame_t *f = new_ieee80211_frame();
-	//ieee80211_header_t *h = &f->buffer.header;
+	ieee80211_frame_t *f = NULL;
+
+	if ( ( f = new_ieee80211_frame(pool) ) == NULL )
+		{ return(NULL); }
 
 	if ( set_ll_frame(&f->info, TYPE_IEEE_80211, ETH_FRAME_LEN) < 0 )
 		{ log_app_msg("Could not set info adequately!\n"); }
 
-	f->buffer.header.frame_control.mac_service = mac_service;
-	f->buffer.header.frame_control.flags = flags;
+	set_ieee80211_header(&f->buffer.header, h_source, h_dest);
 
-	f->buffer.header.duration_id = duration_id;
+	return(f);
 
-	//memcpy(h->bssid_address, bssid, ETH_ALEN);
-	memcpy(f->buffer.header.bssid_address, bssid, ETH_ALEN);
-	memcpy(f->buffer.header.dest_address, h_dest, ETH_ALEN);
-	memcpy(f->buffer.header.src_address, h_source, ETH_ALEN);
+}
 
-	f->buffer.header.sequence_control = sequence_control;
+/* set_ieee80211_header */
+int set_ieee80211_header
+	(	ieee80211_header_t *header,
+		const unsigned char *h_source, const unsigned char *h_dest	)
+{
 
-	memcpy(f->buffer.header.dist_address, dist_address, ETH_ALEN);
-     memcpy(f->buffer.header.qos, qos, 2);
+	const unsigned char wildcard[ETH_ALEN]
+		= { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	ieee80211_header_fields_t fields;
 
-	//falta meterlle o qos control
+	memset(&fields, 0, LEN__IEEE80211_HEADER_FIELDS);
+	fields.frame_control = make_ieee80211_fc(IEEE_80211_TYPE_DATA, 0, 0);
+	fields.addr1 = h_dest;
+	fields.addr2 = h_source;
+	fields.addr3 = wildcard;
 
-	return(f);
+	if ( encode_ieee80211_header(header, LEN__IEEE80211_HEADER, &fields) < 0 )
+		{ return(EX_ERR); }
+
+	return(EX_OK);
+
+}
+
+/* init_ieee80211_test_template */
+ll_frame_template_t *init_ieee80211_test_template
+	(const unsigned char *h_source, const unsigned char *h_dest)
+{
 
-}*/
+	ieee80211_header_t header;
+	ll_frame_template_t *t = NULL;
+	const char test_data[] = "0xffffffffff";
+	char payload[sizeof(test_data) + TEMPLATE_SEQ_LEN];
 
+	if ( set_ieee80211_header(&header, h_source, h_dest) < 0 )
+		{ return(NULL); }
 
+	memset(payload, 0, sizeof(payload));
+	memcpy(payload, test_data, sizeof(test_data));
 
-ieee80211_frame_t *init_ieee80211_frame	(	const int ll_sap, const unsigned char *h_dest, const unsigned char *h_source	)
+	if ( ( t = init_ll_frame_template
+					(	TYPE_IEEE_80211, &header, LEN__IEEE80211_HEADER,
+						payload, sizeof(payload)	) ) == NULL )
+		{ return(NULL); }
+
+	// the sequence number of the frame follows the test data
+	if ( set_ll_frame_template_seq
+				(t, LEN__IEEE80211_HEADER + sizeof(test_data)) < 0 )
+		{ free(t); return(NULL); }
+
+	return(t);
+
+}
+
+/* process_ieee80211_frame */
+int process_ieee80211_frame
+	(	const public_ev_arg_t *arg, const ll_frame_t *info,
+		const ieee80211_buffer_t *buffer	)
 {
 
-	ieee80211_frame_t *f = new_ieee80211_frame();
-	printf("ini3\n");
-	if ( set_ll_frame(&f->info, TYPE_IEEE_80211, ETH_FRAME_LEN) < 0 )
-		{ log_app_msg("Could not set info adequately!\n"); }
+	ll_stats_rx(arg->stats, info->frame_len);
 
-	//f->buffer.header.h_proto = htons(ETH_P_ALL);//ll_sap;//cambio
-	memcpy(f->buffer.header.dest_address, h_dest, ETH_ALEN);
-	memcpy(f->buffer.header.src_address, h_source, ETH_ALEN);
+	// frames are either archived or printed, never both
+	if ( arg->capture != NULL )
+		{ return(write_ll_capture(arg->capture, info, buffer)); }
 
-	return(f);
+	// monitor interfaces prepend a radiotap header to the MAC header
+	if ( arg->if_hatype == ARPHRD_IEEE80211_RADIOTAP )
+		{ return(print_ieee80211_radiotap_frame(info, buffer)); }
+
+	return(print_ieee80211_frame_buffer(info, buffer));
 
 }
 
 #ifdef KERNEL_RING
 
+/* ieee80211_frame_rx_cb */
+void ieee80211_frame_rx_cb(const public_ev_arg_t *arg)
+{
+
+	ll_frame_t info;
+	const ieee80211_buffer_t *buffer = NULL;
+
+	while ( read_ieee80211_frame(arg->rx_ring, &info, &buffer) == EX_OK )
+	{
+		if ( process_ieee80211_frame(arg, &info, buffer) < 0 )
+		{
+			log_app_msg("Could not process IEEE 802.11 frame.\n");
+		}
+	}
+
+}
+
 /* read_ieee80211_frame */
-int read_ieee80211_frame(const void *rx_ring, ieee80211_frame_t *rx_frame)
+int read_ieee80211_frame
+	(	rx_ring_t *rx_ring, ll_frame_t *info,
+		const ieee80211_buffer_t **buffer	)
 {
-		//struct tpacket_hdr *header = NULL;
-	https://github.com/vieites4/rawsockets/
-		//header = (void *) rx_ring + (rxring_offset * getpagesize());
 
-		log_app_msg("Unsupported mmap reading...\n");
-		return(EX_ERR);
+	tpacket3_hdr_t *header = NULL;
+
+	if ( ( header = rx_ring_next_frame(rx_ring) ) == NULL )
+		{ return(EX_EOF); }
+
+	if ( set_ll_frame_tpacket3(info, TYPE_IEEE_80211, header) < 0 )
+	{
+		log_app_msg("Error setting ll_frame's info.\n");
+	}
+
+	*buffer = (const ieee80211_buffer_t *)rx_ring_frame_data(header);
+
+	return(EX_OK);
+
 }
 
 #else
@@ -108,45 +168,88 @@ int read_ieee80211_frame(const void *rx_ring, ieee80211_frame_t *rx_frame)
 /* ieee80211_frame_rx_cb */
 void ieee80211_frame_rx_cb(const public_ev_arg_t *arg)
 {
-printf("inicio\n");
+
 	ieee80211_frame_t *f = (ieee80211_frame_t *)arg->buffer;
+	int result = EX_OK;
+
+	// woken up by the error queue only, no frame to be processed
+	if ( ( result = read_ieee80211_frame(arg->socket_fd, f) ) == EX_EOF )
+		{ return; }
 
-	if ( read_ieee80211_frame(arg->socket_fd, f) < 0 )
+	if ( result < 0 )
 	{
 		log_app_msg("Could not read IEEE 802.11 frame.\n");
+		ll_stats_inc(arg->stats, rx_errors);
 		return;
 	}
 
-	if ( print_ieee80211_frame(f) < 0 )
+	if ( process_ieee80211_frame(arg, &f->info, &f->buffer) < 0 )
 	{
-		log_app_msg("Could not print IEEE 802.11 frame.\n");
+		log_app_msg("Could not process IEEE 802.11 frame.\n");
 		return;
 	}
 
 }
 
-/* read_ieee80211_frame */
-int read_ieee80211_frame(const int socket_fd, ieee80211_frame_t *frame)
+/* ieee80211_frame_rx_batch_cb */
+void ieee80211_frame_rx_batch_cb(const public_ev_arg_t *arg)
 {
-printf("read\n");
-	int b_read = recvfrom(socket_fd, &frame->buffer,IEEE_80211_FRAME_LEN, 0,NULL,NULL);//);//ANTES POÑÍA read
-	printf("ini2\n");
-	if ( b_read <= 0 )
-	{
-		log_sys_error("Could not read socket");
-		return(EX_ERR);
-	}
 
-	if ( b_read < frame->info.frame_len )
-	{
-		log_app_msg("Read %d bytes, but %d bytes were requested.\n"
-						, b_read, ETH_FRAME_LEN);
-	}
+	int no_frames = 0;
+	ieee80211_frame_t *f = NULL;
 
-	if ( set_ll_frame(&frame->info, TYPE_IEEE_80211, b_read) < 0 )
+	// frames are read until the socket is drained or the batch is not full
+	do
 	{
-		log_app_msg("Error setting ll_frame's info.\n");
+
+		if ( ( no_frames = read_ieee80211_frame_batch(arg->socket_fd, arg->batch) )
+				< 0 )
+		{
+			log_app_msg("Could not read IEEE 802.11 frames.\n");
+			ll_stats_inc(arg->stats, rx_errors);
+			return;
+		}
+
+		for ( int i = 0; i < no_frames; i++ )
+		{
+			f = (ieee80211_frame_t *)get_ll_frame_batch(arg->batch, i);
+			if ( process_ieee80211_frame(arg, &f->info, &f->buffer) < 0 )
+			{
+				log_app_msg("Could not process IEEE 802.11 frame.\n");
+			}
+		}
+
 	}
+	while ( no_frames == arg->batch->max_frames );
+
+}
+
+/* init_ieee80211_frame_batch */
+ll_frame_batch_t *init_ieee80211_frame_batch(const int max_frames)
+{
+	// slots are read up to the size of their buffer, never beyond it
+	return(init_ll_frame_batch(	max_frames, LEN__IEEE80211_FRAME,
+								offsetof(ieee80211_frame_t, buffer),
+								LEN__IEEE80211_BUFFER	));
+}
+
+/* read_ieee80211_frame_batch */
+int read_ieee80211_frame_batch(const int socket_fd, ll_frame_batch_t *batch)
+{
+	return(read_ll_frame_batch(socket_fd, batch, TYPE_IEEE_80211));
+}
+
+/* read_ieee80211_frame */
+int read_ieee80211_frame(const int socket_fd, ieee80211_frame_t *frame)
+{
+
+	int b_read = recv_ll_frame(	socket_fd, &frame->buffer, LEN__IEEE80211_BUFFER,
+								&frame->info, TYPE_IEEE_80211	);
+
+	if ( b_read < 0 )
+		{ return(EX_ERR); }
+	if ( b_read == 0 )
+		{ return(EX_EOF); }
 
 	return(EX_OK);
 
@@ -157,114 +260,264 @@ printf("read\n");
 /* ieee80211_frame_tx_cb */
 void ieee80211_frame_tx_cb(const public_ev_arg_t *arg)
 {
-printf("ini\n");
+
+#ifdef KERNEL_RING
 	if ( __tx_ieee80211_test_frame
-				(arg->socket_fd, arg->ll_sap, arg->if_index, arg->if_mac) < 0 )
+				(arg->tx_ring, arg->tx_template, arg->stats) < 0 )
 	{
 		log_app_msg("Could not transmit IEEE 802.11 frame.\n");
 		return;
 	}
 
-	log_app_msg("Sleeping for %d (usecs)...\n", arg->tx_delay);
-	if ( usleep(arg->tx_delay) < 0 )
+	if ( tx_ring_flush(arg->tx_ring) < 0 )
 	{
-		log_app_msg("Could not sleep for %d.\n", arg->tx_delay);
+		log_app_msg("Could not flush IEEE 802.11 frames.\n");
+		ll_stats_inc(arg->stats, tx_errors);
 		return;
 	}
+#else
+	if ( __tx_ieee80211_test_frame
+				(	arg->pool, arg->tx_queue, arg->if_index,
+					arg->tx_template	) < 0 )
+	{
+		log_app_msg("Could not transmit IEEE 802.11 frame.\n");
+		return;
+	}
+#endif
 
 }
 
+#ifdef KERNEL_RING
+
 /* __tx_ieee80211_test_frame */
 int __tx_ieee80211_test_frame
-	(	const int socket_fd, const int ll_sap, int if_index,
-		const unsigned char *h_source	)
-{const unsigned char QOS_M[2]={0x00,0x00};const unsigned char RTH[2]={0x00,0x00};
-//	ieee80211_frame_t *tx_frame	= init_ieee80211_frame(0x08, 0x04, 0, ETH_ADDR_BROADCAST, h_source, ETH_ADDR_FAKE,	0,ETH_ADDR_NULL,QOS_M);//null
-//ieee80211_frame_t *tx_frame	= init_ieee80211_frame(0x08, 0x04, 0, ETH_ADDR_BROADCAST, h_source, ETH_ADDR_FAKE,	0,ETH_ADDR_NULL,QO);//null
-ieee80211_frame_t *tx_frame = init_ieee80211_frame(ll_sap, ANTON,h_source );//ETH_ADDR_BROADCAST);
-printf("esta é a nova\n");
-tx_frame->info.frame_len = IEEE_80211_HLEN + 10;
-	//printf("%x %x \n",* (h_source+5),* (h_source +6));
-	//memcpy(tx_frame->buffer.rth,RTH,2);
-//const unsigned char FCS_M[4]={ 0xD4,0x52,0x0E,0x1E };
-	memcpy(tx_frame->buffer.data,"0xffffffffff",35); //así é como se introducen os datos
-	//memcpy(tx_frame->buffer.fcs,FCS_M,4);
-
-//meter o qos control xusto ó principio do data??
-//meter o fcs dentro do data.
-	if ( print_ieee80211_frame(tx_frame) < 0 )
+	(tx_ring_t *tx_ring, ll_frame_template_t *template, ll_stats_t *stats)
+{
+
+	void *buffer = NULL;
+	int max_len = 0;
+	int frame_len = 0;
+
+	// 1) slots already sent by the kernel are reused
+	tx_ring_reclaim(tx_ring);
+
+	if ( ( buffer = tx_ring_get_slot(tx_ring, &max_len) ) == NULL )
+	{
+		log_app_msg("TX ring is full, frame dropped.\n");
+		ll_stats_inc(stats, ring_full);
+		return(EX_ERR);
+	}
+
+	// 2) frame is copied from the template, in place, within the slot
+	if ( ( frame_len = write_ll_frame_template
+							(template, buffer, max_len, NULL, NULL, 0) ) < 0 )
+	{
+		log_app_msg("Could not write frame from template.\n");
+		return(EX_ERR);
+	}
+
+	if ( print_ieee80211_frame_buffer(&template->info, buffer) < 0 )
 	{
 		log_app_msg("Frame formatted incorrectly!\n");
 		return(EX_ERR);
 	}
+
+	// 3) slot is marked for the next flush
+	if ( tx_ring_commit(tx_ring, frame_len) < 0 )
+	{
+		log_app_msg("Could not commit frame to the TX ring.\n");
+		return(EX_ERR);
+	}
+	ll_stats_tx(stats, frame_len);
+
+	return(EX_OK);
+
+}
+
+#else
+
+/* init_ieee80211_tx_batch */
+ll_frame_batch_t *init_ieee80211_tx_batch
+	(	const int max_frames, const int ll_sap,
+		const unsigned char *h_source, const unsigned char *h_dest	)
+{
+
+	ll_frame_batch_t *b = init_ieee80211_frame_batch(max_frames);
+	ieee80211_frame_t *f = NULL;
+	const char test_data[] = "0xffffffffff";
+
+	for ( int i = 0; i < max_frames; i++ )
+	{
+		f = (ieee80211_frame_t *)get_ll_frame_batch(b, i);
+		set_ieee80211_header(&f->buffer.header, h_source, h_dest);
+		memcpy(f->buffer.data, test_data, sizeof(test_data));
+		set_ll_frame(	&f->info, TYPE_IEEE_80211,
+						LEN__IEEE80211_HEADER + sizeof(test_data)	);
+	}
+
+	b->no_frames = max_frames;
+	b->next_frame = 0;
+
+	return(b);
+
+}
+
+/* send_ieee80211_frame_batch */
+int send_ieee80211_frame_batch
+	(const int socket_fd, ll_frame_batch_t *batch, const int if_index)
+{
+
+	struct sockaddr_ll addr;
+
+	memset(&addr, 0, sizeof(struct sockaddr_ll));
+	addr.sll_family = PF_PACKET;
+	addr.sll_protocol = htons(ETH_P_ALL);
+	addr.sll_hatype = ARPHRD_IEEE80211;
+	addr.sll_ifindex = if_index;
+	addr.sll_halen = ETH_ALEN;
+	memcpy(addr.sll_addr, AMINHA, ETH_ALEN);
+
+	return(send_ll_frame_batch(socket_fd, batch, &addr));
+
+}
+
+/* ieee80211_frame_tx_batch_cb */
+void ieee80211_frame_tx_batch_cb(const public_ev_arg_t *arg)
+{
+
+	// frames of the batch are reused once all of them have been sent
+	if ( arg->batch->next_frame == arg->batch->no_frames )
+		{ arg->batch->next_frame = 0; }
+
+	if ( send_ieee80211_frame_batch(arg->socket_fd, arg->batch, arg->if_index)
+			< 0 )
+	{
+		log_app_msg("Could not transmit IEEE 802.11 frames.\n");
+		ll_stats_inc(arg->stats, tx_errors);
+		return;
+	}
+
+}
+
+/* __tx_ieee80211_test_frame */
+int __tx_ieee80211_test_frame
+	(	ll_frame_pool_t *pool, ll_tx_queue_t *tx_queue, const int if_index,
+		ll_frame_template_t *template	)
+{
+
 	struct sockaddr_ll socket_address;
-	/* Address length*/
+	ieee80211_frame_t *tx_frame = NULL;
 
-	socket_address.sll_halen = ETH_ALEN;
-	socket_address.sll_family   = PF_PACKET;	// engadido
-	socket_address.sll_protocol = htons(ETH_P_ALL);	// htons(0x0707);//engadido
-#define ARPHRD_IEEE80211 801
-    socket_address.sll_hatype= ARPHRD_IEEE80211;
-	socket_address.sll_ifindex  = if_index;//if_nametoindex(if_index);
-//printf("%x\n",socket_address.sll_protocol);->0x300
-	//printf("%x\n",ll_sap);-->0x8c
-	/* Destination MAC */
-	memcpy(socket_address.sll_addr,AMINHA , ETH_ALEN);//ETH_ADDR_BROADCAST
-	//int b_written = write(socket_fd, tx_frame, ETH_FRAME_LEN);
-	int b_written = sendto(	socket_fd,&tx_frame->buffer , tx_frame->info.frame_len,0,(struct sockaddr *)&socket_address,sizeof(struct sockaddr_ll)	);//&tx_frame->buffer //(struct sockaddr *)&socket_address
-	if ( b_written < 0 )
+	if ( ( tx_frame = (ieee80211_frame_t *)acquire_ll_frame(pool) ) == NULL )
 	{
-		log_sys_error("Frame could not be sent");
-		return(EX_SYS);
+		log_app_msg("Frame pool exhausted, frame dropped.\n");
+		return(EX_ERR);
 	}
 
-	if ( b_written < 10)//ETH_FRAME_LEN )
+	if ( write_ll_frame_template(	template, &tx_frame->buffer,
+									pool->frame_size - LEN__LL_FRAME,
+									NULL, NULL, 0	) < 0 )
 	{
-		log_sys_error("Could not transmit all bytes as requested");
-		return(EX_SYS);
+		log_app_msg("Could not write frame from template.\n");
+		release_ll_frame(tx_frame);
+		return(EX_ERR);
 	}
 
-	return(EX_OK);
+	tx_frame->info = template->info;
+
+	if ( print_ieee80211_frame(tx_frame) < 0 )
+	{
+		log_app_msg("Frame formatted incorrectly!\n");
+		release_ll_frame(tx_frame);
+		return(EX_ERR);
+	}
+
+	memset(&socket_address, 0, sizeof(struct sockaddr_ll));
+	socket_address.sll_family = PF_PACKET;
+	socket_address.sll_protocol = htons(ETH_P_ALL);
+	socket_address.sll_hatype = ARPHRD_IEEE80211;
+	socket_address.sll_ifindex = if_index;
+	/* Address length*/
+	socket_address.sll_halen = ETH_ALEN;
+	/* Destination MAC */
+	memcpy(socket_address.sll_addr, AMINHA, ETH_ALEN);
+
+	return(send_ll_tx_queue(	tx_queue, tx_frame, &tx_frame->buffer,
+								tx_frame->info.frame_len, &socket_address	));
 
 }
 
+#endif
+
 /* print_ieee80211_frame */
 int print_ieee80211_frame(const ieee80211_frame_t *frame)
 {
+	return(print_ieee80211_frame_buffer(&frame->info, &frame->buffer));
+}
+
+/* __print_ieee80211_mac_frame */
+static int __print_ieee80211_mac_frame(const uint8_t *raw, const int len)
+{
+
+	ieee80211_header_view_t view;
+	int data_len = len;
 
-	if ( print_ll_frame(&frame->info) < 0 ) { return(EX_ERR); }
-
-//	log_app_msg("\t* header->frame_control.mac_service = %02X\n"
-	//						, frame->buffer.header.frame_control.mac_service);
-	//	log_app_msg("\t* header->frame_control.flags = %02X\n"
-	//				, frame->buffer.header.frame_control.flags);
-	//log_app_msg("\t* header->duration_id = %d\n"
-	//				, frame->buffer.header.duration_id);
-
-	//	log_app_msg("\t* header->bssid = ");
-	//print_eth_address(frame->buffer.header.bssid_address);
-	//log_app_msg("\n");
-	log_app_msg("\t* header->src = ");
-		print_eth_address(frame->buffer.header.src_address);
-		log_app_msg("\n");
-	log_app_msg("\t* header->dest = ");
-		print_eth_address(frame->buffer.header.dest_address);
-		log_app_msg("\n");
-
-		//log_app_msg("\t* header->sequence_control = %d\n"
-		//			, frame->buffer.header.sequence_control);
-
-		//log_app_msg("\t* header->dist = ");
-		//print_eth_address(frame->buffer.header.dist_address);
-		//log_app_msg("\n");
-
-	int data_len = frame->info.frame_len - IEEE_80211_HLEN;
-	log_app_msg("\t* data[%d] = ", data_len);
-	if ( print_hex_data((char *)&frame->buffer.data, data_len) < 0 )
-		{ log_app_msg("\n"); return(EX_ERR); }
-	log_app_msg("\n");
+	// the payload follows the header of the variant of the frame
+	if ( decode_ieee80211_header(&view, raw, len) == EX_OK )
+	{
+		print_ieee80211_header_view(&view);
+		raw += view.len;
+		data_len -= view.len;
+	}
+	else
+		{ log_debug_msg("\t* header = malformed\n"); }
+
+	log_debug_msg("\t* data[%d] = ", data_len);
+	if ( print_hex_data((const char *)raw, data_len) < 0 )
+		{ log_debug_msg("\n"); return(EX_ERR); }
+	log_debug_msg("\n");
 
 	return(EX_OK);
 
+}
+
+/* print_ieee80211_frame_buffer */
+int print_ieee80211_frame_buffer
+	(const ll_frame_t *info, const ieee80211_buffer_t *buffer)
+{
+
+	// per-frame dumps are debug messages, filtered before being queued
+	if ( log_enabled(LOG_LEVEL_DEBUG) == false )
+		{ return(EX_OK); }
+
+	if ( print_ll_frame(info) < 0 ) { return(EX_ERR); }
+
+	return(__print_ieee80211_mac_frame(	(const uint8_t *)buffer,
+										info->frame_len	));
+
+}
+
+/* print_ieee80211_radiotap_frame */
+int print_ieee80211_radiotap_frame
+	(const ll_frame_t *info, const ieee80211_buffer_t *buffer)
+{
+
+	const uint8_t *raw = (const uint8_t *)buffer;
+	int rt_len = 0;
+
+	if ( log_enabled(LOG_LEVEL_DEBUG) == false )
+		{ return(EX_OK); }
+
+	if ( print_ll_frame(info) < 0 ) { return(EX_ERR); }
+
+	if ( ( rt_len = get_ieee80211_radiotap_len(raw, info->frame_len) ) < 0 )
+	{
+		log_debug_msg("\t* radiotap = malformed\n");
+		return(EX_ERR);
+	}
+	log_debug_msg("\t* radiotap (B) = %d\n", rt_len);
+
+	return(__print_ieee80211_mac_frame(raw + rt_len, info->frame_len - rt_len));
+
 }
 //mememe
@@ -26,6 +26,11 @@
 #include "execution_codes.h"
 #include "logger.h"
 #include "ll_library/ll_frame.h"
+#include "ll_library/ieee80211_header.h"
+#include "ll_library/ll_frame_template.h"
+#include "ll_library/ll_capture.h"
+#include "ll_library/ll_stats.h"
+#include "ll_library/ll_tx_queue.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -36,52 +41,38 @@
 #include <inttypes.h>
 #include <linux/if_ether.h>
 #include <linux/if_packet.h>
+#include <net/if_arp.h>
+#include <arpa/inet.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 
 /***************************************************** IEEE 802.11 structures */
 
-#define IEEE_80211_HLEN 		30		/*!< IEEE 802.11 header length (B). */
-#define IEEE_80211_BLEN 		2313	/*!< IEEE 802.11 body length (B). */
-#define IEEE_80211_FRAME_LEN	2343	/*!< IEEE 802.11 frame length (B). */
-
-/*!
- * \struct ieee80211_header_frame_control
- * \brief Frame control field (2 B), composed of MAC service (1 B) and flags
- * 			(1 B).
- */
-typedef struct ieee80211_header_frame_control
-{
+/*!< Destination MAC of the IEEE 802.11 test frames. */
+extern const unsigned char ANTON[ETH_ALEN];
 
-	uint8_t mac_service;				/*!< IEEE 802.11 MAC service (1 B). */
-	uint8_t flags;						/*!< IEEE 802.11 flags (1 B). */
-
-} ieee80211_header_frame_control_t;
-
-#define LEN__IEEE_80211_FRAME_CONTROL sizeof(ieee80211_header_frame_control_t)
+#define IEEE_80211_HLEN 		24		/*!< Data/management header (B). */
+#define IEEE_80211_FRAME_LEN	2343	/*!< IEEE 802.11 frame length (B). */
+#define IEEE_80211_BLEN 		( IEEE_80211_FRAME_LEN - IEEE_80211_HLEN )
 
 /*!
  * \struct ieee80211_header
- * \brief Structure for decoding the header of an IEEE 802.11 frame.
+ * \brief Fields of the header of an IEEE 802.11 frame that are common to
+ * 			the data and management frames, in their wire layout. The rest of
+ * 			the variants of the header (control, 4 addresses, QoS) are
+ * 			decoded through an ieee80211_header_view_t.
  */
 typedef struct ieee80211_header
 {
-//const unsigned char *rth, //unsigned char rth[2]; //radio tap header
-	//ieee80211_header_frame_control_t frame_control;						/*!< Frame control field (2 B). */
-
-	//uint16_t duration_id;					/*!< Duration id field (2 B). */
 
-	//unsigned char bssid_address[ETH_ALEN];	/*!< BSSID MAC address. */
-	unsigned char dest_address[ETH_ALEN]; //é importante a orde na que coloco os compoñentes do struct
-	unsigned char src_address[ETH_ALEN];	/*!< Source MAC address. */
-		/*!< Destination MAC address. */
+	uint16_t frame_control;					/*!< Frame control, little endian. */
+	uint16_t duration_id;					/*!< Duration/ID, little endian. */
+	unsigned char dest_address[ETH_ALEN];	/*!< Address 1, receiver. */
+	unsigned char src_address[ETH_ALEN];	/*!< Address 2, transmitter. */
+	unsigned char bssid_address[ETH_ALEN];	/*!< Address 3, BSSID. */
+	uint16_t sequence_control;				/*!< Sequence control, little endian. */
 
-	//uint16_t sequence_control;				/*!< Sequence control (2 B). */
-
-	//unsigned char dist_address[ETH_ALEN];	/*!< Distribution MAC address. */
-	//unsigned char qos[2];//2
-
-} ieee80211_header_t ;
+} __attribute__((packed)) ieee80211_header_t;
 
 #define LEN__IEEE80211_HEADER sizeof(ieee80211_header_t)
 
@@ -91,10 +82,9 @@ typedef struct ieee80211_header
  */
 typedef struct ieee80211_frame_buffer
 {
-//	unsigned char rth[2];
+
 	ieee80211_header_t header;	/*!< IEEE 802.11 header. */
 	char data[IEEE_80211_BLEN];	/*!< Data body of the IEEE 802.11 frame. */
-//	unsigned char fcs[4];
 
 } ieee80211_buffer_t;
 
@@ -118,34 +108,78 @@ typedef struct ieee80211_frame
 /***************************************************** IEEE 802.11 functions */
 
 /*!
- * \brief Allocates memory for a ieee80211_buffer structure.
+ * \brief Takes from the pool the memory for a ieee80211_frame structure.
+ * \param pool The pool where to take the frame from.
  * \return A pointer to the newly allocated block of memory.
  */
-ieee80211_frame_t *new_ieee80211_frame();
+ieee80211_frame_t *new_ieee80211_frame(ll_frame_pool_t *pool);
 
 /*!
  * \brief Initializes an IEEE 802.11 frame with the given data.
+ * \param pool The pool where to take the frame from.
  * \return A pointer to the initialized structure.
  */
 ieee80211_frame_t *init_ieee80211_frame
-	(//	const uint8_t mac_service, const uint8_t flags,
-		//const uint16_t duration_id,
-		//const unsigned char *bssid,
-		const int ll_sap,
-			const unsigned char *h_source, const unsigned char *h_dest);//,
-		//const uint16_t sequence_control,
-		//const unsigned char *dist_address,
-		//const unsigned char *qos);
+	(	ll_frame_pool_t *pool, const int ll_sap,
+		const unsigned char *h_dest, const unsigned char *h_source	);
 
 /*!
- * \brief Reads from a socket an ll_framebuffer.
- * \param socket_fd The socket from where to read the frame.
+ * \brief Sets the header of an IEEE 802.11 data frame sent outside of the
+ * 			context of a BSS: the BSSID is the wildcard one, as in OCB mode.
+ * \param header The header to be set.
+ * \param h_source Source MAC address.
+ * \param h_dest Destination MAC address.
  * \return EX_OK if everything was correct; otherwise < 0.
  */
+int set_ieee80211_header
+	(	ieee80211_header_t *header,
+		const unsigned char *h_source, const unsigned char *h_dest	);
+
 #ifdef KERNEL_RING
-	int read_ieee80211_frame(const void *rx_ring, ieee80211_frame_t *rx_frame);
+	/*!
+	 * \brief Gets the next IEEE 802.11 frame available within the RX ring.
+	 * 			The frame is not copied, the buffer remains valid until the
+	 * 			next frame is read from the same ring.
+	 * \param rx_ring The ring from where to read the frame.
+	 * \param info Structure where the info of the frame is to be set.
+	 * \param buffer Set to the header + data of the frame, in place.
+	 * \return EX_OK if a frame was read, EX_EOF if no more frames are ready.
+	 */
+	int read_ieee80211_frame
+		(	rx_ring_t *rx_ring, ll_frame_t *info,
+			const ieee80211_buffer_t **buffer	);
 #else
+	/*!
+	 * \brief Reads from a socket an ll_framebuffer.
+	 * \param socket_fd The socket from where to read the frame.
+	 * \return EX_OK if a frame was read, EX_EOF if no frame was ready;
+	 * 			otherwise < 0.
+	 */
 	int read_ieee80211_frame(const int socket_fd, ieee80211_frame_t *rx_frame);
+
+	/*!
+	 * \brief Allocates a batch for the reception of IEEE 802.11 frames.
+	 * \param max_frames Maximum number of frames per batch.
+	 * \return A pointer to the newly allocated batch.
+	 */
+	ll_frame_batch_t *init_ieee80211_frame_batch(const int max_frames);
+
+	/*!
+	 * \brief Reads from a socket a batch of IEEE 802.11 frames with a single
+	 * 			system call.
+	 * \param socket_fd The socket from where to read the frames.
+	 * \param batch The batch where the frames are to be stored.
+	 * \return Number of frames read (>=0), <0 in case of error.
+	 */
+	int read_ieee80211_frame_batch
+		(const int socket_fd, ll_frame_batch_t *batch);
+
+	/*!
+	 * \brief Callback function to be called whenever IEEE 802.11 frames are
+	 * 			received, it drains a whole batch of frames at a time.
+	 * \param arg Argument given by the event handler.
+	 */
+	void ieee80211_frame_rx_batch_cb(const public_ev_arg_t *arg);
 #endif
 
 /*!
@@ -155,6 +189,51 @@ ieee80211_frame_t *init_ieee80211_frame
  */
 int print_ieee80211_frame(const ieee80211_frame_t *frame);
 
+/*!
+ * \brief Prints the data of an IEEE 802.11 frame whose info and contents
+ * 			are stored separately (for instance, frames read in place).
+ * 			Frames are only printed in debug mode.
+ * \param info Info of the frame to be printed out.
+ * \param buffer Header + data of the frame to be printed out.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int print_ieee80211_frame_buffer
+	(const ll_frame_t *info, const ieee80211_buffer_t *buffer);
+
+/*!
+ * \brief Prints the data of an IEEE 802.11 frame received through a monitor
+ * 			interface, whose MAC header follows a radiotap header.
+ * 			Frames are only printed in debug mode.
+ * \param info Info of the frame to be printed out.
+ * \param buffer Radiotap header + 802.11 header + data of the frame.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int print_ieee80211_radiotap_frame
+	(const ll_frame_t *info, const ieee80211_buffer_t *buffer);
+
+/*!
+ * \brief Creates the template of the IEEE 802.11 test frames sent to the
+ * 			given destination: the test data followed by the sequence number
+ * 			of the frame.
+ * \param h_source Pointer to the MAC source address.
+ * \param h_dest Pointer to the buffer that holds the MAC destination.
+ * \return A pointer to the new template, NULL in case of error.
+ */
+ll_frame_template_t *init_ieee80211_test_template
+	(const unsigned char *h_source, const unsigned char *h_dest);
+
+/*!
+ * \brief Processes a frame received: it is stored in the capture of the
+ * 			socket, if any, or printed out otherwise.
+ * \param arg Argument given by the event handler.
+ * \param info Info of the frame.
+ * \param buffer Header + data of the frame.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int process_ieee80211_frame
+	(	const public_ev_arg_t *arg, const ll_frame_t *info,
+		const ieee80211_buffer_t *buffer	);
+
 /*!
  * \brief Callback function to be called whenever an IEEE 802.11 frame is
  * 			received.
@@ -169,15 +248,65 @@ void ieee80211_frame_rx_cb(const public_ev_arg_t *arg);
  */
 void ieee80211_frame_tx_cb(const public_ev_arg_t *arg);
 
-/*!
- * \brief Function that transmits an IEEE 802.11 frame for testing.
- * \param socket_fd The socket through which the test frame will be sent.
- * \param ll_sap Link layer level SAP.
- * \param h_source Source MAC for this packet.
- * \return EX_OK if everything was correct; otherwise < 0.
- */
-int __tx_ieee80211_test_frame
-	(	const int socket_fd, const int ll_sap,  int if_index,
-		const unsigned char *h_source	);
+#ifdef KERNEL_RING
+	/*!
+	 * \brief Writes an IEEE 802.11 test frame out of the given template,
+	 * 			directly within the next slot of the TX ring. The frame is
+	 * 			sent with the next flush of the ring.
+	 * \param tx_ring The ring where to build the frame.
+	 * \param template Template of the test frame.
+	 * \param stats Counters of the socket, NULL if there are none.
+	 * \return EX_OK if everything was correct; otherwise < 0.
+	 */
+	int __tx_ieee80211_test_frame
+		(	tx_ring_t *tx_ring, ll_frame_template_t *template,
+			ll_stats_t *stats	);
+#else
+	/*!
+	 * \brief Function that transmits an IEEE 802.11 test frame out of the
+	 * 			given template. The frame is taken from the pool and given
+	 * 			back once sent (the send queue may keep it for a while).
+	 * \param pool The pool where to take the frame from.
+	 * \param tx_queue Send queue of the socket.
+	 * \param if_index Index of the interface to send the frame through.
+	 * \param template Template of the test frame.
+	 * \return EX_OK if everything was correct; otherwise < 0.
+	 */
+	int __tx_ieee80211_test_frame
+		(	ll_frame_pool_t *pool, ll_tx_queue_t *tx_queue, const int if_index,
+			ll_frame_template_t *template	);
+
+	/*!
+	 * \brief Allocates a batch of IEEE 802.11 test frames, whose headers and
+	 * 			data are built only once so that the batch can be transmitted
+	 * 			over and over again.
+	 * \param max_frames Number of frames of the batch.
+	 * \param ll_sap Link layer Service Access Point.
+	 * \param h_source Source MAC for the test frames.
+	 * \param h_dest Destination MAC for the test frames.
+	 * \return A pointer to the newly allocated batch.
+	 */
+	ll_frame_batch_t *init_ieee80211_tx_batch
+		(	const int max_frames, const int ll_sap,
+			const unsigned char *h_source, const unsigned char *h_dest	);
+
+	/*!
+	 * \brief Writes to a socket the IEEE 802.11 frames of a batch not yet
+	 * 			transmitted, with as few system calls as possible.
+	 * \param socket_fd The socket where to write the frames.
+	 * \param batch The batch with the frames to be written.
+	 * \param if_index Index of the interface for the transmission.
+	 * \return Number of frames sent (>=0), <0 in case of error.
+	 */
+	int send_ieee80211_frame_batch
+		(const int socket_fd, ll_frame_batch_t *batch, const int if_index);
+
+	/*!
+	 * \brief Callback function to be called whenever a batch of IEEE 802.11
+	 * 			frames is to be transmitted.
+	 * \param arg Argument given by the event handler.
+	 */
+	void ieee80211_frame_tx_batch_cb(const public_ev_arg_t *arg);
+#endif
 
 #endif /* IEEE80211_FRAME_H_ */
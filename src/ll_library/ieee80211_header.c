@@ -0,0 +1,214 @@
+/*
+ * @file ieee80211_header.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_library/ieee80211_header.h"
+#include "ll_library/ll_frame.h"
+
+/*!< Control subtypes with address 1 only: control wrapper, CTS and ACK. */
+#define __CTRL_ONE_ADDR	(	( 1 << IEEE_80211_STYPE_WRAPPER )	\
+							| ( 1 << IEEE_80211_STYPE_CTS )		\
+							| ( 1 << IEEE_80211_STYPE_ACK )	)
+
+/* __layout */
+static inline void __layout(ieee80211_header_view_t *v, const uint16_t fc)
+{
+
+	// every flag below is either 0 or 1, so that they all can be combined
+	// into lengths and offsets without branches
+	const unsigned type = ( fc >> 2 ) & 0x03, subtype = ( fc >> 4 ) & 0x0F;
+	const unsigned is_ctrl = ( type == IEEE_80211_TYPE_CTRL );
+	const unsigned is_data = ( type == IEEE_80211_TYPE_DATA );
+	const unsigned is_mgmt = ( type == IEEE_80211_TYPE_MGMT );
+	const unsigned is_wrapper = is_ctrl
+									& ( subtype == IEEE_80211_STYPE_WRAPPER );
+
+	const unsigned has_a2 = 1 - ( is_ctrl & ( __CTRL_ONE_ADDR >> subtype ) );
+	const unsigned has_a3 = is_mgmt | is_data;
+	const unsigned has_a4 = is_data & ( fc >> 8 ) & ( fc >> 9 ) & 1;
+	const unsigned has_qos = is_data & ( subtype >> 3 );
+	// the order flag means HT control only for management and QoS data
+	const unsigned has_ht = ( ( fc >> 15 ) & ( is_mgmt | has_qos ) )
+								| is_wrapper;
+
+	// FC + duration + addr1, the rest is appended in order
+	v->len = 10 + 6 * has_a2 + 8 * has_a3 + 6 * has_a4 + 2 * has_qos
+				+ 2 * is_wrapper + 4 * has_ht;
+
+	v->addr2 = 10 * has_a2;
+	v->addr3 = 16 * has_a3;
+	v->sequence = 22 * has_a3;
+	v->addr4 = 24 * has_a4;
+	v->qos = ( 24 + 6 * has_a4 ) * has_qos;
+	v->carried_fc = 10 * is_wrapper;
+	v->ht = ( v->len - 4 ) * has_ht;
+
+}
+
+/* __put_le16 */
+static inline void __put_le16(uint8_t *p, const uint16_t value)
+	{ uint16_t v = htole16(value); memcpy(p, &v, sizeof(v)); }
+
+/* __put_address */
+static inline void __put_address(uint8_t *p, const uint8_t *address)
+{
+	if ( address != NULL )
+		{ memcpy(p, address, ETH_ALEN); }
+	else
+		{ memset(p, 0, ETH_ALEN); }
+}
+
+/* decode_ieee80211_header */
+int decode_ieee80211_header
+	(ieee80211_header_view_t *view, const void *buffer, const int len)
+{
+
+	const uint8_t *raw = (const uint8_t *)buffer;
+	uint16_t fc = 0;
+
+	if ( len < IEEE_80211_HLEN_MIN )
+		{ return(EX_WRONG_PARAM); }
+
+	fc = __get_le16(raw);
+
+	if ( ( fc & 0x03 ) != 0 )
+		{ return(EX_WRONG_PARAM); }
+	if ( ( ( fc >> 2 ) & 0x03 ) == IEEE_80211_TYPE_EXT )
+		{ return(EX_UNSUPPORTED); }
+
+	view->raw = raw;
+	view->frame_control = fc;
+	__layout(view, fc);
+
+	if ( view->len > len )
+		{ return(EX_WRONG_PARAM); }
+
+	return(EX_OK);
+
+}
+
+/* encode_ieee80211_header */
+int encode_ieee80211_header
+	(	void *buffer, const int max_len,
+		const ieee80211_header_fields_t *fields	)
+{
+
+	const ieee80211_header_fields_t *f = fields;
+	ieee80211_header_view_t v;
+	uint8_t *b = (uint8_t *)buffer;
+	uint32_t ht = 0;
+
+	if ( ( ( f->frame_control & 0x03 ) != 0 )
+			|| ( ( ( f->frame_control >> 2 ) & 0x03 ) == IEEE_80211_TYPE_EXT ) )
+	{
+		log_app_msg("Wrong frame control = %04X.\n", f->frame_control);
+		return(EX_WRONG_PARAM);
+	}
+
+	__layout(&v, f->frame_control);
+
+	if ( v.len > max_len )
+	{
+		log_app_msg("No room for the header, len = %d, max_len = %d.\n"
+						, v.len, max_len);
+		return(EX_WRONG_PARAM);
+	}
+
+	__put_le16(b, f->frame_control);
+	__put_le16(b + 2, f->duration_id);
+	__put_address(b + 4, f->addr1);
+
+	if ( v.addr2 != IEEE_80211_NO_FIELD )
+		{ __put_address(b + v.addr2, f->addr2); }
+	if ( v.addr3 != IEEE_80211_NO_FIELD )
+		{ __put_address(b + v.addr3, f->addr3); }
+	if ( v.sequence != IEEE_80211_NO_FIELD )
+		{ __put_le16(b + v.sequence, f->sequence_control); }
+	if ( v.addr4 != IEEE_80211_NO_FIELD )
+		{ __put_address(b + v.addr4, f->addr4); }
+	if ( v.qos != IEEE_80211_NO_FIELD )
+		{ __put_le16(b + v.qos, f->qos_control); }
+	if ( v.carried_fc != IEEE_80211_NO_FIELD )
+		{ __put_le16(b + v.carried_fc, f->carried_fc); }
+	if ( v.ht != IEEE_80211_NO_FIELD )
+	{
+		ht = htole32(f->ht_control);
+		memcpy(b + v.ht, &ht, sizeof(ht));
+	}
+
+	return(v.len);
+
+}
+
+/* get_ieee80211_radiotap_len */
+int get_ieee80211_radiotap_len(const void *buffer, const int len)
+{
+
+	const uint8_t *raw = (const uint8_t *)buffer;
+	int rt_len = 0;
+
+	// version (1 B), padding (1 B), length (2 B), present flags (4 B)
+	if ( ( len < 8 ) || ( raw[0] != 0 ) )
+		{ return(EX_WRONG_PARAM); }
+
+	rt_len = __get_le16(raw + 2);
+	if ( ( rt_len < 8 ) || ( rt_len > len ) )
+		{ return(EX_WRONG_PARAM); }
+
+	return(rt_len);
+
+}
+
+/* print_ieee80211_header_view */
+void print_ieee80211_header_view(const ieee80211_header_view_t *view)
+{
+
+	const ieee80211_header_view_t *v = view;
+	const uint8_t *addresses[4] = {	get_ieee80211_addr1(v),
+									get_ieee80211_field(v, v->addr2),
+									get_ieee80211_field(v, v->addr3),
+									get_ieee80211_field(v, v->addr4)	};
+
+	log_debug_msg("\t* header->type = %d, subtype = %d, flags = %02X\n"
+				, get_ieee80211_type(v), get_ieee80211_subtype(v)
+				, v->frame_control >> 8);
+	log_debug_msg("\t* header->duration_id = %u\n", get_ieee80211_duration(v));
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		if ( addresses[i] == NULL )
+			{ continue; }
+		log_debug_msg("\t* header->addr%d = ", i + 1);
+			print_eth_address(addresses[i]);
+			log_debug_msg("\n");
+	}
+
+	if ( v->sequence != IEEE_80211_NO_FIELD )
+	{
+		log_debug_msg("\t* header->sequence = %d, fragment = %d\n"
+					, get_ieee80211_sequence(v), get_ieee80211_fragment(v));
+	}
+	if ( v->qos != IEEE_80211_NO_FIELD )
+		{ log_debug_msg("\t* header->tid = %d\n", get_ieee80211_tid(v)); }
+	if ( v->ht != IEEE_80211_NO_FIELD )
+		{ log_debug_msg("\t* header->ht_control = present\n"); }
+
+}
@@ -0,0 +1,261 @@
+/*
+ * @file ieee80211_header.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the codec of the IEEE 802.11 MAC header. The header of
+ * a frame is decoded in place: a view keeps a pointer to the frame and the
+ * offsets of the fields present in its variant (management, control, data,
+ * QoS data, 4 addresses), so that no field is copied out. The offsets are
+ * computed out of the frame control with bit arithmetic instead of nested
+ * switches. The encoder writes a header with the very same layout.
+ */
+
+#ifndef IEEE80211_HEADER_H_
+#define IEEE80211_HEADER_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <endian.h>
+#include <linux/if_ether.h>
+
+/**************************************************************** DATA TYPES */
+
+#define IEEE_80211_HLEN_MIN		10		/*!< ACK/CTS header length (B). */
+#define IEEE_80211_HLEN_MAX		36		/*!< 4 addr + QoS + HT header (B). */
+
+#define IEEE_80211_TYPE_MGMT	0		/*!< Management frame. */
+#define IEEE_80211_TYPE_CTRL	1		/*!< Control frame. */
+#define IEEE_80211_TYPE_DATA	2		/*!< Data frame. */
+#define IEEE_80211_TYPE_EXT		3		/*!< Extension frame. */
+
+#define IEEE_80211_STYPE_QOS		0x08	/*!< QoS bit of data subtypes. */
+#define IEEE_80211_STYPE_WRAPPER	7		/*!< Control wrapper subtype. */
+#define IEEE_80211_STYPE_CTS		12		/*!< Clear to send subtype. */
+#define IEEE_80211_STYPE_ACK		13		/*!< Acknowledgement subtype. */
+
+#define IEEE_80211_FC_TO_DS		0x0100	/*!< To distribution system. */
+#define IEEE_80211_FC_FROM_DS	0x0200	/*!< From distribution system. */
+#define IEEE_80211_FC_MORE_FRAG	0x0400	/*!< More fragments follow. */
+#define IEEE_80211_FC_RETRY		0x0800	/*!< Retransmission. */
+#define IEEE_80211_FC_PWR_MGMT	0x1000	/*!< Power management. */
+#define IEEE_80211_FC_MORE_DATA	0x2000	/*!< More data buffered. */
+#define IEEE_80211_FC_PROTECTED	0x4000	/*!< Body encrypted. */
+#define IEEE_80211_FC_ORDER		0x8000	/*!< Order, or HT control present. */
+
+#define IEEE_80211_NO_FIELD		0		/*!< Offset of a field not present. */
+
+/*!
+ * \struct ieee80211_header_view
+ * \brief Header of an IEEE 802.11 frame decoded in place. Offsets are from
+ * 			the first byte of the header, NO_FIELD if the field is not
+ * 			present in the variant of the header (the frame control, the
+ * 			only field at offset 0, is always present).
+ */
+typedef struct ieee80211_header_view
+{
+
+	const uint8_t *raw;				/*!< First byte of the header. */
+	uint16_t frame_control;			/*!< Frame control, host order. */
+	uint8_t len;					/*!< Length of the header (B). */
+
+	uint8_t addr2;					/*!< Offset of address 2. */
+	uint8_t addr3;					/*!< Offset of address 3. */
+	uint8_t addr4;					/*!< Offset of address 4. */
+	uint8_t sequence;				/*!< Offset of sequence control. */
+	uint8_t qos;					/*!< Offset of QoS control. */
+	uint8_t ht;						/*!< Offset of HT control. */
+	uint8_t carried_fc;				/*!< Offset of carried frame control. */
+
+} ieee80211_header_view_t;
+
+#define LEN__IEEE80211_HEADER_VIEW sizeof(ieee80211_header_view_t)
+
+/*!
+ * \struct ieee80211_header_fields
+ * \brief Fields of an IEEE 802.11 header to be encoded. The frame control
+ * 			selects the variant of the header and, so, which of the other
+ * 			fields are written; the rest are ignored.
+ */
+typedef struct ieee80211_header_fields
+{
+
+	uint16_t frame_control;			/*!< Frame control, host order. */
+	uint16_t duration_id;			/*!< Duration/ID. */
+	const uint8_t *addr1;			/*!< Receiver address. */
+	const uint8_t *addr2;			/*!< Transmitter address. */
+	const uint8_t *addr3;			/*!< BSSID, source or destination. */
+	const uint8_t *addr4;			/*!< Source address, 4 address frames. */
+	uint16_t sequence_control;		/*!< Sequence number and fragment. */
+	uint16_t qos_control;			/*!< QoS control, QoS data frames. */
+	uint32_t ht_control;			/*!< HT control, if the order flag is set. */
+	uint16_t carried_fc;			/*!< Frame control, control wrappers. */
+
+} ieee80211_header_fields_t;
+
+#define LEN__IEEE80211_HEADER_FIELDS sizeof(ieee80211_header_fields_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Builds a frame control field.
+ * \param type Type of the frame (IEEE_80211_TYPE_*).
+ * \param subtype Subtype of the frame.
+ * \param flags Flags of the frame (IEEE_80211_FC_*).
+ * \return The frame control field, host order.
+ */
+static inline uint16_t make_ieee80211_fc
+	(const int type, const int subtype, const uint16_t flags)
+	{ return( ( ( type & 0x03 ) << 2 ) | ( ( subtype & 0x0F ) << 4 ) | flags ); }
+
+/*!
+ * \brief Builds a sequence control field.
+ * \param sequence Sequence number of the frame (12 bits).
+ * \param fragment Fragment number of the frame (4 bits).
+ * \return The sequence control field, host order.
+ */
+static inline uint16_t make_ieee80211_sequence
+	(const int sequence, const int fragment)
+	{ return( ( ( sequence & 0x0FFF ) << 4 ) | ( fragment & 0x0F ) ); }
+
+/*!
+ * \brief Decodes the header of an IEEE 802.11 frame, in place.
+ * \param view Where the header is decoded; it points into the buffer, so it
+ * 				remains valid as long as the buffer does.
+ * \param buffer First byte of the header.
+ * \param len Length of the frame (B).
+ * \return EX_OK if decoded; EX_WRONG_PARAM if the frame is shorter than its
+ * 			header or its protocol version is not 0; EX_UNSUPPORTED for the
+ * 			extension frames.
+ */
+int decode_ieee80211_header
+	(ieee80211_header_view_t *view, const void *buffer, const int len);
+
+/*!
+ * \brief Encodes an IEEE 802.11 header.
+ * \param buffer Where the header is written.
+ * \param max_len Room within the buffer (B).
+ * \param fields Fields of the header.
+ * \return Length of the header (B); < 0 if it does not fit or the frame is
+ * 			an extension one.
+ */
+int encode_ieee80211_header
+	(	void *buffer, const int max_len,
+		const ieee80211_header_fields_t *fields	);
+
+/*!
+ * \brief Gets the length of the radiotap header that precedes the frames
+ * 			captured through monitor interfaces.
+ * \param buffer First byte of the captured frame.
+ * \param len Length of the captured frame (B).
+ * \return Length of the radiotap header (B), < 0 if malformed.
+ */
+int get_ieee80211_radiotap_len(const void *buffer, const int len);
+
+/*!
+ * \brief Prints the header of an IEEE 802.11 frame (debug level).
+ * \param view The decoded header.
+ */
+void print_ieee80211_header_view(const ieee80211_header_view_t *view);
+
+/*!
+ * \brief Reads a little endian field, fields are not aligned within frames.
+ */
+static inline uint16_t __get_le16(const uint8_t *p)
+	{ uint16_t v; memcpy(&v, p, sizeof(v)); return(le16toh(v)); }
+
+/*!
+ * \brief Gets the type of the frame (IEEE_80211_TYPE_*).
+ */
+static inline int get_ieee80211_type(const ieee80211_header_view_t *view)
+	{ return( ( view->frame_control >> 2 ) & 0x03 ); }
+
+/*!
+ * \brief Gets the subtype of the frame.
+ */
+static inline int get_ieee80211_subtype(const ieee80211_header_view_t *view)
+	{ return( ( view->frame_control >> 4 ) & 0x0F ); }
+
+/*!
+ * \brief Checks whether the given flags (IEEE_80211_FC_*) are all set.
+ */
+static inline bool has_ieee80211_flags
+	(const ieee80211_header_view_t *view, const uint16_t flags)
+	{ return( ( view->frame_control & flags ) == flags ); }
+
+/*!
+ * \brief Gets the duration/ID field.
+ */
+static inline uint16_t get_ieee80211_duration
+	(const ieee80211_header_view_t *view)
+	{ return(__get_le16(view->raw + 2)); }
+
+/*!
+ * \brief Gets address 1 (receiver), present in all the frames.
+ */
+static inline const uint8_t *get_ieee80211_addr1
+	(const ieee80211_header_view_t *view)
+	{ return(view->raw + 4); }
+
+/*!
+ * \brief Gets an optional field of the header in place.
+ * \param view The decoded header.
+ * \param offset Offset of the field within the view.
+ * \return First byte of the field, NULL if not present.
+ */
+static inline const uint8_t *get_ieee80211_field
+	(const ieee80211_header_view_t *view, const uint8_t offset)
+	{ return( ( offset != IEEE_80211_NO_FIELD ) ? view->raw + offset : NULL ); }
+
+/*!
+ * \brief Gets the sequence number of the frame, 0 if not present.
+ */
+static inline int get_ieee80211_sequence(const ieee80211_header_view_t *view)
+{
+	return( ( view->sequence != IEEE_80211_NO_FIELD )
+				? __get_le16(view->raw + view->sequence) >> 4 : 0 );
+}
+
+/*!
+ * \brief Gets the fragment number of the frame, 0 if not present.
+ */
+static inline int get_ieee80211_fragment(const ieee80211_header_view_t *view)
+{
+	return( ( view->sequence != IEEE_80211_NO_FIELD )
+				? __get_le16(view->raw + view->sequence) & 0x0F : 0 );
+}
+
+/*!
+ * \brief Gets the traffic identifier of a QoS data frame, 0 otherwise.
+ */
+static inline int get_ieee80211_tid(const ieee80211_header_view_t *view)
+{
+	return( ( view->qos != IEEE_80211_NO_FIELD )
+				? view->raw[view->qos] & 0x0F : 0 );
+}
+
+#endif /* IEEE80211_HEADER_H_ */
@@ -24,57 +24,284 @@
 //const unsigned char ETH_ADDR_ETH0[ETH_ALEN]={0x00, 0x23, 0x8b, 0xfc, 0x0e, 0x3b};
 /*!< Ethernet NULL address. */
 /* new_ethhdr */
-struct ethhdr *new_ethhdr()
+struct ethhdr *new_ethhdr(ll_frame_pool_t *pool)
 {
-
-	struct ethhdr *buffer = NULL;
-	buffer = (struct ethhdr *)malloc(ETH_HLEN);
-	memset(buffer, 0, ETH_HLEN);
-	return(buffer);
-
+	return((struct ethhdr *)new_pool_frame(pool, ETH_HLEN));
 }
 
 /* new_ieee8023_frame */
-ieee8023_frame_t *new_ieee8023_frame()
+ieee8023_frame_t *new_ieee8023_frame(ll_frame_pool_t *pool)
 {
-
-	ieee8023_frame_t *buffer = NULL;
-	buffer = (ieee8023_frame_t *)malloc(LEN__IEEE8023_FRAME);
-	memset(buffer, 0, LEN__IEEE8023_FRAME);
-	return(buffer);
-
+	return((ieee8023_frame_t *)new_pool_frame(pool, LEN__IEEE8023_FRAME));
 }
 
 /* init_ieee8023_frame */
 ieee8023_frame_t *init_ieee8023_frame
-	(	const int ll_sap,
+	(	ll_frame_pool_t *pool, const int ll_sap,
 		const unsigned char *h_source, const unsigned char *h_dest	)
 {
 
-	ieee8023_frame_t *f = new_ieee8023_frame();
+	ieee8023_frame_t *f = NULL;
+
+	if ( ( f = new_ieee8023_frame(pool) ) == NULL )
+		{ return(NULL); }
 
 	if ( set_ll_frame(&f->info, TYPE_IEEE_8023, ETH_FRAME_LEN) < 0 )
 		{ log_app_msg("Could not set info adequately!\n"); }
 
-	f->buffer.header.h_proto = htons(ETH_P_ALL);//ll_sap;//cambio
-	memcpy(f->buffer.header.h_dest, h_dest, ETH_ALEN);
-	memcpy(f->buffer.header.h_source, h_source, ETH_ALEN);
+	set_ieee8023_header(&f->buffer.header, ll_sap, h_source, h_dest);
 
 	return(f);
 
 }
 
+/* set_ieee8023_header */
+int set_ieee8023_header
+	(	eth_header_t *header, const int ll_sap,
+		const unsigned char *h_source, const unsigned char *h_dest	)
+{
+
+	header->h_proto = htons(ETH_P_ALL);//ll_sap;//cambio
+	memcpy(header->h_dest, h_dest, ETH_ALEN);
+	memcpy(header->h_source, h_source, ETH_ALEN);
+
+	return(EX_OK);
+
+}
+
+/* init_ieee8023_test_template */
+ll_frame_template_t *init_ieee8023_test_template
+	(	const int ll_sap,
+		const unsigned char *h_source, const unsigned char *h_dest	)
+{
+
+	eth_header_t header;
+	ll_frame_template_t *t = NULL;
+
+	memset(&header, 0, ETH_HLEN);
+	set_ieee8023_header(&header, ll_sap, h_source, h_dest);
+
+	if ( ( t = init_ll_frame_template
+					(TYPE_IEEE_8023, &header, ETH_HLEN, NULL, 10) ) == NULL )
+		{ return(NULL); }
+
+	// the first bytes of the payload carry the sequence number of the frame
+	if ( set_ll_frame_template_seq(t, ETH_HLEN) < 0 )
+		{ free(t); return(NULL); }
+
+	return(t);
+
+}
+
+/* init_ieee8023_probe_template */
+ll_frame_template_t *init_ieee8023_probe_template
+	(	const int ll_sap,
+		const unsigned char *h_source, const unsigned char *h_dest,
+		const ll_probe_t *probe	)
+{
+
+	eth_header_t header;
+	uint8_t payload[ETH_DATA_LEN];
+	ll_probe_payload_t *p = (ll_probe_payload_t *)payload;
+	ll_frame_template_t *t = NULL;
+	// probes are padded up to the minimum length of an ethernet frame
+	int payload_len = ( LEN__LL_PROBE_PAYLOAD > ETH_ZLEN - ETH_HLEN )
+						? LEN__LL_PROBE_PAYLOAD : ETH_ZLEN - ETH_HLEN;
+
+	memset(&header, 0, ETH_HLEN);
+	set_ieee8023_header(&header, ll_sap, h_source, h_dest);
+
+	memset(payload, 0, payload_len);
+	p->magic = htonl(PROBE_MAGIC);
+	p->type = PROBE_TYPE_REQUEST;
+	p->ping_clock = probe->clock;
+
+	if ( ( t = init_ll_frame_template
+					(TYPE_IEEE_8023, &header, ETH_HLEN, payload, payload_len) )
+			== NULL )
+		{ return(NULL); }
+
+	if ( ( set_ll_frame_template_seq
+				(t, ETH_HLEN + offsetof(ll_probe_payload_t, sequence)) < 0 )
+			|| ( set_ll_frame_template_ts
+				(t, ETH_HLEN + offsetof(ll_probe_payload_t, tx_sec)) < 0 ) )
+		{ free(t); return(NULL); }
+
+	return(t);
+
+}
+
+/* __ieee8023_probe_reply */
+static void __ieee8023_probe_reply
+	(	const public_ev_arg_t *arg, const ll_frame_t *info,
+		const ieee8023_frame_buffer_t *buffer	)
+{
+
+	struct timespec rx;
+	ll_probe_payload_t *p = NULL;
+
+	get_ll_probe_rx_time(arg->probe, info, &rx);
+	ll_stats_rx(arg->stats, info->frame_len);
+
+	// our own requests are also seen by the socket
+	if ( ( p = get_ll_probe_payload(	buffer->data, info->frame_len - ETH_HLEN,
+										PROBE_TYPE_REPLY	) ) == NULL )
+		{ return; }
+
+	if ( process_ll_probe_reply(arg->probe, &rx, p) < 0 )
+		{ log_app_msg("Could not process probe reply.\n"); }
+
+}
+
+/* __reflect_ieee8023_probe */
+static ll_probe_payload_t *__reflect_ieee8023_probe
+	(	const public_ev_arg_t *arg, const ll_frame_t *info,
+		ieee8023_frame_buffer_t *buffer	)
+{
+
+	struct timespec rx;
+	ll_probe_payload_t *p = NULL;
+
+	get_ll_probe_rx_time(arg->probe, info, &rx);
+	ll_stats_rx(arg->stats, info->frame_len);
+
+	// our own replies are also seen by the socket
+	if ( ( p = get_ll_probe_payload(	buffer->data, info->frame_len - ETH_HLEN,
+										PROBE_TYPE_REQUEST	) ) == NULL )
+		{ return(NULL); }
+
+	// the reply goes back to the sender of the request, from this interface
+	memcpy(buffer->header.h_dest, buffer->header.h_source, ETH_ALEN);
+	memcpy(buffer->header.h_source, arg->if_mac, ETH_ALEN);
+	reflect_ll_probe(arg->probe, &rx, p);
+
+	return(p);
+
+}
+
+/* process_ieee8023_frame */
+int process_ieee8023_frame
+	(	const public_ev_arg_t *arg, const ll_frame_t *info,
+		const ieee8023_frame_buffer_t *buffer	)
+{
+
+	ll_stats_rx(arg->stats, info->frame_len);
+
+	// frames are either archived or printed, never both
+	if ( arg->capture != NULL )
+		{ return(write_ll_capture(arg->capture, info, buffer)); }
+
+	return(print_ieee8023_frame_buffer(info, buffer));
+
+}
+
 #ifdef KERNEL_RING
 
+/* ieee8023_frame_rx_cb */
+void ieee8023_frame_rx_cb(const public_ev_arg_t *arg)
+{
+
+	ll_frame_t info;
+	const ieee8023_frame_buffer_t *buffer = NULL;
+
+	while ( read_ieee8023_frame(arg->rx_ring, &info, &buffer) == EX_OK )
+	{
+		if ( process_ieee8023_frame(arg, &info, buffer) < 0 )
+		{
+			log_app_msg("Could not process IEEE 802.3 frame.\n");
+		}
+	}
+
+}
+
+/* ieee8023_probe_rx_cb */
+void ieee8023_probe_rx_cb(const public_ev_arg_t *arg)
+{
+
+	ll_frame_t info;
+	const ieee8023_frame_buffer_t *buffer = NULL;
+
+	while ( read_ieee8023_frame(arg->rx_ring, &info, &buffer) == EX_OK )
+		{ __ieee8023_probe_reply(arg, &info, buffer); }
+
+}
+
+/* ieee8023_probe_reflect_cb */
+void ieee8023_probe_reflect_cb(const public_ev_arg_t *arg)
+{
+
+	ll_frame_t info;
+	const ieee8023_frame_buffer_t *buffer = NULL;
+	void *slot = NULL;
+	int max_len = 0, no_replies = 0;
+
+	tx_ring_reclaim(arg->tx_ring);
+
+	while ( read_ieee8023_frame(arg->rx_ring, &info, &buffer) == EX_OK )
+	{
+
+		// frames within the RX ring are read only, replies are built in
+		// the slots of the TX ring
+		if ( ( get_ll_probe_payload(	buffer->data, info.frame_len - ETH_HLEN,
+										PROBE_TYPE_REQUEST	) == NULL ) )
+			{ continue; }
+
+		if ( ( ( slot = tx_ring_get_slot(arg->tx_ring, &max_len) ) == NULL )
+				|| ( info.frame_len > max_len ) )
+		{
+			log_app_msg("TX ring is full, probe dropped.\n");
+			ll_stats_inc(arg->stats, ring_full);
+			continue;
+		}
+
+		memcpy(slot, buffer, info.frame_len);
+		if ( __reflect_ieee8023_probe(arg, &info, slot) == NULL )
+			{ continue; }
+
+		if ( tx_ring_commit(arg->tx_ring, info.frame_len) < 0 )
+		{
+			log_app_msg("Could not commit probe to the TX ring.\n");
+			continue;
+		}
+		ll_stats_tx(arg->stats, info.frame_len);
+		no_replies++;
+
+	}
+
+	if ( ( no_replies > 0 ) && ( tx_ring_flush(arg->tx_ring) < 0 ) )
+	{
+		log_app_msg("Could not flush probe replies.\n");
+		ll_stats_inc(arg->stats, tx_errors);
+	}
+
+}
+
 /* read_ieee8023_frame */
-int read_ieee8023_frame(const void *rx_ring, ieee8023_frame_t *rx_frame)
+int read_ieee8023_frame
+	(	rx_ring_t *rx_ring, ll_frame_t *info,
+		const ieee8023_frame_buffer_t **buffer	)
 {
-		//struct tpacket_hdr *header = NULL;
 
-		//header = (void *) rx_ring + (rxring_offset * getpagesize());
+	tpacket3_hdr_t *header = NULL;
+
+	if ( ( header = rx_ring_next_frame(rx_ring) ) == NULL )
+		{ return(EX_EOF); }
+
+	if ( header->tp_snaplen < ETH_HLEN )
+	{
+		log_app_msg("Read %d bytes, shorter than an IEEE 802.3 header.\n"
+						, header->tp_snaplen);
+	}
+
+	if ( set_ll_frame_tpacket3(info, TYPE_IEEE_8023, header) < 0 )
+	{
+		log_app_msg("Error setting ll_frame's info.\n");
+	}
+
+	*buffer = (const ieee8023_frame_buffer_t *)rx_ring_frame_data(header);
+
+	return(EX_OK);
 
-		log_app_msg("Unsupported mmap reading...\n");
-		return(EX_ERR);
 }
 
 #else
@@ -84,43 +311,145 @@ void ieee8023_frame_rx_cb(const public_ev_arg_t *arg)
 {
 
 	ieee8023_frame_t *f = (ieee8023_frame_t *)arg->buffer;
+	int result = EX_OK;
+
+	// woken up by the error queue only, no frame to be processed
+	if ( ( result = read_ieee8023_frame(arg->socket_fd, f) ) == EX_EOF )
+		{ return; }
 
-	if ( read_ieee8023_frame(arg->socket_fd, f) < 0 )
+	if ( result < 0 )
 	{
 		log_app_msg("Could not read IEEE 802.3 frame.\n");
+		ll_stats_inc(arg->stats, rx_errors);
 		return;
 	}
 
-	if ( print_ieee8023_frame(f) < 0 )
+	if ( process_ieee8023_frame(arg, &f->info, &f->buffer) < 0 )
 	{
-		log_app_msg("Could not print IEEE 802.3 frame.\n");
+		log_app_msg("Could not process IEEE 802.3 frame.\n");
 		return;
 	}
 
 }
 
-/* read_ieee8023_frame */
-int read_ieee8023_frame(const int socket_fd, ieee8023_frame_t *frame)
+/* ieee8023_probe_rx_cb */
+void ieee8023_probe_rx_cb(const public_ev_arg_t *arg)
 {
 
-	int b_read = read(socket_fd, &frame->buffer, ETH_FRAME_LEN);
+	ieee8023_frame_t *f = (ieee8023_frame_t *)arg->buffer;
+	int result = EX_OK;
+
+	// replies are drained until the socket is empty, the timestamps of the
+	// probes sent also wake this watcher up without any frame to be read
+	while ( ( result = read_ieee8023_frame(arg->socket_fd, f) ) == EX_OK )
+		{ __ieee8023_probe_reply(arg, &f->info, &f->buffer); }
 
-	if ( b_read <= 0 )
+	if ( result != EX_EOF )
 	{
-		log_sys_error("Could not read socket");
-		return(EX_ERR);
+		log_app_msg("Could not read IEEE 802.3 frame.\n");
+		ll_stats_inc(arg->stats, rx_errors);
 	}
 
-	if ( b_read < frame->info.frame_len )
+}
+
+/* ieee8023_probe_reflect_cb */
+void ieee8023_probe_reflect_cb(const public_ev_arg_t *arg)
+{
+
+	ieee8023_frame_t *f = (ieee8023_frame_t *)arg->buffer;
+	struct sockaddr_ll addr;
+	int result = EX_OK;
+
+	if ( ( result = read_ieee8023_frame(arg->socket_fd, f) ) == EX_EOF )
+		{ return; }
+
+	if ( result < 0 )
 	{
-		log_app_msg("Read %d bytes, but %d bytes were requested.\n"
-						, b_read, ETH_FRAME_LEN);
+		log_app_msg("Could not read IEEE 802.3 frame.\n");
+		ll_stats_inc(arg->stats, rx_errors);
+		return;
 	}
 
-	if ( set_ll_frame(&frame->info, TYPE_IEEE_8023, b_read) < 0 )
+	// the request is turned into its reply in place
+	if ( __reflect_ieee8023_probe(arg, &f->info, &f->buffer) == NULL )
+		{ return; }
+
+	memset(&addr, 0, sizeof(struct sockaddr_ll));
+	addr.sll_ifindex = arg->if_index;
+	addr.sll_halen = ETH_ALEN;
+	memcpy(addr.sll_addr, f->buffer.header.h_dest, ETH_ALEN);
+
+	// reflectors have no send queue, a reply the kernel cannot take is lost
+	if ( sendto(	arg->socket_fd, &f->buffer, f->info.frame_len, MSG_DONTWAIT,
+					(struct sockaddr *)&addr, sizeof(struct sockaddr_ll)	)
+			< f->info.frame_len )
 	{
-		log_app_msg("Error setting ll_frame's info.\n");
+		log_sys_error("Probe reply could not be sent");
+		ll_stats_inc(arg->stats, tx_errors);
+		return;
+	}
+
+	ll_stats_tx(arg->stats, f->info.frame_len);
+
+}
+
+/* ieee8023_frame_rx_batch_cb */
+void ieee8023_frame_rx_batch_cb(const public_ev_arg_t *arg)
+{
+
+	int no_frames = 0;
+	ieee8023_frame_t *f = NULL;
+
+	// frames are read until the socket is drained or the batch is not full
+	do
+	{
+
+		if ( ( no_frames = read_ieee8023_frame_batch(arg->socket_fd, arg->batch) )
+				< 0 )
+		{
+			log_app_msg("Could not read IEEE 802.3 frames.\n");
+			ll_stats_inc(arg->stats, rx_errors);
+			return;
+		}
+
+		for ( int i = 0; i < no_frames; i++ )
+		{
+			f = (ieee8023_frame_t *)get_ll_frame_batch(arg->batch, i);
+			if ( process_ieee8023_frame(arg, &f->info, &f->buffer) < 0 )
+			{
+				log_app_msg("Could not process IEEE 802.3 frame.\n");
+			}
+		}
+
 	}
+	while ( no_frames == arg->batch->max_frames );
+
+}
+
+/* init_ieee8023_frame_batch */
+ll_frame_batch_t *init_ieee8023_frame_batch(const int max_frames)
+{
+	return(init_ll_frame_batch(	max_frames, LEN__IEEE8023_FRAME,
+								offsetof(ieee8023_frame_t, buffer), ETH_FRAME_LEN	));
+}
+
+/* read_ieee8023_frame_batch */
+int read_ieee8023_frame_batch(const int socket_fd, ll_frame_batch_t *batch)
+{
+	return(read_ll_frame_batch(socket_fd, batch, TYPE_IEEE_8023));
+}
+
+/* read_ieee8023_frame */
+int read_ieee8023_frame(const int socket_fd, ieee8023_frame_t *frame)
+{
+
+	int b_read = recv_ll_frame(	socket_fd, &frame->buffer, ETH_FRAME_LEN,
+								&frame->info, TYPE_IEEE_8023	);
+
+	if ( b_read < 0 )
+		{ return(EX_ERR); }
+	if ( b_read == 0 )
+		{ return(EX_EOF); }
 
 	return(EX_OK);
 
@@ -132,85 +461,266 @@ int read_ieee8023_frame(const int socket_fd, ieee8023_frame_t *frame)
 void ieee8023_frame_tx_cb(const public_ev_arg_t *arg)
 {
 
+#ifdef KERNEL_RING
 	if ( __tx_ieee8023_test_frame
-				(arg->socket_fd, arg->ll_sap, arg->if_index, arg->if_mac) < 0 )
+				(arg->tx_ring, arg->tx_template, NULL, arg->stats) < 0 )
 	{
 		log_app_msg("Could not transmit IEEE 802.3 frame.\n");
 		return;
 	}
 
-	log_app_msg("Sleeping for %d (usecs)...\n", arg->tx_delay);
-	if ( usleep(arg->tx_delay) < 0 )
+	if ( tx_ring_flush(arg->tx_ring) < 0 )
+	{
+		log_app_msg("Could not flush IEEE 802.3 frames.\n");
+		ll_stats_inc(arg->stats, tx_errors);
+		return;
+	}
+#else
+	if ( __tx_ieee8023_test_frame
+				(	arg->pool, arg->tx_queue, arg->if_index,
+					arg->tx_template, NULL	) < 0 )
 	{
-		log_app_msg("Could not sleep for %d.\n", arg->tx_delay);
+		log_app_msg("Could not transmit IEEE 802.3 frame.\n");
 		return;
 	}
+#endif
 
 }
 
+/* ieee8023_probe_tx_cb */
+void ieee8023_probe_tx_cb(const public_ev_arg_t *arg)
+{
+
+	ll_probe_t *probe = arg->probe;
+	struct timespec now;
+
+	// the pacer may resume the watcher once the last probe is gone
+	if ( probe->sent >= probe->count )
+	{
+		pause_ll_tx_queue(get_ll_tx_queue(probe->watcher));
+		return;
+	}
+
+	get_ll_probe_time(probe, &now);
+
+#ifdef KERNEL_RING
+	if ( __tx_ieee8023_test_frame
+				(arg->tx_ring, arg->tx_template, &now, arg->stats) < 0 )
+	{
+		log_app_msg("Could not transmit IEEE 802.3 probe.\n");
+		return;
+	}
+
+	if ( tx_ring_flush(arg->tx_ring) < 0 )
+	{
+		ll_stats_inc(arg->stats, tx_errors);
+		log_app_msg("Could not transmit IEEE 802.3 probe.\n");
+		return;
+	}
+#else
+	if ( __tx_ieee8023_test_frame
+				(	arg->pool, arg->tx_queue, arg->if_index,
+					arg->tx_template, &now	) < 0 )
+	{
+		log_app_msg("Could not transmit IEEE 802.3 probe.\n");
+		return;
+	}
+#endif
+
+	ll_probe_sent(probe);
+
+}
+
+#ifdef KERNEL_RING
+
 /* __tx_ieee8023_test_frame */
 int __tx_ieee8023_test_frame
-	(	const int socket_fd, const int ll_sap, const int if_index,
-		const unsigned char *h_source	)
+	(	tx_ring_t *tx_ring, ll_frame_template_t *template,
+		const struct timespec *ts, ll_stats_t *stats	)
 {
 
-	ieee8023_frame_t *tx_frame
-		= init_ieee8023_frame(ll_sap, h_source, ETH_ADDR_BROADCAST);
-	tx_frame->info.frame_len = ETH_HLEN + 10;
+	void *buffer = NULL;
+	int max_len = 0;
+	int frame_len = 0;
+
+	// 1) slots already sent by the kernel are reused
+	tx_ring_reclaim(tx_ring);
+
+	if ( ( buffer = tx_ring_get_slot(tx_ring, &max_len) ) == NULL )
+	{
+		log_app_msg("TX ring is full, frame dropped.\n");
+		ll_stats_inc(stats, ring_full);
+		return(EX_ERR);
+	}
+
+	// 2) frame is copied from the template, in place, within the slot
+	if ( ( frame_len = write_ll_frame_template
+							(template, buffer, max_len, ts, NULL, 0) ) < 0 )
+	{
+		log_app_msg("Could not write frame from template.\n");
+		return(EX_ERR);
+	}
 
-	if ( print_ieee8023_frame(tx_frame) < 0 )
+	// printing probes would add to the latencies being measured
+	if ( ( ts == NULL )
+			&& ( print_ieee8023_frame_buffer(&template->info, buffer) < 0 ) )
 	{
 		log_app_msg("Frame formatted incorrectly!\n");
 		return(EX_ERR);
 	}
 
-	struct sockaddr_ll socket_address;
-	socket_address.sll_ifindex = if_index;
-	/* Address length*/
-	socket_address.sll_halen = ETH_ALEN;
-	/* Destination MAC */
-	memcpy(socket_address.sll_addr, ETH_ADDR_BROADCAST, ETH_ALEN);
+	// 3) slot is marked for the next flush
+	if ( tx_ring_commit(tx_ring, frame_len) < 0 )
+	{
+		log_app_msg("Could not commit frame to the TX ring.\n");
+		return(EX_ERR);
+	}
+	ll_stats_tx(stats, frame_len);
+
+	return(EX_OK);
+
+}
+
+#else
 
-printf("%d\n",tx_frame->info.frame_len);
-		int b_written = sendto(	socket_fd,&tx_frame->buffer, tx_frame->info.frame_len, 0,(struct sockaddr *)&socket_address,sizeof(struct sockaddr_ll)	);
+/* init_ieee8023_tx_batch */
+ll_frame_batch_t *init_ieee8023_tx_batch
+	(	const int max_frames, const int ll_sap,
+		const unsigned char *h_source, const unsigned char *h_dest	)
+{
 
+	ll_frame_batch_t *b = init_ieee8023_frame_batch(max_frames);
+	ieee8023_frame_t *f = NULL;
 
-	if ( b_written < 0 )
+	for ( int i = 0; i < max_frames; i++ )
 	{
-		log_sys_error("Frame could not be sent");
-		return(EX_SYS);
+		f = (ieee8023_frame_t *)get_ll_frame_batch(b, i);
+		set_ieee8023_header(&f->buffer.header, ll_sap, h_source, h_dest);
+		set_ll_frame(&f->info, TYPE_IEEE_8023, ETH_HLEN + 10);
 	}
 
-	if ( b_written < ETH_FRAME_LEN )
+	b->no_frames = max_frames;
+	b->next_frame = 0;
+
+	return(b);
+
+}
+
+/* send_ieee8023_frame_batch */
+int send_ieee8023_frame_batch
+	(const int socket_fd, ll_frame_batch_t *batch, const int if_index)
+{
+
+	struct sockaddr_ll addr;
+
+	memset(&addr, 0, sizeof(struct sockaddr_ll));
+	addr.sll_family = PF_PACKET;
+	addr.sll_protocol = htons(ETH_P_ALL);
+	addr.sll_ifindex = if_index;
+	addr.sll_halen = ETH_ALEN;
+	memcpy(addr.sll_addr, ETH_ADDR_BROADCAST, ETH_ALEN);
+
+	return(send_ll_frame_batch(socket_fd, batch, &addr));
+
+}
+
+/* ieee8023_frame_tx_batch_cb */
+void ieee8023_frame_tx_batch_cb(const public_ev_arg_t *arg)
+{
+
+	// frames of the batch are reused once all of them have been sent
+	if ( arg->batch->next_frame == arg->batch->no_frames )
+		{ arg->batch->next_frame = 0; }
+
+	if ( send_ieee8023_frame_batch(arg->socket_fd, arg->batch, arg->if_index)
+			< 0 )
 	{
-		log_sys_error("Could not transmit all bytes as requested");
-		return(EX_SYS);
+		log_app_msg("Could not transmit IEEE 802.3 frames.\n");
+		ll_stats_inc(arg->stats, tx_errors);
+		return;
 	}
 
-	return(EX_OK);
+}
+
+/* __tx_ieee8023_test_frame */
+int __tx_ieee8023_test_frame
+	(	ll_frame_pool_t *pool, ll_tx_queue_t *tx_queue, const int if_index,
+		ll_frame_template_t *template, const struct timespec *ts	)
+{
+
+	struct sockaddr_ll socket_address;
+	ieee8023_frame_t *tx_frame = NULL;
+
+	if ( ( tx_frame = (ieee8023_frame_t *)acquire_ll_frame(pool) ) == NULL )
+	{
+		log_app_msg("Frame pool exhausted, frame dropped.\n");
+		return(EX_ERR);
+	}
+
+	if ( write_ll_frame_template(	template, &tx_frame->buffer,
+									pool->frame_size - LEN__LL_FRAME,
+									ts, NULL, 0	) < 0 )
+	{
+		log_app_msg("Could not write frame from template.\n");
+		release_ll_frame(tx_frame);
+		return(EX_ERR);
+	}
+
+	tx_frame->info = template->info;
+
+	// printing probes would add to the latencies being measured
+	if ( ( ts == NULL ) && ( print_ieee8023_frame(tx_frame) < 0 ) )
+	{
+		log_app_msg("Frame formatted incorrectly!\n");
+		release_ll_frame(tx_frame);
+		return(EX_ERR);
+	}
+
+	memset(&socket_address, 0, sizeof(struct sockaddr_ll));
+	socket_address.sll_ifindex = if_index;
+	/* Address length*/
+	socket_address.sll_halen = ETH_ALEN;
+	/* Destination MAC */
+	memcpy(socket_address.sll_addr, tx_frame->buffer.header.h_dest, ETH_ALEN);
+
+	return(send_ll_tx_queue(	tx_queue, tx_frame, &tx_frame->buffer,
+								tx_frame->info.frame_len, &socket_address	));
 
 }
 
+#endif
+
 /* print_ieee8023_frame */
 int print_ieee8023_frame(const ieee8023_frame_t *frame)
 {
+	return(print_ieee8023_frame_buffer(&frame->info, &frame->buffer));
+}
+
+/* print_ieee8023_frame_buffer */
+int print_ieee8023_frame_buffer
+	(const ll_frame_t *info, const ieee8023_frame_buffer_t *buffer)
+{
+
+	// per-frame dumps are debug messages, filtered before being queued
+	if ( log_enabled(LOG_LEVEL_DEBUG) == false )
+		{ return(EX_OK); }
 
-	if ( print_ll_frame(&frame->info) < 0 ) { return(EX_ERR); }
+	if ( print_ll_frame(info) < 0 ) { return(EX_ERR); }
 
-	log_app_msg("\t* header->dst = ");
-		print_eth_address(frame->buffer.header.h_dest);
-		log_app_msg("\n");
-	log_app_msg("\t* header->src = ");
-		print_eth_address(frame->buffer.header.h_source);
-		log_app_msg("\n");
-	log_app_msg("\t* header->sap = %02X\n", frame->buffer.header.h_proto);
+	log_debug_msg("\t* header->dst = ");
+		print_eth_address(buffer->header.h_dest);
+		log_debug_msg("\n");
+	log_debug_msg("\t* header->src = ");
+		print_eth_address(buffer->header.h_source);
+		log_debug_msg("\n");
+	log_debug_msg("\t* header->sap = %02X\n", buffer->header.h_proto);
 
-	int data_len = frame->info.frame_len - ETH_HLEN;
-	log_app_msg("\t* data[%d] = ", data_len);
+	int data_len = info->frame_len - ETH_HLEN;
+	log_debug_msg("\t* data[%d] = ", data_len);
 
-	if ( print_hex_data((char *)&frame->buffer.data, data_len) < 0 )
-		{ log_app_msg("\n"); return(EX_ERR); }
-	log_app_msg("\n");
+	if ( print_hex_data((char *)&buffer->data, data_len) < 0 )
+		{ log_debug_msg("\n"); return(EX_ERR); }
+	log_debug_msg("\n");
 
 	return(EX_OK);
 
@@ -26,6 +26,11 @@
 #include "execution_codes.h"
 #include "logger.h"
 #include "ll_library/ll_frame.h"
+#include "ll_library/ll_frame_template.h"
+#include "ll_library/ll_capture.h"
+#include "ll_library/ll_stats.h"
+#include "ll_library/ll_tx_queue.h"
+#include "ll_library/ll_probe.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -35,6 +40,7 @@
 #include <inttypes.h>
 #include <linux/if_ether.h>
 #include <linux/if_packet.h>
+#include <arpa/inet.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 
@@ -77,28 +83,83 @@ typedef struct ieee8023_frame
 /******************************************************* IEEE 802.3 functions */
 
 /*!
-	\brief Allocates memory for an ethhdr structure, including MAX PAYLOAD.
+	\brief Takes from the pool the memory for an ethhdr structure.
+	\param pool The pool where to take the frame from.
 	\return A pointer to the newly allocated block of memory.
 */
-struct ethhdr *new_ethhdr();
+struct ethhdr *new_ethhdr(ll_frame_pool_t *pool);
 
 /*!
-	\brief Allocates memory for a ieee8023_buffer structure.
+	\brief Takes from the pool the memory for a ieee8023_frame structure.
+	\param pool The pool where to take the frame from.
 	\return A pointer to the newly allocated block of memory.
 */
-ieee8023_frame_t *new_ieee8023_frame();
+ieee8023_frame_t *new_ieee8023_frame(ll_frame_pool_t *pool);
 
 /*!
  * \brief Initializes an IEEE 802.3 frame with the given data.
+ * \param pool The pool where to take the frame from.
  * \param ll_sap Link layer Service Access Point.
  * \param h_source Pointer to the MAC source address.
  * \param h_dest Pointer to the buffer that holds the MAC destination.
  * \return A pointer to the initialized structure.
  */
 ieee8023_frame_t *init_ieee8023_frame
+	(	ll_frame_pool_t *pool, const int ll_sap,
+		const unsigned char *h_source, const unsigned char *h_dest	);
+
+/*!
+ * \brief Sets the header of an IEEE 802.3 frame with the given data.
+ * \param header The header to be set.
+ * \param ll_sap Link layer Service Access Point.
+ * \param h_source Pointer to the MAC source address.
+ * \param h_dest Pointer to the buffer that holds the MAC destination.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int set_ieee8023_header
+	(	eth_header_t *header, const int ll_sap,
+		const unsigned char *h_source, const unsigned char *h_dest	);
+
+/*!
+ * \brief Creates the template of the IEEE 802.3 test frames sent to the given
+ * 			destination: a null payload whose first bytes carry the sequence
+ * 			number of the frame.
+ * \param ll_sap Link layer Service Access Point.
+ * \param h_source Pointer to the MAC source address.
+ * \param h_dest Pointer to the buffer that holds the MAC destination.
+ * \return A pointer to the new template, NULL in case of error.
+ */
+ll_frame_template_t *init_ieee8023_test_template
 	(	const int ll_sap,
 		const unsigned char *h_source, const unsigned char *h_dest	);
 
+/*!
+ * \brief Creates the template of the IEEE 802.3 latency probes: the payload
+ * 			carries a ll_probe_payload_t whose sequence number and transmission
+ * 			time are patched for every probe sent.
+ * \param ll_sap Link layer Service Access Point.
+ * \param h_source Pointer to the MAC source address.
+ * \param h_dest Pointer to the buffer that holds the MAC destination.
+ * \param probe Probes of the socket, for the clock of the stamps.
+ * \return A pointer to the new template, NULL in case of error.
+ */
+ll_frame_template_t *init_ieee8023_probe_template
+	(	const int ll_sap,
+		const unsigned char *h_source, const unsigned char *h_dest,
+		const ll_probe_t *probe	);
+
+/*!
+ * \brief Processes a frame received: it is stored in the capture of the
+ * 			socket, if any, or printed out otherwise.
+ * \param arg Argument given by the event handler.
+ * \param info Info of the frame.
+ * \param buffer Header + data of the frame.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int process_ieee8023_frame
+	(	const public_ev_arg_t *arg, const ll_frame_t *info,
+		const ieee8023_frame_buffer_t *buffer	);
+
 /*!
  * \brief Callback function to be called whenever an IEEE 802.3 frame is
  * 			received.
@@ -113,28 +174,145 @@ void ieee8023_frame_rx_cb(const public_ev_arg_t *arg);
  */
 void ieee8023_frame_tx_cb(const public_ev_arg_t *arg);
 
+/*!
+ * \brief Callback function for the pinger, sends the next latency probe
+ * 			stamped with the time of its transmission.
+ * \param arg Argument given by the event handler.
+ */
+void ieee8023_probe_tx_cb(const public_ev_arg_t *arg);
+
+/*!
+ * \brief Callback function for the pinger, records the latencies of the
+ * 			replies received. Any other frame is ignored.
+ * \param arg Argument given by the event handler.
+ */
+void ieee8023_probe_rx_cb(const public_ev_arg_t *arg);
+
+/*!
+ * \brief Callback function for the reflector, returns every probe received
+ * 			to its sender. Any other frame is ignored.
+ * \param arg Argument given by the event handler.
+ */
+void ieee8023_probe_reflect_cb(const public_ev_arg_t *arg);
+
 #ifdef KERNEL_RING
-	int read_ieee8023_frame(const void *rx_ring, ieee8023_frame_t *rx_frame);
-	int __tx_ieee8023_test_frame
-		(const void *tx_ring, const int ll_sap, const unsigned char *h_source);
+
+	/*!
+	 * \brief Gets the next IEEE 802.3 frame available within the RX ring.
+	 * 			The frame is not copied, the buffer remains valid until the
+	 * 			next frame is read from the same ring.
+	 * \param rx_ring The ring from where to read the frame.
+	 * \param info Structure where the info of the frame is to be set.
+	 * \param buffer Set to the header + data of the frame, in place.
+	 * \return EX_OK if a frame was read, EX_EOF if no more frames are ready.
+	 */
+	int read_ieee8023_frame
+		(	rx_ring_t *rx_ring, ll_frame_t *info,
+			const ieee8023_frame_buffer_t **buffer	);
+
 #else
 
 	/*!
 	 * \brief Reads from a socket an ll_framebuffer.
 	 * \param socket_fd The socket from where to read the frame.
 	 * \param rx_frame Structure for reading the IEEE 802.3 frame.
-	 * \return EX_OK if everything was correct; otherwise < 0.
+	 * \return EX_OK if a frame was read, EX_EOF if no frame was ready;
+	 * 			otherwise < 0.
 	 */
 	int read_ieee8023_frame(const int socket_fd, ieee8023_frame_t *rx_frame);
 
 	/*!
-	 * \brief Writes to a socket an IEEE 802.3 frame, filled up with null data.
-	 * \param socket_fd The socket where to write the frame.
+	 * \brief Allocates a batch for the reception of IEEE 802.3 frames.
+	 * \param max_frames Maximum number of frames per batch.
+	 * \return A pointer to the newly allocated batch.
+	 */
+	ll_frame_batch_t *init_ieee8023_frame_batch(const int max_frames);
+
+	/*!
+	 * \brief Reads from a socket a batch of IEEE 802.3 frames with a single
+	 * 			system call.
+	 * \param socket_fd The socket from where to read the frames.
+	 * \param batch The batch where the frames are to be stored.
+	 * \return Number of frames read (>=0), <0 in case of error.
+	 */
+	int read_ieee8023_frame_batch
+		(const int socket_fd, ll_frame_batch_t *batch);
+
+	/*!
+	 * \brief Callback function to be called whenever IEEE 802.3 frames are
+	 * 			received, it drains a whole batch of frames at a time.
+	 * \param arg Argument given by the event handler.
+	 */
+	void ieee8023_frame_rx_batch_cb(const public_ev_arg_t *arg);
+
+#endif
+
+#ifdef KERNEL_RING
+
+	/*!
+	 * \brief Writes an IEEE 802.3 test frame out of the given template,
+	 * 			directly within the next slot of the TX ring. The frame is
+	 * 			sent with the next flush of the ring.
+	 * \param tx_ring The ring where to build the frame.
+	 * \param template Template of the test frame.
+	 * \param ts Time written into the frame, NULL for plain test frames.
+	 * 			Stamped frames are latency probes, they are not printed out.
+	 * \param stats Counters of the socket, NULL if there are none.
+	 * \return EX_OK if everything was correct; othewise < 0.
+	 */
+	int __tx_ieee8023_test_frame
+		(	tx_ring_t *tx_ring, ll_frame_template_t *template,
+			const struct timespec *ts, ll_stats_t *stats	);
+
+#else
+
+	/*!
+	 * \brief Writes to a socket an IEEE 802.3 test frame out of the given
+	 * 			template. The frame is taken from the pool and given back
+	 * 			once sent (the send queue may keep it for a while).
+	 * \param pool The pool where to take the frame from.
+	 * \param tx_queue Send queue of the socket.
+	 * \param if_index Index of the interface to send the frame through.
+	 * \param template Template of the test frame.
+	 * \param ts Time written into the frame, NULL for plain test frames.
+	 * 			Stamped frames are latency probes, they are not printed out.
 	 * \return EX_OK if everything was correct; othewise < 0.
 	 */
 	int __tx_ieee8023_test_frame
-		(	const int socket_fd, const int ll_sap, const int if_index,
-			const unsigned char *h_source	);
+		(	ll_frame_pool_t *pool, ll_tx_queue_t *tx_queue, const int if_index,
+			ll_frame_template_t *template, const struct timespec *ts	);
+
+	/*!
+	 * \brief Allocates a batch of IEEE 802.3 test frames, whose headers and
+	 * 			data are built only once so that the batch can be transmitted
+	 * 			over and over again.
+	 * \param max_frames Number of frames of the batch.
+	 * \param ll_sap Link layer Service Access Point.
+	 * \param h_source Source MAC for the test frames.
+	 * \param h_dest Destination MAC for the test frames.
+	 * \return A pointer to the newly allocated batch.
+	 */
+	ll_frame_batch_t *init_ieee8023_tx_batch
+		(	const int max_frames, const int ll_sap,
+			const unsigned char *h_source, const unsigned char *h_dest	);
+
+	/*!
+	 * \brief Writes to a socket the IEEE 802.3 frames of a batch not yet
+	 * 			transmitted, with as few system calls as possible.
+	 * \param socket_fd The socket where to write the frames.
+	 * \param batch The batch with the frames to be written.
+	 * \param if_index Index of the interface for the transmission.
+	 * \return Number of frames sent (>=0), <0 in case of error.
+	 */
+	int send_ieee8023_frame_batch
+		(const int socket_fd, ll_frame_batch_t *batch, const int if_index);
+
+	/*!
+	 * \brief Callback function to be called whenever a batch of IEEE 802.3
+	 * 			frames is to be transmitted.
+	 * \param arg Argument given by the event handler.
+	 */
+	void ieee8023_frame_tx_batch_cb(const public_ev_arg_t *arg);
 
 #endif
 
@@ -145,4 +323,15 @@ void ieee8023_frame_tx_cb(const public_ev_arg_t *arg);
  */
 int print_ieee8023_frame(const ieee8023_frame_t *frame);
 
+/*!
+ * \brief Prints the data of an IEEE 802.3 frame whose info and contents are
+ * 			stored separately (for instance, frames read in place).
+ * 			Frames are only printed in debug mode.
+ * \param info Info of the frame to be printed out.
+ * \param buffer Header + data of the frame to be printed out.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int print_ieee8023_frame_buffer
+	(const ll_frame_t *info, const ieee8023_frame_buffer_t *buffer);
+
 #endif /* IEEE8023_FRAME_H_ */
@@ -0,0 +1,326 @@
+/*
+ * @file ll_backend.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_backend.h"
+
+/* new_ll_backend */
+ll_backend_t *new_ll_backend()
+{
+
+	ll_backend_t *b = NULL;
+	b = (ll_backend_t *)malloc(LEN__LL_BACKEND);
+	memset(b, 0, LEN__LL_BACKEND);
+	b->fd = -1;
+	b->peer_fd = -1;
+	return(b);
+
+}
+
+/* __open_pair */
+static int __open_pair(int fds[2])
+{
+
+	int len = BACKEND_SOCKET_BUFFER;
+
+	// SOCK_SEQPACKET keeps frame boundaries and ignores the addresses given
+	// to sendto()/sendmmsg(), so callbacks can keep their sockaddr_ll
+	if ( socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) < 0 )
+	{
+		log_sys_error("Could not open socket pair");
+		return(EX_SYS);
+	}
+
+	for ( int i = 0; i < 2; i++ )
+	{
+		if ( ( setsockopt(fds[i], SOL_SOCKET, SO_SNDBUF, &len, sizeof(int))
+					< 0 )
+				|| ( setsockopt(fds[i], SOL_SOCKET, SO_RCVBUF, &len, sizeof(int))
+					< 0 ) )
+			{ log_sys_error("Could not set buffers of socket pair"); }
+	}
+
+	return(EX_OK);
+
+}
+
+/* __feed_frames */
+static void *__feed_frames(void *arg)
+{
+
+	ll_backend_t *b = (ll_backend_t *)arg;
+	ll_replay_t *r = b->replay;
+
+	// the socket reads the frames at its own pace, send() blocks meanwhile
+	while ( next_ll_replay_frame(r) == EX_OK )
+	{
+		if ( send(b->peer_fd, r->next_data, r->next_len, MSG_NOSIGNAL) < 0 )
+		{
+			if ( errno == EINTR )
+				{ continue; }
+			break;
+		}
+		b->frames++;
+		b->bytes += r->next_len;
+	}
+
+	// the socket reads the end of file once the frames queued are drained
+	shutdown(b->peer_fd, SHUT_WR);
+	return(NULL);
+
+}
+
+/* __sink_frames */
+static void *__sink_frames(void *arg)
+{
+
+	ll_backend_t *b = (ll_backend_t *)arg;
+	uint8_t buffer[CAPTURE_SNAPLEN];
+	ll_frame_t info;
+	int len = 0;
+
+	memset(&info, 0, LEN__LL_FRAME);
+
+	// the socket closing its end stops the thread
+	while ( ( len = recv(b->peer_fd, buffer, CAPTURE_SNAPLEN, 0) ) != 0 )
+	{
+
+		if ( len < 0 )
+		{
+			if ( errno == EINTR )
+				{ continue; }
+			break;
+		}
+
+		b->frames++;
+		b->bytes += len;
+
+		if ( b->capture == NULL )
+			{ continue; }
+
+		info.frame_len = len;
+		info.orig_len = len;
+		info.ts_source = get_clock_timestamp(&info.timestamp);
+		write_ll_capture(b->capture, &info, buffer);
+
+	}
+
+	return(NULL);
+
+}
+
+/* __set_mac */
+static void __set_mac(ll_backend_t *b, const unsigned char id)
+{
+	// locally administered, unicast
+	b->mac[0] = 0x02;
+	b->mac[ETH_ALEN - 1] = id;
+}
+
+/* init_ll_backend */
+ll_backend_t *init_ll_backend
+	(	const int type, const char *path, const int format,
+		const int linktype, const bool is_transmitter	)
+{
+
+	ll_backend_t *b = new_ll_backend();
+	int fds[2] = { -1, -1 };
+
+	b->type = type;
+
+	switch ( type )
+	{
+		case LL_BACKEND_PACKET:
+			return(b);
+
+		case LL_BACKEND_PCAP:
+
+			if ( path == NULL )
+			{
+				log_app_msg("pcap backend needs a capture file.\n");
+				free(b);
+				return(NULL);
+			}
+
+			if ( is_transmitter == true )
+			{
+				b->capture = init_ll_capture(path, format, linktype, 0, 0);
+				b->serve = __sink_frames;
+			}
+			else
+			{
+				b->replay = init_ll_replay(path, REPLAY_SPEED_MAX, 1, 0);
+				b->serve = __feed_frames;
+			}
+
+			if ( ( b->capture == NULL ) && ( b->replay == NULL ) )
+			{
+				free(b);
+				return(NULL);
+			}
+			break;
+
+		case LL_BACKEND_LOOPBACK:
+
+			if ( is_transmitter == false )
+			{
+				log_app_msg("loop backend alone has nothing to receive.\n");
+				free(b);
+				return(NULL);
+			}
+			b->serve = __sink_frames;
+			break;
+
+		default:
+
+			log_app_msg("Unknown backend type = %d\n", type);
+			free(b);
+			return(NULL);
+	}
+
+	if ( __open_pair(fds) < 0 )
+	{
+		close_ll_backend(b);
+		return(NULL);
+	}
+
+	b->fd = fds[0];
+	b->peer_fd = fds[1];
+	__set_mac(b, 1);
+
+	return(b);
+
+}
+
+/* start_ll_backend */
+int start_ll_backend(ll_backend_t *backend)
+{
+
+	if ( backend == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( ( backend->serve == NULL ) || ( backend->has_thread == true ) )
+		{ return(EX_OK); }
+
+	if ( pthread_create(&backend->thread, NULL, backend->serve, backend) != 0 )
+	{
+		log_app_msg("Could not start backend thread.\n");
+		return(EX_ERR);
+	}
+	backend->has_thread = true;
+
+	return(EX_OK);
+
+}
+
+/* init_ll_backend_pair */
+int init_ll_backend_pair(ll_backend_t **a, ll_backend_t **b)
+{
+
+	int fds[2] = { -1, -1 };
+
+	if ( ( a == NULL ) || ( b == NULL ) )
+		{ return(EX_NULL_PARAM); }
+
+	if ( __open_pair(fds) < 0 )
+		{ return(EX_SYS); }
+
+	// each socket owns its end, there is no peer end left to serve
+	*a = new_ll_backend();
+	(*a)->type = LL_BACKEND_LOOPBACK;
+	(*a)->fd = fds[0];
+	__set_mac(*a, 1);
+
+	*b = new_ll_backend();
+	(*b)->type = LL_BACKEND_LOOPBACK;
+	(*b)->fd = fds[1];
+	__set_mac(*b, 2);
+
+	return(EX_OK);
+
+}
+
+/* close_ll_backend */
+int close_ll_backend(ll_backend_t *backend)
+{
+
+	int result = EX_OK;
+
+	if ( backend == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	// a feeder blocked in send() is woken up, a sink reads its end of file
+	if ( backend->peer_fd >= 0 )
+		{ shutdown(backend->peer_fd, SHUT_RDWR); }
+
+	if ( backend->has_thread == true )
+	{
+		pthread_join(backend->thread, NULL);
+		log_app_msg("Backend thread done, frames = %lu, bytes = %lu\n"
+					, backend->frames, backend->bytes);
+	}
+
+	if ( ( backend->peer_fd >= 0 ) && ( close(backend->peer_fd) < 0 ) )
+	{
+		log_sys_error("Could not close backend");
+		result = EX_SYS;
+	}
+
+	if ( ( backend->replay != NULL )
+			&& ( close_ll_replay(backend->replay) < 0 ) )
+		{ result = EX_ERR; }
+
+	if ( ( backend->capture != NULL )
+			&& ( close_ll_capture(backend->capture) < 0 ) )
+		{ result = EX_ERR; }
+
+	free(backend);
+	return(result);
+
+}
+
+/* is_ll_backend_eof */
+bool is_ll_backend_eof(const ll_backend_t *backend)
+{
+
+	if ( is_ll_backend_virtual(backend) == false )
+		{ return(false); }
+
+	// MSG_TRUNC returns the length of the next frame, 0 only at the end
+	return( recv(	backend->fd, NULL, 0,
+					MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT	) == 0 );
+
+}
+
+/* backend_type_from_name */
+int backend_type_from_name(const char *name)
+{
+
+	if ( strcmp(name, "packet") == 0 )
+		{ return(LL_BACKEND_PACKET); }
+	if ( strcmp(name, "pcap") == 0 )
+		{ return(LL_BACKEND_PCAP); }
+	if ( strcmp(name, "loop") == 0 )
+		{ return(LL_BACKEND_LOOPBACK); }
+
+	return(EX_WRONG_PARAM);
+
+}
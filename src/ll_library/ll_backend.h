@@ -0,0 +1,158 @@
+/*
+ * @file ll_backend.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions of the I/O backends of the sockets. Only
+ * the AF_PACKET backend needs a live interface; the others hand the socket
+ * one end of a SOCK_SEQPACKET socket pair, so that the rx/tx callbacks,
+ * filters and parsers work unchanged on their file descriptor. The other
+ * end is either served by a thread (capture files, frame sink) or given to
+ * a second socket (in-memory loopback pair).
+ */
+
+#ifndef LL_BACKEND_H_
+#define LL_BACKEND_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_frame.h"
+#include "ll_library/ll_capture.h"
+#include "ll_library/ll_replay.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <sys/socket.h>
+
+/**************************************************************** DATA TYPES */
+
+#define LL_BACKEND_PACKET		0	/*!< AF_PACKET socket, live interface. */
+#define LL_BACKEND_PCAP			1	/*!< Capture file, read RX / written TX. */
+#define LL_BACKEND_LOOPBACK		2	/*!< In-memory pair, or frame sink. */
+
+#define BACKEND_SOCKET_BUFFER	( 4 * 1024 * 1024 )	/*!< Buffers of pair (B). */
+#define BACKEND_IF_INDEX		0	/*!< Index of all virtual interfaces. */
+
+/*!
+ * \struct ll_backend
+ * \brief I/O backend of a socket.
+ */
+typedef struct ll_backend
+{
+
+	int type;						/*!< LL_BACKEND_*. */
+	int fd;							/*!< End for the socket, -1 if AF_PACKET. */
+	int peer_fd;					/*!< End for the thread or the peer. */
+	unsigned char mac[ETH_ALEN];	/*!< MAC of the virtual interface. */
+
+	ll_replay_t *replay;			/*!< Capture fed to the socket (RX). */
+	ll_capture_t *capture;			/*!< Capture written by the socket (TX). */
+
+	void *(*serve)(void *);			/*!< Body of the thread, if any. */
+	pthread_t thread;				/*!< Thread serving the peer end. */
+	bool has_thread;				/*!< The thread was started. */
+
+	uint64_t frames;				/*!< Frames moved by the thread. */
+	uint64_t bytes;					/*!< Bytes moved by the thread. */
+
+} ll_backend_t;
+
+#define LEN__LL_BACKEND sizeof(ll_backend_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a backend.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_backend_t *new_ll_backend();
+
+/*!
+ * \brief Creates a backend for a single socket. With LL_BACKEND_PCAP, the
+ * 			frames of the given file are received as fast as the socket
+ * 			reads them (RX), or the frames sent are written to it (TX). With
+ * 			LL_BACKEND_LOOPBACK, the frames sent are discarded (TX only).
+ * 			Nothing flows until start_ll_backend() is called.
+ * \param type Type of the backend (LL_BACKEND_*).
+ * \param path Capture file of LL_BACKEND_PCAP, ignored otherwise.
+ * \param format Format of the capture written (CAPTURE_FORMAT_*).
+ * \param linktype Link layer type of the capture written (LINKTYPE_*).
+ * \param is_transmitter Whether the socket transmits or receives.
+ * \return A pointer to the new backend, NULL in case of error.
+ */
+ll_backend_t *init_ll_backend
+	(	const int type, const char *path, const int format,
+		const int linktype, const bool is_transmitter	);
+
+/*!
+ * \brief Starts the thread that serves the peer end of the backend, if any.
+ * 			Frames only start to flow then, once the socket is configured
+ * 			(filters, batches...).
+ * \param backend The backend to be started.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int start_ll_backend(ll_backend_t *backend);
+
+/*!
+ * \brief Creates two loopback backends connected to each other: every frame
+ * 			sent by the socket of one of them is received by the other one.
+ * \param a Where the first backend is to be stored.
+ * \param b Where the second backend is to be stored.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int init_ll_backend_pair(ll_backend_t **a, ll_backend_t **b);
+
+/*!
+ * \brief Stops the thread of the backend and releases it. The end of the
+ * 			socket is closed together with the socket.
+ * \param backend The backend to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_ll_backend(ll_backend_t *backend);
+
+/*!
+ * \brief Checks whether all the frames of the backend were already read.
+ * \param backend The backend to be checked (NULL for AF_PACKET).
+ * \return true if no frame will ever be received again.
+ */
+bool is_ll_backend_eof(const ll_backend_t *backend);
+
+/*!
+ * \brief Checks whether the backend works without a live interface.
+ * \param backend The backend to be checked (NULL for AF_PACKET).
+ * \return true if the backend is not an AF_PACKET socket.
+ */
+static inline bool is_ll_backend_virtual(const ll_backend_t *backend)
+	{ return( ( backend != NULL ) && ( backend->type != LL_BACKEND_PACKET ) ); }
+
+/*!
+ * \brief Gets the type of backend from its name.
+ * \param name Name of the backend ("packet", "pcap" or "loop").
+ * \return LL_BACKEND_*, <0 if the name is unknown.
+ */
+int backend_type_from_name(const char *name);
+
+#endif /* LL_BACKEND_H_ */
@@ -0,0 +1,474 @@
+/*
+ * @file ll_capture.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_capture.h"
+
+/* new_ll_capture */
+ll_capture_t *new_ll_capture()
+{
+
+	ll_capture_t *c = NULL;
+	c = (ll_capture_t *)malloc(LEN__LL_CAPTURE);
+	memset(c, 0, LEN__LL_CAPTURE);
+	return(c);
+
+}
+
+/* __write_all */
+static int __write_all(const int fd, const void *data, const int len)
+{
+
+	const uint8_t *p = (const uint8_t *)data;
+	int left = len, written = 0;
+
+	while ( left > 0 )
+	{
+		if ( ( written = write(fd, p, left) ) < 0 )
+		{
+			if ( errno == EINTR )
+				{ continue; }
+			return(EX_SYS);
+		}
+		p += written;
+		left -= written;
+	}
+
+	return(EX_OK);
+
+}
+
+/* __put_u16 */
+static uint8_t *__put_u16(uint8_t *p, const uint16_t value)
+	{ memcpy(p, &value, sizeof(uint16_t)); return(p + sizeof(uint16_t)); }
+
+/* __put_u32 */
+static uint8_t *__put_u32(uint8_t *p, const uint32_t value)
+	{ memcpy(p, &value, sizeof(uint32_t)); return(p + sizeof(uint32_t)); }
+
+/* __write_file_header */
+static int __write_file_header(ll_capture_t *c)
+{
+
+	uint8_t header[64], *p = header;
+	pcap_file_header_t pcap;
+	int64_t section_len = -1;
+
+	if ( c->format == CAPTURE_FORMAT_PCAP )
+	{
+		memset(&pcap, 0, sizeof(pcap_file_header_t));
+		pcap.magic = PCAP_MAGIC_NSECS;
+		pcap.version_major = 2;
+		pcap.version_minor = 4;
+		pcap.snaplen = CAPTURE_SNAPLEN;
+		pcap.linktype = c->linktype;
+		memcpy(header, &pcap, sizeof(pcap_file_header_t));
+		p += sizeof(pcap_file_header_t);
+	}
+	else
+	{
+		// section header block, the length of the section is unknown
+		p = __put_u32(p, PCAPNG_SHB_TYPE);
+		p = __put_u32(p, 28);
+		p = __put_u32(p, PCAPNG_BYTE_ORDER);
+		p = __put_u16(p, 1);
+		p = __put_u16(p, 0);
+		memcpy(p, &section_len, sizeof(int64_t));
+		p += sizeof(int64_t);
+		p = __put_u32(p, 28);
+		// interface description block, with nanosecond timestamps
+		p = __put_u32(p, PCAPNG_IDB_TYPE);
+		p = __put_u32(p, 32);
+		p = __put_u16(p, c->linktype);
+		p = __put_u16(p, 0);
+		p = __put_u32(p, CAPTURE_SNAPLEN);
+		p = __put_u16(p, PCAPNG_OPT_TSRESOL);
+		p = __put_u16(p, 1);
+		p = __put_u32(p, PCAPNG_TSRESOL_NSECS);
+		p = __put_u32(p, 0);
+		p = __put_u32(p, 32);
+	}
+
+	if ( __write_all(c->fd, header, p - header) < 0 )
+		{ return(EX_SYS); }
+
+	c->file_bytes = p - header;
+	return(EX_OK);
+
+}
+
+/* __open_capture_file */
+static int __open_capture_file(ll_capture_t *c)
+{
+
+	char path[CAPTURE_PATH_LEN + 16];
+
+	// rotated files are numbered, a single file keeps the given path
+	if ( ( c->max_file_bytes > 0 ) || ( c->max_file_secs > 0 ) )
+		{ snprintf(path, sizeof(path), "%s.%d", c->path, c->file_index); }
+	else
+		{ snprintf(path, sizeof(path), "%s", c->path); }
+
+	if ( ( c->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) ) < 0 )
+	{
+		log_sys_error("Could not open capture file");
+		return(EX_SYS);
+	}
+
+	if ( __write_file_header(c) < 0 )
+	{
+		log_sys_error("Could not write capture file header");
+		close(c->fd);
+		c->fd = -1;
+		return(EX_SYS);
+	}
+
+	c->file_opened = time(NULL);
+	log_app_msg("Capturing frames to %s\n", path);
+
+	return(EX_OK);
+
+}
+
+/* __rotate_capture_file */
+static int __rotate_capture_file(ll_capture_t *c, const int len)
+{
+
+	bool rotate = false;
+	bool has_records = ( c->file_bytes > ( ( c->format == CAPTURE_FORMAT_PCAP )
+										? sizeof(pcap_file_header_t)
+										: PCAPNG_HEADERS_LEN ) );
+
+	if ( ( c->max_file_bytes > 0 ) && has_records
+			&& ( c->file_bytes + len > c->max_file_bytes ) )
+		{ rotate = true; }
+	if ( ( c->max_file_secs > 0 )
+			&& ( time(NULL) - c->file_opened >= c->max_file_secs ) )
+		{ rotate = true; }
+
+	if ( rotate == false )
+		{ return(EX_OK); }
+
+	if ( close(c->fd) < 0 )
+		{ log_sys_error("Could not close capture file"); }
+
+	c->file_index++;
+	return(__open_capture_file(c));
+
+}
+
+/* __capture_writer */
+static void *__capture_writer(void *arg)
+{
+
+	ll_capture_t *c = (ll_capture_t *)arg;
+	ll_capture_buffer_t *b = NULL;
+
+	for ( ;; )
+	{
+
+		pthread_mutex_lock(&c->lock);
+		while ( ( c->buffers[0].full == false )
+					&& ( c->buffers[1].full == false )
+					&& ( c->closing == false ) )
+			{ pthread_cond_wait(&c->cond, &c->lock); }
+		b = ( c->buffers[0].full == true ) ? &c->buffers[0]
+				: ( ( c->buffers[1].full == true ) ? &c->buffers[1] : NULL );
+		pthread_mutex_unlock(&c->lock);
+
+		// closing and nothing else to be written
+		if ( b == NULL )
+			{ break; }
+
+		if ( ( c->fd < 0 ) || ( __rotate_capture_file(c, b->len) < 0 ) )
+			{ log_app_msg("No capture file, %d B lost.\n", b->len); }
+		else if ( __write_all(c->fd, b->data, b->len) < 0 )
+			{ log_sys_error("Could not write capture file"); }
+		else
+			{ c->file_bytes += b->len; }
+
+		pthread_mutex_lock(&c->lock);
+		b->len = 0;
+		b->full = false;
+		pthread_cond_broadcast(&c->cond);
+		pthread_mutex_unlock(&c->lock);
+
+	}
+
+	return(NULL);
+
+}
+
+/* __swap_capture_buffers */
+static void __swap_capture_buffers(ll_capture_t *c)
+{
+
+	pthread_mutex_lock(&c->lock);
+
+	// the writer is still busy with the other buffer, disk is the bottleneck
+	while ( c->buffers[1 - c->active].full == true )
+		{ pthread_cond_wait(&c->cond, &c->lock); }
+
+	c->buffers[c->active].full = true;
+	c->active = 1 - c->active;
+	c->last_swap = time(NULL);
+
+	pthread_cond_broadcast(&c->cond);
+	pthread_mutex_unlock(&c->lock);
+
+}
+
+/* __cb_flush */
+static void __cb_flush(struct ev_loop *loop, ev_timer *timer, int revents)
+{
+
+	ll_capture_t *c = (ll_capture_t *)timer;
+
+	// runs within the loop that writes the frames, buffers are not shared
+	if ( ( c->buffers[c->active].len > 0 )
+			&& ( time(NULL) - c->last_swap >= CAPTURE_FLUSH_SECS ) )
+		{ __swap_capture_buffers(c); }
+
+}
+
+/* init_ll_capture */
+ll_capture_t *init_ll_capture
+	(	const char *path, const int format, const int linktype,
+		const uint64_t max_file_bytes, const int max_file_secs	)
+{
+
+	ll_capture_t *c = NULL;
+
+	if ( ( path == NULL ) || ( strlen(path) >= CAPTURE_PATH_LEN ) )
+		{ return(NULL); }
+	if ( ( format != CAPTURE_FORMAT_PCAP ) && ( format != CAPTURE_FORMAT_PCAPNG ) )
+		{ return(NULL); }
+
+	c = new_ll_capture();
+	c->format = format;
+	c->linktype = linktype;
+	strncpy(c->path, path, CAPTURE_PATH_LEN - 1);
+	c->max_file_bytes = max_file_bytes;
+	c->max_file_secs = max_file_secs;
+	c->last_swap = time(NULL);
+	c->fd = -1;
+	ev_timer_init(	&c->flush_timer, __cb_flush,
+					CAPTURE_FLUSH_SECS / 2.0, CAPTURE_FLUSH_SECS / 2.0	);
+
+	for ( int i = 0; i < 2; i++ )
+	{
+		if ( posix_memalign(	(void **)&c->buffers[i].data,
+								CAPTURE_BUFFER_ALIGN, CAPTURE_BUFFER_LEN	) != 0 )
+		{
+			log_app_msg("Could not allocate capture buffers.\n");
+			free(c->buffers[0].data);
+			free(c);
+			return(NULL);
+		}
+	}
+
+	if ( __open_capture_file(c) < 0 )
+	{
+		free(c->buffers[0].data);
+		free(c->buffers[1].data);
+		free(c);
+		return(NULL);
+	}
+
+	pthread_mutex_init(&c->lock, NULL);
+	pthread_cond_init(&c->cond, NULL);
+
+	if ( pthread_create(&c->writer, NULL, __capture_writer, c) != 0 )
+	{
+		log_sys_error("Could not start capture writer");
+		close(c->fd);
+		free(c->buffers[0].data);
+		free(c->buffers[1].data);
+		free(c);
+		return(NULL);
+	}
+
+	return(c);
+
+}
+
+/* start_ll_capture_flush */
+void start_ll_capture_flush(ll_capture_t *capture, struct ev_loop *loop)
+{
+	capture->loop = loop;
+	ev_timer_start(loop, &capture->flush_timer);
+}
+
+/* close_ll_capture */
+int close_ll_capture(ll_capture_t *capture)
+{
+
+	int result = EX_OK;
+
+	if ( capture == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( capture->loop != NULL )
+		{ ev_timer_stop(capture->loop, &capture->flush_timer); }
+
+	if ( capture->buffers[capture->active].len > 0 )
+		{ __swap_capture_buffers(capture); }
+
+	pthread_mutex_lock(&capture->lock);
+	capture->closing = true;
+	pthread_cond_broadcast(&capture->cond);
+	pthread_mutex_unlock(&capture->lock);
+
+	pthread_join(capture->writer, NULL);
+
+	if ( ( capture->fd >= 0 ) && ( close(capture->fd) < 0 ) )
+	{
+		log_sys_error("Could not close capture file");
+		result = EX_SYS;
+	}
+
+	log_app_msg("Capture closed, frames = %lu, bytes = %lu, files = %d\n"
+					, capture->frames, capture->bytes, capture->file_index + 1);
+
+	pthread_mutex_destroy(&capture->lock);
+	pthread_cond_destroy(&capture->cond);
+	free(capture->buffers[0].data);
+	free(capture->buffers[1].data);
+	free(capture);
+
+	return(result);
+
+}
+
+/* write_ll_capture */
+int write_ll_capture
+	(ll_capture_t *capture, const ll_frame_t *info, const void *data)
+{
+
+	ll_capture_buffer_t *b = NULL;
+	pcap_record_header_t record;
+	pcapng_epb_header_t block;
+	uint8_t *p = NULL;
+	uint64_t nsecs = 0;
+	int caplen = info->frame_len, padding = 0, rec_len = 0;
+	uint32_t orig_len = 0;
+
+	if ( caplen < 0 )
+		{ return(EX_WRONG_PARAM); }
+
+	// frames cut by the ring (tp_snaplen) keep their length on the wire
+	orig_len = ( info->orig_len > caplen ) ? info->orig_len : caplen;
+	if ( caplen > CAPTURE_SNAPLEN )
+		{ caplen = CAPTURE_SNAPLEN; }
+
+	if ( capture->format == CAPTURE_FORMAT_PCAP )
+		{ rec_len = sizeof(pcap_record_header_t) + caplen; }
+	else
+	{
+		padding = ( 4 - ( caplen & 3 ) ) & 3;
+		rec_len = sizeof(pcapng_epb_header_t) + caplen + padding
+					+ sizeof(uint32_t);
+	}
+
+	b = &capture->buffers[capture->active];
+	if ( b->len + rec_len > CAPTURE_BUFFER_LEN )
+	{
+		__swap_capture_buffers(capture);
+		b = &capture->buffers[capture->active];
+	}
+
+	p = b->data + b->len;
+
+	if ( capture->format == CAPTURE_FORMAT_PCAP )
+	{
+		record.ts_sec = info->timestamp.tv_sec;
+		record.ts_nsec = info->timestamp.tv_nsec;
+		record.incl_len = caplen;
+		record.orig_len = orig_len;
+		memcpy(p, &record, sizeof(pcap_record_header_t));
+		memcpy(p + sizeof(pcap_record_header_t), data, caplen);
+	}
+	else
+	{
+		nsecs = info->timestamp.tv_sec * (uint64_t)1000000000
+					+ info->timestamp.tv_nsec;
+		block.type = PCAPNG_EPB_TYPE;
+		block.len = rec_len;
+		block.interface_id = 0;
+		block.ts_high = (uint32_t)( nsecs >> 32 );
+		block.ts_low = (uint32_t)nsecs;
+		block.captured_len = caplen;
+		block.orig_len = orig_len;
+		memcpy(p, &block, sizeof(pcapng_epb_header_t));
+		p += sizeof(pcapng_epb_header_t);
+		memcpy(p, data, caplen);
+		memset(p + caplen, 0, padding);
+		__put_u32(p + caplen + padding, rec_len);
+	}
+
+	b->len += rec_len;
+	capture->frames++;
+	capture->bytes += caplen;
+
+	// buffered frames reach the disk within CAPTURE_FLUSH_SECS
+	if ( time(NULL) - capture->last_swap >= CAPTURE_FLUSH_SECS )
+		{ __swap_capture_buffers(capture); }
+
+	return(EX_OK);
+
+}
+
+/* get_capture_linktype */
+int get_capture_linktype(const int if_hatype)
+{
+
+	switch ( if_hatype )
+	{
+		case ARPHRD_IEEE80211_RADIOTAP:	return(LINKTYPE_IEEE802_11_RADIOTAP);
+		case ARPHRD_IEEE80211:			return(LINKTYPE_IEEE802_11);
+		default:						return(LINKTYPE_ETHERNET);
+	}
+
+}
+
+/* get_frame_linktype */
+int get_frame_linktype(const int frame_type)
+{
+
+	if ( frame_type == TYPE_IEEE_80211 )
+		{ return(LINKTYPE_IEEE802_11); }
+
+	return(LINKTYPE_ETHERNET);
+
+}
+
+/* capture_format_from_name */
+int capture_format_from_name(const char *name)
+{
+
+	if ( strcmp(name, "pcap") == 0 )
+		{ return(CAPTURE_FORMAT_PCAP); }
+	if ( strcmp(name, "pcapng") == 0 )
+		{ return(CAPTURE_FORMAT_PCAPNG); }
+
+	return(EX_WRONG_PARAM);
+
+}
@@ -0,0 +1,243 @@
+/*
+ * @file ll_capture.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for storing the received frames in
+ * capture files (pcap or pcapng). Records are serialized into one of two
+ * large, page-aligned buffers while a writer thread writes the other one
+ * to disk, so that the reception path only performs memory copies. Files
+ * can be rotated once they reach a given size or age.
+ */
+
+#ifndef LL_CAPTURE_H_
+#define LL_CAPTURE_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_frame.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <net/if_arp.h>
+#include <ev.h>
+
+/**************************************************************** DATA TYPES */
+
+#define CAPTURE_FORMAT_PCAP			0		/*!< libpcap, nanosecond stamps. */
+#define CAPTURE_FORMAT_PCAPNG		1		/*!< pcapng, nanosecond stamps. */
+
+#define LINKTYPE_ETHERNET			1		/*!< IEEE 802.3. */
+#define LINKTYPE_IEEE802_11			105		/*!< IEEE 802.11, no radio info. */
+#define LINKTYPE_IEEE802_11_RADIOTAP	127	/*!< IEEE 802.11 + radiotap. */
+
+#define CAPTURE_BUFFER_LEN		( 4 * 1024 * 1024 )	/*!< Buffer length (B). */
+#define CAPTURE_BUFFER_ALIGN	4096		/*!< Alignment of the buffers. */
+#define CAPTURE_SNAPLEN			65535		/*!< Maximum bytes per frame. */
+#define CAPTURE_FLUSH_SECS		1			/*!< Max. age of buffered data. */
+#define CAPTURE_PATH_LEN		256			/*!< Maximum length of paths. */
+
+#define PCAP_MAGIC_NSECS		0xA1B23C4D	/*!< pcap magic, nanoseconds. */
+#define PCAPNG_SHB_TYPE			0x0A0D0D0A	/*!< Section header block. */
+#define PCAPNG_IDB_TYPE			0x00000001	/*!< Interface description. */
+#define PCAPNG_EPB_TYPE			0x00000006	/*!< Enhanced packet block. */
+#define PCAPNG_BYTE_ORDER		0x1A2B3C4D	/*!< Byte order magic. */
+#define PCAPNG_OPT_TSRESOL		9			/*!< if_tsresol option. */
+#define PCAPNG_TSRESOL_NSECS	9			/*!< Timestamps in nanoseconds. */
+#define PCAPNG_HEADERS_LEN		60			/*!< SHB + IDB length (B). */
+
+/*!
+ * \struct pcap_file_header
+ * \brief Global header of a pcap file.
+ */
+typedef struct pcap_file_header
+{
+
+	uint32_t magic;				/*!< Magic number (byte order, resolution). */
+	uint16_t version_major;		/*!< Major version (2). */
+	uint16_t version_minor;		/*!< Minor version (4). */
+	int32_t thiszone;			/*!< GMT offset (0). */
+	uint32_t sigfigs;			/*!< Accuracy of timestamps (0). */
+	uint32_t snaplen;			/*!< Maximum length of the records. */
+	uint32_t linktype;			/*!< Link layer type of the frames. */
+
+} __attribute__((packed)) pcap_file_header_t;
+
+/*!
+ * \struct pcap_record_header
+ * \brief Header of each of the frames of a pcap file.
+ */
+typedef struct pcap_record_header
+{
+
+	uint32_t ts_sec;			/*!< Timestamp, seconds. */
+	uint32_t ts_nsec;			/*!< Timestamp, nanoseconds. */
+	uint32_t incl_len;			/*!< Bytes of the frame stored. */
+	uint32_t orig_len;			/*!< Length of the frame. */
+
+} __attribute__((packed)) pcap_record_header_t;
+
+/*!
+ * \struct pcapng_epb_header
+ * \brief Header of the enhanced packet blocks of a pcapng file, followed by
+ * 			the frame (padded to 32 bits) and the length of the block.
+ */
+typedef struct pcapng_epb_header
+{
+
+	uint32_t type;				/*!< Block type (6). */
+	uint32_t len;				/*!< Total length of the block. */
+	uint32_t interface_id;		/*!< Interface of the frame (0). */
+	uint32_t ts_high;			/*!< Timestamp (nsecs), upper 32 bits. */
+	uint32_t ts_low;			/*!< Timestamp (nsecs), lower 32 bits. */
+	uint32_t captured_len;		/*!< Bytes of the frame stored. */
+	uint32_t orig_len;			/*!< Length of the frame. */
+
+} __attribute__((packed)) pcapng_epb_header_t;
+
+/*!
+ * \struct ll_capture_buffer
+ * \brief One of the two buffers where records are serialized.
+ */
+typedef struct ll_capture_buffer
+{
+
+	uint8_t *data;				/*!< Page aligned memory. */
+	int len;					/*!< Bytes used. */
+	bool full;					/*!< Handed over to the writer thread. */
+
+} ll_capture_buffer_t;
+
+/*!
+ * \struct ll_capture
+ * \brief Capture file (or set of rotated files) being written. The flush
+ * 			timer is the first field so that its callback gets the capture.
+ */
+typedef struct ll_capture
+{
+
+	ev_timer flush_timer;				/*!< Flushes idle buffers (first!). */
+	struct ev_loop *loop;				/*!< Loop of the socket, if any. */
+
+	int format;							/*!< CAPTURE_FORMAT_*. */
+	int linktype;						/*!< LINKTYPE_* of the frames. */
+	char path[CAPTURE_PATH_LEN];		/*!< Path of the capture. */
+
+	int fd;								/*!< Current file, -1 if none. */
+	int file_index;						/*!< Index of the current file. */
+	uint64_t file_bytes;				/*!< Bytes written to current file. */
+	uint64_t max_file_bytes;			/*!< Rotation by size, 0 if off. */
+	int max_file_secs;					/*!< Rotation by age, 0 if off. */
+	time_t file_opened;					/*!< Opening time of the file. */
+
+	ll_capture_buffer_t buffers[2];		/*!< Double buffer. */
+	int active;							/*!< Buffer being filled. */
+	time_t last_swap;					/*!< Time of the last hand over. */
+
+	pthread_t writer;					/*!< Thread writing to disk. */
+	pthread_mutex_t lock;				/*!< Protects the hand overs. */
+	pthread_cond_t cond;				/*!< Signals the hand overs. */
+	bool closing;						/*!< Writer thread must finish. */
+
+	uint64_t frames;					/*!< Frames captured. */
+	uint64_t bytes;						/*!< Bytes of the frames captured. */
+
+} ll_capture_t;
+
+#define LEN__LL_CAPTURE sizeof(ll_capture_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a capture.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_capture_t *new_ll_capture();
+
+/*!
+ * \brief Creates a capture and starts its writer thread. The first file is
+ * 			opened right away so that errors are reported to the caller.
+ * \param path Path of the capture file; rotated files get an index suffix.
+ * \param format Format of the file (CAPTURE_FORMAT_*).
+ * \param linktype Link layer type of the frames (LINKTYPE_*).
+ * \param max_file_bytes Size that triggers a rotation (B), 0 to disable it.
+ * \param max_file_secs Age that triggers a rotation (s), 0 to disable it.
+ * \return A pointer to the new capture, NULL in case of error.
+ */
+ll_capture_t *init_ll_capture
+	(	const char *path, const int format, const int linktype,
+		const uint64_t max_file_bytes, const int max_file_secs	);
+
+/*!
+ * \brief Starts the timer that hands the buffer being filled over to the
+ * 			writer thread once its data is CAPTURE_FLUSH_SECS old, so that
+ * 			frames reach the disk even if no more frames are received.
+ * \param capture The capture to be flushed.
+ * \param loop Loop of the socket that writes the frames to the capture.
+ */
+void start_ll_capture_flush(ll_capture_t *capture, struct ev_loop *loop);
+
+/*!
+ * \brief Writes out all the frames buffered, stops the writer thread and
+ * 			releases the capture.
+ * \param capture The capture to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_ll_capture(ll_capture_t *capture);
+
+/*!
+ * \brief Appends a frame to the capture. Only memory is copied, unless both
+ * 			buffers are full, in which case the caller waits for the writer.
+ * \param capture The capture where the frame is to be stored.
+ * \param info Info of the frame (lengths and timestamp).
+ * \param data Contents of the frame.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int write_ll_capture
+	(ll_capture_t *capture, const ll_frame_t *info, const void *data);
+
+/*!
+ * \brief Gets the link layer type of the frames received through an
+ * 			interface, out of its hardware type.
+ * \param if_hatype Hardware type of the interface (ARPHRD_*).
+ * \return LINKTYPE_* of the interface.
+ */
+int get_capture_linktype(const int if_hatype);
+
+/*!
+ * \brief Gets the link layer type of the frames of the given type, for the
+ * 			frames that do not come from a live interface.
+ * \param frame_type Type of the frames (TYPE_IEEE_*).
+ * \return LINKTYPE_* of the frames.
+ */
+int get_frame_linktype(const int frame_type);
+
+/*!
+ * \brief Gets the capture format from its name.
+ * \param name Name of the format ("pcap" or "pcapng").
+ * \return CAPTURE_FORMAT_*, <0 if the name is unknown.
+ */
+int capture_format_from_name(const char *name);
+
+#endif /* LL_CAPTURE_H_ */
@@ -0,0 +1,233 @@
+/*
+ * @file ll_fanout.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "ll_fanout.h"
+
+/* new_ll_fanout */
+ll_fanout_t *new_ll_fanout(const int no_workers)
+{
+
+	ll_fanout_t *buffer = NULL;
+	buffer = (ll_fanout_t *)malloc(LEN__LL_FANOUT);
+	memset(buffer, 0, LEN__LL_FANOUT);
+
+	buffer->no_workers = no_workers;
+	buffer->workers = (ll_socket_t **)calloc(no_workers, sizeof(ll_socket_t *));
+	buffer->threads = (pthread_t *)calloc(no_workers, sizeof(pthread_t));
+
+	return(buffer);
+
+}
+
+/* fanout_mode_from_name */
+int fanout_mode_from_name(const char *name)
+{
+
+	if ( name == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( strcmp(name, "hash") == 0 )		{ return(FANOUT_MODE_HASH); }
+	if ( strcmp(name, "lb") == 0 )			{ return(FANOUT_MODE_LB); }
+	if ( strcmp(name, "cpu") == 0 )			{ return(FANOUT_MODE_CPU); }
+	if ( strcmp(name, "rollover") == 0 )	{ return(FANOUT_MODE_ROLLOVER); }
+
+	return(EX_WRONG_PARAM);
+
+}
+
+/* set_fanout_ll_socket */
+int set_fanout_ll_socket
+	(const ll_socket_t *ll_socket, const int group_id, const int mode)
+{
+
+	int fanout_arg = ( group_id & 0xFFFF ) | ( mode << 16 );
+
+	#ifdef KERNEL_RING
+	if ( setsockopt(	ll_socket->rx_socket_fd, SOL_PACKET, PACKET_FANOUT,
+						&fanout_arg, sizeof(int)	) < 0 )
+	#else
+	if ( setsockopt(	ll_socket->socket_fd, SOL_PACKET, PACKET_FANOUT,
+						&fanout_arg, sizeof(int)	) < 0 )
+	#endif
+	{
+		log_sys_error("Could not join fanout group");
+		return(EX_SYS);
+	}
+
+	return(EX_OK);
+
+}
+
+/* open_ll_fanout */
+ll_fanout_t *open_ll_fanout
+	(	const int no_workers, const int mode,
+		const char *ll_if_name, const int ll_sap, const int frame_type	)
+{
+
+	ll_fanout_t *f = NULL;
+	ll_socket_t *w = NULL;
+	struct ev_loop *loop = NULL;
+
+	if ( ( no_workers <= 0 ) || ( no_workers > FANOUT_MAX_WORKERS ) )
+	{
+		log_app_msg("Wrong number of workers = %d, maximum = %d.\n"
+						, no_workers, FANOUT_MAX_WORKERS);
+		return(NULL);
+	}
+
+	f = new_ll_fanout(no_workers);
+	f->group_id = getpid() & 0xFFFF;
+	f->mode = mode;
+
+	for ( int i = 0; i < no_workers; i++ )
+	{
+
+		// 1) every worker gets its own socket, buffer and event loop, but
+		// no TX ring since workers only receive
+		if ( ( loop = ev_loop_new(EVFLAG_AUTO) ) == NULL )
+		{
+			log_app_msg("Could not create loop of worker #%d.\n", i);
+			close_ll_fanout(f);
+			return(NULL);
+		}
+
+		if ( ( w = init_rx_worker_ll_socket
+					(ll_if_name, ll_sap, frame_type, loop) ) == NULL )
+		{
+			log_app_msg("Could not open worker #%d.\n", i);
+			ev_loop_destroy(loop);
+			close_ll_fanout(f);
+			return(NULL);
+		}
+
+		// from now on, closing the fanout closes the worker as well
+		f->workers[i] = w;
+
+		// 2) sockets must be bound before joining the group
+		if ( bind_ll_socket(w, false) < 0 )
+		{
+			log_app_msg("Could not bind worker #%d.\n", i);
+			close_ll_fanout(f);
+			return(NULL);
+		}
+
+		if ( set_fanout_ll_socket(w, f->group_id, f->mode) < 0 )
+		{
+			log_app_msg("Worker #%d could not join fanout group = %d.\n"
+							, i, f->group_id);
+			close_ll_fanout(f);
+			return(NULL);
+		}
+
+	}
+
+	log_app_msg("Fanout group = %d open, mode = %d, workers = %d.\n"
+					, f->group_id, f->mode, f->no_workers);
+
+	return(f);
+
+}
+
+/* __run_fanout_worker */
+static void *__run_fanout_worker(void *arg)
+{
+	start_ll_socket((ll_socket_t *)arg);
+	return(NULL);
+}
+
+/* start_ll_fanout */
+int start_ll_fanout(ll_fanout_t *fanout)
+{
+
+	int result = EX_OK;
+	long no_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	cpu_set_t cpus;
+
+	for ( int i = 0; i < fanout->no_workers; i++ )
+	{
+
+		if ( pthread_create(	&fanout->threads[i], NULL,
+								__run_fanout_worker, fanout->workers[i]	) != 0 )
+			{ handle_sys_error("Could not create worker thread"); }
+
+		// each worker is kept on its own CPU whenever there are enough
+		if ( fanout->no_workers <= no_cpus )
+		{
+			CPU_ZERO(&cpus);
+			CPU_SET(i, &cpus);
+			if ( pthread_setaffinity_np
+					(fanout->threads[i], sizeof(cpu_set_t), &cpus) != 0 )
+			{
+				log_app_msg("Could not pin worker #%d to CPU #%d.\n", i, i);
+			}
+		}
+
+	}
+
+	for ( int i = 0; i < fanout->no_workers; i++ )
+	{
+		if ( pthread_join(fanout->threads[i], NULL) != 0 )
+		{
+			log_app_msg("Could not join worker #%d.\n", i);
+			result = EX_ERR;
+		}
+	}
+
+	return(result);
+
+}
+
+/* close_ll_fanout */
+int close_ll_fanout(ll_fanout_t *fanout)
+{
+
+	int result = EX_OK;
+
+	if ( fanout == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	// a fanout only partially opened has the rest of its workers NULL
+	for ( int i = 0; i < fanout->no_workers; i++ )
+	{
+
+		if ( fanout->workers[i] == NULL )
+			{ continue; }
+
+		if ( close_ll_socket(fanout->workers[i]) < 0 )
+		{
+			log_app_msg("Could not close worker #%d.\n", i);
+			result = EX_ERR;
+		}
+
+		ev_loop_destroy(fanout->workers[i]->loop);
+
+	}
+
+	free(fanout->workers);
+	free(fanout->threads);
+	free(fanout);
+
+	return(result);
+
+}
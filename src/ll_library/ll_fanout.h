@@ -0,0 +1,126 @@
+/*
+ * @file ll_fanout.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for multi-threaded frames reception. A
+ * fanout group is composed of several ll_sockets open over the same link
+ * layer interface and joined into a single PACKET_FANOUT group, so that the
+ * kernel spreads the received frames among them. Each of these sockets is
+ * served by its own worker thread, running its own event loop.
+ */
+
+#ifndef LL_FANOUT_H_
+#define LL_FANOUT_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_socket.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+/**************************************************************** DATA TYPES */
+
+#define FANOUT_MODE_HASH		PACKET_FANOUT_HASH		/*!< Flow hash. */
+#define FANOUT_MODE_LB			PACKET_FANOUT_LB		/*!< Round robin. */
+#define FANOUT_MODE_CPU			PACKET_FANOUT_CPU		/*!< Receiving CPU. */
+#define FANOUT_MODE_ROLLOVER	PACKET_FANOUT_ROLLOVER	/*!< Fill one first. */
+
+#define FANOUT_MAX_WORKERS		64	/*!< Maximum number of workers. */
+
+/*!
+ * \struct ll_fanout
+ * \brief Structure with the information for handling a group of ll_sockets
+ * 			that share the frames received from the same interface.
+ */
+typedef struct ll_fanout
+{
+
+	int group_id;					/*!< Identifier of the fanout group. */
+	int mode;						/*!< Fanout mode (FANOUT_MODE_*). */
+
+	int no_workers;					/*!< Number of workers of the group. */
+	ll_socket_t **workers;			/*!< ll_socket owned by each worker. */
+	pthread_t *threads;				/*!< Thread running each worker. */
+
+} ll_fanout_t;
+
+#define LEN__LL_FANOUT sizeof(ll_fanout_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for an ll_fanout structure, including the arrays
+ * 			for the given number of workers.
+ * \param no_workers Number of workers of the group.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_fanout_t *new_ll_fanout(const int no_workers);
+
+/*!
+ * \brief Gets the fanout mode from its name.
+ * \param name Name of the mode: "hash", "lb", "cpu" or "rollover".
+ * \return The fanout mode (>=0), EX_WRONG_PARAM if the name is unknown.
+ */
+int fanout_mode_from_name(const char *name);
+
+/*!
+ * \brief Joins the RX socket of the given ll_socket to a fanout group.
+ * \param ll_socket The socket to be joined, already bound.
+ * \param group_id Identifier of the fanout group.
+ * \param mode Fanout mode (FANOUT_MODE_*).
+ * \return EX_OK if the socket joined the group, <0 otherwise.
+ */
+int set_fanout_ll_socket
+	(const ll_socket_t *ll_socket, const int group_id, const int mode);
+
+/*!
+ * \brief Opens a group of receiving ll_sockets over the same interface, all
+ * 			of them joined to the same fanout group. Each ll_socket gets its
+ * 			own event loop and its own reception buffer.
+ * \param no_workers Number of sockets (and threads) of the group.
+ * \param mode Fanout mode (FANOUT_MODE_*).
+ * \param ll_if_name Name of the link layer level interface.
+ * \param ll_sap Link layer service access point.
+ * \param frame_type Selects the type of frame to be managed.
+ * \return The group information structure or NULL if a problem occurred.
+ */
+ll_fanout_t *open_ll_fanout
+	(	const int no_workers, const int mode,
+		const char *ll_if_name, const int ll_sap, const int frame_type	);
+
+/*!
+ * \brief Starts one thread per worker, each running the event loop of its
+ * 			own ll_socket, and waits until all of them finish.
+ * \param fanout The group to be started.
+ * \return EX_OK if all the workers finished correctly, <0 otherwise.
+ */
+int start_ll_fanout(ll_fanout_t *fanout);
+
+/*!
+ * \brief Closes all the sockets of the given group.
+ * \param fanout The group to be closed.
+ * \return EX_OK if all the sockets were closed correctly, <0 otherwise.
+ */
+int close_ll_fanout(ll_fanout_t *fanout);
+
+#endif /* LL_FANOUT_H_ */
@@ -0,0 +1,388 @@
+/*
+ * @file ll_filter.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_filter.h"
+
+/* new_ll_filter */
+ll_filter_t *new_ll_filter()
+{
+	ll_filter_t *buffer = NULL;
+	buffer = (ll_filter_t *)malloc(LEN__LL_FILTER);
+	memset(buffer, 0, LEN__LL_FILTER);
+	return(buffer);
+}
+
+/* __field_from_name */
+static int __field_from_name(const char *name)
+{
+
+	if ( strcmp(name, "dst") == 0 ) { return(FILTER_FIELD_DST); }
+	if ( strcmp(name, "src") == 0 ) { return(FILTER_FIELD_SRC); }
+	if ( strcmp(name, "ethertype") == 0 ) { return(FILTER_FIELD_ETHERTYPE); }
+	if ( strcmp(name, "type") == 0 ) { return(FILTER_FIELD_TYPE); }
+	if ( strcmp(name, "subtype") == 0 ) { return(FILTER_FIELD_SUBTYPE); }
+
+	return(EX_WRONG_PARAM);
+
+}
+
+/* __parse_rule */
+static int __parse_rule
+	(	const int frame_type, const char *field, const char *value,
+		ll_filter_rule_t *rule	)
+{
+
+	char *end = NULL;
+	unsigned int m[ETH_ALEN];
+
+	if ( ( rule->field = __field_from_name(field) ) < 0 )
+	{
+		log_app_msg("Unknown filter field = %s.\n", field);
+		return(EX_WRONG_PARAM);
+	}
+
+	switch ( rule->field )
+	{
+		case FILTER_FIELD_DST:
+		case FILTER_FIELD_SRC:
+
+			if ( sscanf(value, "%2x:%2x:%2x:%2x:%2x:%2x",
+							&m[0], &m[1], &m[2], &m[3], &m[4], &m[5]) != 6 )
+			{
+				log_app_msg("Wrong MAC address = %s.\n", value);
+				return(EX_WRONG_PARAM);
+			}
+			for ( int i = 0; i < ETH_ALEN; i++ )
+				{ rule->mac[i] = (unsigned char)m[i]; }
+			return(EX_OK);
+
+		case FILTER_FIELD_ETHERTYPE:
+
+			if ( frame_type != TYPE_IEEE_8023 )
+			{
+				log_app_msg("Field ethertype is only valid for IEEE 802.3.\n");
+				return(EX_WRONG_PARAM);
+			}
+			break;
+
+		default:
+
+			if ( frame_type != TYPE_IEEE_80211 )
+			{
+				log_app_msg("Field %s is only valid for IEEE 802.11.\n", field);
+				return(EX_WRONG_PARAM);
+			}
+			break;
+
+	}
+
+	rule->value = (int)strtol(value, &end, 0);
+	if ( ( *end != '\0' ) || ( rule->value < 0 ) )
+	{
+		log_app_msg("Wrong value = %s for field %s.\n", value, field);
+		return(EX_WRONG_PARAM);
+	}
+
+	return(EX_OK);
+
+}
+
+/* parse_ll_filter */
+ll_filter_t *parse_ll_filter(const int frame_type, const char *expression)
+{
+
+	char *copy = NULL, *field = NULL, *value = NULL, *save = NULL;
+	ll_filter_t *f = NULL;
+
+	if ( ( frame_type != TYPE_IEEE_8023 ) && ( frame_type != TYPE_IEEE_80211 ) )
+	{
+		log_app_msg("Frames of type = %d cannot be filtered.\n", frame_type);
+		return(NULL);
+	}
+
+	f = new_ll_filter();
+	f->frame_type = frame_type;
+	copy = strdup(expression);
+
+	for ( field = strtok_r(copy, " \t", &save); field != NULL;
+			field = strtok_r(NULL, " \t", &save) )
+	{
+
+		if ( strcmp(field, "and") == 0 )
+			{ continue; }
+
+		if ( f->no_rules == FILTER_MAX_RULES )
+		{
+			log_app_msg("Too many rules in filter, maximum = %d.\n"
+							, FILTER_MAX_RULES);
+			goto error;
+		}
+
+		if ( ( value = strtok_r(NULL, " \t", &save) ) == NULL )
+		{
+			log_app_msg("Missing value for filter field = %s.\n", field);
+			goto error;
+		}
+
+		if ( __parse_rule(frame_type, field, value, &f->rules[f->no_rules])
+				< 0 )
+			{ goto error; }
+
+		f->no_rules++;
+
+	}
+
+	free(copy);
+	return(f);
+
+error:
+
+	free(copy);
+	free(f);
+	return(NULL);
+
+}
+
+/* __emit */
+static void __emit
+	(	struct sock_filter *code, int *len,
+		const uint16_t op, const uint8_t jt, const uint8_t jf,
+		const uint32_t k	)
+{
+
+	struct sock_filter i = BPF_JUMP(op, k, jt, jf);
+	code[(*len)++] = i;
+
+}
+
+/* __emit_mac */
+static void __emit_mac
+	(struct sock_filter *code, int *len, const int offset,
+		const unsigned char *mac, const uint16_t mode)
+{
+
+	uint32_t high = ( (uint32_t)mac[0] << 24 ) | ( (uint32_t)mac[1] << 16 )
+					| ( (uint32_t)mac[2] << 8 ) | mac[3];
+	uint32_t low = ( (uint32_t)mac[4] << 8 ) | mac[5];
+
+	__emit(code, len, BPF_LD | BPF_W | mode, 0, 0, offset);
+	__emit(code, len, BPF_JMP | BPF_JEQ | BPF_K, 0, 0, high);
+	__emit(code, len, BPF_LD | BPF_H | mode, 0, 0, offset + 4);
+	__emit(code, len, BPF_JMP | BPF_JEQ | BPF_K, 0, 0, low);
+
+}
+
+/* __emit_radiotap_len */
+static void __emit_radiotap_len(struct sock_filter *code, int *len)
+{
+
+	// X = it_len, little endian whatever the byte order of the host is
+	__emit(	code, len, BPF_LD | BPF_B | BPF_ABS, 0, 0,
+			FILTER_RADIOTAP_LEN_OFFSET + 1	);
+	__emit(code, len, BPF_ALU | BPF_LSH | BPF_K, 0, 0, 8);
+	__emit(code, len, BPF_MISC | BPF_TAX, 0, 0, 0);
+	__emit(	code, len, BPF_LD | BPF_B | BPF_ABS, 0, 0,
+			FILTER_RADIOTAP_LEN_OFFSET	);
+	__emit(code, len, BPF_ALU | BPF_OR | BPF_X, 0, 0, 0);
+	__emit(code, len, BPF_MISC | BPF_TAX, 0, 0, 0);
+
+}
+
+/* compile_ll_filter */
+sock_fprog_t *compile_ll_filter(const ll_filter_t *filter)
+{
+
+	struct sock_filter code[FILTER_MAX_LEN];
+	int len = 0, reject = 0;
+	bool is_80211 = ( filter->frame_type == TYPE_IEEE_80211 );
+	uint16_t mode = BPF_ABS;
+	const ll_filter_rule_t *r = NULL;
+	sock_fprog_t *p = NULL;
+
+	// 1) the 802.11 header starts after the radiotap one, if any
+	if ( ( is_80211 == true ) && ( filter->has_radiotap == true ) )
+	{
+		__emit_radiotap_len(code, &len);
+		mode = BPF_IND;
+	}
+
+	// 2) every rule falls through on a match, any mismatch jumps to reject
+	for ( int i = 0; i < filter->no_rules; i++ )
+	{
+
+		r = &filter->rules[i];
+
+		switch ( r->field )
+		{
+			case FILTER_FIELD_DST:
+
+				__emit_mac(	code, &len, is_80211 ? FILTER_80211_DST_OFFSET
+											: FILTER_8023_DST_OFFSET,
+							r->mac, mode	);
+				break;
+
+			case FILTER_FIELD_SRC:
+
+				__emit_mac(	code, &len, is_80211 ? FILTER_80211_SRC_OFFSET
+											: FILTER_8023_SRC_OFFSET,
+							r->mac, mode	);
+				break;
+
+			case FILTER_FIELD_ETHERTYPE:
+
+				__emit(	code, &len, BPF_LD | BPF_H | BPF_ABS, 0, 0,
+						FILTER_8023_PROTO_OFFSET	);
+				__emit(	code, &len, BPF_JMP | BPF_JEQ | BPF_K, 0, 0,
+						r->value & 0xFFFF	);
+				break;
+
+			case FILTER_FIELD_TYPE:
+
+				__emit(	code, &len, BPF_LD | BPF_B | mode, 0, 0,
+						FILTER_80211_FC_OFFSET	);
+				__emit(code, &len, BPF_ALU | BPF_AND | BPF_K, 0, 0, 0x0C);
+				__emit(	code, &len, BPF_JMP | BPF_JEQ | BPF_K, 0, 0,
+						( r->value & 0x03 ) << 2	);
+				break;
+
+			case FILTER_FIELD_SUBTYPE:
+
+				__emit(	code, &len, BPF_LD | BPF_B | mode, 0, 0,
+						FILTER_80211_FC_OFFSET	);
+				__emit(code, &len, BPF_ALU | BPF_AND | BPF_K, 0, 0, 0xF0);
+				__emit(	code, &len, BPF_JMP | BPF_JEQ | BPF_K, 0, 0,
+						( r->value & 0x0F ) << 4	);
+				break;
+
+			default:
+
+				log_app_msg("Unknown filter field = %d.\n", r->field);
+				return(NULL);
+
+		}
+
+	}
+
+	__emit(code, &len, BPF_RET | BPF_K, 0, 0, FILTER_ACCEPT);
+	reject = len;
+	__emit(code, &len, BPF_RET | BPF_K, 0, 0, FILTER_REJECT);
+
+	// 3) jumps are relative to the next instruction
+	for ( int i = 0; i < reject; i++ )
+	{
+		if ( code[i].code == ( BPF_JMP | BPF_JEQ | BPF_K ) )
+			{ code[i].jf = reject - i - 1; }
+	}
+
+	p = (sock_fprog_t *)malloc(LEN__SOCK_FPROG);
+	p->len = len;
+	p->filter = (struct sock_filter *)malloc(len * sizeof(struct sock_filter));
+	memcpy(p->filter, code, len * sizeof(struct sock_filter));
+
+	return(p);
+
+}
+
+/* free_ll_filter_program */
+void free_ll_filter_program(sock_fprog_t *program)
+{
+
+	if ( program == NULL )
+		{ return; }
+
+	free(program->filter);
+	free(program);
+
+}
+
+/* __rx_socket_fd */
+static int __rx_socket_fd(const ll_socket_t *ll_socket)
+{
+	#ifdef KERNEL_RING
+		return(ll_socket->rx_socket_fd);
+	#else
+		return(ll_socket->socket_fd);
+	#endif
+}
+
+/* set_filter_ll_socket */
+int set_filter_ll_socket(ll_socket_t *ll_socket, const char *expression)
+{
+
+	ll_filter_t *f = NULL;
+	sock_fprog_t *p = NULL;
+
+	if ( ( ll_socket == NULL ) || ( expression == NULL ) )
+		{ return(EX_NULL_PARAM); }
+
+	if ( ( f = parse_ll_filter(ll_socket->frame_type, expression) ) == NULL )
+		{ return(EX_WRONG_PARAM); }
+	f->has_radiotap = ( ll_socket->if_hatype == ARPHRD_IEEE80211_RADIOTAP );
+
+	p = compile_ll_filter(f);
+	free(f);
+
+	if ( p == NULL )
+		{ return(EX_ERR); }
+
+	// the kernel swaps the old program for the new one atomically
+	if ( setsockopt(	__rx_socket_fd(ll_socket), SOL_SOCKET, SO_ATTACH_FILTER,
+						p, LEN__SOCK_FPROG	) < 0 )
+	{
+		log_sys_error("Could not attach BPF filter");
+		free_ll_filter_program(p);
+		return(EX_SYS);
+	}
+
+	p = __atomic_exchange_n(&ll_socket->filter, p, __ATOMIC_ACQ_REL);
+	free_ll_filter_program(p);
+
+	return(EX_OK);
+
+}
+
+/* clear_filter_ll_socket */
+int clear_filter_ll_socket(ll_socket_t *ll_socket)
+{
+
+	int dummy = 0;
+	sock_fprog_t *p = NULL;
+
+	if ( ll_socket == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( ( p = __atomic_exchange_n(&ll_socket->filter, NULL, __ATOMIC_ACQ_REL) )
+			== NULL )
+		{ return(EX_OK); }
+
+	free_ll_filter_program(p);
+
+	if ( setsockopt(	__rx_socket_fd(ll_socket), SOL_SOCKET, SO_DETACH_FILTER,
+						&dummy, sizeof(int)	) < 0 )
+	{
+		log_sys_error("Could not detach BPF filter");
+		return(EX_SYS);
+	}
+
+	return(EX_OK);
+
+}
@@ -0,0 +1,149 @@
+/*
+ * @file ll_filter.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for filtering the frames received by a
+ * socket within the kernel. Simple expressions over the link layer header
+ * (MAC addresses, ethertype, IEEE 802.11 type and subtype) are compiled
+ * into a classic BPF program that is attached with SO_ATTACH_FILTER, so
+ * that frames of no interest are never copied to userspace. Attaching a
+ * new program to a socket that already has one replaces it atomically.
+ */
+
+#ifndef LL_FILTER_H_
+#define LL_FILTER_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_socket.h"
+
+#include <ctype.h>
+#include <linux/filter.h>
+
+/**************************************************************** DATA TYPES */
+
+#define FILTER_MAX_RULES		8		/*!< Maximum number of rules. */
+#define FILTER_MAX_LEN			64		/*!< Maximum BPF instructions. */
+
+#define FILTER_FIELD_DST		0		/*!< Destination MAC address. */
+#define FILTER_FIELD_SRC		1		/*!< Source MAC address. */
+#define FILTER_FIELD_ETHERTYPE	2		/*!< IEEE 802.3 ethertype. */
+#define FILTER_FIELD_TYPE		3		/*!< IEEE 802.11 frame type. */
+#define FILTER_FIELD_SUBTYPE	4		/*!< IEEE 802.11 frame subtype. */
+
+#define FILTER_8023_DST_OFFSET		0	/*!< Offset of h_dest. */
+#define FILTER_8023_SRC_OFFSET		6	/*!< Offset of h_source. */
+#define FILTER_8023_PROTO_OFFSET	12	/*!< Offset of h_proto. */
+#define FILTER_80211_FC_OFFSET		0	/*!< Offset of frame control. */
+#define FILTER_80211_DST_OFFSET		4	/*!< Offset of address 1. */
+#define FILTER_80211_SRC_OFFSET		10	/*!< Offset of address 2. */
+#define FILTER_RADIOTAP_LEN_OFFSET	2	/*!< Offset of it_len (le16). */
+
+#define FILTER_ACCEPT			0xFFFFFFFF	/*!< Accept the whole frame. */
+#define FILTER_REJECT			0			/*!< Drop the frame. */
+
+typedef struct sock_fprog sock_fprog_t;		/*!< Type for BPF programs. */
+#define LEN__SOCK_FPROG sizeof(sock_fprog_t)
+
+/*!
+ * \struct ll_filter_rule
+ * \brief A single comparison of a field of the header with a value.
+ */
+typedef struct ll_filter_rule
+{
+
+	int field;						/*!< Field to compare (FILTER_FIELD_*). */
+	unsigned char mac[ETH_ALEN];	/*!< Value for MAC fields. */
+	int value;						/*!< Value for numeric fields. */
+
+} ll_filter_rule_t;
+
+/*!
+ * \struct ll_filter
+ * \brief Filter made of several rules, all of them must match for a frame
+ * 			to be accepted.
+ */
+typedef struct ll_filter
+{
+
+	int frame_type;							/*!< Type of the frames. */
+	bool has_radiotap;						/*!< Radiotap header in front. */
+	int no_rules;							/*!< Number of rules. */
+	ll_filter_rule_t rules[FILTER_MAX_RULES];	/*!< Rules of the filter. */
+
+} ll_filter_t;
+
+#define LEN__LL_FILTER sizeof(ll_filter_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a ll_filter structure.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_filter_t *new_ll_filter();
+
+/*!
+ * \brief Parses a filter expression, a list of "field value" pairs that can
+ * 			be joined with "and". Fields are: dst, src (MAC address written
+ * 			as aa:bb:cc:dd:ee:ff), ethertype (IEEE 802.3), type and subtype
+ * 			(IEEE 802.11).
+ * \param frame_type Type of the frames to be filtered.
+ * \param expression The expression to be parsed.
+ * \return The parsed filter, NULL in case of error.
+ */
+ll_filter_t *parse_ll_filter(const int frame_type, const char *expression);
+
+/*!
+ * \brief Compiles the given filter into a classic BPF program. Frames with
+ * 			a radiotap header have its length loaded into X first, and the
+ * 			fields of the 802.11 header are then loaded relative to it.
+ * \param filter The filter to be compiled.
+ * \return The BPF program, NULL in case of error.
+ */
+sock_fprog_t *compile_ll_filter(const ll_filter_t *filter);
+
+/*!
+ * \brief Releases the memory of a BPF program.
+ * \param program The program to be released.
+ */
+void free_ll_filter_program(sock_fprog_t *program);
+
+/*!
+ * \brief Compiles the given expression and attaches it to the socket that
+ * 			receives the frames. It can be called while the socket is
+ * 			running, from any thread: the kernel replaces the old program
+ * 			atomically and the one kept by the socket is swapped lock-free.
+ * \param ll_socket The socket whose frames are to be filtered.
+ * \param expression The filter expression, see parse_ll_filter().
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int set_filter_ll_socket(ll_socket_t *ll_socket, const char *expression);
+
+/*!
+ * \brief Removes the filter of the given socket, if any.
+ * \param ll_socket The socket whose filter is to be removed.
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int clear_filter_ll_socket(ll_socket_t *ll_socket);
+
+#endif /* LL_FILTER_H_ */
@@ -20,6 +20,8 @@
  * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
+
 #include "ll_frame.h"
 
 /*!< Ethernet broadcast address. */
@@ -36,34 +38,51 @@ const unsigned char ETH_ADDR_NULL[ETH_ALEN]
 const unsigned char ETH_ADDR_FAKE[ETH_ALEN]//{0x00,0x12,0xD9,0xB7,0xC0,0xF0} //cuvi
                                     = { 0x00,0x18,0x39,0xAE,0x7D,0xD5 };//ctag
 
-/* new_ll_frame */
-ll_frame_t *new_ll_frame()
+/* new_pool_frame */
+void *new_pool_frame(ll_frame_pool_t *pool, const int len)
 {
 
-	ll_frame_t *buffer = NULL;
-	buffer = (ll_frame_t *)malloc(LEN__LL_FRAME);
-	memset(buffer, 0, LEN__LL_FRAME);
+	void *buffer = NULL;
+
+	if ( len > pool->frame_size )
+	{
+		log_app_msg("Frame of %d bytes does not fit in pool frames of %d.\n"
+						, len, pool->frame_size);
+		return(NULL);
+	}
+
+	if ( ( buffer = acquire_ll_frame(pool) ) == NULL )
+	{
+		log_app_msg("Frame pool exhausted (%d frames).\n", pool->no_frames);
+		return(NULL);
+	}
+
+	memset(buffer, 0, len);
 	return(buffer);
 
 }
 
-/* new_ll_framebuffer */
-ll_frame_t *new_ll_framebuffer()
+/* new_ll_frame */
+ll_frame_t *new_ll_frame(ll_frame_pool_t *pool)
 {
+	return((ll_frame_t *)new_pool_frame(pool, LEN__LL_FRAME));
+}
 
-	ll_frame_t *buffer = NULL;
-	buffer = (ll_frame_t *)malloc(FRAMEBUFFER_LEN);
-	memset(buffer, 0, FRAMEBUFFER_LEN);
-	return(buffer);
-
+/* new_ll_framebuffer */
+ll_frame_t *new_ll_framebuffer(ll_frame_pool_t *pool)
+{
+	return((ll_frame_t *)new_pool_frame(pool, FRAMEBUFFER_LEN));
 }
 
 /* init_ll_frame */
 ll_frame_t *init_ll_frame
-	(const int frame_type, const int frame_len)
+	(ll_frame_pool_t *pool, const int frame_type, const int frame_len)
 {
 
-	ll_frame_t *buffer = new_ll_frame();
+	ll_frame_t *buffer = NULL;
+
+	if ( ( buffer = new_ll_frame(pool) ) == NULL )
+		{ return(NULL); }
 
 	if ( set_ll_frame(buffer, frame_type, frame_len) < 0 )
 	{
@@ -81,25 +100,225 @@ int set_ll_frame
 
 	frame->frame_type = frame_type;
 	frame->frame_len = frame_len;
+	frame->orig_len = frame_len;
+
+	if ( ( frame->ts_source = get_clock_timestamp(&frame->timestamp) ) < 0 )
+		{ return(EX_ERR); }
+
+	return(EX_OK);
+
+}
+
+#ifndef KERNEL_RING
+
+/* init_ll_frame_batch */
+ll_frame_batch_t *init_ll_frame_batch
+	(	const int max_frames, const int frame_size,
+		const int buffer_offset, const int buffer_len	)
+{
+
+	ll_frame_batch_t *b = (ll_frame_batch_t *)malloc(LEN__LL_FRAME_BATCH);
+	memset(b, 0, LEN__LL_FRAME_BATCH);
+
+	b->max_frames = max_frames;
+	b->frame_size = frame_size;
+	b->frames = (uint8_t *)calloc(max_frames, frame_size);
+	b->msgs = (struct mmsghdr *)calloc(max_frames, sizeof(struct mmsghdr));
+	b->iovs = (struct iovec *)calloc(max_frames, sizeof(struct iovec));
+	b->controls = (uint8_t *)calloc(max_frames, TS_CONTROL_LEN);
+
+	for ( int i = 0; i < max_frames; i++ )
+	{
+		b->iovs[i].iov_base = get_ll_frame_batch(b, i) + buffer_offset;
+		b->iovs[i].iov_len = buffer_len;
+		b->msgs[i].msg_hdr.msg_iov = &b->iovs[i];
+		b->msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	return(b);
+
+}
+
+/* read_ll_frame_batch */
+int read_ll_frame_batch
+	(const int socket_fd, ll_frame_batch_t *batch, const int frame_type)
+{
+
+	ll_frame_t *frame = NULL;
+	struct timespec now;
+	int b_read = 0, now_source = TS_SOURCE_NONE;
+
+	// the kernel overwrites msg_controllen, control buffers are only set
+	// for reception so that sendmmsg() never parses them
+	for ( int i = 0; i < batch->max_frames; i++ )
+	{
+		batch->msgs[i].msg_hdr.msg_control
+			= batch->controls + i * TS_CONTROL_LEN;
+		batch->msgs[i].msg_hdr.msg_controllen = TS_CONTROL_LEN;
+	}
+
+	b_read = recvmmsg(	socket_fd, batch->msgs, batch->max_frames,
+						MSG_DONTWAIT, NULL	);
+	batch->no_frames = 0;
+
+	if ( b_read < 0 )
+	{
+		if ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+			{ return(0); }
+		log_sys_error("Could not read socket");
+		return(EX_SYS);
+	}
+
+	for ( int i = 0; i < b_read; i++ )
+	{
+
+		// only the socket pairs of virtual backends return empty messages,
+		// once their peer is gone: those are not frames
+		if ( batch->msgs[i].msg_len == 0 )
+		{
+			b_read = i;
+			break;
+		}
+
+		frame = (ll_frame_t *)get_ll_frame_batch(batch, i);
+		frame->frame_type = frame_type;
+		frame->frame_len = batch->msgs[i].msg_len;
+		frame->orig_len = batch->msgs[i].msg_len;
+
+		if ( ( frame->ts_source = get_cmsg_timestamp
+					(&batch->msgs[i].msg_hdr, &frame->timestamp) )
+				!= TS_SOURCE_NONE )
+			{ continue; }
+
+		// all the frames were already queued when recvmmsg() was called,
+		// so a single read of the clock is enough for the whole batch
+		if ( now_source == TS_SOURCE_NONE )
+			{ now_source = get_clock_timestamp(&now); }
+		frame->timestamp = now;
+		frame->ts_source = now_source;
+
+	}
+
+	batch->no_frames = b_read;
+	return(b_read);
+
+}
+
+/* recv_ll_frame */
+int recv_ll_frame
+	(	const int socket_fd, void *buffer, const int len,
+		ll_frame_t *info, const int frame_type	)
+{
+
+	uint8_t control[TS_CONTROL_LEN];
+	struct iovec iov = { .iov_base = buffer, .iov_len = len };
+	struct msghdr msg;
+	int b_read = 0;
+
+	memset(&msg, 0, sizeof(struct msghdr));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = TS_CONTROL_LEN;
+
+	// the error queue of timestamped transmissions also raises read events,
+	// so a wakeup does not guarantee that there is a frame to be read
+	if ( ( b_read = recvmsg(socket_fd, &msg, MSG_DONTWAIT) ) < 0 )
+	{
+		if ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+			{ return(0); }
+		log_sys_error("Could not read socket");
+		return(EX_SYS);
+	}
+
+	info->frame_type = frame_type;
+	info->frame_len = b_read;
+	info->orig_len = b_read;
+
+	if ( ( info->ts_source = get_cmsg_timestamp(&msg, &info->timestamp) )
+			== TS_SOURCE_NONE )
+		{ info->ts_source = get_clock_timestamp(&info->timestamp); }
+
+	return(b_read);
+
+}
 
-	if ( gettimeofday(&frame->timestamp, NULL) < 0 )
+/* send_ll_frame_batch */
+int send_ll_frame_batch
+	(	const int socket_fd, ll_frame_batch_t *batch,
+		const struct sockaddr_ll *addr	)
+{
+
+	int sent = 0, b_written = 0;
+	ll_frame_t *frame = NULL;
+
+	for ( int i = batch->next_frame; i < batch->no_frames; i++ )
 	{
-		log_sys_error("Cannot get timestamp");
-		return(EX_ERR);
+		frame = (ll_frame_t *)get_ll_frame_batch(batch, i);
+		batch->iovs[i].iov_len = frame->frame_len;
+		batch->msgs[i].msg_hdr.msg_name = (void *)addr;
+		batch->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_ll);
 	}
 
+	while ( batch->next_frame < batch->no_frames )
+	{
+
+		if ( ( b_written = sendmmsg(	socket_fd,
+										&batch->msgs[batch->next_frame],
+										batch->no_frames - batch->next_frame,
+										MSG_DONTWAIT	) ) < 0 )
+		{
+			if ( errno == EINTR )
+				{ continue; }
+			// the kernel cannot take more frames now, caller will resume
+			if ( ( errno == EAGAIN ) || ( errno == ENOBUFS ) )
+				{ break; }
+			log_sys_error("Frames could not be sent");
+			return(EX_SYS);
+		}
+
+		batch->next_frame += b_written;
+		sent += b_written;
+
+	}
+
+	return(sent);
+
+}
+
+#endif
+
+#ifdef KERNEL_RING
+
+/* set_ll_frame_tpacket3 */
+int set_ll_frame_tpacket3
+	(ll_frame_t *frame, const int frame_type, const tpacket3_hdr_t *header)
+{
+
+	frame->frame_type = frame_type;
+	frame->frame_len = header->tp_snaplen;
+	frame->orig_len = header->tp_len;
+
+	frame->timestamp.tv_sec = header->tp_sec;
+	frame->timestamp.tv_nsec = header->tp_nsec;
+	frame->ts_source = get_tpacket_ts_source(header->tp_status);
+
 	return(EX_OK);
 
 }
 
+#endif
+
 /* print_ll_framebuffer */
 int print_ll_frame(const ll_frame_t *frame)
 {
 
-	log_app_msg(">>>>> LL_FRAMEBUFFER:\n");
-	log_app_msg("\t* type = %d\n", frame->frame_type);
-	log_app_msg("\t* length (B) = %d\n", frame->frame_len);
-	log_app_msg("\t* timestamp (usecs) = %lu\n", get_timestamp_usecs(frame));
+	log_debug_msg(">>>>> LL_FRAMEBUFFER:\n");
+	log_debug_msg("\t* type = %d\n", frame->frame_type);
+	log_debug_msg("\t* length (B) = %d\n", frame->frame_len);
+	log_debug_msg("\t* timestamp (nsecs) = %lu (%s)\n"
+				, get_timestamp_nsecs(frame)
+				, get_ts_source_name(frame->ts_source));
 
 	return(EX_OK);
 
@@ -109,24 +328,38 @@ int print_ll_frame(const ll_frame_t *frame)
 uint64_t get_timestamp_usecs(const ll_frame_t *frame)
 {
     return frame->timestamp.tv_sec * (uint64_t) 1000000
-    				+ frame->timestamp.tv_usec;
+    				+ frame->timestamp.tv_nsec / 1000;
+}
+
+/* get_timestamp_nsecs */
+uint64_t get_timestamp_nsecs(const ll_frame_t *frame)
+{
+    return frame->timestamp.tv_sec * (uint64_t) 1000000000
+    				+ frame->timestamp.tv_nsec;
 }
 
 /* print_eth_data */
 int print_hex_data(const char *buffer, const int len)
 {
 
-	int last_byte = len - 1;
+	int last_byte = len - 1, pos = 0;
+	char line[5 + 3 * BYTES_PER_LINE];
 
 	if ( len < 0 )
 		{ return(EX_WRONG_PARAM); }
+	if ( log_enabled(LOG_LEVEL_DEBUG) == false )
+		{ return(EX_OK); }
 
+	// one log event per line, not per byte
 	for ( int i = 0; i < len; i++ )
 	{
 		if ( ( i % BYTES_PER_LINE ) == 0 )
-			{ log_app_msg("\n\t\t\t"); }
-		log_app_msg("%02X", 0xFF & (unsigned int)buffer[i]);
-		if ( i < last_byte ) { log_app_msg(":"); }
+			{ pos = sprintf(line, "\n\t\t\t"); }
+		pos += sprintf(line + pos, "%02X", 0xFF & (unsigned int)buffer[i]);
+		if ( i < last_byte ) { line[pos++] = ':'; line[pos] = '\0'; }
+		if ( ( ( i % BYTES_PER_LINE ) == BYTES_PER_LINE - 1 )
+				|| ( i == last_byte ) )
+			{ log_debug_msg("%s", line); }
 	}
 
 	return(EX_OK);
@@ -137,7 +370,7 @@ int print_hex_data(const char *buffer, const int len)
 void print_eth_address(const unsigned char *eth_address)
 {
 
-	printf("%02X:%02X:%02X:%02X:%02X:%02X",
+	log_app_msg("%02X:%02X:%02X:%02X:%02X:%02X",
   			(unsigned char) eth_address[0],
   			(unsigned char) eth_address[1],
   			(unsigned char) eth_address[2],
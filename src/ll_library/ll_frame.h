@@ -27,6 +27,7 @@
 #include "logger.h"
 
 #include <errno.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,10 +35,19 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <sys/time.h>
+#include <sys/socket.h>
 #include <linux/if_ether.h>
+#include <linux/if_packet.h>
 
 #include <ev.h>
 
+#include "ll_library/ll_frame_pool.h"
+#include "ll_library/ll_timestamp.h"
+
+#ifdef KERNEL_RING
+	#include "ll_library/ll_ring.h"
+#endif
+
 /*********************************************************** DATA STRUCTURES */
 
 /*!< Ethernet broadcast address. */
@@ -60,13 +70,43 @@ typedef struct ll_frame
 
 	int frame_type;				/*!< Type of the frame. */
 	int frame_len;				/*!< Length of the total bytes read. */
+	int orig_len;				/*!< Length on the wire, 0 if unknown. */
 
-	struct timeval timestamp;	/*!< Frame creation timestamp (usecs). */
+	struct timespec timestamp;	/*!< Frame timestamp (nsecs). */
+	int ts_source;				/*!< Source of the timestamp (TS_SOURCE_*). */
 
 } ll_frame_t;
 
 #define LEN__LL_FRAME 		sizeof(ll_frame_t)
-#define FRAMEBUFFER_LEN		LEN__LL_FRAME + 5000	/*!< Framebuffer len. */
+#define FRAMEBUFFER_LEN		( LEN__LL_FRAME + 5000 )	/*!< Framebuffer len. */
+
+#define RX_BATCH_LEN		64	/*!< Default number of frames per batch. */
+
+/*!
+	\struct ll_frame_batch
+	\brief Structure for receiving (recvmmsg) or transmitting (sendmmsg)
+			several frames with a single system call. Frames are stored in
+			an array of frame structures (all of them starting with an
+			ll_frame_t) whose buffers are directly used as the scatter/gather
+			vectors for the kernel. A batch is meant to be used either for
+			reception or for transmission, never for both.
+ */
+typedef struct ll_frame_batch
+{
+
+	int max_frames;				/*!< Maximum number of frames of the batch. */
+	int no_frames;				/*!< Number of frames currently held. */
+	int next_frame;				/*!< First frame not yet transmitted. */
+	int frame_size;				/*!< Size of each frame structure (B). */
+
+	uint8_t *frames;			/*!< Array with the frame structures. */
+	struct mmsghdr *msgs;		/*!< Messages for recvmmsg(). */
+	struct iovec *iovs;			/*!< One vector per frame buffer. */
+	uint8_t *controls;			/*!< Control buffers for the timestamps. */
+
+} ll_frame_batch_t;
+
+#define LEN__LL_FRAME_BATCH sizeof(ll_frame_batch_t)
 
 /************************************************** Event handling structures */
 
@@ -80,16 +120,26 @@ typedef struct ll_frame
 typedef struct public_ev_arg
 {
 
+	int socket_fd;					/*!< Socket file descriptor. */
+	ll_frame_pool_t *pool;			/*!< Pool of frames of the socket. */
+	struct ll_frame_template *tx_template;	/*!< Template for test frames. */
+	struct ll_capture *capture;		/*!< Capture for received frames. */
+	struct ll_replay *replay;		/*!< Capture replayed, if any. */
+	struct ll_probe *probe;			/*!< Latency probes, if any. */
+	struct ll_stats *stats;			/*!< Counters of the socket. */
+	struct ll_tx_queue *tx_queue;	/*!< Send queue of the socket. */
+
 #ifdef KERNEL_RING
-	void *rx_ring;					/*!< Kernel RX_RING. */
+	rx_ring_t *rx_ring;				/*!< Kernel RX_RING. */
+	tx_ring_t *tx_ring;				/*!< Kernel TX_RING. */
 #else
-	int socket_fd;					/*!< Socket file descriptor. */
 	ll_frame_t *buffer;				/*!< Buffer for frames reception. */
+	ll_frame_batch_t *batch;		/*!< Batch for frames reception. */
 #endif
 
 	int ll_sap;						/*!< Link layer SAP. */
-	int tx_delay;					/*!< Delay (ms) between two test frames. */
 	int if_index;					/*!< Index of the interface. */
+	int if_hatype;					/*!< Hardware type of the interface. */
 	unsigned char if_mac[ETH_ALEN];	/*!< MAC of the link layer interface. */
 
 } public_ev_arg_t;
@@ -101,24 +151,38 @@ typedef void (*ev_cb_t)(public_ev_arg_t *);		/*!< Callback function. */
 /****************************************************************** FUNCTIONS */
 
 /*!
- * \brief Allocates memory for a ll_frame structure.
+ * \brief Takes a frame from the given pool and clears its first len bytes.
+ * \param pool The pool where to take the frame from.
+ * \param len Number of bytes of the frame that are going to be used.
+ * \return A pointer to the frame, NULL if the pool is exhausted or its
+ * 			frames are shorter than len.
+ */
+void *new_pool_frame(ll_frame_pool_t *pool, const int len);
+
+/*!
+ * \brief Takes from the pool the memory for a ll_frame structure.
+ * \param pool The pool where to take the frame from.
  * \return A pointer to the newly allocated block of memory.
  */
-ll_frame_t *new_ll_frame();
+ll_frame_t *new_ll_frame(ll_frame_pool_t *pool);
 
 /*!
- * \brief Allocates memory for a ll_frame structure.
+ * \brief Takes from the pool the memory for a ll_frame structure followed
+ * 			by its data buffer, FRAMEBUFFER_LEN bytes in total.
+ * \param pool The pool where to take the frame from.
  * \return A pointer to the newly allocated block of memory.
  */
-ll_frame_t *new_ll_framebuffer();
+ll_frame_t *new_ll_framebuffer(ll_frame_pool_t *pool);
 
 /*!
  * \brief Initializes and allocates a new frame buffer with the given data.
+ * 	\param pool The pool where to take the frame from.
  * 	\param frame_type Type of the frame contained in this buffer.
  * 	\param frame_len Length of the frame contained.
  * 	\return A pointer to the newly initialized block of memory.
  */
-ll_frame_t *init_ll_frame(const int frame_type, const int frame_len);
+ll_frame_t *init_ll_frame
+	(ll_frame_pool_t *pool, const int frame_type, const int frame_len);
 
 /*!
  * \brief Initializes the given frame buffer with the given data.
@@ -129,10 +193,93 @@ ll_frame_t *init_ll_frame(const int frame_type, const int frame_len);
 int set_ll_frame
 	(ll_frame_t *frame, const int frame_type, const int frame_len);
 
+#ifndef KERNEL_RING
+
+/*!
+ * \brief Allocates a batch of frames, including the frame structures and the
+ * 			vectors that point to their buffers.
+ * \param max_frames Maximum number of frames of the batch.
+ * \param frame_size Size of each of the frame structures (B).
+ * \param buffer_offset Offset of the buffer within the frame structure (B).
+ * \param buffer_len Length of the buffer of each frame structure (B).
+ * \return A pointer to the newly initialized batch.
+ */
+ll_frame_batch_t *init_ll_frame_batch
+	(	const int max_frames, const int frame_size,
+		const int buffer_offset, const int buffer_len	);
+
+/*!
+ * \brief Gets one of the frames held within a batch.
+ * \param batch The batch that holds the frame.
+ * \param index Index of the frame within the batch.
+ * \return A pointer to the frame structure.
+ */
+static inline void *get_ll_frame_batch
+	(const ll_frame_batch_t *batch, const int index)
+	{ return(batch->frames + index * batch->frame_size); }
+
+/*!
+ * \brief Reads from a socket as many frames as the batch can hold with a
+ * 			single recvmmsg() call, without blocking.
+ * \param socket_fd The socket from where to read the frames.
+ * \param batch The batch where the frames are to be stored.
+ * \param frame_type Type of the frames to be read.
+ * \return Number of frames read (>=0), <0 in case of error.
+ */
+int read_ll_frame_batch
+	(const int socket_fd, ll_frame_batch_t *batch, const int frame_type);
+
+/*!
+ * \brief Reads a single frame from a socket, taking its timestamp from the
+ * 			control messages of the kernel when available.
+ * \param socket_fd The socket from where to read the frame.
+ * \param buffer Buffer where the contents of the frame are to be stored.
+ * \param len Length of the buffer (B).
+ * \param info Structure where the info of the frame is to be set.
+ * \param frame_type Type of the frame to be read.
+ * \return Number of bytes read (>0), 0 if no frame was ready, <0 in case of
+ * 			error.
+ */
+int recv_ll_frame
+	(	const int socket_fd, void *buffer, const int len,
+		ll_frame_t *info, const int frame_type	);
+
+/*!
+ * \brief Writes to a socket the frames of a batch that were not transmitted
+ * 			yet, all of them to the same address, with as few sendmmsg()
+ * 			calls as possible. If the kernel cannot take all of them, the
+ * 			next call resumes from the first frame that was not sent.
+ * \param socket_fd The socket where to write the frames.
+ * \param batch The batch with the frames to be written, whose lengths are
+ * 			taken from their ll_frame_t.
+ * \param addr Address the frames are to be sent to.
+ * \return Number of frames sent by this call (>=0), <0 in case of error.
+ */
+int send_ll_frame_batch
+	(	const int socket_fd, ll_frame_batch_t *batch,
+		const struct sockaddr_ll *addr	);
+
+#endif
+
+#ifdef KERNEL_RING
+
+/*!
+ * \brief Initializes the given frame info with the data that the kernel
+ * 			stored in the header of a frame within the RX ring, including
+ * 			its timestamp.
+ * 	\param frame_type Type of the frame contained in the ring.
+ * 	\param header Header of the frame within the RX ring.
+ * 	\return EX_OK if everything was correct; otherwise < 0.
+ */
+int set_ll_frame_tpacket3
+	(ll_frame_t *frame, const int frame_type, const tpacket3_hdr_t *header);
+
+#endif
+
 #define BYTES_PER_LINE 8	/*!< Number of bytes per line to be printed. */
 
 /*!
- * \brief Prints the given ll_framebuffer.
+ * \brief Prints the given ll_framebuffer (debug level).
  * \param frame The ll_framebuffer to be printed.
  * \return EX_OK if everything was correct; otherwise < 0.
  * */
@@ -146,7 +293,14 @@ int print_ll_frame(const ll_frame_t *frame);
 uint64_t get_timestamp_usecs(const ll_frame_t *frame);
 
 /*!
- * \brief Prints the data field of the given IEEE 802.3 frame.
+ * \brief Gets the timestamp of a given frame with full resolution.
+ * \param frame ll_framebuffer with the timestamp to be calculated.
+ * \return Long number containing the timestamp of the given frame (nsecs).
+ */
+uint64_t get_timestamp_nsecs(const ll_frame_t *frame);
+
+/*!
+ * \brief Prints the data field of the given IEEE 802.3 frame (debug level).
  * \param buffer The IEEE 802.3 frame whose data is to be printed.
  * \return EX_OK if everything was correct; otherwise < 0.
  */
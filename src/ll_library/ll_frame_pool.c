@@ -0,0 +1,156 @@
+/*
+ * @file ll_frame_pool.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_frame_pool.h"
+
+/* __node_of */
+static ll_pool_node_t *__node_of(void *frame)
+{
+	return((ll_pool_node_t *)( (uint8_t *)frame - LEN__LL_POOL_NODE ));
+}
+
+/* init_ll_frame_pool */
+ll_frame_pool_t *init_ll_frame_pool(const int frame_size, const int no_frames)
+{
+
+	ll_frame_pool_t *p = NULL;
+	ll_pool_node_t *n = NULL;
+
+	if ( ( frame_size <= 0 ) || ( no_frames <= 0 ) )
+		{ return(NULL); }
+
+	if ( posix_memalign((void **)&p, CACHE_LINE_LEN, LEN__LL_FRAME_POOL) != 0 )
+	{
+		log_app_msg("Could not allocate frame pool.\n");
+		return(NULL);
+	}
+	memset(p, 0, LEN__LL_FRAME_POOL);
+
+	// 1) every frame is rounded up to a whole number of cache lines
+	p->frame_size = frame_size;
+	p->node_size = LEN__LL_POOL_NODE
+					+ ( ( frame_size + CACHE_LINE_LEN - 1 )
+							/ CACHE_LINE_LEN ) * CACHE_LINE_LEN;
+	p->no_frames = no_frames;
+
+	if ( posix_memalign(	(void **)&p->memory, CACHE_LINE_LEN,
+							(size_t)p->node_size * no_frames	) != 0 )
+	{
+		log_app_msg("Could not allocate %d frames of %d bytes.\n"
+						, no_frames, frame_size);
+		free(p);
+		return(NULL);
+	}
+
+	// 2) all frames start in the free list of the owner, in memory order
+	for ( int i = no_frames - 1; i >= 0; i-- )
+	{
+		n = (ll_pool_node_t *)( p->memory + (size_t)i * p->node_size );
+		n->pool = p;
+		n->next = p->free_list;
+		p->free_list = n;
+	}
+
+	p->no_free = no_frames;
+
+	return(p);
+
+}
+
+/* close_ll_frame_pool */
+int close_ll_frame_pool(ll_frame_pool_t *pool)
+{
+
+	if ( pool == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	free(pool->memory);
+	free(pool);
+
+	return(EX_OK);
+
+}
+
+/* acquire_ll_frame */
+void *acquire_ll_frame(ll_frame_pool_t *pool)
+{
+
+	ll_pool_node_t *n = NULL;
+
+	// frames given back by other threads are adopted all at once
+	if ( pool->free_list == NULL )
+	{
+
+		pool->free_list = __atomic_exchange_n
+							(&pool->remote_list, NULL, __ATOMIC_ACQUIRE);
+
+		for ( n = pool->free_list; n != NULL; n = n->next )
+			{ pool->no_free++; }
+
+		if ( pool->free_list == NULL )
+			{ return(NULL); }
+
+	}
+
+	n = pool->free_list;
+	pool->free_list = n->next;
+	pool->no_free--;
+
+	return((uint8_t *)n + LEN__LL_POOL_NODE);
+
+}
+
+/* release_ll_frame */
+void release_ll_frame(void *frame)
+{
+
+	ll_pool_node_t *n = NULL;
+
+	if ( frame == NULL )
+		{ return; }
+
+	n = __node_of(frame);
+	n->next = n->pool->free_list;
+	n->pool->free_list = n;
+	n->pool->no_free++;
+
+}
+
+/* release_ll_frame_remote */
+void release_ll_frame_remote(void *frame)
+{
+
+	ll_pool_node_t *n = NULL;
+	ll_pool_node_t *head = NULL;
+
+	if ( frame == NULL )
+		{ return; }
+
+	n = __node_of(frame);
+	head = __atomic_load_n(&n->pool->remote_list, __ATOMIC_RELAXED);
+
+	do { n->next = head; }
+	while ( __atomic_compare_exchange_n(	&n->pool->remote_list, &head, n,
+											true, __ATOMIC_RELEASE,
+											__ATOMIC_RELAXED	) == false );
+
+}
@@ -0,0 +1,127 @@
+/*
+ * @file ll_frame_pool.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions of a fixed-size pool of frames. All the
+ * frames of a pool are carved out of a single cache-aligned block of memory
+ * that is allocated when the pool is created, so that acquiring or releasing
+ * a frame is an O(1) operation that never calls the allocator. The thread
+ * that owns the pool acquires and releases frames without any locking;
+ * other threads can give frames back through a lock-free stack that the
+ * owner adopts whenever its own list of free frames runs out.
+ */
+
+#ifndef LL_FRAME_POOL_H_
+#define LL_FRAME_POOL_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**************************************************************** DATA TYPES */
+
+#define CACHE_LINE_LEN		64		/*!< Length of a cache line (B). */
+#define FRAME_POOL_LEN		1024	/*!< Default number of frames per pool. */
+
+/*!
+ * \struct ll_pool_node
+ * \brief Header that precedes every frame of a pool, it takes a whole cache
+ * 			line so that frames are cache-aligned and links between free
+ * 			frames never share a line with the frames contents.
+ */
+typedef struct ll_pool_node
+{
+
+	struct ll_pool_node *next;		/*!< Next free frame. */
+	struct ll_frame_pool *pool;		/*!< Pool this frame belongs to. */
+
+} __attribute__((aligned(CACHE_LINE_LEN))) ll_pool_node_t;
+
+#define LEN__LL_POOL_NODE sizeof(ll_pool_node_t)
+
+/*!
+ * \struct ll_frame_pool
+ * \brief Structure for managing a pool of frames of the same size.
+ */
+typedef struct ll_frame_pool
+{
+
+	int frame_size;					/*!< Usable length of each frame (B). */
+	int node_size;					/*!< Length of header + frame (B). */
+	int no_frames;					/*!< Number of frames of the pool. */
+	uint8_t *memory;				/*!< Memory block with all the frames. */
+
+	ll_pool_node_t *free_list;		/*!< Free frames, owner thread only. */
+	int no_free;					/*!< Length of the free list. */
+
+	/*!< Free frames given back by other threads, lock-free. */
+	ll_pool_node_t *remote_list __attribute__((aligned(CACHE_LINE_LEN)));
+
+} ll_frame_pool_t;
+
+#define LEN__LL_FRAME_POOL sizeof(ll_frame_pool_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Creates a pool of frames, allocating all the memory required.
+ * \param frame_size Length of each of the frames (B).
+ * \param no_frames Number of frames of the pool.
+ * \return A pointer to the newly created pool, NULL in case of error.
+ */
+ll_frame_pool_t *init_ll_frame_pool(const int frame_size, const int no_frames);
+
+/*!
+ * \brief Releases all the memory of the given pool. Frames still in use
+ * 			become invalid.
+ * \param pool The pool to be closed.
+ * \return EX_OK if the pool could be closed correctly, <0 otherwise.
+ */
+int close_ll_frame_pool(ll_frame_pool_t *pool);
+
+/*!
+ * \brief Takes a frame from the pool, its contents are not cleared. Only the
+ * 			thread that owns the pool can acquire frames.
+ * \param pool The pool where to take the frame from.
+ * \return A pointer to the frame, NULL if there are no free frames left.
+ */
+void *acquire_ll_frame(ll_frame_pool_t *pool);
+
+/*!
+ * \brief Gives a frame back to its pool, from the thread that owns the pool.
+ * \param frame The frame to be released.
+ */
+void release_ll_frame(void *frame);
+
+/*!
+ * \brief Gives a frame back to its pool from any thread other than the one
+ * 			that owns the pool, without locking.
+ * \param frame The frame to be released.
+ */
+void release_ll_frame_remote(void *frame);
+
+#endif /* LL_FRAME_POOL_H_ */
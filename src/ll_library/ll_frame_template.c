@@ -0,0 +1,164 @@
+/*
+ * @file ll_frame_template.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_frame_template.h"
+
+/* new_ll_frame_template */
+ll_frame_template_t *new_ll_frame_template()
+{
+	ll_frame_template_t *buffer = NULL;
+	buffer = (ll_frame_template_t *)malloc(LEN__LL_FRAME_TEMPLATE);
+	memset(buffer, 0, LEN__LL_FRAME_TEMPLATE);
+	return(buffer);
+}
+
+/* init_ll_frame_template */
+ll_frame_template_t *init_ll_frame_template
+	(	const int frame_type, const void *header, const int header_len,
+		const void *payload, const int payload_len	)
+{
+
+	ll_frame_template_t *t = NULL;
+
+	if ( ( header_len < 0 ) || ( payload_len < 0 )
+			|| ( ( header_len + payload_len ) > TEMPLATE_MAX_LEN ) )
+	{
+		log_app_msg("Template of %d bytes exceeds maximum length = %d.\n"
+						, header_len + payload_len, TEMPLATE_MAX_LEN);
+		return(NULL);
+	}
+
+	t = new_ll_frame_template();
+	t->len = header_len + payload_len;
+	t->seq_offset = TEMPLATE_NO_FIELD;
+	t->ts_offset = TEMPLATE_NO_FIELD;
+	t->slice_offset = TEMPLATE_NO_FIELD;
+
+	memcpy(t->frame, header, header_len);
+	if ( payload != NULL )
+		{ memcpy(t->frame + header_len, payload, payload_len); }
+
+	t->info.frame_type = frame_type;
+	t->info.frame_len = t->len;
+
+	return(t);
+
+}
+
+/* __check_field */
+static int __check_field
+	(const ll_frame_template_t *template, const int offset, const int len)
+{
+
+	if ( ( offset < 0 ) || ( ( offset + len ) > template->len ) )
+	{
+		log_app_msg("Field [%d, %d) out of template, length = %d.\n"
+						, offset, offset + len, template->len);
+		return(EX_WRONG_PARAM);
+	}
+
+	return(EX_OK);
+
+}
+
+/* set_ll_frame_template_seq */
+int set_ll_frame_template_seq(ll_frame_template_t *template, const int offset)
+{
+
+	if ( __check_field(template, offset, TEMPLATE_SEQ_LEN) < 0 )
+		{ return(EX_WRONG_PARAM); }
+
+	template->seq_offset = offset;
+	return(EX_OK);
+
+}
+
+/* set_ll_frame_template_ts */
+int set_ll_frame_template_ts(ll_frame_template_t *template, const int offset)
+{
+
+	if ( __check_field(template, offset, TEMPLATE_TS_LEN) < 0 )
+		{ return(EX_WRONG_PARAM); }
+
+	template->ts_offset = offset;
+	return(EX_OK);
+
+}
+
+/* set_ll_frame_template_slice */
+int set_ll_frame_template_slice
+	(ll_frame_template_t *template, const int offset, const int max_len)
+{
+
+	if ( __check_field(template, offset, max_len) < 0 )
+		{ return(EX_WRONG_PARAM); }
+
+	template->slice_offset = offset;
+	template->slice_len = max_len;
+	return(EX_OK);
+
+}
+
+/* write_ll_frame_template */
+int write_ll_frame_template
+	(	ll_frame_template_t *template, void *frame, const int max_len,
+		const struct timespec *ts, const void *slice, const int slice_len	)
+{
+
+	uint8_t *f = (uint8_t *)frame;
+	uint32_t word = 0;
+
+	if ( template->len > max_len )
+		{ return(EX_WRONG_PARAM); }
+	if ( ( slice != NULL ) && ( ( template->slice_offset < 0 )
+									|| ( slice_len > template->slice_len ) ) )
+		{ return(EX_WRONG_PARAM); }
+
+	// 1) static part, serialized only once when the template was created
+	memcpy(f, template->frame, template->len);
+
+	// 2) variable fields
+	if ( template->seq_offset >= 0 )
+	{
+		word = htonl(template->sequence++);
+		memcpy(f + template->seq_offset, &word, TEMPLATE_SEQ_LEN);
+	}
+
+	if ( ts != NULL )
+	{
+		template->info.timestamp = *ts;
+		if ( template->ts_offset >= 0 )
+		{
+			word = htonl((uint32_t)ts->tv_sec);
+			memcpy(f + template->ts_offset, &word, sizeof(uint32_t));
+			word = htonl((uint32_t)ts->tv_nsec);
+			memcpy(	f + template->ts_offset + sizeof(uint32_t),
+					&word, sizeof(uint32_t)	);
+		}
+	}
+
+	if ( slice != NULL )
+		{ memcpy(f + template->slice_offset, slice, slice_len); }
+
+	return(template->len);
+
+}
@@ -0,0 +1,142 @@
+/*
+ * @file ll_frame_template.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions of frame templates. A template holds a
+ * frame that has already been serialized (header plus static payload), so
+ * that transmitting it again only requires copying it and patching those
+ * fields that change from one frame to the next: a sequence number, a
+ * timestamp and a slice of the payload.
+ */
+
+#ifndef LL_FRAME_TEMPLATE_H_
+#define LL_FRAME_TEMPLATE_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_frame.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/time.h>
+
+/**************************************************************** DATA TYPES */
+
+#define TEMPLATE_MAX_LEN		2048	/*!< Maximum length of a template (B). */
+#define TEMPLATE_NO_FIELD		-1		/*!< Field not present in template. */
+
+#define TEMPLATE_SEQ_LEN		4		/*!< Sequence number length (B). */
+#define TEMPLATE_TS_LEN			8		/*!< Timestamp length (B). */
+
+/*!
+ * \struct ll_frame_template
+ * \brief Structure with a serialized frame plus the offsets of the fields
+ * 			to be patched for every transmission. Offsets are counted from
+ * 			the first byte of the frame and are TEMPLATE_NO_FIELD for those
+ * 			fields that the template does not carry.
+ */
+typedef struct ll_frame_template
+{
+
+	ll_frame_t info;				/*!< Info of the last frame written. */
+	int len;						/*!< Length of the static frame (B). */
+
+	int seq_offset;					/*!< Offset of the sequence number. */
+	uint32_t sequence;				/*!< Next sequence number. */
+	int ts_offset;					/*!< Offset of the timestamp. */
+	int slice_offset;				/*!< Offset of the payload slice. */
+	int slice_len;					/*!< Maximum length of the slice (B). */
+
+	uint8_t frame[TEMPLATE_MAX_LEN];	/*!< Serialized frame. */
+
+} ll_frame_template_t;
+
+#define LEN__LL_FRAME_TEMPLATE sizeof(ll_frame_template_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a ll_frame_template structure.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_frame_template_t *new_ll_frame_template();
+
+/*!
+ * \brief Creates a template by serializing the given header and payload.
+ * \param frame_type Type of the frames built out of this template.
+ * \param header Header of the frame, already in network byte order.
+ * \param header_len Length of the header (B).
+ * \param payload Static payload, NULL for a payload filled up with zeros.
+ * \param payload_len Length of the static payload (B).
+ * \return A pointer to the new template, NULL in case of error.
+ */
+ll_frame_template_t *init_ll_frame_template
+	(	const int frame_type, const void *header, const int header_len,
+		const void *payload, const int payload_len	);
+
+/*!
+ * \brief Sets the offset where a 32 bit sequence number is written (network
+ * 			byte order), incremented for every frame written.
+ * \param template The template to be modified.
+ * \param offset Offset of the field within the frame.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int set_ll_frame_template_seq(ll_frame_template_t *template, const int offset);
+
+/*!
+ * \brief Sets the offset where the timestamp given for each frame is written,
+ * 			as two 32 bit words (seconds, nanoseconds) in network byte order.
+ * \param template The template to be modified.
+ * \param offset Offset of the field within the frame.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int set_ll_frame_template_ts(ll_frame_template_t *template, const int offset);
+
+/*!
+ * \brief Sets the area of the payload that is overwritten for each frame.
+ * \param template The template to be modified.
+ * \param offset Offset of the slice within the frame.
+ * \param max_len Maximum length of the slice (B).
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int set_ll_frame_template_slice
+	(ll_frame_template_t *template, const int offset, const int max_len);
+
+/*!
+ * \brief Writes a new frame out of the given template, patching its variable
+ * 			fields. The info of the template is updated to describe it.
+ * \param template The template to be used.
+ * \param frame Buffer where the frame is to be written.
+ * \param max_len Length of the buffer (B).
+ * \param ts Timestamp for the frame, NULL to leave the field untouched.
+ * \param slice Variable part of the payload, NULL if there is none.
+ * \param slice_len Length of the variable part of the payload (B).
+ * \return Length of the frame written (B), <0 in case of error.
+ */
+int write_ll_frame_template
+	(	ll_frame_template_t *template, void *frame, const int max_len,
+		const struct timespec *ts, const void *slice, const int slice_len	);
+
+#endif /* LL_FRAME_TEMPLATE_H_ */
@@ -0,0 +1,190 @@
+/*
+ * @file ll_histogram.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_histogram.h"
+
+/* __index */
+static int __index(const uint64_t value)
+{
+
+	int shift = 0;
+
+	// values of the first power of two above the linear range keep all
+	// their bits, every next power of two loses one more of them
+	if ( value < ( 1ULL << HISTOGRAM_SUB_BITS ) )
+		{ return((int)value); }
+
+	shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS + 1;
+	return(shift * HISTOGRAM_HALF + (int)( value >> shift ));
+
+}
+
+/* __highest_value */
+static uint64_t __highest_value(const int index)
+{
+
+	int shift = 0;
+	uint64_t sub_bucket = 0;
+
+	if ( index < ( 1 << HISTOGRAM_SUB_BITS ) )
+		{ return((uint64_t)index); }
+
+	shift = index / HISTOGRAM_HALF - 1;
+	sub_bucket = index - shift * HISTOGRAM_HALF;
+	return(( ( sub_bucket + 1 ) << shift ) - 1);
+
+}
+
+/* new_ll_histogram */
+ll_histogram_t *new_ll_histogram()
+{
+
+	ll_histogram_t *h = NULL;
+	h = (ll_histogram_t *)malloc(LEN__LL_HISTOGRAM);
+	reset_ll_histogram(h);
+	return(h);
+
+}
+
+/* reset_ll_histogram */
+void reset_ll_histogram(ll_histogram_t *histogram)
+{
+
+	memset(histogram, 0, LEN__LL_HISTOGRAM);
+	histogram->min = UINT64_MAX;
+
+}
+
+/* record_ll_histogram */
+void record_ll_histogram(ll_histogram_t *histogram, const uint64_t value)
+{
+
+	uint64_t v = value;
+
+	if ( v > HISTOGRAM_MAX_VALUE )
+	{
+		v = HISTOGRAM_MAX_VALUE;
+		histogram->overflows++;
+	}
+
+	histogram->counts[__index(v)]++;
+	histogram->count++;
+	histogram->sum += v;
+	histogram->sum_sq += (double)v * v;
+
+	if ( v < histogram->min )
+		{ histogram->min = v; }
+	if ( v > histogram->max )
+		{ histogram->max = v; }
+
+}
+
+/* get_ll_histogram_percentile */
+uint64_t get_ll_histogram_percentile
+	(const ll_histogram_t *histogram, const double percentile)
+{
+
+	uint64_t target = 0, seen = 0, value = 0;
+
+	if ( histogram->count == 0 )
+		{ return(0); }
+
+	target = (uint64_t)ceil(percentile / 100.0 * histogram->count);
+	if ( target < 1 )
+		{ target = 1; }
+	if ( target > histogram->count )
+		{ target = histogram->count; }
+
+	for ( int i = 0; i < HISTOGRAM_LEN; i++ )
+	{
+
+		if ( ( seen += histogram->counts[i] ) < target )
+			{ continue; }
+
+		// the bucket may span beyond the biggest value actually recorded
+		value = __highest_value(i);
+		return( ( value > histogram->max ) ? histogram->max : value );
+
+	}
+
+	return(histogram->max);
+
+}
+
+/* get_ll_histogram_mean */
+double get_ll_histogram_mean(const ll_histogram_t *histogram)
+{
+
+	if ( histogram->count == 0 )
+		{ return(0.); }
+
+	return(histogram->sum / histogram->count);
+
+}
+
+/* get_ll_histogram_stddev */
+double get_ll_histogram_stddev(const ll_histogram_t *histogram)
+{
+
+	double mean = get_ll_histogram_mean(histogram), variance = 0.;
+
+	if ( histogram->count == 0 )
+		{ return(0.); }
+
+	variance = histogram->sum_sq / histogram->count - mean * mean;
+	return( ( variance > 0. ) ? sqrt(variance) : 0. );
+
+}
+
+/* print_ll_histogram */
+void print_ll_histogram(const ll_histogram_t *histogram, const char *name)
+{
+
+	const ll_histogram_t *h = histogram;
+
+	if ( h->count == 0 )
+	{
+		log_app_msg("\t.%s = (no samples)\n", name);
+		return;
+	}
+
+	log_app_msg("\t.%s (us) = \n\t{\n", name);
+	log_app_msg("\t\t.samples = %lu\n", h->count);
+	log_app_msg("\t\t.min = %.3f\n", h->min / 1e3);
+	log_app_msg("\t\t.p50 = %.3f\n"
+				, get_ll_histogram_percentile(h, 50.0) / 1e3);
+	log_app_msg("\t\t.p90 = %.3f\n"
+				, get_ll_histogram_percentile(h, 90.0) / 1e3);
+	log_app_msg("\t\t.p99 = %.3f\n"
+				, get_ll_histogram_percentile(h, 99.0) / 1e3);
+	log_app_msg("\t\t.p99.9 = %.3f\n"
+				, get_ll_histogram_percentile(h, 99.9) / 1e3);
+	log_app_msg("\t\t.max = %.3f\n", h->max / 1e3);
+	log_app_msg("\t\t.mean = %.3f\n", get_ll_histogram_mean(h) / 1e3);
+	log_app_msg("\t\t.stddev = %.3f\n", get_ll_histogram_stddev(h) / 1e3);
+
+	if ( h->overflows > 0 )
+		{ log_app_msg("\t\t.overflows = %lu\n", h->overflows); }
+
+	log_app_msg("\t}\n");
+
+}
@@ -0,0 +1,129 @@
+/*
+ * @file ll_histogram.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for recording latencies in log-linear
+ * histograms (as HdrHistogram does): every power of two is split into the
+ * same number of linear sub-buckets, so that any value is recorded with a
+ * bounded relative error and percentiles can be read out of a fixed amount
+ * of memory, without storing the samples.
+ */
+
+#ifndef LL_HISTOGRAM_H_
+#define LL_HISTOGRAM_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/**************************************************************** DATA TYPES */
+
+#define HISTOGRAM_SUB_BITS		8		/*!< Sub-buckets per power of 2 (log2). */
+#define HISTOGRAM_MAX_BITS		40		/*!< Values up to 2^40 (18 min in ns). */
+
+/*!< Sub-buckets of every power of two above the linear range. */
+#define HISTOGRAM_HALF			( 1 << ( HISTOGRAM_SUB_BITS - 1 ) )
+/*!< Number of counters of a histogram. */
+#define HISTOGRAM_LEN			\
+			( ( HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 2 ) * HISTOGRAM_HALF )
+/*!< Largest value that can be recorded, bigger ones are clamped. */
+#define HISTOGRAM_MAX_VALUE		( ( 1ULL << HISTOGRAM_MAX_BITS ) - 1 )
+
+/*!
+ * \struct ll_histogram
+ * \brief Log-linear histogram, values are recorded with a relative error
+ * 			below 1 / HISTOGRAM_HALF.
+ */
+typedef struct ll_histogram
+{
+
+	uint64_t count;						/*!< Values recorded. */
+	uint64_t overflows;					/*!< Values clamped to the maximum. */
+	uint64_t min;						/*!< Smallest value recorded. */
+	uint64_t max;						/*!< Biggest value recorded. */
+	double sum;							/*!< Sum of the values. */
+	double sum_sq;						/*!< Sum of the squared values. */
+
+	uint64_t counts[HISTOGRAM_LEN];		/*!< Values per bucket. */
+
+} ll_histogram_t;
+
+#define LEN__LL_HISTOGRAM sizeof(ll_histogram_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for an empty histogram.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_histogram_t *new_ll_histogram();
+
+/*!
+ * \brief Removes all the values recorded in a histogram.
+ * \param histogram The histogram to be cleared.
+ */
+void reset_ll_histogram(ll_histogram_t *histogram);
+
+/*!
+ * \brief Records a value in a histogram.
+ * \param histogram The histogram where the value is to be recorded.
+ * \param value The value to be recorded.
+ */
+void record_ll_histogram(ll_histogram_t *histogram, const uint64_t value);
+
+/*!
+ * \brief Gets the value below which the given percentage of the values
+ * 			recorded fall, with the resolution of the histogram.
+ * \param histogram The histogram to be read.
+ * \param percentile Percentage of the values (0-100].
+ * \return Highest value equivalent to the percentile, 0 if empty.
+ */
+uint64_t get_ll_histogram_percentile
+	(const ll_histogram_t *histogram, const double percentile);
+
+/*!
+ * \brief Gets the mean of the values recorded.
+ * \param histogram The histogram to be read.
+ * \return The mean, 0 if the histogram is empty.
+ */
+double get_ll_histogram_mean(const ll_histogram_t *histogram);
+
+/*!
+ * \brief Gets the standard deviation of the values recorded.
+ * \param histogram The histogram to be read.
+ * \return The standard deviation, 0 if the histogram is empty.
+ */
+double get_ll_histogram_stddev(const ll_histogram_t *histogram);
+
+/*!
+ * \brief Prints the percentiles of a histogram of nanoseconds, in usecs.
+ * \param histogram The histogram to be printed.
+ * \param name Name of the values recorded.
+ */
+void print_ll_histogram(const ll_histogram_t *histogram, const char *name);
+
+#endif /* LL_HISTOGRAM_H_ */
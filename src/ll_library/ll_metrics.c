@@ -0,0 +1,572 @@
+/*
+ * @file ll_metrics.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include "ll_metrics.h"
+
+/*!
+ * \struct __metrics_counter
+ * \brief Counter of ll_stats_t exported in the text format.
+ */
+typedef struct __metrics_counter
+{
+	const char *name;				/*!< Name of the metric. */
+	const char *help;				/*!< Description of the metric. */
+	size_t offset;					/*!< Offset within ll_stats_t. */
+} __metrics_counter_t;
+
+static const __metrics_counter_t __counters[] =
+{
+	{ "ll_rx_frames_total", "Frames received.",
+		offsetof(ll_stats_t, rx_frames) },
+	{ "ll_rx_bytes_total", "Bytes of the frames received.",
+		offsetof(ll_stats_t, rx_bytes) },
+	{ "ll_rx_errors_total", "Frames that could not be read.",
+		offsetof(ll_stats_t, rx_errors) },
+	{ "ll_tx_frames_total", "Frames sent.",
+		offsetof(ll_stats_t, tx_frames) },
+	{ "ll_tx_bytes_total", "Bytes of the frames sent.",
+		offsetof(ll_stats_t, tx_bytes) },
+	{ "ll_tx_errors_total", "Frames that could not be sent.",
+		offsetof(ll_stats_t, tx_errors) },
+	{ "ll_tx_short_total", "Frames sent only partially.",
+		offsetof(ll_stats_t, tx_short) },
+	{ "ll_kernel_drops_total", "Frames dropped by the kernel.",
+		offsetof(ll_stats_t, kernel_drops) },
+	{ "ll_ring_freezes_total", "Times the RX ring was full.",
+		offsetof(ll_stats_t, ring_freezes) },
+	{ "ll_ring_full_total", "Frames not sent, TX ring full.",
+		offsetof(ll_stats_t, ring_full) },
+	{ NULL, NULL, 0 }
+};
+
+/* __append */
+static int __append(char *buffer, const int len, int *used, const char *fmt, ...)
+{
+
+	va_list args;
+	int n = 0;
+
+	if ( *used >= len )
+		{ return(EX_ERR); }
+
+	va_start(args, fmt);
+	n = vsnprintf(buffer + *used, len - *used, fmt, args);
+	va_end(args);
+
+	if ( ( n < 0 ) || ( n >= len - *used ) )
+	{
+		*used = len;
+		return(EX_ERR);
+	}
+
+	*used += n;
+	return(EX_OK);
+
+}
+
+/* __get_latency */
+static void __get_latency
+	(const ll_histogram_t *histogram, ll_metrics_latency_t *latency)
+{
+
+	memset(latency, 0, sizeof(ll_metrics_latency_t));
+
+	if ( ( histogram == NULL ) || ( histogram->count == 0 ) )
+		{ return; }
+
+	latency->count = histogram->count;
+	latency->sum = (uint64_t)histogram->sum;
+	latency->p50 = get_ll_histogram_percentile(histogram, 50.);
+	latency->p90 = get_ll_histogram_percentile(histogram, 90.);
+	latency->p99 = get_ll_histogram_percentile(histogram, 99.);
+	latency->p999 = get_ll_histogram_percentile(histogram, 99.9);
+	latency->max = histogram->max;
+
+}
+
+/* __append_latency */
+static int __append_latency
+	(	char *buffer, const int len, int *used, const char *name,
+		const char *direction, const ll_metrics_latency_t *l	)
+{
+
+	const char *quantiles[] = { "0.5", "0.9", "0.99", "0.999", "1" };
+	const uint64_t values[] = { l->p50, l->p90, l->p99, l->p999, l->max };
+
+	for ( int i = 0; i < 5; i++ )
+	{
+		__append(	buffer, len, used,
+					"ll_callback_latency_seconds{socket=\"%s\",\
+direction=\"%s\",quantile=\"%s\"} %.9f\n"
+					, name, direction, quantiles[i], values[i] / 1e9	);
+	}
+
+	__append(	buffer, len, used,
+				"ll_callback_latency_seconds_sum{socket=\"%s\",\
+direction=\"%s\"} %.9f\n", name, direction, l->sum / 1e9	);
+	return(__append(	buffer, len, used,
+						"ll_callback_latency_seconds_count{socket=\"%s\",\
+direction=\"%s\"} %lu\n", name, direction, l->count	));
+
+}
+
+/* __append_rings */
+static int __append_rings
+	(char *buffer, const int len, int *used, const ll_metrics_record_t *r)
+{
+
+	const char *rings[] = { "rx", "tx" };
+	const uint32_t in_use[] = { r->rx_ring_used, r->tx_ring_used };
+	const uint32_t size[] = { r->rx_ring_len, r->tx_ring_len };
+
+	// the samples of a metric must not be interleaved with other metrics
+	__append(	buffer, len, used,
+				"# HELP ll_ring_slots Blocks (RX) or slots (TX) of the ring.\n\
+# TYPE ll_ring_slots gauge\n"	);
+	for ( int i = 0; i < 2; i++ )
+	{
+		if ( size[i] == 0 )
+			{ continue; }
+		__append(	buffer, len, used,
+					"ll_ring_slots{socket=\"%s\",ring=\"%s\"} %u\n"
+					, r->name, rings[i], size[i]	);
+	}
+
+	__append(	buffer, len, used,
+				"# HELP ll_ring_utilization Fraction of the ring not available.\n\
+# TYPE ll_ring_utilization gauge\n"	);
+	for ( int i = 0; i < 2; i++ )
+	{
+		if ( size[i] == 0 )
+			{ continue; }
+		__append(	buffer, len, used,
+					"ll_ring_utilization{socket=\"%s\",ring=\"%s\"} %.6f\n"
+					, r->name, rings[i], (double)in_use[i] / size[i]	);
+	}
+
+	return( ( *used < len ) ? EX_OK : EX_ERR );
+
+}
+
+/* __close_client */
+static void __close_client(struct ev_loop *loop, ll_metrics_client_t *client)
+{
+
+	ev_io_stop(loop, &client->watcher);
+	ev_timer_stop(loop, &client->timeout);
+	if ( close(client->watcher.fd) < 0 )
+		{ log_sys_error("Could not close metrics client"); }
+	free(client);
+
+}
+
+/* __cb_timeout */
+static void __cb_timeout(struct ev_loop *loop, ev_timer *timer, int revents)
+{
+
+	ll_metrics_client_t *client = (ll_metrics_client_t *)
+		( (uint8_t *)timer - offsetof(ll_metrics_client_t, timeout) );
+
+	// a client that never completes its request would keep its fd forever
+	log_app_msg("Metrics client idle for %.1f s, closed.\n"
+					, METRICS_CLIENT_TIMEOUT);
+	__close_client(loop, client);
+
+}
+
+/* __cb_write */
+static void __cb_write(struct ev_loop *loop, ev_io *watcher, int revents)
+{
+
+	ll_metrics_client_t *client = (ll_metrics_client_t *)watcher;
+	ssize_t n = 0;
+
+	while ( client->sent < client->response_len )
+	{
+
+		n = send(	watcher->fd, client->response + client->sent,
+					client->response_len - client->sent,
+					MSG_DONTWAIT | MSG_NOSIGNAL	);
+
+		if ( n < 0 )
+		{
+			if ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+				{ return; }
+			log_sys_error("Could not send metrics");
+			break;
+		}
+
+		client->sent += n;
+		ev_timer_again(loop, &client->timeout);
+
+	}
+
+	__close_client(loop, client);
+
+}
+
+/* __respond */
+static void __respond(struct ev_loop *loop, ll_metrics_client_t *client)
+{
+
+	ll_metrics_server_t *server = client->server;
+	ll_metrics_record_t record;
+	int format = METRICS_FORMAT_TEXT, offset = 0, len = 0;
+	double uptime = ev_now(loop) - server->start;
+
+	client->request[client->request_len] = '\0';
+	if ( strncmp(client->request, "binary", 6) == 0 )
+		{ format = METRICS_FORMAT_BINARY; }
+	else if ( strncmp(client->request, "GET ", 4) == 0 )
+		{ format = METRICS_FORMAT_HTTP; }
+
+	get_ll_metrics_record(server, &record);
+
+	// the HTTP header has no length, the connection is closed at the end
+	if ( format == METRICS_FORMAT_HTTP )
+	{
+		__append(	client->response, METRICS_RESPONSE_LEN, &offset,
+					"HTTP/1.0 200 OK\r\n\
+Content-Type: text/plain; version=0.0.4\r\n\r\n"	);
+	}
+
+	if ( format == METRICS_FORMAT_BINARY )
+	{
+		len = format_ll_metrics_binary
+					(&record, uptime, client->response, METRICS_RESPONSE_LEN);
+	}
+	else
+	{
+		len = format_ll_metrics_text(	&record, uptime,
+										client->response + offset,
+										METRICS_RESPONSE_LEN - offset	);
+	}
+
+	if ( len < 0 )
+	{
+		log_app_msg("Metrics do not fit in %d bytes.\n", METRICS_RESPONSE_LEN);
+		__close_client(loop, client);
+		return;
+	}
+
+	client->response_len = offset + len;
+	server->requests++;
+
+	ev_io_stop(loop, &client->watcher);
+	ev_io_init(&client->watcher, __cb_write, client->watcher.fd, EV_WRITE);
+	ev_io_start(loop, &client->watcher);
+
+}
+
+/* __cb_read */
+static void __cb_read(struct ev_loop *loop, ev_io *watcher, int revents)
+{
+
+	ll_metrics_client_t *client = (ll_metrics_client_t *)watcher;
+	ssize_t n = 0;
+	int left = METRICS_REQUEST_LEN - 1 - client->request_len;
+
+	n = recv(watcher->fd, client->request + client->request_len, left, 0);
+
+	if ( n < 0 )
+	{
+		if ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+			{ return; }
+		log_sys_error("Could not read metrics request");
+		__close_client(loop, client);
+		return;
+	}
+
+	client->request_len += n;
+	if ( n > 0 )
+		{ ev_timer_again(loop, &client->timeout); }
+
+	// a request is complete with its first line, or once the client is done
+	if ( ( n > 0 ) && ( n < left )
+			&& ( memchr(client->request, '\n', client->request_len) == NULL ) )
+		{ return; }
+
+	__respond(loop, client);
+
+}
+
+/* __cb_accept */
+static void __cb_accept(struct ev_loop *loop, ev_io *watcher, int revents)
+{
+
+	ll_metrics_server_t *server = (ll_metrics_server_t *)watcher;
+	ll_metrics_client_t *client = NULL;
+	int fd = -1;
+
+	if ( EV_ERROR & revents )
+	{
+		log_sys_error("Invalid event");
+		return;
+	}
+
+	if ( ( fd = accept4(	watcher->fd, NULL, NULL,
+							SOCK_NONBLOCK | SOCK_CLOEXEC	) ) < 0 )
+	{
+		if ( ( errno != EAGAIN ) && ( errno != EWOULDBLOCK ) )
+			{ log_sys_error("Could not accept metrics client"); }
+		return;
+	}
+
+	client = (ll_metrics_client_t *)malloc(LEN__LL_METRICS_CLIENT);
+	memset(client, 0, LEN__LL_METRICS_CLIENT);
+	client->server = server;
+
+	ev_io_init(&client->watcher, __cb_read, fd, EV_READ);
+	ev_io_start(loop, &client->watcher);
+
+	ev_timer_init(&client->timeout, __cb_timeout, 0., METRICS_CLIENT_TIMEOUT);
+	ev_timer_again(loop, &client->timeout);
+
+}
+
+/* new_ll_metrics_server */
+ll_metrics_server_t *new_ll_metrics_server()
+{
+
+	ll_metrics_server_t *s = NULL;
+	s = (ll_metrics_server_t *)malloc(LEN__LL_METRICS_SERVER);
+	memset(s, 0, LEN__LL_METRICS_SERVER);
+	return(s);
+
+}
+
+/* init_ll_metrics_server */
+ll_metrics_server_t *init_ll_metrics_server
+	(const char *path, ll_socket_t *ll_socket, const char *name)
+{
+
+	ll_metrics_server_t *s = NULL;
+	struct sockaddr_un addr;
+	int fd = -1;
+
+	if ( ( path == NULL ) || ( ll_socket == NULL ) )
+		{ return(NULL); }
+
+	if ( strlen(path) >= METRICS_PATH_LEN )
+	{
+		log_app_msg("Metrics path too long, path = %s\n", path);
+		return(NULL);
+	}
+
+	memset(&addr, 0, sizeof(struct sockaddr_un));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+	if ( ( fd = socket(	AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+						0	) ) < 0 )
+	{
+		log_sys_error("Could not open metrics socket");
+		return(NULL);
+	}
+
+	// a socket left behind by a previous run would make bind() fail
+	unlink(path);
+
+	if ( ( bind(fd, (struct sockaddr *)&addr, sizeof(struct sockaddr_un)) < 0 )
+			|| ( listen(fd, METRICS_BACKLOG) < 0 ) )
+	{
+		log_sys_error("Could not listen on metrics socket");
+		close(fd);
+		return(NULL);
+	}
+
+	if ( set_latency_ll_socket(ll_socket) < 0 )
+	{
+		close(fd);
+		unlink(path);
+		return(NULL);
+	}
+
+	s = new_ll_metrics_server();
+	s->ll_socket = ll_socket;
+	s->loop = ll_socket->loop;
+	snprintf(s->name, STATS_NAME_LEN, "%s"
+				, ( name != NULL ) ? name : ll_socket->if_name);
+	snprintf(s->path, METRICS_PATH_LEN, "%s", path);
+
+	ev_io_init(&s->watcher, __cb_accept, fd, EV_READ);
+
+	log_app_msg("Metrics of %s served at %s\n", s->name, s->path);
+
+	return(s);
+
+}
+
+/* start_ll_metrics_server */
+void start_ll_metrics_server(ll_metrics_server_t *server)
+{
+
+	ev_now_update(server->loop);
+	server->start = ev_now(server->loop);
+	ev_io_start(server->loop, &server->watcher);
+
+}
+
+/* close_ll_metrics_server */
+int close_ll_metrics_server(ll_metrics_server_t *server)
+{
+
+	int result = EX_OK;
+
+	if ( server == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	ev_io_stop(server->loop, &server->watcher);
+
+	if ( close(server->watcher.fd) < 0 )
+	{
+		log_sys_error("Could not close metrics socket");
+		result = EX_SYS;
+	}
+
+	unlink(server->path);
+	free(server);
+
+	return(result);
+
+}
+
+/* get_ll_metrics_record */
+void get_ll_metrics_record
+	(ll_metrics_server_t *server, ll_metrics_record_t *record)
+{
+
+	ll_socket_t *s = server->ll_socket;
+	ll_stats_t stats;
+
+	memset(record, 0, LEN__LL_METRICS_RECORD);
+	snprintf(record->name, STATS_NAME_LEN, "%s", server->name);
+
+	// the counters are copied once, everything else works on the copy
+	if ( get_ll_socket_stats(s, &stats) < 0 )
+		{ log_app_msg("Could not read kernel statistics of %s.\n", s->if_name); }
+
+	record->rx_frames = stats.rx_frames;
+	record->rx_bytes = stats.rx_bytes;
+	record->rx_errors = stats.rx_errors;
+	record->tx_frames = stats.tx_frames;
+	record->tx_bytes = stats.tx_bytes;
+	record->tx_errors = stats.tx_errors;
+	record->tx_short = stats.tx_short;
+	record->kernel_drops = stats.kernel_drops;
+	record->ring_freezes = stats.ring_freezes;
+	record->ring_full = stats.ring_full;
+
+	#ifdef KERNEL_RING
+		if ( s->rx_ring != NULL )
+		{
+			record->rx_ring_used = rx_ring_used_blocks(s->rx_ring);
+			record->rx_ring_len = s->rx_ring->no_blocks;
+		}
+		if ( s->tx_ring != NULL )
+		{
+			record->tx_ring_used = tx_ring_used_slots(s->tx_ring);
+			record->tx_ring_len = s->tx_ring->no_frames;
+		}
+	#endif
+
+	__get_latency(s->rx_latency, &record->rx_latency);
+	__get_latency(s->tx_latency, &record->tx_latency);
+
+}
+
+/* format_ll_metrics_text */
+int format_ll_metrics_text
+	(	const ll_metrics_record_t *record, const double uptime,
+		char *buffer, const int len	)
+{
+
+	const char *name = record->name;
+	ll_stats_t stats;
+	int used = 0;
+
+	stats.rx_frames = record->rx_frames;
+	stats.rx_bytes = record->rx_bytes;
+	stats.rx_errors = record->rx_errors;
+	stats.tx_frames = record->tx_frames;
+	stats.tx_bytes = record->tx_bytes;
+	stats.tx_errors = record->tx_errors;
+	stats.tx_short = record->tx_short;
+	stats.kernel_drops = record->kernel_drops;
+	stats.ring_freezes = record->ring_freezes;
+	stats.ring_full = record->ring_full;
+
+	__append(	buffer, len, &used,
+				"# HELP ll_uptime_seconds Time since the server started.\n\
+# TYPE ll_uptime_seconds gauge\n\
+ll_uptime_seconds{socket=\"%s\"} %.3f\n", name, uptime	);
+
+	for ( const __metrics_counter_t *c = __counters; c->name != NULL; c++ )
+	{
+		__append(	buffer, len, &used,
+					"# HELP %s %s\n# TYPE %s counter\n%s{socket=\"%s\"} %lu\n"
+					, c->name, c->help, c->name, c->name, name
+					, *(const uint64_t *)( (const uint8_t *)&stats + c->offset )
+				);
+	}
+
+	if ( ( record->rx_ring_len > 0 ) || ( record->tx_ring_len > 0 ) )
+		{ __append_rings(buffer, len, &used, record); }
+
+	__append(	buffer, len, &used,
+				"# HELP ll_callback_latency_seconds Time within the frame \
+callbacks.\n# TYPE ll_callback_latency_seconds summary\n"	);
+	__append_latency(buffer, len, &used, name, "rx", &record->rx_latency);
+	__append_latency(buffer, len, &used, name, "tx", &record->tx_latency);
+
+	return( ( used < len ) ? used : EX_ERR );
+
+}
+
+/* format_ll_metrics_binary */
+int format_ll_metrics_binary
+	(	const ll_metrics_record_t *record, const double uptime,
+		char *buffer, const int len	)
+{
+
+	ll_metrics_header_t header;
+	struct timespec now;
+
+	if ( len < (int)( LEN__LL_METRICS_HEADER + LEN__LL_METRICS_RECORD ) )
+		{ return(EX_ERR); }
+
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	header.magic = METRICS_MAGIC;
+	header.version = METRICS_VERSION;
+	header.no_records = 1;
+	header.timestamp = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+	header.uptime = (uint64_t)( uptime * 1e9 );
+
+	memcpy(buffer, &header, LEN__LL_METRICS_HEADER);
+	memcpy(buffer + LEN__LL_METRICS_HEADER, record, LEN__LL_METRICS_RECORD);
+
+	return(LEN__LL_METRICS_HEADER + LEN__LL_METRICS_RECORD);
+
+}
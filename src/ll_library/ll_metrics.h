@@ -0,0 +1,247 @@
+/*
+ * @file ll_metrics.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for the metrics server of a socket. The
+ * server listens on a Unix socket and runs on the event loop of the socket
+ * it reports, so that no other thread ever reads the counters; every
+ * request is answered from a snapshot copied into the memory of the client.
+ * A request starting with "binary" gets the records below, one starting
+ * with "GET " an HTTP response and anything else (even an empty request)
+ * the Prometheus text format.
+ */
+
+#ifndef LL_METRICS_H_
+#define LL_METRICS_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_socket.h"
+#include "ll_library/ll_stats.h"
+#include "ll_library/ll_histogram.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <ev.h>
+
+/**************************************************************** DATA TYPES */
+
+#define METRICS_MAGIC			0x4C4C4D58	/*!< Binary responses, "LLMX". */
+#define METRICS_VERSION			1			/*!< Version of the records. */
+
+#define METRICS_PATH_LEN		108		/*!< Maximum length of the path. */
+#define METRICS_BACKLOG			8		/*!< Connections waiting for accept. */
+#define METRICS_REQUEST_LEN		64		/*!< Bytes of the request read. */
+#define METRICS_RESPONSE_LEN	8192	/*!< Maximum length of a response. */
+#define METRICS_CLIENT_TIMEOUT	5.0		/*!< Idle clients are closed (s). */
+
+#define METRICS_FORMAT_TEXT		0		/*!< Prometheus text format. */
+#define METRICS_FORMAT_HTTP		1		/*!< Text format, within HTTP. */
+#define METRICS_FORMAT_BINARY	2		/*!< Header plus records. */
+
+/*!
+ * \struct ll_metrics_header
+ * \brief Header of the binary responses, in host byte order.
+ */
+typedef struct ll_metrics_header
+{
+
+	uint32_t magic;					/*!< METRICS_MAGIC. */
+	uint16_t version;				/*!< METRICS_VERSION. */
+	uint16_t no_records;			/*!< Records following the header. */
+	uint64_t timestamp;				/*!< Time of the snapshot (ns, UTC). */
+	uint64_t uptime;				/*!< Time since the server started (ns). */
+
+} __attribute__((packed)) ll_metrics_header_t;
+
+#define LEN__LL_METRICS_HEADER sizeof(ll_metrics_header_t)
+
+/*!
+ * \struct ll_metrics_latency
+ * \brief Summary of the time spent within the callbacks of a watcher (ns).
+ */
+typedef struct ll_metrics_latency
+{
+
+	uint64_t count;					/*!< Callbacks timed. */
+	uint64_t sum;					/*!< Time of all of them. */
+	uint64_t p50;					/*!< Median. */
+	uint64_t p90;					/*!< 90th percentile. */
+	uint64_t p99;					/*!< 99th percentile. */
+	uint64_t p999;					/*!< 99.9th percentile. */
+	uint64_t max;					/*!< Longest callback. */
+
+} __attribute__((packed)) ll_metrics_latency_t;
+
+/*!
+ * \struct ll_metrics_record
+ * \brief Snapshot of the metrics of a socket, as sent in binary responses.
+ */
+typedef struct ll_metrics_record
+{
+
+	char name[STATS_NAME_LEN];		/*!< Name of the socket. */
+
+	uint64_t rx_frames;				/*!< Same counters as ll_stats_t. */
+	uint64_t rx_bytes;
+	uint64_t rx_errors;
+	uint64_t tx_frames;
+	uint64_t tx_bytes;
+	uint64_t tx_errors;
+	uint64_t tx_short;
+	uint64_t kernel_drops;
+	uint64_t ring_freezes;
+	uint64_t ring_full;
+
+	uint32_t rx_ring_used;			/*!< RX blocks owned by userspace. */
+	uint32_t rx_ring_len;			/*!< RX blocks, 0 without rings. */
+	uint32_t tx_ring_used;			/*!< TX slots not available. */
+	uint32_t tx_ring_len;			/*!< TX slots, 0 without rings. */
+
+	ll_metrics_latency_t rx_latency;	/*!< RX callbacks. */
+	ll_metrics_latency_t tx_latency;	/*!< TX callbacks. */
+
+} __attribute__((packed)) ll_metrics_record_t;
+
+#define LEN__LL_METRICS_RECORD sizeof(ll_metrics_record_t)
+
+/*!
+ * \struct ll_metrics_server
+ * \brief Server of the metrics of a socket. The watcher is the first field
+ * 			so that its callback gets the server.
+ */
+typedef struct ll_metrics_server
+{
+
+	ev_io watcher;					/*!< Watcher of the listening socket. */
+	struct ev_loop *loop;			/*!< Loop of the reported socket. */
+
+	ll_socket_t *ll_socket;			/*!< Socket being reported. */
+	char name[STATS_NAME_LEN];		/*!< Name of the socket. */
+	char path[METRICS_PATH_LEN];	/*!< Path of the Unix socket. */
+
+	ev_tstamp start;				/*!< Time the server was started. */
+	uint64_t requests;				/*!< Requests answered. */
+
+} ll_metrics_server_t;
+
+#define LEN__LL_METRICS_SERVER sizeof(ll_metrics_server_t)
+
+/*!
+ * \struct ll_metrics_client
+ * \brief Connection of a client, alive until its response is sent or it
+ * 			stays idle for METRICS_CLIENT_TIMEOUT.
+ */
+typedef struct ll_metrics_client
+{
+
+	ev_io watcher;						/*!< Watcher of the connection. */
+	ev_timer timeout;					/*!< Closes the client once idle. */
+	ll_metrics_server_t *server;		/*!< Server that accepted it. */
+
+	char request[METRICS_REQUEST_LEN];	/*!< Request received so far. */
+	int request_len;					/*!< Length of the request. */
+
+	char response[METRICS_RESPONSE_LEN];	/*!< Response to be sent. */
+	int response_len;						/*!< Length of the response. */
+	int sent;								/*!< Bytes already sent. */
+
+} ll_metrics_client_t;
+
+#define LEN__LL_METRICS_CLIENT sizeof(ll_metrics_client_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a metrics server.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_metrics_server_t *new_ll_metrics_server();
+
+/*!
+ * \brief Creates a server for the metrics of the given socket, listening on
+ * 			the given path (an old socket at that path is replaced). The rx
+ * 			and tx callbacks of the socket are timed from now on.
+ * \param path Path of the Unix socket.
+ * \param ll_socket The socket to be reported.
+ * \param name Name of the socket in the metrics, NULL for the interface.
+ * \return A pointer to the server, NULL in case of error.
+ */
+ll_metrics_server_t *init_ll_metrics_server
+	(const char *path, ll_socket_t *ll_socket, const char *name);
+
+/*!
+ * \brief Starts accepting requests, on the event loop of the socket.
+ * \param server The server to be started.
+ */
+void start_ll_metrics_server(ll_metrics_server_t *server);
+
+/*!
+ * \brief Stops the server and removes its Unix socket.
+ * \param server The server to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_ll_metrics_server(ll_metrics_server_t *server);
+
+/*!
+ * \brief Takes a snapshot of the metrics of the socket of the server.
+ * \param server The server whose socket is to be read.
+ * \param record Where the snapshot is written.
+ */
+void get_ll_metrics_record
+	(ll_metrics_server_t *server, ll_metrics_record_t *record);
+
+/*!
+ * \brief Writes a snapshot in the Prometheus text format.
+ * \param record The snapshot to be written.
+ * \param uptime Time since the server started (s).
+ * \param buffer Where the text is written.
+ * \param len Length of the buffer.
+ * \return Length of the text, <0 if it does not fit.
+ */
+int format_ll_metrics_text
+	(	const ll_metrics_record_t *record, const double uptime,
+		char *buffer, const int len	);
+
+/*!
+ * \brief Writes a snapshot as a binary header followed by its record.
+ * \param record The snapshot to be written.
+ * \param uptime Time since the server started (s).
+ * \param buffer Where the response is written.
+ * \param len Length of the buffer.
+ * \return Length of the response, <0 if it does not fit.
+ */
+int format_ll_metrics_binary
+	(	const ll_metrics_record_t *record, const double uptime,
+		char *buffer, const int len	);
+
+#endif /* LL_METRICS_H_ */
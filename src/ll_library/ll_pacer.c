@@ -0,0 +1,136 @@
+/*
+ * @file ll_pacer.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_pacer.h"
+
+/* new_ll_pacer */
+ll_pacer_t *new_ll_pacer()
+{
+	ll_pacer_t *buffer = NULL;
+	buffer = (ll_pacer_t *)malloc(LEN__LL_PACER);
+	memset(buffer, 0, LEN__LL_PACER);
+	return(buffer);
+}
+
+/* __cb_resume */
+static void __cb_resume(struct ev_loop *loop, ev_timer *timer, int revents)
+{
+
+	ll_pacer_t *pacer = (ll_pacer_t *)timer;
+	resume_ll_tx_queue(get_ll_tx_queue(pacer->watcher));
+
+}
+
+/* init_ll_pacer */
+ll_pacer_t *init_ll_pacer(const int unit, const double rate, const double burst)
+{
+
+	ll_pacer_t *p = NULL;
+
+	if ( ( unit != PACER_UNIT_FRAMES ) && ( unit != PACER_UNIT_BITS ) )
+	{
+		log_app_msg("Unknown pacer unit = %d.\n", unit);
+		return(NULL);
+	}
+
+	if ( ( rate <= 0 ) || ( burst <= 0 ) )
+	{
+		log_app_msg("Pacer rate = %f and burst = %f must be positive.\n"
+						, rate, burst);
+		return(NULL);
+	}
+
+	p = new_ll_pacer();
+	p->unit = unit;
+	p->rate = rate;
+	p->burst = burst;
+
+	ev_timer_init(&p->timer, __cb_resume, 0., 0.);
+
+	return(p);
+
+}
+
+/* start_ll_pacer */
+int start_ll_pacer
+	(ll_pacer_t *pacer, struct ev_loop *loop, struct ev_io *watcher)
+{
+
+	if ( ( pacer == NULL ) || ( loop == NULL ) || ( watcher == NULL ) )
+		{ return(EX_NULL_PARAM); }
+
+	pacer->loop = loop;
+	pacer->watcher = watcher;
+	pacer->tokens = pacer->burst;
+	pacer->last = ev_now(loop);
+
+	return(EX_OK);
+
+}
+
+/* close_ll_pacer */
+int close_ll_pacer(ll_pacer_t *pacer)
+{
+
+	if ( pacer == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( pacer->loop != NULL )
+		{ ev_timer_stop(pacer->loop, &pacer->timer); }
+
+	free(pacer);
+	return(EX_OK);
+
+}
+
+/* consume_ll_pacer */
+bool consume_ll_pacer(ll_pacer_t *pacer, const int frames, const int bytes)
+{
+
+	ev_tstamp now = ev_now(pacer->loop);
+
+	// 1) refill for the time elapsed since the last transmission
+	pacer->tokens += ( now - pacer->last ) * pacer->rate;
+	if ( pacer->tokens > pacer->burst )
+		{ pacer->tokens = pacer->burst; }
+	pacer->last = now;
+
+	// 2) tokens used by this transmission, the bucket may go into debt
+	if ( pacer->unit == PACER_UNIT_BITS )
+		{ pacer->tokens -= 8.0 * bytes; }
+	else
+		{ pacer->tokens -= frames; }
+
+	pacer->frames += frames;
+
+	if ( pacer->tokens > 0 )
+		{ return(false); }
+
+	// 3) no transmissions until the debt has been paid back
+	pause_ll_tx_queue(get_ll_tx_queue(pacer->watcher));
+	ev_timer_set(&pacer->timer, -pacer->tokens / pacer->rate, 0.);
+	ev_timer_start(pacer->loop, &pacer->timer);
+	pacer->pauses++;
+
+	return(true);
+
+}
@@ -0,0 +1,126 @@
+/*
+ * @file ll_pacer.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions of a token bucket that paces the test
+ * frames transmitted by a socket. Tokens (frames or bits) are refilled at
+ * the target rate up to the burst size and every transmission takes the
+ * tokens it used. Whenever the bucket runs dry, the send queue stops running
+ * the TX watcher and a timer is armed to resume it exactly when the debt has
+ * been paid back, so the event loop remains free to serve other watchers.
+ */
+
+#ifndef LL_PACER_H_
+#define LL_PACER_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_tx_queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <ev.h>
+
+/**************************************************************** DATA TYPES */
+
+#define PACER_UNIT_FRAMES		0	/*!< Rate given in frames/s. */
+#define PACER_UNIT_BITS			1	/*!< Rate given in bit/s. */
+
+#define PACER_MIN_BURST			1	/*!< Minimum burst size (frames). */
+
+/*!
+ * \struct ll_pacer
+ * \brief Structure for pacing the transmissions driven by an io watcher. The
+ * 			timer is the first field so that its callback gets the pacer.
+ */
+typedef struct ll_pacer
+{
+
+	ev_timer timer;					/*!< Timer for resuming transmission. */
+
+	struct ev_loop *loop;			/*!< Loop of the paced watcher. */
+	struct ev_io *watcher;			/*!< Watcher being paced. */
+
+	int unit;						/*!< Unit of the rate (frames or bits). */
+	double rate;					/*!< Tokens refilled per second. */
+	double burst;					/*!< Maximum number of tokens. */
+
+	double tokens;					/*!< Tokens currently available. */
+	ev_tstamp last;					/*!< Time of the last refill. */
+
+	uint64_t frames;				/*!< Frames paced so far. */
+	uint64_t pauses;				/*!< Times the watcher was paused. */
+
+} ll_pacer_t;
+
+#define LEN__LL_PACER sizeof(ll_pacer_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a ll_pacer structure.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_pacer_t *new_ll_pacer();
+
+/*!
+ * \brief Creates a token bucket with the given rate and burst.
+ * \param unit Unit of the rate and burst (PACER_UNIT_FRAMES/BITS).
+ * \param rate Target rate (frames/s or bit/s).
+ * \param burst Size of the bucket (frames or bits).
+ * \return A pointer to the new pacer, NULL in case of error.
+ */
+ll_pacer_t *init_ll_pacer(const int unit, const double rate, const double burst);
+
+/*!
+ * \brief Starts pacing the given watcher, with the bucket full.
+ * \param pacer The pacer to be started.
+ * \param loop Loop where the watcher is running.
+ * \param watcher The watcher whose transmissions are paced.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int start_ll_pacer
+	(ll_pacer_t *pacer, struct ev_loop *loop, struct ev_io *watcher);
+
+/*!
+ * \brief Stops the timer of the pacer and releases its memory.
+ * \param pacer The pacer to be closed.
+ * \return EX_OK if the pacer could be closed correctly, <0 otherwise.
+ */
+int close_ll_pacer(ll_pacer_t *pacer);
+
+/*!
+ * \brief Takes from the bucket the tokens used by a transmission. If the
+ * 			bucket runs dry, the watcher is paused until enough tokens
+ * 			have been refilled.
+ * \param pacer The pacer of the watcher.
+ * \param frames Number of frames transmitted.
+ * \param bytes Number of bytes transmitted.
+ * \return true if the watcher was paused, false otherwise.
+ */
+bool consume_ll_pacer(ll_pacer_t *pacer, const int frames, const int bytes);
+
+#endif /* LL_PACER_H_ */
@@ -0,0 +1,314 @@
+/*
+ * @file ll_probe.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_probe.h"
+
+/* __nsecs */
+static uint64_t __nsecs(const uint32_t sec, const uint32_t nsec)
+{
+	return(ntohl(sec) * 1000000000ULL + ntohl(nsec));
+}
+
+/* __ts_nsecs */
+static uint64_t __ts_nsecs(const struct timespec *ts)
+{
+	return((uint32_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec);
+}
+
+/* __finish_probe */
+static void __finish_probe(ll_probe_t *probe)
+{
+
+	probe->finished = true;
+	ev_timer_stop(probe->loop, &probe->timer);
+	print_ll_probe_stats(probe);
+	ev_break(probe->loop, EVBREAK_ALL);
+
+}
+
+/* __cb_linger */
+static void __cb_linger(struct ev_loop *loop, ev_timer *timer, int revents)
+{
+	__finish_probe((ll_probe_t *)timer);
+}
+
+/* new_ll_probe */
+ll_probe_t *new_ll_probe()
+{
+
+	ll_probe_t *p = NULL;
+	p = (ll_probe_t *)malloc(LEN__LL_PROBE);
+	memset(p, 0, LEN__LL_PROBE);
+	return(p);
+
+}
+
+/* init_ll_probe */
+ll_probe_t *init_ll_probe
+	(const int mode, const uint64_t count, const int ts_source)
+{
+
+	ll_probe_t *p = NULL;
+
+	if ( ( mode != PROBE_MODE_PING ) && ( mode != PROBE_MODE_REFLECT ) )
+	{
+		log_app_msg("Unknown probe mode = %d.\n", mode);
+		return(NULL);
+	}
+
+	if ( ( mode == PROBE_MODE_PING ) && ( count == 0 ) )
+	{
+		log_app_msg("At least one probe must be sent.\n");
+		return(NULL);
+	}
+
+	p = new_ll_probe();
+	p->mode = mode;
+	p->count = count;
+	p->ts_source = ts_source;
+
+	// kernel stamps come from CLOCK_REALTIME, those of the NIC from a clock
+	// of its own that cannot be compared with the one of the probes
+	if ( ( ts_source == TS_SOURCE_SOFTWARE )
+			|| ( ts_source == TS_SOURCE_HARDWARE ) )
+	{
+		p->clock_id = CLOCK_REALTIME;
+		p->clock = PROBE_CLOCK_REALTIME;
+	}
+	else
+	{
+		p->clock_id = CLOCK_MONOTONIC_RAW;
+		p->clock = PROBE_CLOCK_MONOTONIC;
+	}
+
+	p->rtt = new_ll_histogram();
+	p->forward = new_ll_histogram();
+	p->backward = new_ll_histogram();
+
+	ev_timer_init(&p->timer, __cb_linger, PROBE_LINGER_SECS, 0.);
+
+	return(p);
+
+}
+
+/* start_ll_probe */
+void start_ll_probe
+	(ll_probe_t *probe, struct ev_loop *loop, struct ev_io *watcher)
+{
+	probe->loop = loop;
+	probe->watcher = watcher;
+}
+
+/* close_ll_probe */
+int close_ll_probe(ll_probe_t *probe)
+{
+
+	if ( probe == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( probe->loop != NULL )
+		{ ev_timer_stop(probe->loop, &probe->timer); }
+
+	free(probe->rtt);
+	free(probe->forward);
+	free(probe->backward);
+	free(probe);
+
+	return(EX_OK);
+
+}
+
+/* get_ll_probe_time */
+void get_ll_probe_time(const ll_probe_t *probe, struct timespec *ts)
+{
+	clock_gettime(probe->clock_id, ts);
+}
+
+/* get_ll_probe_rx_time */
+void get_ll_probe_rx_time
+	(const ll_probe_t *probe, const ll_frame_t *info, struct timespec *ts)
+{
+
+	if ( ( ( info->ts_source == TS_SOURCE_SOFTWARE )
+				&& ( probe->clock == PROBE_CLOCK_REALTIME ) )
+			|| ( ( info->ts_source == TS_SOURCE_CLOCK )
+				&& ( probe->clock == PROBE_CLOCK_MONOTONIC ) ) )
+	{
+		*ts = info->timestamp;
+		return;
+	}
+
+	get_ll_probe_time(probe, ts);
+
+}
+
+/* get_ll_probe_payload */
+ll_probe_payload_t *get_ll_probe_payload
+	(const void *data, const int len, const int type)
+{
+
+	ll_probe_payload_t *p = (ll_probe_payload_t *)data;
+
+	if ( len < (int)LEN__LL_PROBE_PAYLOAD )
+		{ return(NULL); }
+	if ( ( ntohl(p->magic) != PROBE_MAGIC ) || ( p->type != type ) )
+		{ return(NULL); }
+
+	return(p);
+
+}
+
+/* ll_probe_sent */
+void ll_probe_sent(ll_probe_t *probe)
+{
+
+	if ( ++probe->sent < probe->count )
+		{ return; }
+
+	pause_ll_tx_queue(get_ll_tx_queue(probe->watcher));
+	if ( ev_is_active(&probe->timer) == false )
+		{ ev_timer_start(probe->loop, &probe->timer); }
+
+}
+
+/* process_ll_probe_reply */
+int process_ll_probe_reply
+	(	ll_probe_t *probe, const struct timespec *rx,
+		const ll_probe_payload_t *payload	)
+{
+
+	uint64_t tx = __nsecs(payload->tx_sec, payload->tx_nsec);
+	uint64_t rx_ns = __ts_nsecs(rx);
+	uint64_t reflect_rx = 0, reflect_tx = 0;
+	uint32_t sequence = ntohl(payload->sequence);
+
+	if ( ( probe->finished == true ) || ( payload->ping_clock != probe->clock ) )
+		{ return(EX_WRONG_PARAM); }
+
+	if ( rx_ns < tx )
+	{
+		log_app_msg("Reply #%u received before its request was sent.\n"
+						, sequence);
+		return(EX_WRONG_PARAM);
+	}
+
+	if ( ( probe->received > 0 ) && ( sequence < probe->last_sequence ) )
+		{ probe->reordered++; }
+	else
+		{ probe->last_sequence = sequence; }
+	probe->received++;
+
+	record_ll_histogram(probe->rtt, rx_ns - tx);
+
+	// one way latencies are only meaningful between wall clocks
+	if ( ( payload->ping_clock == PROBE_CLOCK_REALTIME )
+			&& ( payload->reflect_clock == PROBE_CLOCK_REALTIME ) )
+	{
+
+		reflect_rx = __nsecs(payload->rx_sec, payload->rx_nsec);
+		reflect_tx = __nsecs(payload->reflect_sec, payload->reflect_nsec);
+
+		if ( ( reflect_rx < tx ) || ( rx_ns < reflect_tx ) )
+			{ probe->skewed++; }
+		else
+		{
+			record_ll_histogram(probe->forward, reflect_rx - tx);
+			record_ll_histogram(probe->backward, rx_ns - reflect_tx);
+		}
+
+	}
+
+	// nothing else to wait for
+	if ( probe->received >= probe->count )
+		{ __finish_probe(probe); }
+
+	return(EX_OK);
+
+}
+
+/* reflect_ll_probe */
+void reflect_ll_probe
+	(	ll_probe_t *probe, const struct timespec *rx,
+		ll_probe_payload_t *payload	)
+{
+
+	struct timespec now;
+
+	payload->type = PROBE_TYPE_REPLY;
+	payload->reflect_clock = probe->clock;
+	payload->rx_sec = htonl((uint32_t)rx->tv_sec);
+	payload->rx_nsec = htonl((uint32_t)rx->tv_nsec);
+
+	get_ll_probe_time(probe, &now);
+	payload->reflect_sec = htonl((uint32_t)now.tv_sec);
+	payload->reflect_nsec = htonl((uint32_t)now.tv_nsec);
+
+	probe->reflected++;
+
+}
+
+/* print_ll_probe_stats */
+void print_ll_probe_stats(const ll_probe_t *probe)
+{
+
+	const ll_probe_t *p = probe;
+
+	log_app_msg(">>> Probe statistics = \n{\n");
+
+	if ( p->mode == PROBE_MODE_REFLECT )
+	{
+		log_app_msg("\t.reflected = %lu\n", p->reflected);
+		log_app_msg("}\n");
+		return;
+	}
+
+	log_app_msg("\t.clock = %s\n"
+				, ( p->clock == PROBE_CLOCK_REALTIME )
+					? "CLOCK_REALTIME" : "CLOCK_MONOTONIC_RAW");
+	log_app_msg("\t.rx_timestamps = %s\n", get_ts_source_name(p->ts_source));
+	log_app_msg("\t.sent = %lu\n", p->sent);
+	log_app_msg("\t.received = %lu\n", p->received);
+	log_app_msg("\t.lost = %lu\n"
+				, ( p->sent > p->received ) ? p->sent - p->received : 0);
+	log_app_msg("\t.reordered = %lu\n", p->reordered);
+
+	print_ll_histogram(p->rtt, "rtt");
+
+	if ( p->received == 0 )
+	{
+		log_app_msg("}\n");
+		return;
+	}
+
+	if ( ( p->forward->count == 0 ) && ( p->skewed == 0 ) )
+	{
+		log_app_msg("\t.one_way = (needs CLOCK_REALTIME at both ends)\n");
+		log_app_msg("}\n");
+		return;
+	}
+
+	print_ll_histogram(p->forward, "one_way_forward");
+	print_ll_histogram(p->backward, "one_way_backward");
+	log_app_msg("\t.one_way_skewed = %lu\n", p->skewed);
+	log_app_msg("}\n");
+
+}
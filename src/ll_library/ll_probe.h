@@ -0,0 +1,227 @@
+/*
+ * @file ll_probe.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for measuring the latency of the link
+ * layer path with probes: a pinger sends sequence numbered, timestamped
+ * test frames and a reflector sends them back, adding the times when it
+ * received and returned them. Round trip times are always measured with the
+ * clock of the pinger; one way latencies are only measured when both ends
+ * use CLOCK_REALTIME, so they are as good as the synchronization of the
+ * clocks (PTP, NTP) of both hosts.
+ */
+
+#ifndef LL_PROBE_H_
+#define LL_PROBE_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_frame.h"
+#include "ll_library/ll_histogram.h"
+#include "ll_library/ll_timestamp.h"
+#include "ll_library/ll_tx_queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <ev.h>
+
+/**************************************************************** DATA TYPES */
+
+#define PROBE_MODE_NONE			0		/*!< Probes disabled. */
+#define PROBE_MODE_PING			1		/*!< Sends probes, measures them. */
+#define PROBE_MODE_REFLECT		2		/*!< Returns the probes received. */
+
+#define PROBE_TYPE_REQUEST		1		/*!< Probe sent by the pinger. */
+#define PROBE_TYPE_REPLY		2		/*!< Probe returned by the reflector. */
+
+#define PROBE_CLOCK_MONOTONIC	0		/*!< Stamps from CLOCK_MONOTONIC_RAW. */
+#define PROBE_CLOCK_REALTIME	1		/*!< Stamps from CLOCK_REALTIME. */
+
+#define PROBE_MAGIC				0x4C4C5052	/*!< "LLPR", marks probes. */
+#define PROBE_DELAY_MS			10		/*!< Default delay between probes. */
+#define PROBE_LINGER_SECS		1.0		/*!< Wait for the last replies (s). */
+
+/*!
+ * \struct ll_probe_payload
+ * \brief Payload of the probes, all fields in network byte order. The
+ * 			pinger fills up the first half, the reflector the second one.
+ */
+typedef struct ll_probe_payload
+{
+
+	uint32_t magic;				/*!< PROBE_MAGIC. */
+	uint32_t sequence;			/*!< Sequence number of the probe. */
+	uint32_t tx_sec;			/*!< Sent by the pinger, seconds. */
+	uint32_t tx_nsec;			/*!< Sent by the pinger, nanoseconds. */
+	uint8_t type;				/*!< PROBE_TYPE_*. */
+	uint8_t ping_clock;			/*!< PROBE_CLOCK_* of the pinger. */
+	uint8_t reflect_clock;		/*!< PROBE_CLOCK_* of the reflector. */
+	uint8_t padding;			/*!< Unused. */
+	uint32_t rx_sec;			/*!< Received by the reflector, seconds. */
+	uint32_t rx_nsec;			/*!< Received by the reflector, nsecs. */
+	uint32_t reflect_sec;		/*!< Returned by the reflector, seconds. */
+	uint32_t reflect_nsec;		/*!< Returned by the reflector, nsecs. */
+
+} __attribute__((packed)) ll_probe_payload_t;
+
+#define LEN__LL_PROBE_PAYLOAD sizeof(ll_probe_payload_t)
+
+/*!
+ * \struct ll_probe
+ * \brief State of the probes of a socket, either pinger or reflector.
+ */
+typedef struct ll_probe
+{
+
+	ev_timer timer;					/*!< Waits for the last replies (first!). */
+	struct ev_loop *loop;			/*!< Loop of the tx watcher. */
+	struct ev_io *watcher;			/*!< tx watcher of the pinger. */
+
+	int mode;						/*!< PROBE_MODE_*. */
+	uint64_t count;					/*!< Probes to be sent by the pinger. */
+	clockid_t clock_id;				/*!< Clock of the stamps. */
+	int clock;						/*!< PROBE_CLOCK_* of clock_id. */
+	int ts_source;					/*!< Stamps of the frames received. */
+
+	uint64_t sent;					/*!< Probes sent. */
+	uint64_t received;				/*!< Replies received. */
+	uint64_t reflected;				/*!< Probes returned (reflector). */
+	uint64_t reordered;				/*!< Replies older than a previous one. */
+	uint64_t skewed;				/*!< One way latencies < 0 (clocks). */
+	uint32_t last_sequence;			/*!< Newest reply received. */
+	bool finished;					/*!< All probes sent and waited for. */
+
+	ll_histogram_t *rtt;			/*!< Round trip times (ns). */
+	ll_histogram_t *forward;		/*!< Pinger to reflector latency (ns). */
+	ll_histogram_t *backward;		/*!< Reflector to pinger latency (ns). */
+
+} ll_probe_t;
+
+#define LEN__LL_PROBE sizeof(ll_probe_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for the probes of a socket.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_probe_t *new_ll_probe();
+
+/*!
+ * \brief Creates the probes of a socket. Stamps are taken from the clock of
+ * 			the kernel timestamps of the socket, so that the timestamps of
+ * 			the frames received can be used right away.
+ * \param mode Role of the socket (PROBE_MODE_PING or PROBE_MODE_REFLECT).
+ * \param count Number of probes to be sent by a pinger.
+ * \param ts_source Source of the timestamps of the socket (TS_SOURCE_*).
+ * \return A pointer to the new probes, NULL in case of error.
+ */
+ll_probe_t *init_ll_probe
+	(const int mode, const uint64_t count, const int ts_source);
+
+/*!
+ * \brief Starts the probes of a pinger, whose tx watcher is paused once
+ * 			all the probes have been sent.
+ * \param probe The probes to be started.
+ * \param loop Loop of the watcher.
+ * \param watcher tx watcher of the socket.
+ */
+void start_ll_probe
+	(ll_probe_t *probe, struct ev_loop *loop, struct ev_io *watcher);
+
+/*!
+ * \brief Stops the timer of the probes and releases them.
+ * \param probe The probes to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_ll_probe(ll_probe_t *probe);
+
+/*!
+ * \brief Gets the current time with the clock of the probes.
+ * \param probe The probes whose clock is to be read.
+ * \param ts Set to the current time.
+ */
+void get_ll_probe_time(const ll_probe_t *probe, struct timespec *ts);
+
+/*!
+ * \brief Gets the time when a frame was received with the clock of the
+ * 			probes: the timestamp of the frame if it comes from that clock,
+ * 			the current time otherwise (for instance, NIC timestamps).
+ * \param probe The probes whose clock is to be used.
+ * \param info Info of the frame received.
+ * \param ts Set to the time of the reception.
+ */
+void get_ll_probe_rx_time
+	(const ll_probe_t *probe, const ll_frame_t *info, struct timespec *ts);
+
+/*!
+ * \brief Checks whether a payload is the one of a probe of the given type.
+ * \param data Payload of the frame.
+ * \param len Length of the payload (B).
+ * \param type Type of probe expected (PROBE_TYPE_*).
+ * \return The payload of the probe, NULL if it is not a probe of that type.
+ */
+ll_probe_payload_t *get_ll_probe_payload
+	(const void *data, const int len, const int type);
+
+/*!
+ * \brief Accounts for a probe sent by the pinger. Once the last one has been
+ * 			sent, the tx watcher is paused and the replies still on their
+ * 			way are waited for PROBE_LINGER_SECS.
+ * \param probe The probes of the pinger.
+ */
+void ll_probe_sent(ll_probe_t *probe);
+
+/*!
+ * \brief Records the latencies of a reply received by the pinger.
+ * \param probe The probes of the pinger.
+ * \param rx Time of the reception, see get_ll_probe_rx_time().
+ * \param payload Payload of the reply.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int process_ll_probe_reply
+	(	ll_probe_t *probe, const struct timespec *rx,
+		const ll_probe_payload_t *payload	);
+
+/*!
+ * \brief Turns the payload of a request into the one of its reply, stamping
+ * 			it with the times of reception and return.
+ * \param probe The probes of the reflector.
+ * \param rx Time of the reception, see get_ll_probe_rx_time().
+ * \param payload Payload of the request, modified in place.
+ */
+void reflect_ll_probe
+	(	ll_probe_t *probe, const struct timespec *rx,
+		ll_probe_payload_t *payload	);
+
+/*!
+ * \brief Prints the statistics and latency histograms of the probes.
+ * \param probe The probes whose statistics are to be printed.
+ */
+void print_ll_probe_stats(const ll_probe_t *probe);
+
+#endif /* LL_PROBE_H_ */
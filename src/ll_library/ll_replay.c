@@ -0,0 +1,606 @@
+/*
+ * @file ll_replay.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_replay.h"
+
+/* __now_nsecs */
+static uint64_t __now_nsecs()
+{
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return(now.tv_sec * NSECS_PER_SEC + now.tv_nsec);
+
+}
+
+/* __read_u16 */
+static uint16_t __read_u16(const ll_replay_t *r, const size_t offset)
+{
+
+	uint16_t v = 0;
+	memcpy(&v, r->data + offset, sizeof(uint16_t));
+	return( ( r->swapped == true ) ? bswap_16(v) : v );
+
+}
+
+/* __read_u32 */
+static uint32_t __read_u32(const ll_replay_t *r, const size_t offset)
+{
+
+	uint32_t v = 0;
+	memcpy(&v, r->data + offset, sizeof(uint32_t));
+	return( ( r->swapped == true ) ? bswap_32(v) : v );
+
+}
+
+/* __units_2_nsecs */
+static uint64_t __units_2_nsecs(const uint64_t ts, const uint64_t units)
+{
+
+	if ( units == NSECS_PER_SEC )
+		{ return(ts); }
+	if ( ( units < NSECS_PER_SEC ) && ( ( NSECS_PER_SEC % units ) == 0 ) )
+		{ return(ts * ( NSECS_PER_SEC / units )); }
+
+	return(	( ts / units ) * NSECS_PER_SEC
+			+ (uint64_t)( (unsigned __int128)( ts % units ) * NSECS_PER_SEC
+							/ units )	);
+
+}
+
+/* __cb_resume */
+static void __cb_resume(struct ev_loop *loop, ev_timer *timer, int revents)
+{
+
+	ll_replay_t *replay = (ll_replay_t *)timer;
+	resume_ll_tx_queue(get_ll_tx_queue(replay->watcher));
+
+}
+
+/* new_ll_replay */
+ll_replay_t *new_ll_replay()
+{
+
+	ll_replay_t *r = NULL;
+	r = (ll_replay_t *)malloc(LEN__LL_REPLAY);
+	memset(r, 0, LEN__LL_REPLAY);
+	return(r);
+
+}
+
+/* init_ll_replay */
+ll_replay_t *init_ll_replay
+	(	const char *path, const double speed, const int max_frames,
+		const int if_index	)
+{
+
+	ll_replay_t *r = new_ll_replay();
+	struct stat st;
+	uint32_t magic = 0;
+
+	if ( ( r->fd = open(path, O_RDONLY) ) < 0 )
+	{
+		log_sys_error("Could not open replay file");
+		free(r);
+		return(NULL);
+	}
+
+	if ( ( fstat(r->fd, &st) < 0 ) || ( st.st_size < sizeof(uint32_t) ) )
+	{
+		log_app_msg("Replay file %s is empty.\n", path);
+		close(r->fd);
+		free(r);
+		return(NULL);
+	}
+
+	r->len = st.st_size;
+	if ( ( r->data = mmap(NULL, r->len, PROT_READ, MAP_PRIVATE, r->fd, 0) )
+			== MAP_FAILED )
+	{
+		log_sys_error("Could not map replay file");
+		close(r->fd);
+		free(r);
+		return(NULL);
+	}
+
+	// frames are read only once and in order
+	madvise((void *)r->data, r->len, MADV_SEQUENTIAL);
+	madvise((void *)r->data, r->len, MADV_WILLNEED);
+
+	memcpy(&magic, r->data, sizeof(uint32_t));
+	if ( ( magic == bswap_32(PCAP_MAGIC_USECS) )
+			|| ( magic == bswap_32(PCAP_MAGIC_NSECS) ) )
+		{ r->swapped = true; }
+
+	if ( ( r->len >= sizeof(pcap_file_header_t) )
+			&& ( ( __read_u32(r, 0) == PCAP_MAGIC_USECS )
+					|| ( __read_u32(r, 0) == PCAP_MAGIC_NSECS ) ) )
+	{
+		r->format = CAPTURE_FORMAT_PCAP;
+		r->nsecs = ( __read_u32(r, 0) == PCAP_MAGIC_NSECS );
+		r->offset = sizeof(pcap_file_header_t);
+	}
+	else if ( magic == PCAPNG_SHB_TYPE )
+	{
+		// the byte order is read from each section header
+		r->format = CAPTURE_FORMAT_PCAPNG;
+		r->offset = 0;
+	}
+	else
+	{
+		log_app_msg("Unknown format of replay file %s.\n", path);
+		close_ll_replay(r);
+		return(NULL);
+	}
+
+	r->speed = ( speed > 0 ) ? speed : REPLAY_SPEED_MAX;
+	ev_timer_init(&r->timer, __cb_resume, 0., 0.);
+
+	#ifndef KERNEL_RING
+		// frames are sent straight from the mapping, only their info is kept
+		r->batch = init_ll_frame_batch(max_frames, LEN__LL_FRAME, 0, 0);
+		r->addr.sll_family = AF_PACKET;
+		r->addr.sll_ifindex = if_index;
+		r->addr.sll_halen = ETH_ALEN;
+	#endif
+
+	return(r);
+
+}
+
+/* start_ll_replay */
+void start_ll_replay
+	(ll_replay_t *replay, struct ev_loop *loop, struct ev_io *watcher)
+{
+
+	replay->loop = loop;
+	replay->watcher = watcher;
+
+}
+
+/* close_ll_replay */
+int close_ll_replay(ll_replay_t *replay)
+{
+
+	int result = EX_OK;
+
+	if ( replay == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( replay->loop != NULL )
+		{ ev_timer_stop(replay->loop, &replay->timer); }
+
+	if ( munmap((void *)replay->data, replay->len) < 0 )
+	{
+		log_sys_error("Could not unmap replay file");
+		result = EX_SYS;
+	}
+
+	if ( close(replay->fd) < 0 )
+	{
+		log_sys_error("Could not close replay file");
+		result = EX_SYS;
+	}
+
+	#ifndef KERNEL_RING
+		if ( replay->batch != NULL )
+		{
+			free(replay->batch->frames);
+			free(replay->batch->msgs);
+			free(replay->batch->iovs);
+			free(replay->batch->controls);
+			free(replay->batch);
+		}
+	#endif
+
+	free(replay);
+	return(result);
+
+}
+
+/* __next_pcap_frame */
+static int __next_pcap_frame(ll_replay_t *r)
+{
+
+	uint32_t sec = 0, frac = 0, caplen = 0;
+
+	if ( r->offset + sizeof(pcap_record_header_t) > r->len )
+		{ return(EX_EOF); }
+
+	sec = __read_u32(r, r->offset);
+	frac = __read_u32(r, r->offset + 4);
+	caplen = __read_u32(r, r->offset + 8);
+
+	// next_len is an int, a bogus caplen would turn it negative
+	if ( caplen > CAPTURE_SNAPLEN )
+	{
+		log_app_msg("Replay file corrupted, offset = %lu, caplen = %u\n"
+						, r->offset, caplen);
+		return(EX_ERR);
+	}
+
+	if ( r->offset + sizeof(pcap_record_header_t) + caplen > r->len )
+	{
+		log_app_msg("Replay file truncated, offset = %lu\n", r->offset);
+		return(EX_EOF);
+	}
+
+	r->next_ts = sec * NSECS_PER_SEC
+					+ ( ( r->nsecs == true ) ? frac : frac * 1000ULL );
+	r->next_data = r->data + r->offset + sizeof(pcap_record_header_t);
+	r->next_len = caplen;
+	r->offset += sizeof(pcap_record_header_t) + caplen;
+
+	return(EX_OK);
+
+}
+
+/* __parse_pcapng_idb */
+static void __parse_pcapng_idb(ll_replay_t *r, const size_t end)
+{
+
+	size_t o = r->offset + 16;
+	uint16_t code = 0, len = 0;
+	uint8_t v = 0;
+	uint64_t units = 1000000;
+
+	if ( r->no_ifaces >= REPLAY_MAX_IFACES )
+		{ return; }
+
+	// options follow the fixed part of the block, until opt_endofopt
+	while ( o + 4 <= end )
+	{
+
+		code = __read_u16(r, o);
+		len = __read_u16(r, o + 2);
+		if ( ( code == 0 ) || ( o + 4 + len > end ) )
+			{ break; }
+
+		if ( ( code == PCAPNG_OPT_TSRESOL ) && ( len >= 1 ) )
+		{
+			v = r->data[o + 4];
+			units = 1;
+			if ( v & 0x80 )
+				{ units = 1ULL << ( v & 0x7F ); }
+			else
+				{ for ( int i = 0; i < v; i++ ) { units *= 10; } }
+		}
+
+		o += 4 + ( ( len + 3 ) & ~3 );
+
+	}
+
+	r->ts_units[r->no_ifaces++] = units;
+
+}
+
+/* __corrupted_pcapng */
+static int __corrupted_pcapng(const ll_replay_t *r, const uint32_t block_len)
+{
+	log_app_msg("Replay file corrupted, offset = %lu, block_len = %u\n"
+					, r->offset, block_len);
+	return(EX_ERR);
+}
+
+/* __next_pcapng_frame */
+static int __next_pcapng_frame(ll_replay_t *r)
+{
+
+	uint32_t type = 0, block_len = 0, iface = 0, caplen = 0, bom = 0;
+	uint64_t ts = 0;
+
+	for ( ;; )
+	{
+
+		if ( r->offset + 12 > r->len )
+			{ return(EX_EOF); }
+
+		memcpy(&type, r->data + r->offset, sizeof(uint32_t));
+		if ( type == PCAPNG_SHB_TYPE )
+		{
+			memcpy(&bom, r->data + r->offset + 8, sizeof(uint32_t));
+			r->swapped = ( bom != PCAPNG_BYTE_ORDER );
+			r->no_ifaces = 0;
+		}
+		type = __read_u32(r, r->offset);
+		block_len = __read_u32(r, r->offset + 4);
+
+		if ( ( block_len < 12 ) || ( block_len & 3 )
+				|| ( r->offset + block_len > r->len ) )
+		{
+			log_app_msg("Replay file corrupted, offset = %lu\n", r->offset);
+			return(EX_ERR);
+		}
+
+		switch ( type )
+		{
+			case PCAPNG_IDB_TYPE:
+
+				__parse_pcapng_idb(r, r->offset + block_len - 4);
+				break;
+
+			case PCAPNG_EPB_TYPE:
+
+				// the fixed part and the trailing length, before any field
+				if ( block_len < sizeof(pcapng_epb_header_t) + 4 )
+					{ return(__corrupted_pcapng(r, block_len)); }
+
+				iface = __read_u32(r, r->offset + 8);
+				ts = ( (uint64_t)__read_u32(r, r->offset + 12) << 32 )
+						| __read_u32(r, r->offset + 16);
+				caplen = __read_u32(r, r->offset + 20);
+				if ( ( caplen > CAPTURE_SNAPLEN ) || ( caplen
+						> block_len - sizeof(pcapng_epb_header_t) - 4 ) )
+					{ return(__corrupted_pcapng(r, block_len)); }
+
+				r->next_ts = __units_2_nsecs
+								(	ts, ( iface < r->no_ifaces )
+										? r->ts_units[iface] : 1000000	);
+				r->next_data = r->data + r->offset
+								+ sizeof(pcapng_epb_header_t);
+				r->next_len = caplen;
+				r->offset += block_len;
+				return(EX_OK);
+
+			case PCAPNG_SPB_TYPE:
+
+				// no timestamp, the frame goes right after the previous one
+				if ( block_len < 16 )
+					{ return(__corrupted_pcapng(r, block_len)); }
+
+				caplen = __read_u32(r, r->offset + 8);
+				if ( caplen > block_len - 16 )
+					{ caplen = block_len - 16; }
+				if ( caplen > CAPTURE_SNAPLEN )
+					{ return(__corrupted_pcapng(r, block_len)); }
+
+				r->next_data = r->data + r->offset + 12;
+				r->next_len = caplen;
+				r->offset += block_len;
+				return(EX_OK);
+
+			default:
+				break;
+		}
+
+		r->offset += block_len;
+
+	}
+
+}
+
+/* next_ll_replay_frame */
+int next_ll_replay_frame(ll_replay_t *replay)
+{
+
+	if ( replay->format == CAPTURE_FORMAT_PCAP )
+		{ return(__next_pcap_frame(replay)); }
+
+	return(__next_pcapng_frame(replay));
+
+}
+
+/* __queue_replay_frame */
+static int __queue_replay_frame(const public_ev_arg_t *arg, ll_replay_t *r)
+{
+
+#ifdef KERNEL_RING
+
+	void *slot = NULL;
+	int max_len = 0;
+
+	if ( ( slot = tx_ring_get_slot(arg->tx_ring, &max_len) ) == NULL )
+		{ return(EX_ERR); }
+
+	if ( ( r->next_len < 0 ) || ( r->next_len > max_len ) )
+	{
+		r->stats.skipped++;
+		ll_stats_inc(arg->stats, tx_errors);
+		return(EX_OK);
+	}
+
+	memcpy(slot, r->next_data, r->next_len);
+	if ( tx_ring_commit(arg->tx_ring, r->next_len) < 0 )
+		{ return(EX_ERR); }
+	ll_stats_tx(arg->stats, r->next_len);
+
+#else
+
+	ll_frame_batch_t *b = r->batch;
+	ll_frame_t *frame = NULL;
+
+	if ( b->no_frames >= b->max_frames )
+		{ return(EX_ERR); }
+
+	frame = (ll_frame_t *)get_ll_frame_batch(b, b->no_frames);
+	frame->frame_len = r->next_len;
+	b->iovs[b->no_frames].iov_base = (void *)r->next_data;
+	b->no_frames++;
+
+#endif
+
+	r->stats.frames++;
+	r->stats.bytes += r->next_len;
+
+	return(EX_OK);
+
+}
+
+#ifndef KERNEL_RING
+
+/* __send_replay_batch */
+static int __send_replay_batch
+	(const int socket_fd, ll_replay_t *r, ll_stats_t *stats)
+{
+
+	ll_frame_batch_t *b = r->batch;
+	ll_frame_t *frame = NULL;
+	int first = 0, result = 0;
+
+	while ( b->next_frame < b->no_frames )
+	{
+
+		first = b->next_frame;
+		result = send_ll_frame_batch(socket_fd, b, &r->addr);
+		ll_stats_tx_batch(stats, b, first);
+
+		if ( result >= 0 )
+			{ break; }
+
+		// the frame rejected by the kernel is skipped, not retried forever
+		frame = (ll_frame_t *)get_ll_frame_batch(b, b->next_frame);
+		r->stats.frames--;
+		r->stats.bytes -= frame->frame_len;
+		r->stats.skipped++;
+		ll_stats_inc(stats, tx_errors);
+		b->next_frame++;
+
+	}
+
+	return( ( b->next_frame < b->no_frames ) ? EX_ERR : EX_OK );
+
+}
+
+#endif
+
+/* __finish_replay */
+static void __finish_replay(ll_replay_t *r)
+{
+
+	r->stats.end = __now_nsecs();
+	print_ll_replay_stats(r);
+
+	pause_ll_tx_queue(get_ll_tx_queue(r->watcher));
+	ev_break(r->loop, EVBREAK_ALL);
+
+}
+
+/* ll_replay_tx_cb */
+void ll_replay_tx_cb(public_ev_arg_t *arg)
+{
+
+	ll_replay_t *r = arg->replay;
+	uint64_t now = __now_nsecs(), due = 0, error = 0, offset = 0;
+
+#ifdef KERNEL_RING
+	tx_ring_reclaim(arg->tx_ring);
+#else
+	// frames the kernel could not take the last time go first
+	if ( __send_replay_batch(arg->socket_fd, r, arg->stats) < 0 )
+	{
+		stall_ll_tx_queue(arg->tx_queue);
+		return;
+	}
+	r->batch->no_frames = 0;
+	r->batch->next_frame = 0;
+#endif
+
+	while ( r->finished == false )
+	{
+
+		if ( ( r->has_next == false )
+				&& ( next_ll_replay_frame(r) != EX_OK ) )
+			{ r->finished = true; break; }
+		r->has_next = true;
+
+		if ( r->wall_start == 0 )
+		{
+			r->wall_start = now;
+			r->first_ts = r->next_ts;
+			r->stats.start = now;
+		}
+
+		if ( r->speed > REPLAY_SPEED_MAX )
+		{
+
+			offset = ( r->next_ts > r->first_ts )
+						? r->next_ts - r->first_ts : 0;
+			due = r->wall_start + (uint64_t)( offset / r->speed );
+
+			// nothing else is due, the loop wakes the replay up later
+			if ( due > now )
+			{
+				pause_ll_tx_queue(get_ll_tx_queue(r->watcher));
+				ev_timer_set(&r->timer, ( due - now ) / 1e9, 0.);
+				ev_timer_start(r->loop, &r->timer);
+				break;
+			}
+
+			error = now - due;
+			r->stats.error_sum += error;
+			if ( error > r->stats.error_max )
+				{ r->stats.error_max = error; }
+
+		}
+
+		// ring or batch are full, the rest goes with the next call
+		if ( __queue_replay_frame(arg, r) < 0 )
+			{ break; }
+		r->has_next = false;
+
+	}
+
+#ifdef KERNEL_RING
+	if ( tx_ring_flush(arg->tx_ring) < 0 )
+		{ log_app_msg("Could not flush replayed frames.\n"); }
+#else
+	if ( __send_replay_batch(arg->socket_fd, r, arg->stats) < 0 )
+	{
+		stall_ll_tx_queue(arg->tx_queue);
+		return;
+	}
+#endif
+
+	if ( r->finished == true )
+		{ __finish_replay(r); }
+
+}
+
+/* print_ll_replay_stats */
+void print_ll_replay_stats(const ll_replay_t *replay)
+{
+
+	const ll_replay_stats_t *s = &replay->stats;
+	double secs = ( s->end > s->start ) ? ( s->end - s->start ) / 1e9 : 0.;
+	double mean = ( s->frames > 0 ) ? s->error_sum / 1e3 / s->frames : 0.;
+
+	log_app_msg(">>> Replay statistics = \n{\n");
+	log_app_msg("\t.frames = %lu\n", s->frames);
+	log_app_msg("\t.bytes = %lu\n", s->bytes);
+	log_app_msg("\t.skipped = %lu\n", s->skipped);
+	log_app_msg("\t.elapsed (s) = %.6f\n", secs);
+
+	if ( secs > 0 )
+	{
+		log_app_msg("\t.rate (frames/s) = %.1f\n", s->frames / secs);
+		log_app_msg("\t.rate (Mbit/s) = %.3f\n", s->bytes * 8. / secs / 1e6);
+	}
+
+	if ( replay->speed > REPLAY_SPEED_MAX )
+	{
+		log_app_msg("\t.timing_error_mean (us) = %.3f\n", mean);
+		log_app_msg("\t.timing_error_max (us) = %.3f\n", s->error_max / 1e3);
+	}
+
+	log_app_msg("}\n");
+
+}
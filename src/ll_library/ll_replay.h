@@ -0,0 +1,183 @@
+/*
+ * @file ll_replay.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for replaying the frames of a capture
+ * file (pcap or pcapng) through the transmission path of a socket. The file
+ * is mmap()ed and its frames are sent either with the original timing
+ * between them, scaled by a speed factor, or as fast as possible. Frames
+ * are sent in batches: straight from the mapping with sendmmsg(), or
+ * copied into the slots of the TX ring when kernel rings are used.
+ */
+
+#ifndef LL_REPLAY_H_
+#define LL_REPLAY_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_frame.h"
+#include "ll_library/ll_capture.h"
+#include "ll_library/ll_stats.h"
+#include "ll_library/ll_tx_queue.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <byteswap.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ev.h>
+
+#ifdef KERNEL_RING
+	#include "ll_library/ll_ring.h"
+#endif
+
+/**************************************************************** DATA TYPES */
+
+#define REPLAY_SPEED_MAX		0.0		/*!< Speed for "as fast as possible". */
+#define REPLAY_BATCH_LEN		64		/*!< Default frames per batch. */
+#define REPLAY_MAX_IFACES		8		/*!< pcapng interfaces supported. */
+
+#define PCAP_MAGIC_USECS		0xA1B2C3D4	/*!< pcap magic, microseconds. */
+#define PCAPNG_SPB_TYPE			0x00000003	/*!< Simple packet block. */
+
+#define NSECS_PER_SEC			1000000000ULL	/*!< Nanoseconds per second. */
+
+/*!
+ * \struct ll_replay_stats
+ * \brief Statistics of a replay.
+ */
+typedef struct ll_replay_stats
+{
+
+	uint64_t frames;			/*!< Frames sent. */
+	uint64_t bytes;				/*!< Bytes sent. */
+	uint64_t skipped;			/*!< Frames that could not be sent. */
+	uint64_t error_sum;			/*!< Sum of the timing errors (nsecs). */
+	uint64_t error_max;			/*!< Maximum timing error (nsecs). */
+	uint64_t start;				/*!< Time of the first frame (nsecs). */
+	uint64_t end;				/*!< Time of the last frame (nsecs). */
+
+} ll_replay_stats_t;
+
+/*!
+ * \struct ll_replay
+ * \brief Capture file being replayed.
+ */
+typedef struct ll_replay
+{
+
+	ev_timer timer;					/*!< Wakes up the replay (first!). */
+	struct ev_loop *loop;			/*!< Loop of the tx watcher. */
+	struct ev_io *watcher;			/*!< tx watcher, paused while waiting. */
+
+	int fd;							/*!< File descriptor of the capture. */
+	const uint8_t *data;			/*!< Mapping of the capture. */
+	size_t len;						/*!< Length of the capture (B). */
+	size_t offset;					/*!< Offset of the next record. */
+
+	int format;						/*!< CAPTURE_FORMAT_*. */
+	bool swapped;					/*!< Byte order differs from host's. */
+	bool nsecs;						/*!< pcap timestamps in nanoseconds. */
+	int no_ifaces;					/*!< pcapng interfaces described. */
+	uint64_t ts_units[REPLAY_MAX_IFACES];	/*!< Units per second. */
+
+	double speed;					/*!< Speed factor, 0 as fast as possible. */
+
+	bool has_next;					/*!< Next frame already parsed. */
+	const uint8_t *next_data;		/*!< Contents of the next frame. */
+	int next_len;					/*!< Length of the next frame. */
+	uint64_t next_ts;				/*!< Timestamp of the next frame (ns). */
+
+	bool finished;					/*!< No frames left in the capture. */
+	uint64_t first_ts;				/*!< Timestamp of the first frame (ns). */
+	uint64_t wall_start;			/*!< Time the first frame was sent (ns). */
+
+#ifndef KERNEL_RING
+	ll_frame_batch_t *batch;		/*!< Frames of the mapping to be sent. */
+	struct sockaddr_ll addr;		/*!< Address for the frames. */
+#endif
+
+	ll_replay_stats_t stats;		/*!< Statistics. */
+
+} ll_replay_t;
+
+#define LEN__LL_REPLAY sizeof(ll_replay_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a replay.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_replay_t *new_ll_replay();
+
+/*!
+ * \brief Maps the given capture file and checks its format.
+ * \param path Path of the capture file (pcap or pcapng).
+ * \param speed Speed factor (1.0 = original timing), 0 as fast as possible.
+ * \param max_frames Maximum number of frames sent per batch.
+ * \param if_index Index of the interface for the transmission.
+ * \return A pointer to the new replay, NULL in case of error.
+ */
+ll_replay_t *init_ll_replay
+	(	const char *path, const double speed, const int max_frames,
+		const int if_index	);
+
+/*!
+ * \brief Starts a replay: the frames are sent whenever the given tx watcher
+ * 			is run by the send queue, which is paused while no frame is due.
+ * \param replay The replay to be started.
+ * \param loop Loop of the watcher.
+ * \param watcher tx watcher of the socket.
+ */
+void start_ll_replay
+	(ll_replay_t *replay, struct ev_loop *loop, struct ev_io *watcher);
+
+/*!
+ * \brief Unmaps the capture file and releases the replay.
+ * \param replay The replay to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_ll_replay(ll_replay_t *replay);
+
+/*!
+ * \brief Parses the next frame of the capture.
+ * \param replay The replay whose next frame is to be read.
+ * \return EX_OK if a frame was read, EX_EOF at the end of the capture,
+ * 			<0 if the capture is corrupted.
+ */
+int next_ll_replay_frame(ll_replay_t *replay);
+
+/*!
+ * \brief Callback for the tx watcher, sends all the frames already due.
+ * \param arg Argument given by the event handler.
+ */
+void ll_replay_tx_cb(public_ev_arg_t *arg);
+
+/*!
+ * \brief Prints the statistics of a replay.
+ * \param replay The replay whose statistics are to be printed.
+ */
+void print_ll_replay_stats(const ll_replay_t *replay);
+
+#endif /* LL_REPLAY_H_ */
@@ -0,0 +1,467 @@
+/*
+ * @file ll_ring.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_ring.h"
+
+/*!< Size of the RX rings of the sockets, every socket maps its own. */
+static int __rx_block_size = RX_RING_BLOCK_SIZE;
+static int __rx_no_blocks = RX_RING_NO_BLOCKS;
+
+/* new_rx_ring */
+rx_ring_t *new_rx_ring()
+{
+	rx_ring_t *buffer = NULL;
+	buffer = (rx_ring_t *)malloc(LEN__RX_RING);
+	memset(buffer, 0, LEN__RX_RING);
+	return(buffer);
+}
+
+/* init_tpacket_req3 */
+tpacket_req3_t *init_tpacket_req3
+	(	const int block_size, const int no_blocks,
+		const int frame_size, const int block_tmo	)
+{
+	tpacket_req3_t *t = (tpacket_req3_t *)malloc(LEN__TPACKET_REQ3);
+	memset(t, 0, LEN__TPACKET_REQ3);
+	t->tp_block_size = block_size;
+	t->tp_block_nr = no_blocks;
+	t->tp_frame_size = frame_size;
+	t->tp_frame_nr = ( block_size / frame_size ) * no_blocks;
+	t->tp_retire_blk_tov = block_tmo;
+	t->tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+	return(t);
+}
+
+/* init_rx_ring */
+rx_ring_t *init_rx_ring
+	(	const int socket_fd, const int block_size, const int no_blocks,
+		const int frame_size, const int block_tmo	)
+{
+
+	int version = TPACKET_V3;
+	rx_ring_t *r = NULL;
+	tpacket_req3_t *p = NULL;
+
+	if ( ( block_size % getpagesize() ) != 0 )
+	{
+		log_app_msg("RX ring block size = %d is not a multiple of %d.\n"
+						, block_size, getpagesize());
+		return(NULL);
+	}
+
+	// 1) blocks layout is only available with TPACKET_V3
+	if ( setsockopt(socket_fd, SOL_PACKET, PACKET_VERSION,
+						&version, sizeof(int)) < 0 )
+	{
+		log_sys_error("Setting TPACKET_V3 for the RX ring");
+		return(NULL);
+	}
+
+	// 2) export kernel mmap()ed memory
+	p = init_tpacket_req3(block_size, no_blocks, frame_size, block_tmo);
+
+	if ( setsockopt(socket_fd, SOL_PACKET, PACKET_RX_RING,
+						p, LEN__TPACKET_REQ3) < 0 )
+	{
+		log_sys_error("Setting socket options for the RX ring");
+		free(p);
+		return(NULL);
+	}
+
+	free(p);
+
+	// 3) open ring
+	r = new_rx_ring();
+	r->socket_fd = socket_fd;
+	r->block_size = block_size;
+	r->no_blocks = no_blocks;
+	r->len = block_size * no_blocks;
+
+	if ( ( r->map = mmap(	NULL, r->len, PROT_READ | PROT_WRITE,
+							MAP_SHARED | MAP_LOCKED, socket_fd, 0 ) )
+			== MAP_FAILED )
+	{
+		// MAP_LOCKED might fail because of RLIMIT_MEMLOCK, retry without it
+		if ( ( r->map = mmap(	NULL, r->len, PROT_READ | PROT_WRITE,
+								MAP_SHARED, socket_fd, 0 ) )
+				== MAP_FAILED )
+		{
+			log_sys_error("mmap()ing RX ring");
+			free(r);
+			return(NULL);
+		}
+	}
+
+	return(r);
+
+}
+
+/* set_rx_ring_size */
+int set_rx_ring_size(const int block_size, const int no_blocks)
+{
+
+	if ( ( block_size < RX_RING_FRAME_SIZE )
+			|| ( ( block_size % getpagesize() ) != 0 ) )
+	{
+		log_app_msg("RX ring block size = %d, shall be a multiple of %d and "
+					"at least %d.\n", block_size, getpagesize()
+					, RX_RING_FRAME_SIZE);
+		return(EX_WRONG_PARAM);
+	}
+
+	if ( ( no_blocks <= 0 )
+			|| ( (uint64_t)block_size * no_blocks > RX_RING_MAX_LEN ) )
+	{
+		log_app_msg("RX ring blocks = %d, shall be > 0 and the ring not "
+					"bigger than %d MB.\n", no_blocks, RX_RING_MAX_LEN >> 20);
+		return(EX_WRONG_PARAM);
+	}
+
+	__rx_block_size = block_size;
+	__rx_no_blocks = no_blocks;
+
+	return(EX_OK);
+
+}
+
+/* get_rx_ring_block_size */
+int get_rx_ring_block_size()
+{
+	return(__rx_block_size);
+}
+
+/* get_rx_ring_no_blocks */
+int get_rx_ring_no_blocks()
+{
+	return(__rx_no_blocks);
+}
+
+/* close_rx_ring */
+int close_rx_ring(rx_ring_t *ring)
+{
+
+	if ( ring == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( munmap(ring->map, ring->len) < 0 )
+	{
+		log_sys_error("Closing RX ring buffer");
+		return(EX_ERR);
+	}
+
+	free(ring);
+	return(EX_OK);
+
+}
+
+/* rx_ring_next_frame */
+tpacket3_hdr_t *rx_ring_next_frame(rx_ring_t *ring)
+{
+
+	tpacket3_hdr_t *frame = NULL;
+	tpacket_block_desc_t *block = NULL;
+
+	for ( ;; )
+	{
+
+		// 1) frames still pending within the current block
+		if ( ring->frames_left > 0 )
+		{
+			frame = ring->next_frame;
+			ring->next_frame = (tpacket3_hdr_t *)
+				( (uint8_t *)frame + frame->tp_next_offset );
+			ring->frames_left--;
+			return(frame);
+		}
+
+		// 2) current block completely walked, it is given back to the kernel
+		if ( ring->block_in_use == true )
+		{
+			block = (tpacket_block_desc_t *)
+				( ring->map + ring->current_block * ring->block_size );
+			__atomic_store_n
+				(&block->hdr.bh1.block_status, TP_STATUS_KERNEL
+					, __ATOMIC_RELEASE);
+			ring->block_in_use = false;
+			ring->current_block = ( ring->current_block + 1 )
+										% ring->no_blocks;
+		}
+
+		// 3) check whether the kernel has already retired the next block
+		block = (tpacket_block_desc_t *)
+			( ring->map + ring->current_block * ring->block_size );
+
+		if ( ( __atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE)
+				& TP_STATUS_USER ) == 0 )
+			{ return(NULL); }
+
+		ring->block_in_use = true;
+		ring->frames_left = block->hdr.bh1.num_pkts;
+		ring->next_frame = (tpacket3_hdr_t *)
+			( (uint8_t *)block + block->hdr.bh1.offset_to_first_pkt );
+
+	}
+
+}
+
+/* new_tx_ring */
+tx_ring_t *new_tx_ring()
+{
+	tx_ring_t *buffer = NULL;
+	buffer = (tx_ring_t *)malloc(LEN__TX_RING);
+	memset(buffer, 0, LEN__TX_RING);
+	return(buffer);
+}
+
+/* init_tx_ring */
+tx_ring_t *init_tx_ring
+	(const int socket_fd, const int frame_size, const int no_frames)
+{
+
+	int version = TPACKET_V2;
+	int block_size = getpagesize();
+	struct tpacket_req p;
+	tx_ring_t *r = NULL;
+
+	if ( ( frame_size % TPACKET_ALIGNMENT ) != 0 )
+	{
+		log_app_msg("TX ring frame size = %d is not aligned to %d.\n"
+						, frame_size, TPACKET_ALIGNMENT);
+		return(NULL);
+	}
+
+	// 1) slots hold a TPACKET_V2 header followed by the frame
+	if ( setsockopt(socket_fd, SOL_PACKET, PACKET_VERSION,
+						&version, sizeof(int)) < 0 )
+	{
+		log_sys_error("Setting TPACKET_V2 for the TX ring");
+		return(NULL);
+	}
+
+	// 2) export kernel mmap()ed memory
+	while ( block_size < frame_size ) { block_size <<= 1; }
+
+	memset(&p, 0, sizeof(struct tpacket_req));
+	p.tp_frame_size = frame_size;
+	p.tp_block_size = block_size;
+	p.tp_block_nr = ( no_frames * frame_size + block_size - 1 ) / block_size;
+	p.tp_frame_nr = p.tp_block_nr * ( block_size / frame_size );
+
+	if ( setsockopt(socket_fd, SOL_PACKET, PACKET_TX_RING,
+						&p, sizeof(struct tpacket_req)) < 0 )
+	{
+		log_sys_error("Setting socket options for the TX ring");
+		return(NULL);
+	}
+
+	// 3) open ring
+	r = new_tx_ring();
+	r->socket_fd = socket_fd;
+	r->frame_size = frame_size;
+	r->no_frames = p.tp_frame_nr;
+	r->len = p.tp_block_size * p.tp_block_nr;
+
+	if ( ( r->map = mmap(	NULL, r->len, PROT_READ | PROT_WRITE,
+							MAP_SHARED, socket_fd, 0 ) )
+			== MAP_FAILED )
+	{
+		log_sys_error("mmap()ing TX ring");
+		free(r);
+		return(NULL);
+	}
+
+	return(r);
+
+}
+
+/* close_tx_ring */
+int close_tx_ring(tx_ring_t *ring)
+{
+
+	if ( ring == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( munmap(ring->map, ring->len) < 0 )
+	{
+		log_sys_error("Closing TX ring buffer");
+		return(EX_ERR);
+	}
+
+	free(ring);
+	return(EX_OK);
+
+}
+
+/* tx_ring_slot */
+static tpacket2_hdr_t *tx_ring_slot(const tx_ring_t *ring, const int index)
+{
+	return((tpacket2_hdr_t *)( ring->map + index * ring->frame_size ));
+}
+
+/* tx_ring_get_slot */
+void *tx_ring_get_slot(tx_ring_t *ring, int *max_len)
+{
+
+	if ( ring->queued == ring->no_frames )
+	{
+		if ( tx_ring_reclaim(ring) == 0 )
+			{ return(NULL); }
+	}
+
+	if ( max_len != NULL )
+		{ *max_len = ring->frame_size - TX_RING_DATA_OFFSET; }
+
+	return((uint8_t *)tx_ring_slot(ring, ring->head) + TX_RING_DATA_OFFSET);
+
+}
+
+/* tx_ring_commit */
+int tx_ring_commit(tx_ring_t *ring, const int len)
+{
+
+	tpacket2_hdr_t *slot = tx_ring_slot(ring, ring->head);
+
+	if ( ring->queued == ring->no_frames )
+		{ return(EX_ERR); }
+	if ( ( len <= 0 )
+			|| ( len > ( ring->frame_size - (int)TX_RING_DATA_OFFSET ) ) )
+		{ return(EX_WRONG_PARAM); }
+
+	slot->tp_len = len;
+	__atomic_store_n(&slot->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+	ring->head = ( ring->head + 1 ) % ring->no_frames;
+	ring->queued++;
+	ring->pending++;
+
+	return(EX_OK);
+
+}
+
+/* tx_ring_flush */
+int tx_ring_flush(tx_ring_t *ring)
+{
+
+	int flushed = ring->pending;
+
+	if ( flushed == 0 )
+		{ return(0); }
+
+	if ( send(ring->socket_fd, NULL, 0, MSG_DONTWAIT) < 0 )
+	{
+		// EAGAIN/ENOBUFS: slots remain marked, next flush will retry
+		if ( ( errno != EAGAIN ) && ( errno != ENOBUFS ) )
+		{
+			log_sys_error("Could not flush TX ring");
+			return(EX_SYS);
+		}
+		return(0);
+	}
+
+	ring->pending = 0;
+	return(flushed);
+
+}
+
+/* tx_ring_reclaim */
+int tx_ring_reclaim(tx_ring_t *ring)
+{
+
+	int reclaimed = 0;
+	tpacket2_hdr_t *slot = NULL;
+
+	while ( ring->queued > ring->pending )
+	{
+
+		slot = tx_ring_slot(ring, ring->tail);
+
+		switch ( __atomic_load_n(&slot->tp_status, __ATOMIC_ACQUIRE) )
+		{
+			case TP_STATUS_AVAILABLE:
+
+				ring->sent++;
+				break;
+
+			case TP_STATUS_WRONG_FORMAT:
+
+				log_app_msg("TX ring slot %d rejected by the kernel.\n"
+								, ring->tail);
+				ring->wrong_format++;
+				__atomic_store_n
+					(&slot->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELEASE);
+				break;
+
+			default:
+
+				// TP_STATUS_SEND_REQUEST or TP_STATUS_SENDING
+				return(reclaimed);
+
+		}
+
+		ring->tail = ( ring->tail + 1 ) % ring->no_frames;
+		ring->queued--;
+		reclaimed++;
+
+	}
+
+	return(reclaimed);
+
+}
+
+/* tx_ring_is_blocked */
+bool tx_ring_is_blocked(tx_ring_t *ring)
+{
+
+	if ( ring->pending > 0 )
+		{ return(true); }
+
+	if ( ring->queued == ring->no_frames )
+		{ tx_ring_reclaim(ring); }
+
+	return( ring->queued == ring->no_frames );
+
+}
+
+/* rx_ring_used_blocks */
+int rx_ring_used_blocks(const rx_ring_t *ring)
+{
+
+	int used = 0;
+	tpacket_block_desc_t *block = NULL;
+
+	for ( int i = 0; i < ring->no_blocks; i++ )
+	{
+		block = (tpacket_block_desc_t *)( ring->map + i * ring->block_size );
+		if ( __atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE)
+				& TP_STATUS_USER )
+			{ used++; }
+	}
+
+	return(used);
+
+}
+
+/* tx_ring_used_slots */
+int tx_ring_used_slots(const tx_ring_t *ring)
+{
+	return(ring->queued);
+}
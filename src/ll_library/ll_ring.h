@@ -0,0 +1,288 @@
+/*
+ * @file ll_ring.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for managing the kernel mmap()ed rings
+ * of an AF_PACKET socket. The RX ring follows the TPACKET_V3 block-based
+ * layout: the kernel fills whole blocks of frames and hands them over to
+ * userspace, which walks them in place and gives them back once they have
+ * been completely processed. The TX ring follows the TPACKET_V2 layout:
+ * frames are built directly within the slots of the ring, marked as ready
+ * and flushed to the kernel in batches with a single send() call.
+ */
+
+#ifndef LL_RING_H_
+#define LL_RING_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/if_packet.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+
+/**************************************************************** DATA TYPES */
+
+#define RX_RING_BLOCK_SIZE		( 1 << 19 )	/*!< Default block size (512 kB). */
+#define RX_RING_NO_BLOCKS		8			/*!< Default number of blocks. */
+#define RX_RING_MAX_LEN			( 1 << 30 )	/*!< Max. size of a ring (1 GB). */
+#define RX_RING_FRAME_SIZE		( 1 << 11 )	/*!< Max size of a frame (B). */
+#define RX_RING_BLOCK_TMO		64			/*!< Block retire timeout (ms). */
+
+#define TX_RING_FRAME_SIZE		( 1 << 12 )	/*!< Size of each TX slot (B). */
+#define TX_RING_NO_FRAMES		1024		/*!< Number of TX slots. */
+#define TX_RING_BATCH			64			/*!< Frames per send() kick. */
+
+typedef struct tpacket_req3 tpacket_req3_t;		/*!< Type for tpacket_req3. */
+#define LEN__TPACKET_REQ3 sizeof(tpacket_req3_t)	/*!< Length of tpacket_req3. */
+
+typedef struct tpacket_block_desc tpacket_block_desc_t;	/*!< Block header. */
+typedef struct tpacket3_hdr tpacket3_hdr_t;				/*!< Frame header. */
+typedef struct tpacket2_hdr tpacket2_hdr_t;				/*!< TX slot header. */
+
+/*!< Offset of the frame data within a TX slot. */
+#define TX_RING_DATA_OFFSET	( TPACKET2_HDRLEN - sizeof(struct sockaddr_ll) )
+
+/*!
+ * \struct rx_ring
+ * \brief Structure for walking a TPACKET_V3 RX ring. The frame being
+ * 			processed lives within a block that belongs to userspace, the
+ * 			block is only given back to the kernel once all of its frames
+ * 			have been handed over to the upper layers.
+ */
+typedef struct rx_ring
+{
+
+	int socket_fd;					/*!< FD of the socket owning the ring. */
+
+	uint8_t *map;					/*!< Kernel mmap()ed memory. */
+	int len;						/*!< Length of the mmap()ed memory (B). */
+
+	int block_size;					/*!< Size of each of the blocks (B). */
+	int no_blocks;					/*!< Number of blocks of the ring. */
+
+	int current_block;				/*!< Block currently being walked. */
+	bool block_in_use;				/*!< Flag, current block owned by us. */
+	int frames_left;				/*!< Frames not yet walked in block. */
+	tpacket3_hdr_t *next_frame;		/*!< Next frame to be walked. */
+
+} rx_ring_t;
+
+#define LEN__RX_RING sizeof(rx_ring_t)
+
+/*!
+ * \struct tx_ring
+ * \brief Structure for managing a TPACKET_V2 TX ring. Slots are filled in
+ * 			order at the head of the ring and reclaimed in order at its tail
+ * 			once the kernel has reported their completion.
+ */
+typedef struct tx_ring
+{
+
+	int socket_fd;					/*!< FD of the socket owning the ring. */
+
+	uint8_t *map;					/*!< Kernel mmap()ed memory. */
+	int len;						/*!< Length of the mmap()ed memory (B). */
+
+	int frame_size;					/*!< Size of each of the slots (B). */
+	int no_frames;					/*!< Number of slots of the ring. */
+
+	int head;						/*!< Next slot to be filled. */
+	int tail;						/*!< Oldest slot owned by the kernel. */
+	int queued;						/*!< Slots owned by the kernel. */
+	int pending;					/*!< Slots ready but not yet flushed. */
+
+	uint64_t sent;					/*!< Frames sent by the kernel. */
+	uint64_t wrong_format;			/*!< Frames rejected by the kernel. */
+
+} tx_ring_t;
+
+#define LEN__TX_RING sizeof(tx_ring_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a rx_ring structure.
+ * \return A pointer to the newly allocated block of memory.
+ */
+rx_ring_t *new_rx_ring();
+
+/*!
+ * \brief Initializes a tpacket_req3 structure for requesting a TPACKET_V3
+ * 			ring to the kernel.
+ * \param block_size Size of each of the blocks (B), multiple of the page size.
+ * \param no_blocks Number of blocks to be used for this ring.
+ * \param frame_size Maximum size of a single frame (B).
+ * \param block_tmo Timeout (ms) after which a non-full block is retired.
+ * \return The initialized tpacket_req3 structure.
+ */
+tpacket_req3_t *init_tpacket_req3
+	(	const int block_size, const int no_blocks,
+		const int frame_size, const int block_tmo	);
+
+/*!
+ * \brief Switches the given socket to TPACKET_V3 and mmap()s its RX ring.
+ * \param socket_fd FD of the socket whose RX ring is to be initialized.
+ * \param block_size Size of each of the blocks (B), multiple of the page size.
+ * \param no_blocks Number of blocks to be used for this ring.
+ * \param frame_size Maximum size of a single frame (B).
+ * \param block_tmo Timeout (ms) after which a non-full block is retired.
+ * \return The initialized ring, NULL in case of error.
+ */
+rx_ring_t *init_rx_ring
+	(	const int socket_fd, const int block_size, const int no_blocks,
+		const int frame_size, const int block_tmo	);
+
+/*!
+ * \brief Sets the size of the RX rings initialized from now on by the
+ * 			sockets, by default RX_RING_NO_BLOCKS of RX_RING_BLOCK_SIZE. The
+ * 			rings are locked in memory whenever possible, once per socket.
+ * \param block_size Size of each of the blocks (B), multiple of the page size.
+ * \param no_blocks Number of blocks of each ring.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int set_rx_ring_size(const int block_size, const int no_blocks);
+
+/*!
+ * \brief Gets the size of the blocks of the RX rings of the sockets.
+ * \return Size of each of the blocks (B).
+ */
+int get_rx_ring_block_size();
+
+/*!
+ * \brief Gets the number of blocks of the RX rings of the sockets.
+ * \return Number of blocks of each ring.
+ */
+int get_rx_ring_no_blocks();
+
+/*!
+ * \brief Releases the memory mmap()ed for the given RX ring.
+ * \param ring The ring to be closed.
+ * \return EX_OK if the ring could be closed correctly, <0 otherwise.
+ */
+int close_rx_ring(rx_ring_t *ring);
+
+/*!
+ * \brief Gets the next frame available within the RX ring. The frame is not
+ * 			copied, it remains valid until the next call to this function.
+ * 			Blocks whose frames have all been walked are given back to the
+ * 			kernel before moving to the following one.
+ * \param ring The ring to be walked.
+ * \return The header of the next frame, NULL if no more frames are ready.
+ */
+tpacket3_hdr_t *rx_ring_next_frame(rx_ring_t *ring);
+
+/*!
+ * \brief Gets the first byte of the link layer header of the given frame.
+ * \param frame Header of the frame within the ring.
+ * \return A pointer to the frame contents, in place.
+ */
+static inline void *rx_ring_frame_data(const tpacket3_hdr_t *frame)
+	{ return((uint8_t *)frame + frame->tp_mac); }
+
+/*!
+ * \brief Allocates memory for a tx_ring structure.
+ * \return A pointer to the newly allocated block of memory.
+ */
+tx_ring_t *new_tx_ring();
+
+/*!
+ * \brief Switches the given socket to TPACKET_V2 and mmap()s its TX ring.
+ * \param socket_fd FD of the socket whose TX ring is to be initialized.
+ * \param frame_size Size of each of the slots (B).
+ * \param no_frames Number of slots of the ring.
+ * \return The initialized ring, NULL in case of error.
+ */
+tx_ring_t *init_tx_ring
+	(const int socket_fd, const int frame_size, const int no_frames);
+
+/*!
+ * \brief Releases the memory mmap()ed for the given TX ring.
+ * \param ring The ring to be closed.
+ * \return EX_OK if the ring could be closed correctly, <0 otherwise.
+ */
+int close_tx_ring(tx_ring_t *ring);
+
+/*!
+ * \brief Gets the data area of the slot at the head of the ring, where the
+ * 			next frame is to be built.
+ * \param ring The ring whose next slot is requested.
+ * \param max_len Set to the maximum length of the frame within the slot.
+ * \return A pointer to the data area of the slot, NULL if the ring is full.
+ */
+void *tx_ring_get_slot(tx_ring_t *ring, int *max_len);
+
+/*!
+ * \brief Marks the slot at the head of the ring as ready to be sent.
+ * \param ring The ring whose slot is to be marked.
+ * \param len Length of the frame built within the slot.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int tx_ring_commit(tx_ring_t *ring, const int len);
+
+/*!
+ * \brief Requests the kernel to send all the slots marked as ready.
+ * \param ring The ring whose slots are to be sent.
+ * \return Number of frames flushed (>=0), <0 in case of error.
+ */
+int tx_ring_flush(tx_ring_t *ring);
+
+/*!
+ * \brief Gives back to userspace the slots whose frames were already sent or
+ * 			rejected by the kernel, so that they can be reused.
+ * \param ring The ring whose slots are to be reclaimed.
+ * \return Number of slots reclaimed.
+ */
+int tx_ring_reclaim(tx_ring_t *ring);
+
+/*!
+ * \brief Checks whether the kernel is pushing back: the last flush could not
+ * 			be completed or no slot is free, even after reclaiming them.
+ * \param ring The ring to be checked.
+ * \return true if no more frames should be offered for now.
+ */
+bool tx_ring_is_blocked(tx_ring_t *ring);
+
+/*!
+ * \brief Counts the blocks of the RX ring retired by the kernel and not yet
+ * 			given back to it, the headers of the blocks are only read.
+ * \param ring The ring to be checked.
+ * \return Number of blocks owned by userspace.
+ */
+int rx_ring_used_blocks(const rx_ring_t *ring);
+
+/*!
+ * \brief Counts the slots of the TX ring that cannot be filled yet, either
+ * 			waiting for a flush or owned by the kernel.
+ * \param ring The ring to be checked.
+ * \return Number of slots in use.
+ */
+int tx_ring_used_slots(const tx_ring_t *ring);
+
+#endif /* LL_RING_H_ */
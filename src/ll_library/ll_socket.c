@@ -31,6 +31,7 @@ ifreq_t* new_ifreq()
 {
 	ifreq_t* buffer = NULL;
 	buffer = (ifreq_t *)malloc(LEN__IFREQ);
+	memset(buffer, 0, LEN__IFREQ);
 	return(buffer);
 }
 
@@ -70,6 +71,18 @@ ev_io_arg_t *new_ev_io_arg()
 	return(buffer);
 }
 
+/* __rx_arg */
+static inline ev_io_arg_t *__rx_arg(const ll_socket_t *ll_socket)
+{
+	// watchers hold their own copy of the callbacks and arguments of the
+	// socket, taken by init_ev_io_arg, so later changes are written there
+	return((ev_io_arg_t *)ll_socket->rx_watcher);
+}
+
+/* __tx_arg */
+static inline ev_io_arg_t *__tx_arg(const ll_socket_t *ll_socket)
+	{ return((ev_io_arg_t *)ll_socket->tx_watcher); }
+
 /* new_mac_buffer */
 unsigned char *new_mac_buffer()
 {
@@ -88,37 +101,29 @@ ev_io_arg_t *init_ev_io_arg(ll_socket_t *ll_socket)
 	a->cb_frame_tx = ll_socket->cb_frame_tx;
 
 	a->public_arg.ll_sap = ll_socket->ll_sap;
-	a->public_arg.tx_delay = ll_socket->tx_delay;
 
 	memcpy(a->public_arg.if_mac, ll_socket->if_mac, ETH_ALEN);
+	a->public_arg.pool = ll_socket->pool;
+	a->public_arg.tx_template = ll_socket->tx_template;
+	a->public_arg.capture = ll_socket->capture;
+	a->public_arg.probe = ll_socket->probe;
+	a->public_arg.stats = ll_socket->stats;
+	a->public_arg.tx_queue = ll_socket->tx_queue;
+	a->backend = ll_socket->backend;
 
 	#ifdef KERNEL_RING
-		a->public_arg.rx_ring = ll_socket->rx_ring_buffer;
+		a->public_arg.rx_ring = ll_socket->rx_ring;
+		a->public_arg.tx_ring = ll_socket->tx_ring;
 	#else
 		a->public_arg.buffer = ll_socket->buffer;
 	#endif
 a->public_arg.if_index=ll_socket->if_index;
+	a->public_arg.if_hatype = ll_socket->if_hatype;
 
 
 	return(a);
 }
 
-#ifdef KERNEL_RING
-
-/* init_tpacket_req */
-tpacket_req_t *init_tpacket_req
-					(const int frames_per_block, const int no_blocks)
-{
-	tpacket_req_t *t = new_tpacket_req();
-  	t->tp_block_size = frames_per_block * getpagesize();
-  	t->tp_block_nr = no_blocks;
-  	t->tp_frame_size = getpagesize();
-  	t->tp_frame_nr = frames_per_block * no_blocks;
-  	return(t); 	
-}
-
-#endif
-
 /* init_sockaddr_ll */
 sockaddr_ll_t *init_sockaddr_ll(const ll_socket_t* ll_socket, bool is_transmitter)
 {
@@ -140,7 +145,7 @@ sockaddr_ll_t *init_sockaddr_ll(const ll_socket_t* ll_socket, bool is_transmitte
 /* if_name_2_if_index */
 int if_name_2_if_index(const int socket_fd, const char *if_name)
 {
-	printf("ini5\n");
+
 	int len_if_name = -1;
 
 	if ( if_name == NULL )
@@ -163,11 +168,32 @@ int if_name_2_if_index(const int socket_fd, const char *if_name)
 
 }
 
+/* __get_if_hwaddr */
+static int __get_if_hwaddr
+	(const int socket_fd, const char *if_name, struct sockaddr *hwaddr)
+{
+
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(struct ifreq));
+	strncpy(ifr.ifr_name, if_name, IF_NAMESIZE - 1);
+
+	if ( ioctl(socket_fd, SIOCGIFHWADDR, &ifr) < 0 )
+	{
+		log_sys_error("Could not get hardware address");
+		return(EX_SYS);
+	}
+
+	*hwaddr = ifr.ifr_hwaddr;
+	return(EX_OK);
+
+}
+
 /* get_mac_address */
 int get_mac_address
 	(const int socket_fd, const char *if_name, unsigned char *mac)
 {
-	printf("ini6\n");
+
 	int len_if_name = -1;
 
 	if ( if_name == NULL )
@@ -185,21 +211,33 @@ int get_mac_address
 	if ( len_if_name > IF_NAMESIZE )
 		{ return(EX_WRONG_PARAM); }
 
-	ifreq_t *ifr = new_ifreq();
-	strncpy(ifr->ifr_name, if_name, len_if_name);
+	struct sockaddr hwaddr;
 
-	if ( ioctl(socket_fd, SIOCGIFHWADDR, ifr) < 0 )
-	{
-		log_sys_error("Could not get interface index");
-		return(EX_SYS);
-	}
+	if ( __get_if_hwaddr(socket_fd, if_name, &hwaddr) < 0 )
+		{ return(EX_SYS); }
 
-	memcpy(mac, ifr->ifr_hwaddr.sa_data, ETH_ALEN);
+	memcpy(mac, hwaddr.sa_data, ETH_ALEN);
 
 	return(EX_OK);
 
 }
 
+/* get_if_hatype */
+int get_if_hatype(const int socket_fd, const char *if_name)
+{
+
+	struct sockaddr hwaddr;
+
+	if ( if_name == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( __get_if_hwaddr(socket_fd, if_name, &hwaddr) < 0 )
+		{ return(EX_SYS); }
+
+	return(hwaddr.sa_family);
+
+}
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 // LL_SOCKET MANAGEMENT
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
@@ -217,7 +255,17 @@ ll_socket_t *new_ll_socket()
 ll_socket_t *init_ll_socket
 	(	const bool is_transmitter, const int tx_delay,
 		const char *ll_if_name, const int ll_sap,
-		const int frame_type	)
+		const int frame_type, struct ev_loop *loop	)
+{
+	return(init_ll_socket_backend(	NULL, is_transmitter, tx_delay,
+									ll_if_name, ll_sap, frame_type, loop	));
+}
+
+/* __init_ll_socket */
+static ll_socket_t *__init_ll_socket
+	(	ll_backend_t *backend, const bool is_transmitter, const int tx_delay,
+		const char *ll_if_name, const int ll_sap,
+		const int frame_type, struct ev_loop *loop, const bool has_tx_ring	)
 {
 
 	#ifdef KERNEL_RING
@@ -229,15 +277,20 @@ ll_socket_t *init_ll_socket
 	ll_socket_t *s = new_ll_socket();
 	
 	s->state = LL_SOCKET_STATE_UNDEF;
+	s->backend = backend;
 
-	// 1) create RAW socket(s)	
+	// 1) create RAW socket(s), or take the one of the backend
 	#ifdef KERNEL_RING
+		if ( is_ll_backend_virtual(backend) == true )
+			{ handle_app_error("Kernel rings need an AF_PACKET backend.\n"); }
 		if ( ( tx_socket_fd = socket(AF_PACKET, SOCK_RAW, ll_sap) ) < 0 )
 			{ handle_sys_error("Could not open TX socket"); }
 		if ( ( rx_socket_fd = socket(AF_PACKET, SOCK_RAW, ll_sap) ) < 0 )
 			{ handle_sys_error("Could not open RX socket"); }
 	#else
-		if ( ( socket_fd = socket(AF_PACKET, SOCK_RAW, ll_sap) ) < 0 )
+		if ( is_ll_backend_virtual(backend) == true )
+			{ socket_fd = backend->fd; }
+		else if ( ( socket_fd = socket(AF_PACKET, SOCK_RAW, ll_sap) ) < 0 )
 			{ handle_sys_error("Could not open socket"); }
 	#endif
 /*
@@ -255,12 +308,24 @@ ll_socket_t *init_ll_socket
 		s->rx_socket_fd = rx_socket_fd;
 	#else
 		s->socket_fd = socket_fd;
-		s->buffer = new_ll_framebuffer();
+	#endif
+
+	if ( ( s->stats = new_ll_stats() ) == NULL )
+		{ handle_app_error("Could not create counters.\n"); }
+
+	if ( ( s->pool = init_ll_frame_pool(FRAMEBUFFER_LEN, FRAME_POOL_LEN) )
+			== NULL )
+		{ handle_app_error("Could not create frame pool.\n"); }
+
+	#ifndef KERNEL_RING
+		if ( ( s->buffer = new_ll_framebuffer(s->pool) ) == NULL )
+			{ handle_app_error("Could not get frame buffer.\n"); }
 	#endif
 
 	s->ll_sap = ll_sap;
 	s->frame_type = frame_type;
 	s->tx_delay = tx_delay;
+	s->loop = loop;
 
 	#ifdef KERNEL_RING
 		log_app_msg("Socket created, TX_FD = %d, RX_FD = %d, ll_sap = %d\n",
@@ -275,7 +340,10 @@ ll_socket_t *init_ll_socket
 		int socket_fd = tx_socket_fd;
 	#endif
 	//if ( ( ll_if_index = if_name_2_if_index(socket_fd, ll_if_name) ) < 0 ) //cambio
-		if ((ll_if_index=if_nametoindex(ll_if_name))<0)
+	// virtual backends have no interface, only a name for the logs
+	if ( is_ll_backend_virtual(backend) == true )
+		{ ll_if_index = BACKEND_IF_INDEX; }
+	else if ((ll_if_index=if_nametoindex(ll_if_name))<0)
 		{ handle_app_error("Could not get index, if_name = %s\n", ll_if_name); }
 	//
 	strncpy(s->if_name, ll_if_name, strlen(ll_if_name));
@@ -286,22 +354,63 @@ ll_socket_t *init_ll_socket
 	
 	// 4) get interface MAC address from interface name
 	//if (is_transmitter){
-	if ( get_mac_address
+	if ( is_ll_backend_virtual(backend) == true )
+		{ memcpy(s->if_mac, backend->mac, ETH_ALEN); }
+	else if ( get_mac_address
 			(socket_fd, ll_if_name, (unsigned char *)s->if_mac) < 0 )
 	{
 		handle_app_error(	"Could not get MAC address, if_name = %s\n"
 							, ll_if_name	);
 	}//}
 
+	// monitor interfaces prepend a radiotap header to the 802.11 frames
+	if ( is_ll_backend_virtual(backend) == true )
+	{
+		s->if_hatype = ( frame_type == TYPE_IEEE_80211 ) ? ARPHRD_IEEE80211
+														: ARPHRD_ETHER;
+	}
+	else if ( ( s->if_hatype = get_if_hatype(socket_fd, ll_if_name) ) < 0 )
+	{
+		handle_app_error(	"Could not get hardware type, if_name = %s\n"
+							, ll_if_name	);
+	}
+
 	log_app_msg("IF: name = %s, index = %d, MAC = ", ll_if_name, ll_if_index);
 		print_eth_address((unsigned char *)s->if_mac);
 		log_app_msg("\n");
 
-	// 5) initialize events
+	// 5) timestamps from the kernel or the NIC, before the RX ring is mapped
+	#ifdef KERNEL_RING
+		s->ts_source = enable_ring_timestamping(rx_socket_fd, ll_if_name);
+	#else
+		if ( is_ll_backend_virtual(backend) == true )
+			{ s->ts_source = TS_SOURCE_CLOCK; }
+		else
+		{
+			s->ts_source = enable_ll_timestamping
+							(socket_fd, ll_if_name, is_transmitter);
+		}
+	#endif
+	if ( s->ts_source < 0 )
+	{
+		log_warning_msg("No kernel timestamps, using %s clock.\n"
+						, get_ts_source_name(TS_SOURCE_CLOCK));
+		s->ts_source = TS_SOURCE_CLOCK;
+	}
+	log_app_msg("Timestamps source = %s\n", get_ts_source_name(s->ts_source));
+
+	#ifdef KERNEL_RING
+
+	// 6) initialize rings for frames tx+rx, before events get a hold of them
+	if ( init_rings(s, has_tx_ring) < 0 )
+		{ handle_app_error("Could not initialize TX/RX rings.\n"); }
+	log_app_msg("IO rings iniatialized.\n");
+
+	#endif
+
+	// 7) initialize events
 	if ( init_events(is_transmitter, s) < 0 )
 		{ handle_app_error("Could not initialize event manager!"); }
-printf("volvo de init_events\n");
-print_eth_address(s->if_mac);
 	// Ready is socket's final state
 	s->state = LL_SOCKET_STATE_READY;
 
@@ -309,28 +418,52 @@ print_eth_address(s->if_mac);
 	
 }
 
+/* init_ll_socket_backend */
+ll_socket_t *init_ll_socket_backend
+	(	ll_backend_t *backend, const bool is_transmitter, const int tx_delay,
+		const char *ll_if_name, const int ll_sap,
+		const int frame_type, struct ev_loop *loop	)
+{
+	return(__init_ll_socket(	backend, is_transmitter, tx_delay,
+								ll_if_name, ll_sap, frame_type, loop, true	));
+}
+
+/* init_rx_worker_ll_socket */
+ll_socket_t *init_rx_worker_ll_socket
+	(	const char *ll_if_name, const int ll_sap,
+		const int frame_type, struct ev_loop *loop	)
+{
+	return(__init_ll_socket(	NULL, false, 0,
+								ll_if_name, ll_sap, frame_type, loop, false	));
+}
+
 /* open_ll_socket */
 ll_socket_t *open_ll_socket
 	(	const bool is_transmitter, const int tx_delay,
 		const char* ll_if_name, const int ll_sap,
 		const int frame_type	)
 {
+	return(open_ll_socket_backend(	NULL, is_transmitter, tx_delay,
+									ll_if_name, ll_sap, frame_type	));
+}
+
+/* open_ll_socket_backend */
+ll_socket_t *open_ll_socket_backend
+	(	ll_backend_t *backend, const bool is_transmitter, const int tx_delay,
+		const char* ll_if_name, const int ll_sap,
+		const int frame_type	)
+{
 
 	// 1) create RAW socket
-	ll_socket_t *ll_socket = init_ll_socket
-			(is_transmitter, tx_delay, ll_if_name, ll_sap, frame_type);
-printf("volvo de init_ll_socket\n");
+	ll_socket_t *ll_socket = init_ll_socket_backend
+			(	backend, is_transmitter, tx_delay, ll_if_name, ll_sap,
+				frame_type, EV_DEFAULT	);
 //print_eth_address(ll_socket->if_mac);
-	#ifdef KERNEL_RING
 
-	// 2) initialize rings for frames tx+rx
-	if ( init_rings(ll_socket) < 0 )
-		{ handle_app_error("Could not initialize TX/RX rings.\n"); }
-	log_app_msg("IO rings iniatialized.\n");
+	// 2) bind RAW socket, the ends of the virtual backends are connected
 
-	#endif
-	
-	// 3) bind RAW socket	
+	if ( is_ll_backend_virtual(backend) == true )
+		{ return(ll_socket); }
 
 	if ( bind_ll_socket(ll_socket,is_transmitter) < 0 )
 		{ handle_sys_error("Could not bind socket"); }
@@ -377,6 +510,15 @@ int close_ll_socket(const ll_socket_t *ll_socket)
 {
 
 	int result = EX_OK;
+	ll_stats_t totals;
+
+	// the drops of the kernel go away together with the socket
+	if ( ll_socket->reporter != NULL )
+	{
+		get_ll_socket_stats((ll_socket_t *)ll_socket, &totals);
+		print_ll_stats(&totals, ll_socket->reporter->name, 0);
+		close_ll_stats_reporter(ll_socket->reporter);
+	}
 
 	#ifdef KERNEL_RING
 		if ( close_rings(ll_socket) < 0 )
@@ -411,6 +553,59 @@ int close_ll_socket(const ll_socket_t *ll_socket)
 		result = EX_ERR;
 	}
 
+	free(ll_socket->tx_template);
+
+	if ( ll_socket->pacer != NULL )
+		{ close_ll_pacer(ll_socket->pacer); }
+
+	if ( ll_socket->tx_queue != NULL )
+		{ close_ll_tx_queue(ll_socket->tx_queue); }
+
+	if ( ll_socket->filter != NULL )
+	{
+		free(ll_socket->filter->filter);
+		free(ll_socket->filter);
+	}
+
+	if ( ( ll_socket->capture != NULL )
+			&& ( close_ll_capture(ll_socket->capture) < 0 ) )
+	{
+		log_app_msg("Error closing capture.\n");
+		result = EX_ERR;
+	}
+
+	if ( ( ll_socket->replay != NULL )
+			&& ( close_ll_replay(ll_socket->replay) < 0 ) )
+	{
+		log_app_msg("Error closing replay.\n");
+		result = EX_ERR;
+	}
+
+	if ( ( ll_socket->probe != NULL )
+			&& ( close_ll_probe(ll_socket->probe) < 0 ) )
+	{
+		log_app_msg("Error closing probes.\n");
+		result = EX_ERR;
+	}
+
+	// after the socket, so that the thread of the backend sees it closed
+	if ( ( ll_socket->backend != NULL )
+			&& ( close_ll_backend(ll_socket->backend) < 0 ) )
+	{
+		log_app_msg("Error closing backend.\n");
+		result = EX_ERR;
+	}
+
+	if ( close_ll_frame_pool(ll_socket->pool) < 0 )
+	{
+		log_app_msg("Error closing frame pool.\n");
+		result = EX_ERR;
+	}
+
+	free(ll_socket->stats);
+	free(ll_socket->rx_latency);
+	free(ll_socket->tx_latency);
+
 	return(result);
 
 }
@@ -421,7 +616,7 @@ int set_sockaddr_ll(ll_socket_t *ll_socket, bool is_transmitter)
 bool is_true=1;
 	#ifdef KERNEL_RING
 		ll_socket->tx_ring_addr = init_sockaddr_ll(ll_socket,is_true);
-		ll_socket->rx_ring_addr = init_sockaddr_ll(ll_socket,not(is_true));
+		ll_socket->rx_ring_addr = init_sockaddr_ll(ll_socket,!is_true);
 	#else
 		ll_socket->addr = init_sockaddr_ll(ll_socket,is_transmitter);
 	#endif
@@ -462,26 +657,28 @@ int set_promiscuous_ll_socket(const ll_socket_t *ll_socket)
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
 /* init_rings */
-int init_rings(ll_socket_t *ll_socket)
+int init_rings(ll_socket_t *ll_socket, const bool has_tx_ring)
 {
   	
 	// 1) initialize rx ring
-	if ( ( ll_socket->rx_ring_len
-			= init_ring(	ll_socket->rx_socket_fd, PACKET_RX_RING,
-							FRAMES_PER_BLOCK, NO_BLOCKS,
-							&ll_socket->rx_ring_buffer	) )
-				< 0 )
+	if ( ( ll_socket->rx_ring
+			= init_rx_ring(	ll_socket->rx_socket_fd,
+							get_rx_ring_block_size(), get_rx_ring_no_blocks(),
+							RX_RING_FRAME_SIZE, RX_RING_BLOCK_TMO	) )
+				== NULL )
 	{
   		log_app_msg("Could not set initialize RX ring.");
   		return(EX_ERR);
 	}
 	
-	// 2) initialize tx ring
-	if ( ( ll_socket->tx_ring_len
-			= init_ring(	ll_socket->tx_socket_fd, PACKET_TX_RING,
-							FRAMES_PER_BLOCK, NO_BLOCKS,
-							&ll_socket->tx_ring_buffer	) )
-				< 0 )
+	// 2) initialize tx ring, unless the socket only receives
+	if ( has_tx_ring == true )
+	{
+		ll_socket->tx_ring = init_tx_ring(	ll_socket->tx_socket_fd,
+											TX_RING_FRAME_SIZE,
+											TX_RING_NO_FRAMES	);
+	}
+	if ( ( has_tx_ring == true ) && ( ll_socket->tx_ring == NULL ) )
 	{
   		log_app_msg("Could not set initialize TX ring.");
   		return(EX_ERR);
@@ -498,59 +695,18 @@ int init_rings(ll_socket_t *ll_socket)
 
 }
 
-/* init_ring */
-int init_ring(	const int socket_fd, const int type,
-				const int frames_per_block, const int no_blocks,
-				void **ring	)
-{
-
-	int ring_access_flags = PROT_READ | PROT_WRITE;
-	tpacket_req_t *p = init_tpacket_req(frames_per_block, no_blocks);
-	int ring_len = ( p->tp_block_size ) * ( p->tp_block_nr );
-  	
-  	// 1) export kernel mmap()ed memory
-  	if ( setsockopt(socket_fd, SOL_PACKET, type, p, LEN__TPACKET_REQ) < 0 )
-	{
-		log_sys_error("Setting socket options for this ring");
-		return(EX_ERR);
-	}
-
-	#ifdef TPACKET_V2
-  		int val = TPACKET_V1;
-  		if ( setsockopt(socket_fd, SOL_PACKET, PACKET_HDRLEN,
-  							&val, sizeof(int)) < 0 )
-			{ handle_sys_error("Setting TPACKET_V1 for this ring..."); }
-	#endif
-	
-	// 2) open ring
-  	if ( ( (*ring) = mmap(	NULL, ring_len, ring_access_flags, MAP_SHARED,
-  							socket_fd, 0) ) == NULL )
-	{
-		log_sys_error("mmap()ing error");
-		return(EX_ERR);
-	}
-	
-	return(ring_len);
-	
-}
-
 /* close_rings */
 int close_rings(const ll_socket_t *ll_socket)
 {
 
 	int result = EX_OK;
 
-	if ( munmap(ll_socket->tx_ring_buffer, ll_socket->tx_ring_len) < 0 )
-	{
-		log_sys_error("Closing TX ring buffer");
-		result = EX_ERR;
-	}
+	if ( ( ll_socket->tx_ring != NULL )
+			&& ( close_tx_ring(ll_socket->tx_ring) < 0 ) )
+		{ result = EX_ERR; }
 
-	if ( munmap(ll_socket->rx_ring_buffer, ll_socket->rx_ring_len) < 0 )
-	{
-		log_sys_error("Closing RX ring buffer");
-		result = EX_ERR;
-	}
+	if ( close_rx_ring(ll_socket->rx_ring) < 0 )
+		{ result = EX_ERR; }
 	
 	return(result);
 
@@ -565,8 +721,6 @@ int close_rings(const ll_socket_t *ll_socket)
 /* init_events */
 int init_events(const bool is_transmitter, ll_socket_t *ll_socket)
 {
-	printf("ini7\n");
-
 
 	if ( init_events_cb(ll_socket) < 0 )
 	{
@@ -577,7 +731,6 @@ int init_events(const bool is_transmitter, ll_socket_t *ll_socket)
 	if ( is_transmitter == true )
 	{
 
-		printf("init_tx_events\n");
 		if ( init_tx_events(ll_socket) < 0 )
 			{ handle_app_error("Could not initialize TX events with libev!"); }
 		log_app_msg("Frame reception is disabled.\n");
@@ -586,7 +739,6 @@ int init_events(const bool is_transmitter, ll_socket_t *ll_socket)
 	else
 	{
 
-		printf("init_rx_events\n");
 		if ( init_rx_events(ll_socket) < 0 )
 			{ handle_app_error("Could not initialize RX events with libev!"); }
 		log_app_msg("Frame transmission is disabled.\n");
@@ -600,14 +752,14 @@ int init_events(const bool is_transmitter, ll_socket_t *ll_socket)
 /* init_events_cb */
 int init_events_cb(ll_socket_t *ll_socket)
 {
-	printf("ini8\n");
+
 	ev_cb_t rx_cb = NULL;
 	ev_cb_t tx_cb = NULL;
-	printf("go\n");
+
 	switch(ll_socket->frame_type)
-	{printf("mau\n");
+	{
 		case TYPE_BUFFER:
-			printf("go\n");
+
 			log_app_msg("Buffer frame type not supported yet.\n");
 			return(EX_UNSUPPORTED);
 
@@ -615,12 +767,19 @@ int init_events_cb(ll_socket_t *ll_socket)
 
 			rx_cb = (ev_cb_t)&ieee8023_frame_rx_cb;
 			tx_cb = (ev_cb_t)&ieee8023_frame_tx_cb;
+			ll_socket->tx_template = init_ieee8023_test_template
+										(	ll_socket->ll_sap,
+											(unsigned char *)ll_socket->if_mac,
+											ETH_ADDR_BROADCAST	);
 			break;
 
 		case TYPE_IEEE_80211:
-printf("go1\n");
+
 			rx_cb = (ev_cb_t)&ieee80211_frame_rx_cb;
 			tx_cb = (ev_cb_t)&ieee80211_frame_tx_cb; // punto clave
+			ll_socket->tx_template = init_ieee80211_test_template
+										(	(unsigned char *)ll_socket->if_mac,
+											ANTON	);
 
 
 			break;
@@ -651,15 +810,14 @@ printf("go1\n");
 /* init_rx_events */
 int init_rx_events(ll_socket_t *ll_socket)
 {
-	printf("ini9\n");
-	ll_socket->loop = EV_DEFAULT;
+
 	ev_io_arg_t *arg = init_ev_io_arg(ll_socket);
 	ll_socket->rx_watcher = &arg->watcher;
-	printf(">2 ll_sap = %d, h_dest = ", arg->public_arg.ll_sap);
-	//print_eth_address(ETH_ADDR_BROADCAST);
-		//	printf(", h_source = ");
-			print_eth_address(ll_socket->if_mac);
-			printf("\n");
+
+	log_app_msg(">2 ll_sap = %d, h_dest = ", arg->public_arg.ll_sap);
+		print_eth_address(ll_socket->if_mac);
+		log_app_msg("\n");
+
 #ifdef KERNEL_RING
 	ev_io_init(	ll_socket->rx_watcher, cb_process_frame_rx,
 				ll_socket->rx_socket_fd,
@@ -669,7 +827,7 @@ int init_rx_events(ll_socket_t *ll_socket)
 				ll_socket->socket_fd,
 				EV_READ	);
 #endif
-printf("ev_io_start\n");
+
 	ev_io_start(ll_socket->loop, ll_socket->rx_watcher);
 
     return(EX_OK);
@@ -682,16 +840,16 @@ int init_tx_events(ll_socket_t *ll_socket)
 
 	log_app_msg("Starting test tx in loop mode...\n");
 
-	ll_socket->loop = EV_DEFAULT;
 	ev_io_arg_t *arg = init_ev_io_arg(ll_socket);
 	ll_socket->tx_watcher = &arg->watcher;
 
-	printf(">2 ll_sap = %d, h_dest = ", arg->public_arg.ll_sap);
+	log_app_msg(">2 ll_sap = %d, h_dest = ", arg->public_arg.ll_sap);
 		print_eth_address(ETH_ADDR_BROADCAST);
-		printf(", h_source = ");
+		log_app_msg(", h_source = ");
 		print_eth_address(arg->public_arg.if_mac);
-		printf("\n");
+		log_app_msg("\n");
 
+	// the watcher is never started by itself, the send queue runs it
 #ifdef KERNEL_RING
 	ev_io_init(	ll_socket->tx_watcher, cb_process_frame_tx,
 				ll_socket->tx_socket_fd,
@@ -702,7 +860,29 @@ int init_tx_events(ll_socket_t *ll_socket)
 				EV_WRITE	);
 #endif
 
-	ev_io_start(ll_socket->loop, ll_socket->tx_watcher);
+	if ( ( ll_socket->tx_queue = init_ll_tx_queue
+										(	ll_socket->loop,
+											ll_socket->tx_watcher->fd,
+											ll_socket->tx_watcher,
+											ll_socket->stats,
+											TX_QUEUE_LEN	) ) == NULL )
+		{ return(EX_ERR); }
+	#ifdef KERNEL_RING
+		ll_socket->tx_queue->tx_ring = ll_socket->tx_ring;
+	#endif
+	arg->public_arg.tx_queue = ll_socket->tx_queue;
+
+	resume_ll_tx_queue(ll_socket->tx_queue);
+
+	// one test frame every tx_delay ms, unless another rate is set later
+	if ( ( ll_socket->pacer = init_ll_pacer
+									(	PACER_UNIT_FRAMES,
+										1000.0 / ll_socket->tx_delay,
+										PACER_MIN_BURST	) ) == NULL )
+		{ return(EX_ERR); }
+
+	start_ll_pacer(ll_socket->pacer, ll_socket->loop, ll_socket->tx_watcher);
+	arg->pacer = ll_socket->pacer;
 
 	return(EX_OK);
 
@@ -718,10 +898,59 @@ int close_events(const ll_socket_t *ll_socket)
 
 }
 
+/* __cb_clock */
+static inline uint64_t __cb_clock()
+{
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return( (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec );
+
+}
+
+#ifndef KERNEL_RING
+
+/* __read_tx_timestamps */
+static int __read_tx_timestamps(public_ev_arg_t *arg, const int socket_fd)
+{
+
+	int source = TS_SOURCE_NONE, no_ts = 0;
+	struct timespec ts;
+
+	// TX timestamps are queued in the error queue, the template keeps the
+	// one of the last frame sent
+	while ( ( source = read_tx_timestamp(socket_fd, &ts) ) > TS_SOURCE_NONE )
+	{
+		no_ts++;
+		if ( arg->tx_template == NULL )
+			{ continue; }
+		arg->tx_template->info.timestamp = ts;
+		arg->tx_template->info.ts_source = source;
+	}
+
+	return(no_ts);
+
+}
+
+/* __is_rx_frame_ready */
+static bool __is_rx_frame_ready(const int socket_fd)
+{
+
+	uint8_t byte = 0;
+
+	return( recv(	socket_fd, &byte, sizeof(byte),
+					MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT	) >= 0 );
+
+}
+
+#endif
+
 /* cb_process_frame_rx */
 void cb_process_frame_rx
 	(struct ev_loop *loop, struct ev_io *watcher, int revents)
-{printf("ini10\n");
+{
+
+	uint64_t start = 0;
 
 	if( EV_ERROR & revents )
 	{
@@ -733,15 +962,54 @@ void cb_process_frame_rx
 	public_ev_arg_t *public_arg = &arg->public_arg;
 	public_arg->socket_fd = watcher->fd;
 
+	// capture files do end, unlike interfaces
+	if ( is_ll_backend_eof(arg->backend) == true )
+	{
+		log_app_msg("No frames left in the backend.\n");
+		ev_io_stop(loop, watcher);
+		ev_break(loop, EVBREAK_ALL);
+		return;
+	}
+
+#ifndef KERNEL_RING
+	// full-duplex sockets share the fd, the error queue also wakes up rx:
+	// wakeups caused only by timestamps have no frame to be processed
+	if ( ( public_arg->tx_queue != NULL )
+			&& ( __read_tx_timestamps(public_arg, watcher->fd) > 0 )
+			&& ( __is_rx_frame_ready(watcher->fd) == false ) )
+		{ return; }
+#endif
+
+	if ( arg->latency == NULL )
+	{
+		arg->cb_frame_rx(public_arg);
+		return;
+	}
+
+	start = __cb_clock();
 	arg->cb_frame_rx(public_arg);
+	record_ll_histogram(arg->latency, __cb_clock() - start);
 
 }
 
+/* __tx_frames_sent */
+static int __tx_frames_sent(const public_ev_arg_t *arg, const int first)
+{
+#ifndef KERNEL_RING
+	if ( arg->batch != NULL )
+		{ return(arg->batch->next_frame - first); }
+#endif
+	return(1);
+}
+
 /* cb_process_frame_tx */
 void cb_process_frame_tx
 	(struct ev_loop *loop, struct ev_io *watcher, int revents)
 {
 
+	int first = 0, frames = 0;
+	uint64_t start = 0;
+
 	if( EV_ERROR & revents )
 	{
 		log_sys_error("Invalid event");
@@ -752,14 +1020,50 @@ void cb_process_frame_tx
 	public_ev_arg_t *public_arg = &arg->public_arg;
 	public_arg->socket_fd = watcher->fd;
 
-	arg->cb_frame_tx(public_arg);
+#ifndef KERNEL_RING
+	// a batch completely sent is restarted from its first frame
+	if ( ( public_arg->batch != NULL )
+			&& ( public_arg->batch->next_frame < public_arg->batch->no_frames ) )
+		{ first = public_arg->batch->next_frame; }
+#endif
+
+	if ( arg->latency == NULL )
+		{ arg->cb_frame_tx(public_arg); }
+	else
+	{
+		start = __cb_clock();
+		arg->cb_frame_tx(public_arg);
+		record_ll_histogram(arg->latency, __cb_clock() - start);
+	}
+
+#ifdef KERNEL_RING
+	if ( tx_ring_is_blocked(public_arg->tx_ring) == true )
+		{ stall_ll_tx_queue(public_arg->tx_queue); }
+#else
+	if ( public_arg->batch != NULL )
+	{
+		ll_stats_tx_batch(public_arg->stats, public_arg->batch, first);
+		// the rest of the batch is sent once the socket is writable again
+		if ( public_arg->batch->next_frame < public_arg->batch->no_frames )
+			{ stall_ll_tx_queue(public_arg->tx_queue); }
+	}
+
+	__read_tx_timestamps(public_arg, watcher->fd);
+#endif
+
+	if ( arg->pacer == NULL )
+		{ return; }
+
+	frames = __tx_frames_sent(public_arg, first);
+	consume_ll_pacer(	arg->pacer, frames,
+						frames * public_arg->tx_template->len	);
 
 }
 
 /* set_cb_frame_rx */
 int set_cb_frame_rx(ll_socket_t *ll_socket, ev_cb_t cb_frame_rx)
 {
-	printf("ini11\n");
+
 	if ( ll_socket == NULL )
 		{ return(EX_NULL_PARAM); }
 
@@ -782,6 +1086,455 @@ int set_cb_frame_tx(ll_socket_t *ll_socket, ev_cb_t cb_frame_tx)
 
 }
 
+/* set_pacer_ll_socket */
+int set_pacer_ll_socket
+	(	ll_socket_t *ll_socket, const int unit,
+		const double rate, const int burst	)
+{
+
+	ev_io_arg_t *arg = NULL;
+	ll_pacer_t *pacer = NULL;
+	double tokens = ( burst < PACER_MIN_BURST ) ? PACER_MIN_BURST : burst;
+
+	if ( ll_socket == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( ll_socket->tx_watcher == NULL )
+	{
+		log_app_msg("Frame transmission is disabled, no pacer is needed.\n");
+		return(EX_ERR);
+	}
+
+	// the burst is always given in frames, bits are those of the test frame
+	if ( unit == PACER_UNIT_BITS )
+		{ tokens *= 8.0 * ll_socket->tx_template->len; }
+
+	if ( ( pacer = init_ll_pacer(unit, rate, tokens) ) == NULL )
+		{ return(EX_WRONG_PARAM); }
+
+	// a producer paused by the old pacer would never be resumed otherwise
+	if ( ll_socket->pacer != NULL )
+		{ close_ll_pacer(ll_socket->pacer); }
+	resume_ll_tx_queue(ll_socket->tx_queue);
+
+	start_ll_pacer(pacer, ll_socket->loop, ll_socket->tx_watcher);
+	ll_socket->pacer = pacer;
+
+	arg = __tx_arg(ll_socket);
+	arg->pacer = pacer;
+
+	return(EX_OK);
+
+}
+
+/* set_capture_ll_socket */
+int set_capture_ll_socket
+	(	ll_socket_t *ll_socket, const char *path, const int format,
+		const uint64_t max_file_bytes, const int max_file_secs	)
+{
+
+	ev_io_arg_t *arg = NULL;
+	ll_capture_t *capture = NULL;
+	int linktype = -1;
+
+	if ( ( ll_socket == NULL ) || ( path == NULL ) )
+		{ return(EX_NULL_PARAM); }
+
+	if ( ll_socket->rx_watcher == NULL )
+	{
+		log_app_msg("Frame reception is disabled, no capture is needed.\n");
+		return(EX_ERR);
+	}
+
+	// virtual backends get the hardware type of their frame type
+	linktype = get_capture_linktype(ll_socket->if_hatype);
+
+	if ( ( capture = init_ll_capture(	path, format, linktype,
+										max_file_bytes, max_file_secs	) )
+			== NULL )
+		{ return(EX_ERR); }
+
+	// the rx callback runs within the thread of the loop as well, so the
+	// old capture can be closed right away
+	arg = __rx_arg(ll_socket);
+	arg->public_arg.capture = capture;
+
+	if ( ll_socket->capture != NULL )
+		{ close_ll_capture(ll_socket->capture); }
+	ll_socket->capture = capture;
+
+	start_ll_capture_flush(capture, ll_socket->loop);
+
+	return(EX_OK);
+
+}
+
+/* set_replay_ll_socket */
+int set_replay_ll_socket
+	(	ll_socket_t *ll_socket, const char *path,
+		const double speed, const int batch	)
+{
+
+	ev_io_arg_t *arg = NULL;
+	ll_replay_t *replay = NULL;
+
+	if ( ( ll_socket == NULL ) || ( path == NULL ) )
+		{ return(EX_NULL_PARAM); }
+
+	if ( ll_socket->tx_watcher == NULL )
+	{
+		log_app_msg("Frame transmission is disabled, nothing to replay.\n");
+		return(EX_ERR);
+	}
+
+	if ( ( replay = init_ll_replay(path, speed, batch, ll_socket->if_index) )
+			== NULL )
+		{ return(EX_ERR); }
+
+	// the capture sets the timing, test frames are no longer paced
+	if ( ll_socket->pacer != NULL )
+	{
+		close_ll_pacer(ll_socket->pacer);
+		ll_socket->pacer = NULL;
+	}
+	resume_ll_tx_queue(ll_socket->tx_queue);
+
+	if ( ll_socket->replay != NULL )
+		{ close_ll_replay(ll_socket->replay); }
+	start_ll_replay(replay, ll_socket->loop, ll_socket->tx_watcher);
+	ll_socket->replay = replay;
+
+	arg = __tx_arg(ll_socket);
+	arg->pacer = NULL;
+	arg->cb_frame_tx = ll_replay_tx_cb;
+	arg->public_arg.replay = replay;
+
+	return(EX_OK);
+
+}
+
+/* set_probe_ll_socket */
+int set_probe_ll_socket
+	(ll_socket_t *ll_socket, const int mode, const uint64_t count)
+{
+
+	ev_io_arg_t *arg = NULL;
+	ll_probe_t *probe = NULL;
+	ll_frame_template_t *template = NULL;
+
+	if ( ll_socket == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( ll_socket->frame_type != TYPE_IEEE_8023 )
+	{
+		log_app_msg("Probes are only supported for IEEE 802.3 frames.\n");
+		return(EX_UNSUPPORTED);
+	}
+
+	if ( ( ( mode == PROBE_MODE_PING ) && ( ll_socket->tx_watcher == NULL ) )
+			|| ( ( mode == PROBE_MODE_REFLECT )
+					&& ( ll_socket->rx_watcher == NULL ) ) )
+	{
+		log_app_msg("Pingers need TX mode, reflectors RX mode.\n");
+		return(EX_ERR);
+	}
+
+	if ( ( probe = init_ll_probe(mode, count, ll_socket->ts_source) ) == NULL )
+		{ return(EX_ERR); }
+
+	if ( ll_socket->probe != NULL )
+		{ close_ll_probe(ll_socket->probe); }
+	ll_socket->probe = probe;
+
+	if ( mode == PROBE_MODE_REFLECT )
+	{
+		arg = __rx_arg(ll_socket);
+		arg->cb_frame_rx = (ev_cb_t)&ieee8023_probe_reflect_cb;
+		arg->public_arg.probe = probe;
+		return(EX_OK);
+	}
+
+	// 1) probes replace the test frames
+	if ( ( template = init_ieee8023_probe_template
+							(	ll_socket->ll_sap,
+								(unsigned char *)ll_socket->if_mac,
+								ETH_ADDR_BROADCAST, probe	) ) == NULL )
+		{ return(EX_ERR); }
+	free(ll_socket->tx_template);
+	ll_socket->tx_template = template;
+
+	arg = __tx_arg(ll_socket);
+	arg->cb_frame_tx = (ev_cb_t)&ieee8023_probe_tx_cb;
+	arg->public_arg.tx_template = template;
+	arg->public_arg.probe = probe;
+	start_ll_probe(probe, ll_socket->loop, ll_socket->tx_watcher);
+
+	// 2) replies are received by the same socket
+	if ( ( ll_socket->rx_watcher == NULL )
+			&& ( init_rx_events(ll_socket) < 0 ) )
+		{ return(EX_ERR); }
+
+	arg = __rx_arg(ll_socket);
+	arg->cb_frame_rx = (ev_cb_t)&ieee8023_probe_rx_cb;
+	arg->public_arg.tx_template = template;
+
+	return(EX_OK);
+
+}
+
+/* set_duplex_ll_socket */
+int set_duplex_ll_socket(ll_socket_t *ll_socket)
+{
+
+	ev_io_arg_t *arg = NULL;
+
+	if ( ll_socket == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	// 1) the direction the socket was not opened for is added
+	if ( ll_socket->rx_watcher == NULL )
+	{
+		if ( init_rx_events(ll_socket) < 0 )
+			{ return(EX_ERR); }
+	}
+	else if ( ll_socket->tx_watcher == NULL )
+	{
+
+		#ifndef KERNEL_RING
+		// receivers only asked the kernel for the timestamps of rx frames
+		if ( ( is_ll_backend_virtual(ll_socket->backend) == false )
+				&& ( ll_socket->ts_source != TS_SOURCE_CLOCK )
+				&& ( enable_ll_timestamping(	ll_socket->socket_fd,
+												ll_socket->if_name, true	)
+						< 0 ) )
+			{ log_warning_msg("No TX timestamps.\n"); }
+		#endif
+
+		if ( init_tx_events(ll_socket) < 0 )
+			{ return(EX_ERR); }
+
+	}
+
+	#ifdef KERNEL_RING
+	// the rx ring has a socket of its own, that would get our frames back
+	int one = 1;
+	if ( setsockopt(	ll_socket->rx_socket_fd, SOL_PACKET,
+						PACKET_IGNORE_OUTGOING, &one, sizeof(int)	) < 0 )
+		{ log_sys_error("Could not ignore outgoing frames"); }
+	#endif
+
+	// 2) the rx watcher also drains what the tx one leaves in the socket
+	arg = __rx_arg(ll_socket);
+	arg->public_arg.tx_queue = ll_socket->tx_queue;
+	arg->public_arg.tx_template = ll_socket->tx_template;
+
+	log_app_msg("Full-duplex socket, if_name = %s.\n", ll_socket->if_name);
+
+	return(EX_OK);
+
+}
+
+/* __stats_socket_fd */
+static int __stats_socket_fd(const ll_socket_t *ll_socket, bool *is_ring)
+{
+
+	// drops of the rx ring are the only ones counted by the kernel
+	#ifdef KERNEL_RING
+		*is_ring = true;
+		return(ll_socket->rx_socket_fd);
+	#else
+		*is_ring = false;
+		if ( is_ll_backend_virtual(ll_socket->backend) == true )
+			{ return(-1); }
+		return(ll_socket->socket_fd);
+	#endif
+
+}
+
+/* get_ll_socket_stats */
+int get_ll_socket_stats(ll_socket_t *ll_socket, ll_stats_t *snapshot)
+{
+
+	int socket_fd = -1;
+	bool is_ring = false;
+
+	if ( ( ll_socket == NULL ) || ( snapshot == NULL ) )
+		{ return(EX_NULL_PARAM); }
+
+	socket_fd = __stats_socket_fd(ll_socket, &is_ring);
+	return(snapshot_ll_stats(	ll_socket->stats, &ll_socket->kernel_stats,
+								socket_fd, is_ring, snapshot	));
+
+}
+
+/* set_stats_reporter_ll_socket */
+int set_stats_reporter_ll_socket
+	(ll_socket_t *ll_socket, const double interval, const char *name)
+{
+
+	ll_stats_reporter_t *reporter = NULL;
+	int socket_fd = -1;
+	bool is_ring = false;
+
+	if ( ll_socket == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( name == NULL )
+		{ name = ll_socket->if_name; }
+
+	socket_fd = __stats_socket_fd(ll_socket, &is_ring);
+	if ( ( reporter = init_ll_stats_reporter
+							(	ll_socket->stats, &ll_socket->kernel_stats,
+								socket_fd, is_ring, name, interval	) ) == NULL )
+		{ return(EX_ERR); }
+
+	if ( ll_socket->reporter != NULL )
+		{ close_ll_stats_reporter(ll_socket->reporter); }
+	ll_socket->reporter = reporter;
+
+	start_ll_stats_reporter(reporter, ll_socket->loop);
+
+	return(EX_OK);
+
+}
+
+/* set_latency_ll_socket */
+int set_latency_ll_socket(ll_socket_t *ll_socket)
+{
+
+	if ( ll_socket == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( ( ll_socket->rx_watcher != NULL ) && ( ll_socket->rx_latency == NULL ) )
+	{
+		ll_socket->rx_latency = new_ll_histogram();
+		__rx_arg(ll_socket)->latency = ll_socket->rx_latency;
+	}
+
+	if ( ( ll_socket->tx_watcher != NULL ) && ( ll_socket->tx_latency == NULL ) )
+	{
+		ll_socket->tx_latency = new_ll_histogram();
+		__tx_arg(ll_socket)->latency = ll_socket->tx_latency;
+	}
+
+	return(EX_OK);
+
+}
+
+#ifndef KERNEL_RING
+
+/* set_rx_batch_ll_socket */
+int set_rx_batch_ll_socket(ll_socket_t *ll_socket, const int max_frames)
+{
+
+	ev_io_arg_t *arg = NULL;
+	ll_frame_batch_t *batch = NULL;
+	ev_cb_t rx_cb = NULL;
+
+	if ( ll_socket == NULL )
+		{ return(EX_NULL_PARAM); }
+	if ( max_frames <= 1 )
+		{ return(EX_WRONG_PARAM); }
+
+	if ( ll_socket->rx_watcher == NULL )
+	{
+		log_app_msg("Frame reception is disabled, no batch is needed.\n");
+		return(EX_ERR);
+	}
+
+	switch(ll_socket->frame_type)
+	{
+		case TYPE_IEEE_8023:
+
+			batch = init_ieee8023_frame_batch(max_frames);
+			rx_cb = (ev_cb_t)&ieee8023_frame_rx_batch_cb;
+			break;
+
+		case TYPE_IEEE_80211:
+
+			batch = init_ieee80211_frame_batch(max_frames);
+			rx_cb = (ev_cb_t)&ieee80211_frame_rx_batch_cb;
+			break;
+
+		default:
+
+			log_app_msg("Unsupported frame_type = %d\n", ll_socket->frame_type);
+			return(EX_UNSUPPORTED);
+
+	}
+
+	ll_socket->rx_batch = batch;
+	if ( set_cb_frame_rx(ll_socket, rx_cb) < 0 )
+		{ return(EX_ERR); }
+
+	arg = __rx_arg(ll_socket);
+	arg->cb_frame_rx = rx_cb;
+	arg->public_arg.batch = batch;
+
+	return(EX_OK);
+
+}
+
+/* set_tx_batch_ll_socket */
+int set_tx_batch_ll_socket(ll_socket_t *ll_socket, const int max_frames)
+{
+
+	ev_io_arg_t *arg = NULL;
+	ll_frame_batch_t *batch = NULL;
+	ev_cb_t tx_cb = NULL;
+
+	if ( ll_socket == NULL )
+		{ return(EX_NULL_PARAM); }
+	if ( max_frames <= 1 )
+		{ return(EX_WRONG_PARAM); }
+
+	if ( ll_socket->tx_watcher == NULL )
+	{
+		log_app_msg("Frame transmission is disabled, no batch is needed.\n");
+		return(EX_ERR);
+	}
+
+	switch(ll_socket->frame_type)
+	{
+		case TYPE_IEEE_8023:
+
+			batch = init_ieee8023_tx_batch
+						(	max_frames, ll_socket->ll_sap,
+							(unsigned char *)ll_socket->if_mac,
+							ETH_ADDR_BROADCAST	);
+			tx_cb = (ev_cb_t)&ieee8023_frame_tx_batch_cb;
+			break;
+
+		case TYPE_IEEE_80211:
+
+			batch = init_ieee80211_tx_batch
+						(	max_frames, ll_socket->ll_sap,
+							(unsigned char *)ll_socket->if_mac,
+							ETH_ADDR_BROADCAST	);
+			tx_cb = (ev_cb_t)&ieee80211_frame_tx_batch_cb;
+			break;
+
+		default:
+
+			log_app_msg("Unsupported frame_type = %d\n", ll_socket->frame_type);
+			return(EX_UNSUPPORTED);
+
+	}
+
+	ll_socket->tx_batch = batch;
+	if ( set_cb_frame_tx(ll_socket, tx_cb) < 0 )
+		{ return(EX_ERR); }
+
+	arg = __tx_arg(ll_socket);
+	arg->cb_frame_tx = tx_cb;
+	arg->public_arg.batch = batch;
+
+	return(EX_OK);
+
+}
+
+#endif
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 // DATA TX/RX INTERFACE
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
@@ -790,14 +1543,13 @@ int set_cb_frame_tx(ll_socket_t *ll_socket, ev_cb_t cb_frame_tx)
 int start_ll_socket(ll_socket_t *ll_socket)
 {
 
-	// 1) start event_loop event's reading
+	// 1) frames of virtual backends flow once the socket is configured
+	if ( ( ll_socket->backend != NULL )
+			&& ( start_ll_backend(ll_socket->backend) < 0 ) )
+		{ return(EX_ERR); }
+
+	// 2) start event_loop event's reading
 	log_app_msg("Starting ev_run_loop.\n");
-	print_eth_address(ll_socket->if_mac);
-	//printf(ll_socket->loop);
-	printf("1\n");
-	//printf("%d %s\n",ll_socket-> frame_type,);
-	//print_eth_address(ll_socket->if_mac);
-	//ll_socket->sll_protocol = htons(ETH_P_ALL);
 	ev_loop(ll_socket->loop, 0);
 	log_app_msg("Done ev_run_loop.\n");
 	ll_socket->state = LL_SOCKET_STATE_RUNNING;
@@ -28,6 +28,14 @@
 #include "ll_library/ll_frame.h"
 #include "ll_library/ieee8023_frame.h"
 #include "ll_library/ieee80211_frame.h"
+#include "ll_library/ll_pacer.h"
+#include "ll_library/ll_capture.h"
+#include "ll_library/ll_replay.h"
+#include "ll_library/ll_backend.h"
+#include "ll_library/ll_probe.h"
+#include "ll_library/ll_stats.h"
+#include "ll_library/ll_histogram.h"
+#include "ll_library/ll_tx_queue.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,6 +43,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <linux/if_packet.h>
+#include <linux/filter.h>
 #include <net/if.h>
 #include <net/ethernet.h> /* the L2 protocols */
 #include <netinet/in.h>
@@ -45,8 +54,7 @@
 #include <ev.h>
 
 #ifdef KERNEL_RING
-	#define FRAMES_PER_BLOCK 128		/*!< Number of frames per block. */
-	#define NO_BLOCKS 1					/*!< Total number of blocks of the ring. */
+	#include "ll_library/ll_ring.h"
 #endif
 
 /**************************************************************** DATA TYPES */
@@ -73,14 +81,12 @@ typedef struct ll_socket
 	#ifdef KERNEL_RING
 
 		int tx_socket_fd;				/*!< FD of the tx socket. */	
-		void *tx_ring_buffer;			/*!< Kernel mmap()ed tx ring. */
+		tx_ring_t *tx_ring;				/*!< Kernel mmap()ed tx ring. */
 		sockaddr_ll_t *tx_ring_addr;	/*!< Address for the tx ring. */
-		int tx_ring_len;				/*!< Length of the tx ring. */
 	
 		int rx_socket_fd;				/*!< FD of the rx socket. */	
-		void *rx_ring_buffer;			/*!< Kernel mmap()ed tx ring. */
+		rx_ring_t *rx_ring;				/*!< Kernel mmap()ed rx ring. */
 		sockaddr_ll_t *rx_ring_addr;	/*!< Address for the rx ring. */
-		int rx_ring_len;				/*!< Length of the rx ring. */
 
 	#else
 
@@ -88,13 +94,31 @@ typedef struct ll_socket
 		sockaddr_ll_t *addr;			/*!< TX address. */
 
 		ll_frame_t *buffer;				/*!< Buffer for frames reception. */
+		ll_frame_batch_t *rx_batch;		/*!< Batch for frames reception. */
+		ll_frame_batch_t *tx_batch;		/*!< Batch for frames transmission. */
 
 	#endif
+
+	ll_frame_pool_t *pool;					/*!< Pool of frames of the socket. */
+	ll_frame_template_t *tx_template;		/*!< Template for test frames. */
+	ll_pacer_t *pacer;						/*!< Pacer for test frames. */
+	ll_tx_queue_t *tx_queue;				/*!< Send queue, runs tx watcher. */
+	struct sock_fprog *filter;				/*!< BPF program attached. */
+	int ts_source;							/*!< Best source of timestamps. */
+	ll_capture_t *capture;					/*!< Capture of frames received. */
+	ll_replay_t *replay;					/*!< Capture being transmitted. */
+	ll_backend_t *backend;					/*!< I/O backend, NULL = AF_PACKET. */
+	ll_probe_t *probe;						/*!< Latency probes, if any. */
+	ll_stats_t *stats;						/*!< Counters of the socket. */
+	ll_kernel_stats_t kernel_stats;			/*!< Read from the kernel. */
+	ll_stats_reporter_t *reporter;			/*!< Periodic report, if any. */
+	ll_histogram_t *rx_latency;				/*!< Time of the rx callbacks. */
+	ll_histogram_t *tx_latency;				/*!< Time of the tx callbacks. */
 	
 	ev_cb_t cb_frame_rx;					/*!< Callback frame rx function. */
 	ev_cb_t cb_frame_tx;					/*!< Callback frame tx function. */
 
-	struct ev_loop *loop;					/*!< Default event loop. */
+	struct ev_loop *loop;					/*!< Event loop of the socket. */
 	struct ev_io *rx_watcher;				/*!< Frame rx watcher. */
 	struct ev_io *tx_watcher;				/*!< Frame tx watcher. */
 
@@ -104,6 +128,7 @@ typedef struct ll_socket
 	char if_name[IF_NAMESIZE];	/*!< Name of the link layer level if. */
 	int if_index;				/*!< Index of the link layer level if.*/
 	char if_mac[ETH_ALEN];		/*!< MAC address of the link layer level if. */
+	int if_hatype;				/*!< Hardware type of the if (ARPHRD_*). */
 
 	int tx_delay;				/*!< Delay (ms) between two test frames. */
 	int frame_type;				/*!< Frame type for post-processing. */
@@ -126,6 +151,10 @@ typedef struct ev_io_arg
 
 	public_ev_arg_t public_arg;		/*!< Data for external callbacks. */
 
+	ll_pacer_t *pacer;				/*!< Pacer of the tx watcher, if any. */
+	ll_backend_t *backend;			/*!< Backend of the socket, if any. */
+	ll_histogram_t *latency;		/*!< Time within the callback (ns). */
+
 } ev_io_arg_t;
 
 #define LEN__EV_IO_ARG sizeof(ev_io_arg_t)
@@ -176,21 +205,6 @@ unsigned char *new_mac_buffer();
 */
 ev_io_arg_t *init_ev_io_arg(ll_socket_t *ll_socket);
 
-#ifdef KERNEL_RING
-
-/*!
-	\brief Initializes a tpacket structure for the request of a ring to the 
-			kernel, with 1 block of memory containing the requested number 
-			of frames.
-	\param frames_per_block Number of frames for each of the blocks.
-	\param no_blocks Number of blocks to be used for this ring.
-	\return The initialized tpacket_req structure.
-*/
-tpacket_req_t *init_tpacket_req
-					(const int frames_per_block, const int no_blocks);
-
-#endif
-
 /*!
 	\brief Allocates memory for a socket_addr structure and fills it up with 
 			the data necessary for defining the socket access to the kernel 
@@ -219,6 +233,15 @@ int if_name_2_if_index(const int socket_fd, const char *if_name);
 int get_mac_address
 	(const int socket_fd, const char *if_name, unsigned char *mac);
 
+/*!
+	\brief Gets the hardware type of the given interface, which tells whether
+			the frames received carry a radiotap header in front.
+	\param socket_fd Identifier of the socket.
+	\param if_name The name of the link layer level interface.
+	\return The hardware type (ARPHRD_*), <0 in case of error.
+*/
+int get_if_hatype(const int socket_fd, const char *if_name);
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 // LL_SOCKET MANAGEMENT
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
@@ -237,6 +260,8 @@ ll_socket_t *new_ll_socket();
 	\param tx_delay Delay (in ms) after each test frame sent to the channel.
 	\param ll_if_name Name of the link layer level interface to be used.
 	\param ll_sap Service access point to be used.
+	\param frame_type Selects the type of frame to be managed.
+	\param loop Event loop that will serve this socket.
 	\return Structure containing all information necessary for handling this
 			socket. A 'NULL' value indicates that an unsupported error has
 			ocurred.
@@ -244,7 +269,31 @@ ll_socket_t *new_ll_socket();
 ll_socket_t *init_ll_socket
 	(	const bool is_transmitter, const int tx_delay,
 		const char *ll_if_name, const int ll_sap,
-		const int frame_type	);
+		const int frame_type, struct ev_loop *loop	);
+
+/*!
+	\brief Creates a socket on top of the given I/O backend, see
+			init_ll_socket(). Virtual backends need no live interface: the
+			name is only a label and the MAC is the one of the backend.
+	\param backend I/O backend, NULL for an AF_PACKET socket.
+	\return Structure containing all information necessary for handling this
+			socket, NULL in case of error.
+*/
+ll_socket_t *init_ll_socket_backend
+	(	ll_backend_t *backend, const bool is_transmitter, const int tx_delay,
+		const char *ll_if_name, const int ll_sap,
+		const int frame_type, struct ev_loop *loop	);
+
+/*!
+	\brief Creates a socket that only receives frames, as the workers of a
+			fanout group do, see init_ll_socket(). With kernel rings, no TX
+			ring is mapped for it.
+	\return Structure containing all information necessary for handling this
+			socket, NULL in case of error.
+*/
+ll_socket_t *init_rx_worker_ll_socket
+	(	const char *ll_if_name, const int ll_sap,
+		const int frame_type, struct ev_loop *loop	);
 
 /*!
 	\brief Opens a new socket without binding it.
@@ -261,6 +310,17 @@ ll_socket_t *open_ll_socket
 		const char* ll_if_name, const int ll_sap,
 		const int frame_type	);
 
+/*!
+	\brief Opens a new socket on top of the given I/O backend, binding it
+			only if it is an AF_PACKET socket.
+	\param backend I/O backend, NULL for an AF_PACKET socket.
+	\return Socket information structure or NULL if a problem occurred.
+*/
+ll_socket_t *open_ll_socket_backend
+	(	ll_backend_t *backend, const bool is_transmitter, const int tx_delay,
+		const char* ll_if_name, const int ll_sap,
+		const int frame_type	);
+
 /*!
 	\brief Creates and binds a new socket to the given SAP of the link layer.
 	\param ll_socket Information of the socket to be created.
@@ -298,26 +358,15 @@ int set_promiscuous_ll_socket(const ll_socket_t *ll_socket);
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
 /*!
-	\brief Initializes both TX and RX rings for the given socket.
+	\brief Initializes both TX and RX rings for the given socket. The RX ring
+			is a TPACKET_V3 block-based ring and the TX ring a TPACKET_V2
+			one, see ll_ring.h.
 	\param ll_socket Socket whose rings are to be initialized.
+	\param has_tx_ring Flag, false for receive-only sockets without TX ring.
 	\return Function execution result code.
 */
-int init_rings(ll_socket_t *ll_socket);
+int init_rings(ll_socket_t *ll_socket, const bool has_tx_ring);
 
-/*!
-	\brief Initializes one of the rings with the given type.
-	\param socket_fd FD of the socket whose ring is to be initialized.
-	\param type Type of ring to be created, either TX or RX.
-	\param frames_per_block Number of frames for a given block of memory.
-	\param no_blocks Number of blocks that the buffer is composed of.
-	\param ring Pointer to the initialized ring buffer.
-	\return Length of the ring (>0) in case operation was successfull, (<0) 
-				otherwise.
-*/
-int init_ring(	const int socket_fd, const int type,
-				const int frames_per_block, const int no_blocks,
-				void **ring	);
-				
 /*!
 	\brief Closes the access requested to kernel tx and rx rings.
 	\param ll_socket The socket whose rings are to be closed.
@@ -391,6 +440,126 @@ int set_cb_frame_rx(ll_socket_t *ll_socket, ev_cb_t cb_frame_rx);
  */
 int set_cb_frame_tx(ll_socket_t *ll_socket, ev_cb_t cb_frame_tx);
 
+/*!
+ * \brief Sets the rate at which the test frames of the given socket are
+ * 			transmitted, replacing the one derived from its tx_delay.
+ * \param ll_socket The socket whose transmission is to be paced.
+ * \param unit Unit of the rate (PACER_UNIT_FRAMES or PACER_UNIT_BITS).
+ * \param rate Target rate (frames/s or bit/s).
+ * \param burst Maximum number of frames sent back to back.
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int set_pacer_ll_socket
+	(	ll_socket_t *ll_socket, const int unit,
+		const double rate, const int burst	);
+
+/*!
+ * \brief Stores all the frames received by the given socket in a capture,
+ * 			instead of printing them.
+ * \param ll_socket The socket whose frames are to be captured.
+ * \param path Path of the capture file.
+ * \param format Format of the file (CAPTURE_FORMAT_*).
+ * \param max_file_bytes Size that triggers a rotation (B), 0 to disable it.
+ * \param max_file_secs Age that triggers a rotation (s), 0 to disable it.
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int set_capture_ll_socket
+	(	ll_socket_t *ll_socket, const char *path, const int format,
+		const uint64_t max_file_bytes, const int max_file_secs	);
+
+/*!
+ * \brief Transmits the frames of a capture file instead of the test frames,
+ * 			with their original timing (scaled) or as fast as possible. The
+ * 			event loop is broken once all of them have been sent.
+ * \param ll_socket The socket through which the capture is to be replayed.
+ * \param path Path of the capture file (pcap or pcapng).
+ * \param speed Speed factor (1.0 = original timing), 0 as fast as possible.
+ * \param batch Maximum number of frames sent with a single system call.
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int set_replay_ll_socket
+	(	ll_socket_t *ll_socket, const char *path,
+		const double speed, const int batch	);
+
+/*!
+ * \brief Turns the socket into one of the ends of a latency measurement. A
+ * 			pinger sends probes instead of the test frames, at the rate of
+ * 			the socket, and also receives their replies; once all of them
+ * 			are back (or late), the latencies are printed and the event loop
+ * 			is broken. A reflector returns the probes it receives.
+ * \param ll_socket The socket to be used, TX for a pinger, RX otherwise.
+ * \param mode PROBE_MODE_PING or PROBE_MODE_REFLECT.
+ * \param count Number of probes to be sent by a pinger.
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int set_probe_ll_socket
+	(ll_socket_t *ll_socket, const int mode, const uint64_t count);
+
+/*!
+ * \brief Makes the socket full-duplex: the watcher of the direction it was
+ * 			not opened for is added, so that both receive and transmit
+ * 			within the same event loop. A socket opened as a transmitter
+ * 			keeps its binding, only frames of its SAP are received.
+ * \param ll_socket The socket to be made full-duplex.
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int set_duplex_ll_socket(ll_socket_t *ll_socket);
+
+/*!
+ * \brief Takes a snapshot of the counters of the socket, including the
+ * 			drops counted by the kernel up to now.
+ * \param ll_socket The socket whose counters are to be read.
+ * \param snapshot Where the counters are copied.
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int get_ll_socket_stats(ll_socket_t *ll_socket, ll_stats_t *snapshot);
+
+/*!
+ * \brief Prints the counters of the socket periodically, from its own event
+ * 			loop; the totals are printed once the socket is closed.
+ * \param ll_socket The socket whose counters are to be reported.
+ * \param interval Time between two reports (s).
+ * \param name Name of the socket in the reports, NULL for the interface.
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int set_stats_reporter_ll_socket
+	(ll_socket_t *ll_socket, const double interval, const char *name);
+
+/*!
+ * \brief Records the time spent within the rx and tx callbacks of the socket
+ * 			in a histogram each; without them, callbacks are not timed.
+ * \param ll_socket The socket whose callbacks are to be timed.
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int set_latency_ll_socket(ll_socket_t *ll_socket);
+
+
+#ifndef KERNEL_RING
+
+/*!
+ * \brief Switches the reception of the given socket to batch mode: every
+ * 			time the socket becomes readable, up to max_frames frames are
+ * 			read with a single recvmmsg() call and handed over together to
+ * 			the batch-aware callback of the frame type of the socket.
+ * \param ll_socket The socket whose reception mode is to be changed.
+ * \param max_frames Maximum number of frames per batch (>1).
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int set_rx_batch_ll_socket(ll_socket_t *ll_socket, const int max_frames);
+
+/*!
+ * \brief Switches the transmission of the given socket to batch mode: a
+ * 			batch of max_frames test frames is built once and, every time
+ * 			the socket becomes writable, the whole batch is transmitted with
+ * 			sendmmsg(), resuming from the first frame not yet sent.
+ * \param ll_socket The socket whose transmission mode is to be changed.
+ * \param max_frames Number of frames per batch (>1).
+ * \return EX_OK in case of a correct execution, <0 otherwise.
+ */
+int set_tx_batch_ll_socket(ll_socket_t *ll_socket, const int max_frames);
+
+#endif
+
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 // DATA TX/RX INTERFACE
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
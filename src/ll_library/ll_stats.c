@@ -0,0 +1,252 @@
+/*
+ * @file ll_stats.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_stats.h"
+
+/* __cb_report */
+static void __cb_report(struct ev_loop *loop, ev_timer *timer, int revents)
+{
+
+	ll_stats_reporter_t *r = (ll_stats_reporter_t *)timer;
+	ll_stats_t now, diff;
+	ev_tstamp t = ev_now(loop);
+
+	if ( snapshot_ll_stats(	r->stats, r->kernel, r->socket_fd, r->is_ring,
+							&now	) < 0 )
+		{ log_app_msg("Could not read kernel statistics of %s.\n", r->name); }
+
+	diff_ll_stats(&now, &r->last, &diff);
+	print_ll_stats(&diff, r->name, t - r->last_time);
+
+	r->last = now;
+	r->last_time = t;
+
+}
+
+/* new_ll_stats */
+ll_stats_t *new_ll_stats()
+{
+
+	void *buffer = NULL;
+
+	if ( posix_memalign(&buffer, STATS_ALIGN, LEN__LL_STATS) != 0 )
+		{ handle_sys_error("Could not allocate statistics"); }
+	memset(buffer, 0, LEN__LL_STATS);
+
+	return((ll_stats_t *)buffer);
+
+}
+
+#ifndef KERNEL_RING
+
+/* ll_stats_tx_batch */
+void ll_stats_tx_batch
+	(ll_stats_t *stats, const ll_frame_batch_t *batch, const int first)
+{
+
+	const ll_frame_t *frame = NULL;
+
+	if ( stats == NULL )
+		{ return; }
+
+	for ( int i = first; i < batch->next_frame; i++ )
+	{
+		frame = (const ll_frame_t *)get_ll_frame_batch(batch, i);
+		ll_stats_tx(stats, frame->frame_len);
+	}
+
+}
+
+#endif
+
+/* read_ll_kernel_stats */
+int read_ll_kernel_stats
+	(ll_kernel_stats_t *kernel, const int socket_fd, const bool is_ring)
+{
+
+	union tpacket_stats_u k;
+	socklen_t len = ( is_ring == true ) ? sizeof(struct tpacket_stats_v3)
+										: sizeof(struct tpacket_stats);
+
+	memset(&k, 0, sizeof(k));
+
+	// the kernel clears its counters every time they are read
+	if ( getsockopt(socket_fd, SOL_PACKET, PACKET_STATISTICS, &k, &len) < 0 )
+	{
+		log_sys_error("Could not read PACKET_STATISTICS");
+		return(EX_SYS);
+	}
+
+	if ( is_ring == true )
+	{
+		kernel->kernel_drops += k.stats3.tp_drops;
+		kernel->ring_freezes += k.stats3.tp_freeze_q_cnt;
+	}
+	else
+		{ kernel->kernel_drops += k.stats1.tp_drops; }
+
+	return(EX_OK);
+
+}
+
+/* snapshot_ll_stats */
+int snapshot_ll_stats
+	(	const ll_stats_t *stats, ll_kernel_stats_t *kernel,
+		const int socket_fd, const bool is_ring, ll_stats_t *snapshot	)
+{
+
+	int result = EX_OK;
+
+	if ( ( stats == NULL ) || ( snapshot == NULL ) )
+		{ return(EX_NULL_PARAM); }
+
+	*snapshot = *stats;
+
+	if ( kernel == NULL )
+		{ return(EX_OK); }
+
+	// the kernel ones are kept apart, the packet path is never written
+	if ( socket_fd >= 0 )
+		{ result = read_ll_kernel_stats(kernel, socket_fd, is_ring); }
+
+	snapshot->kernel_drops += kernel->kernel_drops;
+	snapshot->ring_freezes += kernel->ring_freezes;
+	return(result);
+
+}
+
+/* diff_ll_stats */
+void diff_ll_stats
+	(const ll_stats_t *now, const ll_stats_t *before, ll_stats_t *diff)
+{
+
+	diff->rx_frames = now->rx_frames - before->rx_frames;
+	diff->rx_bytes = now->rx_bytes - before->rx_bytes;
+	diff->rx_errors = now->rx_errors - before->rx_errors;
+
+	diff->tx_frames = now->tx_frames - before->tx_frames;
+	diff->tx_bytes = now->tx_bytes - before->tx_bytes;
+	diff->tx_errors = now->tx_errors - before->tx_errors;
+	diff->tx_short = now->tx_short - before->tx_short;
+
+	diff->kernel_drops = now->kernel_drops - before->kernel_drops;
+	diff->ring_freezes = now->ring_freezes - before->ring_freezes;
+	diff->ring_full = now->ring_full - before->ring_full;
+
+}
+
+/* print_ll_stats */
+void print_ll_stats(const ll_stats_t *stats, const char *name, const double secs)
+{
+
+	const ll_stats_t *s = stats;
+
+	log_app_msg(">>> Statistics (%s) = \n", name);
+	log_app_msg("\t* rx: frames = %lu, bytes = %lu, errors = %lu\n"
+				, s->rx_frames, s->rx_bytes, s->rx_errors);
+	log_app_msg("\t* tx: frames = %lu, bytes = %lu, errors = %lu, short = %lu\n"
+				, s->tx_frames, s->tx_bytes, s->tx_errors, s->tx_short);
+	log_app_msg("\t* kernel: drops = %lu, ring_freezes = %lu, ring_full = %lu\n"
+				, s->kernel_drops, s->ring_freezes, s->ring_full);
+
+	if ( secs <= 0 )
+		{ return; }
+
+	log_app_msg("\t* rate (%.3f s): rx = %.1f frames/s (%.3f Mbit/s), \
+tx = %.1f frames/s (%.3f Mbit/s)\n"
+				, secs
+				, s->rx_frames / secs, s->rx_bytes * 8. / secs / 1e6
+				, s->tx_frames / secs, s->tx_bytes * 8. / secs / 1e6);
+
+}
+
+/* new_ll_stats_reporter */
+ll_stats_reporter_t *new_ll_stats_reporter()
+{
+
+	ll_stats_reporter_t *r = NULL;
+	r = (ll_stats_reporter_t *)malloc(LEN__LL_STATS_REPORTER);
+	memset(r, 0, LEN__LL_STATS_REPORTER);
+	return(r);
+
+}
+
+/* init_ll_stats_reporter */
+ll_stats_reporter_t *init_ll_stats_reporter
+	(	ll_stats_t *stats, ll_kernel_stats_t *kernel, const int socket_fd,
+		const bool is_ring, const char *name, const double interval	)
+{
+
+	ll_stats_reporter_t *r = NULL;
+
+	if ( ( stats == NULL ) || ( name == NULL ) )
+		{ return(NULL); }
+
+	if ( interval <= 0 )
+	{
+		log_app_msg("Statistics interval = %f must be positive.\n", interval);
+		return(NULL);
+	}
+
+	r = new_ll_stats_reporter();
+	r->stats = stats;
+	r->kernel = kernel;
+	r->socket_fd = socket_fd;
+	r->is_ring = is_ring;
+	snprintf(r->name, STATS_NAME_LEN, "%s", name);
+
+	ev_timer_init(&r->timer, __cb_report, interval, interval);
+
+	return(r);
+
+}
+
+/* start_ll_stats_reporter */
+void start_ll_stats_reporter
+	(ll_stats_reporter_t *reporter, struct ev_loop *loop)
+{
+
+	reporter->loop = loop;
+	snapshot_ll_stats(	reporter->stats, reporter->kernel, -1, false,
+						&reporter->last	);
+	// the loop might not have run yet, its time would be stale
+	ev_now_update(loop);
+	reporter->last_time = ev_now(loop);
+
+	ev_timer_start(loop, &reporter->timer);
+
+}
+
+/* close_ll_stats_reporter */
+int close_ll_stats_reporter(ll_stats_reporter_t *reporter)
+{
+
+	if ( reporter == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	if ( reporter->loop != NULL )
+		{ ev_timer_stop(reporter->loop, &reporter->timer); }
+
+	free(reporter);
+	return(EX_OK);
+
+}
@@ -0,0 +1,244 @@
+/*
+ * @file ll_stats.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for the counters of the frames handled
+ * by a socket. Counters are only written by the thread that runs the loop
+ * of the socket, so they are plain (not atomic) integers; each set lives in
+ * cache lines of its own so that the sockets of several workers do not
+ * slow each other down. Kernel drops and ring freezes are read out of
+ * PACKET_STATISTICS whenever a snapshot is taken, into counters of their own
+ * so that snapshots never write the ones of the packet path.
+ */
+
+#ifndef LL_STATS_H_
+#define LL_STATS_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_frame.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <ev.h>
+
+/**************************************************************** DATA TYPES */
+
+#define STATS_ALIGN				64		/*!< Size of a cache line (B). */
+#define STATS_NAME_LEN			32		/*!< Maximum length of the names. */
+
+/*!
+ * \struct ll_stats
+ * \brief Counters of a socket, since it was opened.
+ */
+typedef struct ll_stats
+{
+
+	uint64_t rx_frames;				/*!< Frames received. */
+	uint64_t rx_bytes;				/*!< Bytes of the frames received. */
+	uint64_t rx_errors;				/*!< Frames that could not be read. */
+
+	uint64_t tx_frames;				/*!< Frames sent (queued for rings). */
+	uint64_t tx_bytes;				/*!< Bytes of the frames sent. */
+	uint64_t tx_errors;				/*!< Frames that could not be sent. */
+	uint64_t tx_short;				/*!< Frames sent only partially. */
+
+	uint64_t kernel_drops;			/*!< Frames dropped by the kernel. */
+	uint64_t ring_freezes;			/*!< Times the RX ring was full (V3). */
+	uint64_t ring_full;				/*!< Frames not sent, TX ring full. */
+
+} __attribute__((aligned(STATS_ALIGN))) ll_stats_t;
+
+#define LEN__LL_STATS sizeof(ll_stats_t)
+
+/*!
+ * \struct ll_kernel_stats
+ * \brief Counters read out of PACKET_STATISTICS, since the socket was opened.
+ */
+typedef struct ll_kernel_stats
+{
+
+	uint64_t kernel_drops;			/*!< Frames dropped by the kernel. */
+	uint64_t ring_freezes;			/*!< Times the RX ring was full (V3). */
+
+} ll_kernel_stats_t;
+
+#define LEN__LL_KERNEL_STATS sizeof(ll_kernel_stats_t)
+
+/*!
+ * \struct ll_stats_reporter
+ * \brief Periodic report of the counters of a socket, printed by the loop
+ * 			of the socket itself. The timer is the first field so that its
+ * 			callback gets the reporter.
+ */
+typedef struct ll_stats_reporter
+{
+
+	ev_timer timer;					/*!< Periodic timer (first!). */
+	struct ev_loop *loop;			/*!< Loop of the socket. */
+
+	ll_stats_t *stats;				/*!< Counters of the socket. */
+	ll_kernel_stats_t *kernel;		/*!< Counters read from the kernel. */
+	int socket_fd;					/*!< Socket for PACKET_STATISTICS. */
+	bool is_ring;					/*!< The socket has a TPACKET_V3 ring. */
+	char name[STATS_NAME_LEN];		/*!< Name of the socket in the reports. */
+
+	ll_stats_t last;				/*!< Snapshot of the last report. */
+	ev_tstamp last_time;			/*!< Time of the last report. */
+
+} ll_stats_reporter_t;
+
+#define LEN__LL_STATS_REPORTER sizeof(ll_stats_reporter_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates a set of counters, cleared and aligned to a cache line.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_stats_t *new_ll_stats();
+
+/*!
+ * \brief Accounts for a frame received.
+ * \param stats Counters of the socket, NULL if there are none.
+ * \param len Length of the frame (B).
+ */
+static inline void ll_stats_rx(ll_stats_t *stats, const int len)
+{
+	if ( stats == NULL ) { return; }
+	stats->rx_frames++;
+	stats->rx_bytes += len;
+}
+
+/*!
+ * \brief Accounts for a frame sent, or queued in the TX ring.
+ * \param stats Counters of the socket, NULL if there are none.
+ * \param len Length of the frame (B).
+ */
+static inline void ll_stats_tx(ll_stats_t *stats, const int len)
+{
+	if ( stats == NULL ) { return; }
+	stats->tx_frames++;
+	stats->tx_bytes += len;
+}
+
+/*!< Increments one of the counters, if the socket has any. */
+#define ll_stats_inc(stats, counter) \
+			do { if ( (stats) != NULL ) { (stats)->counter++; } } while (0)
+
+#ifndef KERNEL_RING
+
+/*!
+ * \brief Accounts for the frames of a batch sent since the given one.
+ * \param stats Counters of the socket, NULL if there are none.
+ * \param batch Batch whose frames were sent, up to next_frame.
+ * \param first First frame sent.
+ */
+void ll_stats_tx_batch
+	(ll_stats_t *stats, const ll_frame_batch_t *batch, const int first);
+
+#endif
+
+/*!
+ * \brief Reads the drops (and RX ring freezes) counted by the kernel since
+ * 			the last time they were read and adds them to the counters.
+ * \param kernel Counters read from the kernel so far.
+ * \param socket_fd Socket to be read.
+ * \param is_ring The socket has a TPACKET_V3 ring.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int read_ll_kernel_stats
+	(ll_kernel_stats_t *kernel, const int socket_fd, const bool is_ring);
+
+/*!
+ * \brief Takes a snapshot of the counters, kernel ones included; the
+ * 			counters of the socket are only read.
+ * \param stats Counters of the socket.
+ * \param kernel Counters read from the kernel so far, NULL if none.
+ * \param socket_fd Socket for PACKET_STATISTICS, <0 not to read it.
+ * \param is_ring The socket has a TPACKET_V3 ring.
+ * \param snapshot Where the copy of the counters is to be stored.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int snapshot_ll_stats
+	(	const ll_stats_t *stats, ll_kernel_stats_t *kernel,
+		const int socket_fd, const bool is_ring, ll_stats_t *snapshot	);
+
+/*!
+ * \brief Gets the increment of the counters between two snapshots.
+ * \param now Newest snapshot.
+ * \param before Oldest snapshot.
+ * \param diff Where the increments are to be stored.
+ */
+void diff_ll_stats
+	(const ll_stats_t *now, const ll_stats_t *before, ll_stats_t *diff);
+
+/*!
+ * \brief Prints a set of counters.
+ * \param stats The counters to be printed.
+ * \param name Name of the socket.
+ * \param secs Period covered by the counters, rates are printed if > 0.
+ */
+void print_ll_stats(const ll_stats_t *stats, const char *name, const double secs);
+
+/*!
+ * \brief Allocates memory for a reporter.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_stats_reporter_t *new_ll_stats_reporter();
+
+/*!
+ * \brief Creates a reporter that prints the increment of the counters of a
+ * 			socket every interval.
+ * \param stats Counters of the socket.
+ * \param kernel Counters read from the kernel so far.
+ * \param socket_fd Socket for PACKET_STATISTICS, <0 if it has none.
+ * \param is_ring The socket has a TPACKET_V3 ring.
+ * \param name Name of the socket in the reports.
+ * \param interval Seconds between two reports.
+ * \return A pointer to the new reporter, NULL in case of error.
+ */
+ll_stats_reporter_t *init_ll_stats_reporter
+	(	ll_stats_t *stats, ll_kernel_stats_t *kernel, const int socket_fd,
+		const bool is_ring, const char *name, const double interval	);
+
+/*!
+ * \brief Starts the timer of a reporter.
+ * \param reporter The reporter to be started.
+ * \param loop Loop of the socket.
+ */
+void start_ll_stats_reporter
+	(ll_stats_reporter_t *reporter, struct ev_loop *loop);
+
+/*!
+ * \brief Stops the timer of a reporter and releases it.
+ * \param reporter The reporter to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_ll_stats_reporter(ll_stats_reporter_t *reporter);
+
+#endif /* LL_STATS_H_ */
@@ -0,0 +1,191 @@
+/*
+ * @file ll_timestamp.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_timestamp.h"
+
+/* __enable_hw_timestamping */
+static int __enable_hw_timestamping(const int socket_fd, const char *if_name)
+{
+
+	struct ifreq ifr;
+	struct hwtstamp_config cfg;
+
+	memset(&cfg, 0, sizeof(struct hwtstamp_config));
+	cfg.tx_type = HWTSTAMP_TX_ON;
+	cfg.rx_filter = HWTSTAMP_FILTER_ALL;
+
+	memset(&ifr, 0, sizeof(struct ifreq));
+	strncpy(ifr.ifr_name, if_name, IF_NAMESIZE - 1);
+	ifr.ifr_data = (void *)&cfg;
+
+	// most drivers (and every virtual interface) do not support it
+	if ( ioctl(socket_fd, SIOCSHWTSTAMP, &ifr) < 0 )
+		{ return(EX_UNSUPPORTED); }
+
+	return(EX_OK);
+
+}
+
+/* enable_ll_timestamping */
+int enable_ll_timestamping
+	(const int socket_fd, const char *if_name, const bool tx)
+{
+
+	int source = TS_SOURCE_SOFTWARE;
+	int flags = TS_FLAGS_RX | ( ( tx == true ) ? TS_FLAGS_TX : 0 );
+
+	if ( __enable_hw_timestamping(socket_fd, if_name) == EX_OK )
+		{ source = TS_SOURCE_HARDWARE; }
+
+	if ( setsockopt(	socket_fd, SOL_SOCKET, SO_TIMESTAMPING,
+						&flags, sizeof(int)	) < 0 )
+	{
+		log_sys_error("Could not enable SO_TIMESTAMPING");
+		return(EX_SYS);
+	}
+
+	log_app_msg("Timestamping enabled, if_name = %s, source = %s\n"
+					, if_name, get_ts_source_name(source));
+
+	return(source);
+
+}
+
+/* enable_ring_timestamping */
+int enable_ring_timestamping(const int socket_fd, const char *if_name)
+{
+
+	int flags = SOF_TIMESTAMPING_RAW_HARDWARE;
+
+	// software timestamps are always stored in the tpacket headers
+	if ( __enable_hw_timestamping(socket_fd, if_name) < 0 )
+		{ return(TS_SOURCE_SOFTWARE); }
+
+	if ( setsockopt(	socket_fd, SOL_PACKET, PACKET_TIMESTAMP,
+						&flags, sizeof(int)	) < 0 )
+	{
+		log_sys_error("Could not enable PACKET_TIMESTAMP");
+		return(TS_SOURCE_SOFTWARE);
+	}
+
+	return(TS_SOURCE_HARDWARE);
+
+}
+
+/* get_cmsg_timestamp */
+int get_cmsg_timestamp(const struct msghdr *msg, struct timespec *ts)
+{
+
+	struct cmsghdr *c = NULL;
+	struct scm_timestamping *t = NULL;
+
+	for ( c = CMSG_FIRSTHDR(msg); c != NULL;
+			c = CMSG_NXTHDR((struct msghdr *)msg, c) )
+	{
+
+		if ( ( c->cmsg_level != SOL_SOCKET )
+				|| ( c->cmsg_type != SO_TIMESTAMPING ) )
+			{ continue; }
+
+		// ts[0] holds the software timestamp, ts[2] the hardware one
+		t = (struct scm_timestamping *)CMSG_DATA(c);
+
+		if ( ( t->ts[2].tv_sec != 0 ) || ( t->ts[2].tv_nsec != 0 ) )
+		{
+			*ts = t->ts[2];
+			return(TS_SOURCE_HARDWARE);
+		}
+
+		if ( ( t->ts[0].tv_sec != 0 ) || ( t->ts[0].tv_nsec != 0 ) )
+		{
+			*ts = t->ts[0];
+			return(TS_SOURCE_SOFTWARE);
+		}
+
+	}
+
+	return(TS_SOURCE_NONE);
+
+}
+
+/* get_tpacket_ts_source */
+int get_tpacket_ts_source(const uint32_t tp_status)
+{
+
+	if ( tp_status & TP_STATUS_TS_RAW_HARDWARE )
+		{ return(TS_SOURCE_HARDWARE); }
+
+	return(TS_SOURCE_SOFTWARE);
+
+}
+
+/* get_clock_timestamp */
+int get_clock_timestamp(struct timespec *ts)
+{
+
+	if ( clock_gettime(CLOCK_MONOTONIC_RAW, ts) < 0 )
+	{
+		log_sys_error("Cannot get timestamp");
+		return(EX_SYS);
+	}
+
+	return(TS_SOURCE_CLOCK);
+
+}
+
+/* read_tx_timestamp */
+int read_tx_timestamp(const int socket_fd, struct timespec *ts)
+{
+
+	uint8_t control[	TS_CONTROL_LEN
+						+ CMSG_SPACE(sizeof(struct sock_extended_err))	];
+	struct msghdr msg;
+
+	memset(&msg, 0, sizeof(struct msghdr));
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	if ( recvmsg(socket_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0 )
+	{
+		if ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+			{ return(TS_SOURCE_NONE); }
+		log_sys_error("Could not read TX timestamp");
+		return(EX_SYS);
+	}
+
+	return(get_cmsg_timestamp(&msg, ts));
+
+}
+
+/* get_ts_source_name */
+const char *get_ts_source_name(const int source)
+{
+
+	switch ( source )
+	{
+		case TS_SOURCE_CLOCK:		return("clock");
+		case TS_SOURCE_SOFTWARE:	return("software");
+		case TS_SOURCE_HARDWARE:	return("hardware");
+		default:					return("none");
+	}
+
+}
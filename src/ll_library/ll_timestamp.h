@@ -0,0 +1,138 @@
+/*
+ * @file ll_timestamp.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for timestamping frames as close to the
+ * wire as possible. Timestamps are taken, in order of preference, by the
+ * NIC (hardware), by the kernel when the frame enters or leaves the stack
+ * (software) and, only when none of them is available, from
+ * CLOCK_MONOTONIC_RAW by the application itself. Hardware and software
+ * timestamps are delivered through SO_TIMESTAMPING control messages or,
+ * when kernel rings are used, within the tpacket header of each frame.
+ */
+
+#ifndef LL_TIMESTAMP_H_
+#define LL_TIMESTAMP_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#include <linux/if_packet.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+
+/**************************************************************** DATA TYPES */
+
+#define TS_SOURCE_NONE			0	/*!< Frame not timestamped. */
+#define TS_SOURCE_CLOCK			1	/*!< CLOCK_MONOTONIC_RAW, userspace. */
+#define TS_SOURCE_SOFTWARE		2	/*!< Kernel, CLOCK_REALTIME. */
+#define TS_SOURCE_HARDWARE		3	/*!< NIC clock. */
+
+/*!< Space required for the control messages that carry a timestamp. */
+#define TS_CONTROL_LEN		CMSG_SPACE(sizeof(struct scm_timestamping))
+
+/*!< SO_TIMESTAMPING flags requested for received frames. */
+#define TS_FLAGS_RX		(	SOF_TIMESTAMPING_RX_SOFTWARE		\
+							| SOF_TIMESTAMPING_SOFTWARE			\
+							| SOF_TIMESTAMPING_RX_HARDWARE		\
+							| SOF_TIMESTAMPING_RAW_HARDWARE	)
+
+/*!< SO_TIMESTAMPING flags requested for transmitted frames. */
+#define TS_FLAGS_TX		(	SOF_TIMESTAMPING_TX_SOFTWARE		\
+							| SOF_TIMESTAMPING_TX_HARDWARE		\
+							| SOF_TIMESTAMPING_OPT_TSONLY	)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Enables timestamping of the frames of the given socket: hardware
+ * 			timestamping is requested to the NIC, software timestamping is
+ * 			used if the NIC does not support it.
+ * \param socket_fd Socket whose frames are to be timestamped.
+ * \param if_name Name of the interface of the socket.
+ * \param tx Flag that requests timestamps for transmitted frames as well.
+ * \return Best source of timestamps enabled (TS_SOURCE_*), <0 on error.
+ */
+int enable_ll_timestamping
+	(const int socket_fd, const char *if_name, const bool tx);
+
+/*!
+ * \brief Enables hardware timestamps within the tpacket headers of the
+ * 			kernel rings of the given socket, if the NIC supports them.
+ * \param socket_fd Socket whose rings are to be timestamped.
+ * \param if_name Name of the interface of the socket.
+ * \return Best source of timestamps enabled (TS_SOURCE_*), <0 on error.
+ */
+int enable_ring_timestamping(const int socket_fd, const char *if_name);
+
+/*!
+ * \brief Gets the timestamp carried by the control messages of a frame.
+ * \param msg Message header filled up by recvmsg()/recvmmsg().
+ * \param ts Set to the timestamp found, if any.
+ * \return Source of the timestamp (TS_SOURCE_*), TS_SOURCE_NONE if the
+ * 			message carries no timestamp.
+ */
+int get_cmsg_timestamp(const struct msghdr *msg, struct timespec *ts);
+
+/*!
+ * \brief Gets the source of the timestamp of a tpacket header out of the
+ * 			status of the frame.
+ * \param tp_status Status field of the tpacket header.
+ * \return Source of the timestamp (TS_SOURCE_*).
+ */
+int get_tpacket_ts_source(const uint32_t tp_status);
+
+/*!
+ * \brief Fallback timestamp taken from CLOCK_MONOTONIC_RAW.
+ * \param ts Set to the current time.
+ * \return TS_SOURCE_CLOCK, <0 in case of error.
+ */
+int get_clock_timestamp(struct timespec *ts);
+
+/*!
+ * \brief Reads from the error queue of the socket the timestamp of a frame
+ * 			already transmitted, without blocking.
+ * \param socket_fd Socket through which the frame was transmitted.
+ * \param ts Set to the timestamp of the transmission.
+ * \return Source of the timestamp (TS_SOURCE_*), TS_SOURCE_NONE if there
+ * 			were no timestamps pending, <0 in case of error.
+ */
+int read_tx_timestamp(const int socket_fd, struct timespec *ts);
+
+/*!
+ * \brief Gets the name of a source of timestamps.
+ * \param source The source (TS_SOURCE_*).
+ * \return A constant string with the name of the source.
+ */
+const char *get_ts_source_name(const int source);
+
+#endif /* LL_TIMESTAMP_H_ */
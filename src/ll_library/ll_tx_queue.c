@@ -0,0 +1,302 @@
+/*
+ * @file ll_tx_queue.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ll_tx_queue.h"
+
+#define __TX_SENT			0		/*!< Frame taken by the kernel. */
+#define __TX_PUSHED_BACK	1		/*!< Kernel cannot take it now. */
+#define __TX_FAILED			2		/*!< Frame could not be sent. */
+
+/* __kick */
+static void __kick(ll_tx_queue_t *q)
+{
+
+	if ( ev_is_active(&q->kick) )
+		{ return; }
+
+	// a timer already expired makes the loop poll without waiting
+	ev_timer_set(&q->kick, 0., 0.);
+	ev_timer_start(q->loop, &q->kick);
+
+}
+
+/* __cb_kick */
+static void __cb_kick(struct ev_loop *loop, ev_timer *timer, int revents)
+{
+
+	ll_tx_queue_t *q = (ll_tx_queue_t *)timer->data;
+
+	// the producer itself pauses or stalls the queue when it is done
+	for ( int i = 0; ( i < TX_QUEUE_BUDGET )
+						&& ( q->demand == true ) && ( q->stalled == false ); i++ )
+		{ q->producer->cb(loop, q->producer, EV_WRITE); }
+
+	if ( ( q->demand == true ) && ( q->stalled == false ) )
+		{ __kick(q); }
+
+}
+
+#ifndef KERNEL_RING
+
+/* __send */
+static int __send
+	(	ll_tx_queue_t *q, const void *buffer, const int len,
+		const struct sockaddr_ll *addr	)
+{
+
+	ssize_t b_written = 0;
+
+	for ( ;; )
+	{
+
+		b_written = sendto(	q->socket_fd, buffer, len, MSG_DONTWAIT,
+							(const struct sockaddr *)addr,
+							sizeof(struct sockaddr_ll)	);
+
+		if ( b_written >= 0 )
+			{ break; }
+		if ( errno == EINTR )
+			{ continue; }
+		if ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK )
+				|| ( errno == ENOBUFS ) )
+			{ return(__TX_PUSHED_BACK); }
+
+		log_sys_error("Frame could not be sent");
+		ll_stats_inc(q->stats, tx_errors);
+		return(__TX_FAILED);
+
+	}
+
+	if ( b_written < len )
+	{
+		log_app_msg("Could not transmit all bytes as requested.\n");
+		ll_stats_inc(q->stats, tx_short);
+		return(__TX_FAILED);
+	}
+
+	ll_stats_tx(q->stats, len);
+	return(__TX_SENT);
+
+}
+
+/* __drain */
+static bool __drain(ll_tx_queue_t *q)
+{
+
+	ll_tx_entry_t *e = NULL;
+
+	while ( q->count > 0 )
+	{
+
+		e = &q->entries[q->head];
+		if ( __send(q, e->buffer, e->len, &e->addr) == __TX_PUSHED_BACK )
+			{ return(false); }
+
+		release_ll_frame(e->frame);
+		q->head = ( q->head + 1 ) % q->len;
+		q->count--;
+
+	}
+
+	return(true);
+
+}
+
+#endif
+
+/* __cb_writable */
+static void __cb_writable(struct ev_loop *loop, ev_io *watcher, int revents)
+{
+
+	ll_tx_queue_t *q = (ll_tx_queue_t *)watcher;
+
+	if ( EV_ERROR & revents )
+	{
+		log_sys_error("Invalid event");
+		return;
+	}
+
+#ifdef KERNEL_RING
+	if ( tx_ring_flush(q->tx_ring) < 0 )
+		{ ll_stats_inc(q->stats, tx_errors); }
+	if ( tx_ring_is_blocked(q->tx_ring) == true )
+		{ return; }
+#else
+	if ( __drain(q) == false )
+		{ return; }
+#endif
+
+	ev_io_stop(loop, watcher);
+	q->stalled = false;
+
+	if ( q->demand == true )
+		{ __kick(q); }
+
+}
+
+/* new_ll_tx_queue */
+ll_tx_queue_t *new_ll_tx_queue()
+{
+
+	ll_tx_queue_t *q = NULL;
+	q = (ll_tx_queue_t *)malloc(LEN__LL_TX_QUEUE);
+	memset(q, 0, LEN__LL_TX_QUEUE);
+	return(q);
+
+}
+
+/* init_ll_tx_queue */
+ll_tx_queue_t *init_ll_tx_queue
+	(	struct ev_loop *loop, const int socket_fd, struct ev_io *producer,
+		ll_stats_t *stats, const int len	)
+{
+
+	ll_tx_queue_t *q = NULL;
+
+	if ( ( loop == NULL ) || ( producer == NULL ) )
+		{ return(NULL); }
+
+	if ( len <= 0 )
+	{
+		log_app_msg("Send queue length = %d must be positive.\n", len);
+		return(NULL);
+	}
+
+	q = new_ll_tx_queue();
+	q->loop = loop;
+	q->producer = producer;
+	q->socket_fd = socket_fd;
+	q->stats = stats;
+	q->len = len;
+	q->entries = (ll_tx_entry_t *)malloc(len * LEN__LL_TX_ENTRY);
+	memset(q->entries, 0, len * LEN__LL_TX_ENTRY);
+
+	ev_io_init(&q->watcher, __cb_writable, socket_fd, EV_WRITE);
+	ev_timer_init(&q->kick, __cb_kick, 0., 0.);
+	q->kick.data = q;
+	producer->data = q;
+
+	return(q);
+
+}
+
+/* close_ll_tx_queue */
+int close_ll_tx_queue(ll_tx_queue_t *queue)
+{
+
+	if ( queue == NULL )
+		{ return(EX_NULL_PARAM); }
+
+	ev_io_stop(queue->loop, &queue->watcher);
+	ev_timer_stop(queue->loop, &queue->kick);
+
+	for ( ; queue->count > 0; queue->count-- )
+	{
+		release_ll_frame(queue->entries[queue->head].frame);
+		queue->head = ( queue->head + 1 ) % queue->len;
+	}
+
+	free(queue->entries);
+	free(queue);
+
+	return(EX_OK);
+
+}
+
+/* resume_ll_tx_queue */
+void resume_ll_tx_queue(ll_tx_queue_t *queue)
+{
+
+	queue->demand = true;
+
+	if ( queue->stalled == false )
+		{ __kick(queue); }
+
+}
+
+/* pause_ll_tx_queue */
+void pause_ll_tx_queue(ll_tx_queue_t *queue)
+{
+
+	queue->demand = false;
+	ev_timer_stop(queue->loop, &queue->kick);
+
+}
+
+/* stall_ll_tx_queue */
+void stall_ll_tx_queue(ll_tx_queue_t *queue)
+{
+
+	if ( queue->stalled == true )
+		{ return; }
+
+	queue->stalled = true;
+	queue->stalls++;
+
+	ev_timer_stop(queue->loop, &queue->kick);
+	ev_io_start(queue->loop, &queue->watcher);
+
+}
+
+#ifndef KERNEL_RING
+
+/* send_ll_tx_queue */
+int send_ll_tx_queue
+	(	ll_tx_queue_t *queue, void *frame, const void *buffer, const int len,
+		const struct sockaddr_ll *addr	)
+{
+
+	ll_tx_entry_t *e = NULL;
+	int result = __TX_PUSHED_BACK;
+
+	// frames are sent in order, none goes before those already waiting
+	if ( ( queue->count == 0 ) && ( queue->stalled == false ) )
+		{ result = __send(queue, buffer, len, addr); }
+
+	if ( result != __TX_PUSHED_BACK )
+	{
+		release_ll_frame(frame);
+		return( ( result == __TX_SENT ) ? EX_OK : EX_SYS );
+	}
+
+	if ( queue->count == queue->len )
+	{
+		ll_stats_inc(queue->stats, tx_errors);
+		queue->drops++;
+		release_ll_frame(frame);
+		return(EX_ERR);
+	}
+
+	e = &queue->entries[( queue->head + queue->count ) % queue->len];
+	e->frame = frame;
+	e->buffer = buffer;
+	e->len = len;
+	e->addr = *addr;
+	queue->count++;
+
+	stall_ll_tx_queue(queue);
+
+	return(EX_OK);
+
+}
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * @file ll_tx_queue.h
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @section DESCRIPTION
+ *
+ * Header file with the definitions for the send queue of a socket. The tx
+ * watcher of the socket is no longer started on the socket: it is the
+ * producer of the frames and the queue runs it, once per iteration of the
+ * event loop, while there is demand (the pacer has tokens, a replay has
+ * frames due...). Only when the kernel pushes back (EAGAIN, TX ring full)
+ * the queue keeps the frames not sent, pauses the producer and arms an
+ * EV_WRITE watcher, which is stopped again as soon as the queue is empty.
+ * An idle transmitter has no watchers active and a busy one never blocks.
+ */
+
+#ifndef LL_TX_QUEUE_H_
+#define LL_TX_QUEUE_H_
+
+#include "execution_codes.h"
+#include "logger.h"
+#include "ll_library/ll_frame_pool.h"
+#include "ll_library/ll_stats.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <ev.h>
+
+#ifdef KERNEL_RING
+	#include "ll_library/ll_ring.h"
+#endif
+
+/**************************************************************** DATA TYPES */
+
+#define TX_QUEUE_LEN		64		/*!< Default number of frames waiting. */
+#define TX_QUEUE_BUDGET		32		/*!< Producer runs per loop iteration. */
+
+/*!
+ * \struct ll_tx_entry
+ * \brief Frame waiting for the socket to accept it.
+ */
+typedef struct ll_tx_entry
+{
+
+	void *frame;					/*!< Frame of the pool, released later. */
+	const void *buffer;				/*!< First byte to be sent. */
+	int len;						/*!< Bytes to be sent. */
+	struct sockaddr_ll addr;		/*!< Destination of the frame. */
+
+} ll_tx_entry_t;
+
+#define LEN__LL_TX_ENTRY sizeof(ll_tx_entry_t)
+
+/*!
+ * \struct ll_tx_queue
+ * \brief Send queue of a socket. The watcher is the first field so that its
+ * 			callback gets the queue; the producer and the kick timer point
+ * 			back to the queue through their data field.
+ */
+typedef struct ll_tx_queue
+{
+
+	ev_io watcher;					/*!< EV_WRITE, only armed while stalled. */
+	ev_timer kick;					/*!< Runs the producer on next iteration. */
+	struct ev_loop *loop;			/*!< Loop of the socket. */
+
+	struct ev_io *producer;			/*!< tx watcher of the socket. */
+	bool demand;					/*!< The producer has frames to send. */
+	bool stalled;					/*!< The kernel pushed back. */
+
+	int socket_fd;					/*!< Socket where frames are sent. */
+	ll_stats_t *stats;				/*!< Counters of the socket. */
+	#ifdef KERNEL_RING
+		tx_ring_t *tx_ring;			/*!< TX ring, the queue of the kernel. */
+	#endif
+
+	ll_tx_entry_t *entries;			/*!< Frames waiting, circular. */
+	int len;						/*!< Maximum number of frames waiting. */
+	int head;						/*!< Oldest frame waiting. */
+	int count;						/*!< Frames waiting. */
+
+	uint64_t stalls;				/*!< Times the kernel pushed back. */
+	uint64_t drops;					/*!< Frames dropped, queue full. */
+
+} ll_tx_queue_t;
+
+#define LEN__LL_TX_QUEUE sizeof(ll_tx_queue_t)
+
+/****************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Allocates memory for a send queue.
+ * \return A pointer to the newly allocated block of memory.
+ */
+ll_tx_queue_t *new_ll_tx_queue();
+
+/*!
+ * \brief Creates the send queue of a socket, with no demand.
+ * \param loop Loop of the socket.
+ * \param socket_fd Socket where frames are sent.
+ * \param producer tx watcher of the socket, never started by itself.
+ * \param stats Counters of the socket.
+ * \param len Maximum number of frames waiting.
+ * \return A pointer to the queue, NULL in case of error.
+ */
+ll_tx_queue_t *init_ll_tx_queue
+	(	struct ev_loop *loop, const int socket_fd, struct ev_io *producer,
+		ll_stats_t *stats, const int len	);
+
+/*!
+ * \brief Stops the queue; frames still waiting are released, not sent.
+ * \param queue The queue to be closed.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int close_ll_tx_queue(ll_tx_queue_t *queue);
+
+/*!
+ * \brief Gets the send queue that runs the given producer.
+ * \param producer tx watcher of a socket.
+ * \return The queue of the socket.
+ */
+static inline ll_tx_queue_t *get_ll_tx_queue(const struct ev_io *producer)
+	{ return((ll_tx_queue_t *)producer->data); }
+
+/*!
+ * \brief The producer has frames to send, it is run from the next iteration
+ * 			of the loop on (unless the kernel is pushing back).
+ * \param queue The queue of the producer.
+ */
+void resume_ll_tx_queue(ll_tx_queue_t *queue);
+
+/*!
+ * \brief The producer has nothing to send for now, it is no longer run.
+ * \param queue The queue of the producer.
+ */
+void pause_ll_tx_queue(ll_tx_queue_t *queue);
+
+/*!
+ * \brief The kernel did not take all the frames offered by the producer
+ * 			(a batch or a TX ring): the producer is paused until the socket
+ * 			becomes writable again; the frames are offered again then.
+ * \param queue The queue of the producer.
+ */
+void stall_ll_tx_queue(ll_tx_queue_t *queue);
+
+#ifndef KERNEL_RING
+
+/*!
+ * \brief Sends a frame, or keeps it at the end of the queue if the kernel
+ * 			pushes back or other frames are still waiting. The queue becomes
+ * 			the owner of the frame, which is released once sent.
+ * \param queue The queue of the socket.
+ * \param frame Frame of the pool holding the bytes to be sent.
+ * \param buffer First byte to be sent.
+ * \param len Bytes to be sent.
+ * \param addr Destination of the frame.
+ * \return EX_OK if the frame was sent or queued, <0 if it was dropped.
+ */
+int send_ll_tx_queue
+	(	ll_tx_queue_t *queue, void *frame, const void *buffer, const int len,
+		const struct sockaddr_ll *addr	);
+
+#endif
+
+#endif /* LL_TX_QUEUE_H_ */
@@ -0,0 +1,471 @@
+/*
+ * @file logger.c
+ * @author Ricardo Tubío (rtpardavila[at]gmail.com)
+ * @version 0.1
+ *
+ * @section LICENSE
+ *
+ * This file is part of linklayertool.
+ * linklayertool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * linklayertool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with linklayertool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logger.h"
+#include "execution_codes.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#define ARG_NONE	0	/*!< Conversion without argument (%%, %n). */
+#define ARG_INT		1	/*!< Signed integer conversion. */
+#define ARG_UINT	2	/*!< Unsigned integer conversion. */
+#define ARG_CHAR	3	/*!< Character conversion. */
+#define ARG_DOUBLE	4	/*!< Floating point conversion. */
+#define ARG_STRING	5	/*!< String conversion. */
+#define ARG_PTR		6	/*!< Pointer conversion. */
+
+#define SPEC_LEN	32	/*!< Maximum length of a single conversion. */
+
+int __log_level = LOG_LEVEL_INFO;
+
+static log_ring_t *__log_rings = NULL;			/*!< Rings of all threads. */
+static __thread log_ring_t *__log_ring = NULL;	/*!< Ring of this thread. */
+
+static pthread_t __log_thread;					/*!< Logger thread. */
+static pthread_mutex_t __log_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool __log_running = false;				/*!< Logger thread is on. */
+
+/*!
+ * \struct log_spec
+ * \brief A single conversion of a format, as parsed.
+ */
+typedef struct log_spec
+{
+
+	const char *start;			/*!< First character (%). */
+	const char *end;			/*!< Character after the conversion. */
+	char length[3];				/*!< Length modifier (hh, h, l, ll...). */
+	char conversion;			/*!< Conversion character. */
+	int type;					/*!< Type of the argument (ARG_*). */
+	int no_stars;				/*!< Width and precision taken from args. */
+
+} log_spec_t;
+
+/* __parse_spec */
+static int __parse_spec(const char *p, log_spec_t *spec)
+{
+
+	int l = 0;
+
+	memset(spec, 0, sizeof(log_spec_t));
+	spec->start = p++;
+
+	while ( ( *p != '\0' ) && ( strchr("-+ #0'", *p) != NULL ) ) { p++; }
+
+	if ( *p == '*' ) { spec->no_stars++; p++; }
+	while ( ( *p >= '0' ) && ( *p <= '9' ) ) { p++; }
+
+	if ( *p == '.' )
+	{
+		p++;
+		if ( *p == '*' ) { spec->no_stars++; p++; }
+		while ( ( *p >= '0' ) && ( *p <= '9' ) ) { p++; }
+	}
+
+	while ( ( l < 2 ) && ( *p != '\0' ) && ( strchr("hlzjtL", *p) != NULL ) )
+		{ spec->length[l++] = *p++; }
+
+	spec->conversion = *p;
+	spec->end = ( *p != '\0' ) ? p + 1 : p;
+
+	switch ( *p )
+	{
+		case 'd': case 'i':
+			spec->type = ARG_INT; break;
+		case 'u': case 'o': case 'x': case 'X':
+			spec->type = ARG_UINT; break;
+		case 'c':
+			spec->type = ARG_CHAR; break;
+		case 'e': case 'E': case 'f': case 'F':
+		case 'g': case 'G': case 'a': case 'A':
+			spec->type = ARG_DOUBLE; break;
+		case 's':
+			spec->type = ARG_STRING; break;
+		case 'p':
+			spec->type = ARG_PTR; break;
+		case '%': case 'n':
+			spec->type = ARG_NONE; break;
+		default:
+			return(EX_WRONG_PARAM);
+	}
+
+	return(EX_OK);
+
+}
+
+/* __read_int */
+static long long __read_int(const char *length, va_list *args)
+{
+
+	if ( strcmp(length, "hh") == 0 )
+		{ return((signed char)va_arg(*args, int)); }
+	if ( strcmp(length, "h") == 0 ) { return((short)va_arg(*args, int)); }
+	if ( strcmp(length, "l") == 0 ) { return(va_arg(*args, long)); }
+	if ( strcmp(length, "ll") == 0 ) { return(va_arg(*args, long long)); }
+	if ( strcmp(length, "z") == 0 ) { return(va_arg(*args, ssize_t)); }
+	if ( strcmp(length, "j") == 0 ) { return(va_arg(*args, intmax_t)); }
+	if ( strcmp(length, "t") == 0 ) { return(va_arg(*args, ptrdiff_t)); }
+	return(va_arg(*args, int));
+
+}
+
+/* __read_uint */
+static unsigned long long __read_uint(const char *length, va_list *args)
+{
+
+	if ( strcmp(length, "hh") == 0 )
+		{ return((unsigned char)va_arg(*args, unsigned int)); }
+	if ( strcmp(length, "h") == 0 )
+		{ return((unsigned short)va_arg(*args, unsigned int)); }
+	if ( strcmp(length, "l") == 0 ) { return(va_arg(*args, unsigned long)); }
+	if ( strcmp(length, "ll") == 0 )
+		{ return(va_arg(*args, unsigned long long)); }
+	if ( strcmp(length, "z") == 0 ) { return(va_arg(*args, size_t)); }
+	if ( strcmp(length, "j") == 0 ) { return(va_arg(*args, uintmax_t)); }
+	if ( strcmp(length, "t") == 0 ) { return(va_arg(*args, ptrdiff_t)); }
+	return(va_arg(*args, unsigned int));
+
+}
+
+/* __record_event */
+static void __record_event
+	(	log_event_t *e, const int level, const char *format,
+		va_list *args	)
+{
+
+	log_spec_t spec;
+	const char *s = NULL;
+	int str_len = 0, str_next = 0;
+
+	e->format = format;
+	e->level = level;
+	e->no_args = 0;
+
+	for ( const char *p = format; *p != '\0'; p++ )
+	{
+
+		if ( *p != '%' )
+			{ continue; }
+		if ( __parse_spec(p, &spec) < 0 )
+			{ break; }
+		p = spec.end - 1;
+
+		// conversions beyond the limit are not printed at all
+		if ( e->no_args + spec.no_stars + 1 > LOG_MAX_ARGS )
+			{ break; }
+
+		for ( int i = 0; i < spec.no_stars; i++ )
+			{ e->args[e->no_args++].i = va_arg(*args, int); }
+
+		switch ( spec.type )
+		{
+			case ARG_INT:
+				e->args[e->no_args++].i = __read_int(spec.length, args);
+				break;
+			case ARG_UINT:
+				e->args[e->no_args++].u = __read_uint(spec.length, args);
+				break;
+			case ARG_CHAR:
+				e->args[e->no_args++].i = va_arg(*args, int);
+				break;
+			case ARG_DOUBLE:
+				if ( spec.length[0] == 'L' )
+					{ e->args[e->no_args++].d = va_arg(*args, long double); }
+				else
+					{ e->args[e->no_args++].d = va_arg(*args, double); }
+				break;
+			case ARG_STRING:
+				// the string might not outlive the event, so it is copied
+				if ( ( s = va_arg(*args, const char *) ) == NULL )
+					{ s = "(null)"; }
+				str_len = strnlen(s, LOG_STRINGS_LEN - 1 - str_next);
+				memcpy(e->strings + str_next, s, str_len);
+				e->strings[str_next + str_len] = '\0';
+				e->args[e->no_args++].s = str_next;
+				str_next += str_len;
+				if ( str_next < LOG_STRINGS_LEN - 1 )
+					{ str_next++; }
+				break;
+			case ARG_PTR:
+				e->args[e->no_args++].p = va_arg(*args, void *);
+				break;
+			case ARG_NONE:
+				if ( spec.conversion == 'n' )
+					{ (void)va_arg(*args, void *); }
+				break;
+		}
+
+	}
+
+}
+
+/* format_log_event */
+int format_log_event(const log_event_t *e, char *buffer, const int len)
+{
+
+	log_spec_t spec;
+	char f[SPEC_LEN];
+	int pos = 0, arg = 0, f_len = 0, w = 0;
+
+	buffer[0] = '\0';
+
+	for ( const char *p = e->format; ( *p != '\0' ) && ( pos < len - 1 ); )
+	{
+
+		if ( *p != '%' )
+			{ buffer[pos++] = *p++; continue; }
+
+		if ( __parse_spec(p, &spec) < 0 )
+			{ buffer[pos++] = *p++; continue; }
+
+		// conversions whose arguments were not stored are skipped
+		if ( ( spec.type == ARG_NONE )
+				|| ( arg + spec.no_stars + 1 > e->no_args ) )
+		{
+			if ( spec.conversion == '%' )
+				{ buffer[pos++] = '%'; }
+			p = spec.end;
+			continue;
+		}
+
+		// the conversion is rebuilt with the width and precision values, and
+		// with the length modifier of the type the argument was stored as
+		f_len = 0;
+		for ( const char *c = spec.start;
+				( c < spec.end - 1 ) && ( f_len < SPEC_LEN - 24 ); c++ )
+		{
+			if ( *c == '*' )
+				{ f_len += sprintf(f + f_len, "%d", (int)e->args[arg++].i); }
+			else if ( strchr("hlzjtL", *c) == NULL )
+				{ f[f_len++] = *c; }
+		}
+		if ( ( spec.type == ARG_INT ) || ( spec.type == ARG_UINT ) )
+			{ f[f_len++] = 'l'; f[f_len++] = 'l'; }
+		f[f_len++] = spec.conversion;
+		f[f_len] = '\0';
+
+		switch ( spec.type )
+		{
+			case ARG_INT:
+			case ARG_CHAR:
+				w = snprintf(buffer + pos, len - pos, f, e->args[arg].i);
+				break;
+			case ARG_UINT:
+				w = snprintf(buffer + pos, len - pos, f, e->args[arg].u);
+				break;
+			case ARG_DOUBLE:
+				w = snprintf(buffer + pos, len - pos, f, e->args[arg].d);
+				break;
+			case ARG_STRING:
+				w = snprintf(	buffer + pos, len - pos, f,
+								e->strings + e->args[arg].s	);
+				break;
+			case ARG_PTR:
+				w = snprintf(buffer + pos, len - pos, f, e->args[arg].p);
+				break;
+		}
+
+		arg++;
+		pos += ( w < len - pos ) ? w : len - 1 - pos;
+		p = spec.end;
+
+	}
+
+	buffer[pos] = '\0';
+	return(pos);
+
+}
+
+/* __write_event */
+static void __write_event(const log_event_t *e)
+{
+
+	char line[LOG_LINE_LEN];
+	int len = format_log_event(e, line, LOG_LINE_LEN);
+
+	if ( e->level == LOG_LEVEL_WARNING )
+		{ fputs("[WARNING] ", stdout); }
+	fwrite(line, 1, len, ( e->level == LOG_LEVEL_ERROR ) ? stderr : stdout);
+
+}
+
+/* __get_log_ring */
+static log_ring_t *__get_log_ring()
+{
+
+	log_ring_t *r = NULL;
+
+	if ( __log_ring != NULL )
+		{ return(__log_ring); }
+
+	if ( posix_memalign((void **)&r, 64, LEN__LOG_RING) != 0 )
+		{ return(NULL); }
+	memset(r, 0, LEN__LOG_RING);
+
+	// rings are never released, the logger thread might be reading them
+	r->next = __atomic_load_n(&__log_rings, __ATOMIC_RELAXED);
+	while ( ! __atomic_compare_exchange_n(	&__log_rings, &r->next, r, true,
+											__ATOMIC_RELEASE,
+											__ATOMIC_RELAXED	) ) {}
+
+	__log_ring = r;
+	return(r);
+
+}
+
+/* __drain_logger */
+static int __drain_logger()
+{
+
+	int drained = 0;
+	uint32_t head = 0, tail = 0;
+	uint64_t dropped = 0;
+
+	pthread_mutex_lock(&__log_lock);
+
+	for ( log_ring_t *r = __atomic_load_n(&__log_rings, __ATOMIC_ACQUIRE);
+			r != NULL; r = r->next )
+	{
+
+		head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		tail = r->tail;
+
+		for ( ; tail != head; tail++, drained++ )
+			{ __write_event(&r->events[tail & ( LOG_RING_LEN - 1 )]); }
+
+		__atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+
+		if ( ( dropped = __atomic_exchange_n(	&r->dropped, 0,
+												__ATOMIC_RELAXED	) ) > 0 )
+			{ fprintf(stderr, "[LOGGER] %lu events dropped.\n", dropped); }
+
+	}
+
+	if ( drained > 0 )
+		{ fflush(stdout); }
+
+	pthread_mutex_unlock(&__log_lock);
+
+	return(drained);
+
+}
+
+/* __logger_thread */
+static void *__logger_thread(void *arg)
+{
+
+	struct timespec idle = { .tv_sec = 0, .tv_nsec = LOG_POLL_NSECS };
+
+	while ( __atomic_load_n(&__log_running, __ATOMIC_ACQUIRE) == true )
+	{
+		if ( __drain_logger() == 0 )
+			{ nanosleep(&idle, NULL); }
+	}
+
+	return(NULL);
+
+}
+
+/* init_logger */
+int init_logger(const int level)
+{
+
+	__log_level = level;
+
+	if ( __atomic_load_n(&__log_running, __ATOMIC_ACQUIRE) == true )
+		{ return(EX_OK); }
+
+	__atomic_store_n(&__log_running, true, __ATOMIC_RELEASE);
+
+	if ( pthread_create(&__log_thread, NULL, __logger_thread, NULL) != 0 )
+	{
+		__atomic_store_n(&__log_running, false, __ATOMIC_RELEASE);
+		perror("Could not start logger thread");
+		return(EX_SYS);
+	}
+
+	return(EX_OK);
+
+}
+
+/* close_logger */
+void close_logger()
+{
+
+	if ( __atomic_exchange_n(&__log_running, false, __ATOMIC_ACQ_REL) == false )
+		{ return; }
+
+	pthread_join(__log_thread, NULL);
+	__drain_logger();
+
+}
+
+/* flush_logger */
+void flush_logger()
+{
+	__drain_logger();
+}
+
+/* log_event */
+void log_event(const int level, const char *format, ...)
+{
+
+	va_list args;
+	log_ring_t *r = NULL;
+	log_event_t event, *e = &event;
+	uint32_t head = 0;
+
+	va_start(args, format);
+
+	// without the logger thread, events are written out right away
+	if ( ( __atomic_load_n(&__log_running, __ATOMIC_ACQUIRE) == false )
+			|| ( ( r = __get_log_ring() ) == NULL ) )
+	{
+		__record_event(e, level, format, &args);
+		va_end(args);
+		pthread_mutex_lock(&__log_lock);
+		__write_event(e);
+		pthread_mutex_unlock(&__log_lock);
+		return;
+	}
+
+	head = r->head;
+
+	if ( head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= LOG_RING_LEN )
+	{
+		__atomic_fetch_add(&r->dropped, 1, __ATOMIC_RELAXED);
+		va_end(args);
+		return;
+	}
+
+	e = &r->events[head & ( LOG_RING_LEN - 1 )];
+	__record_event(e, level, format, &args);
+	va_end(args);
+
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+
+}
@@ -23,28 +23,167 @@
  *
  * Header file with the definitions for a very simple logging utility.
  *
+ * Messages are not formatted by the thread that logs them: the format string
+ * (that works as the identifier of the event) and the arguments are stored
+ * in binary form within a lock-free ring owned by that thread, and a
+ * background thread formats and writes them out. Logging never blocks, if
+ * the ring is full the event is dropped and accounted for.
+ *
  */
 
 #ifndef LOGGER_H_
 #define LOGGER_H_
 
+#include <errno.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/******************************************************************** LEVELS */
+
+#define LOG_LEVEL_ERROR		0	/*!< Errors, always written to stderr. */
+#define LOG_LEVEL_WARNING	1	/*!< Warnings. */
+#define LOG_LEVEL_INFO		2	/*!< Regular application messages. */
+#define LOG_LEVEL_DEBUG		3	/*!< Debug messages (verbose mode). */
+
+/*!< Most verbose level compiled in, the rest are removed by the compiler. */
+#ifndef LOG_LEVEL_MAX
+	#define LOG_LEVEL_MAX	LOG_LEVEL_DEBUG
+#endif
+
+/*!< Most verbose level logged at runtime. */
+extern int __log_level;
+
+/****************************************************************** EVENTS */
+
+#define LOG_MAX_ARGS		12		/*!< Arguments stored per event. */
+#define LOG_STRINGS_LEN		128		/*!< Space for string arguments (B). */
+#define LOG_RING_LEN		2048	/*!< Events per ring (power of 2). */
+#define LOG_LINE_LEN		1024	/*!< Maximum length of a formatted event. */
+#define LOG_POLL_NSECS		1000000	/*!< Sleep of the idle logger (nsecs). */
+
+/*!
+ * \union log_arg
+ * \brief Argument of a log event, as read from the variable argument list.
+ */
+typedef union log_arg
+{
+
+	long long i;				/*!< Signed integers and characters. */
+	unsigned long long u;		/*!< Unsigned integers. */
+	double d;					/*!< Floating point numbers. */
+	const void *p;				/*!< Pointers. */
+	int s;						/*!< Offset of a string argument. */
+
+} log_arg_t;
+
+/*!
+ * \struct log_event
+ * \brief Binary log event, formatted later by the logger thread.
+ */
+typedef struct log_event
+{
+
+	const char *format;				/*!< Format, also the ID of the event. */
+	int level;						/*!< Level of the event. */
+	int no_args;					/*!< Number of arguments stored. */
+	log_arg_t args[LOG_MAX_ARGS];	/*!< Arguments of the event. */
+	char strings[LOG_STRINGS_LEN];	/*!< Copies of the string arguments. */
+
+} __attribute__((aligned(64))) log_event_t;
+
+#define LEN__LOG_EVENT sizeof(log_event_t)
+
+/*!
+ * \struct log_ring
+ * \brief Single producer, single consumer ring of log events. Each thread
+ * 			that logs owns one, the logger thread consumes all of them.
+ */
+typedef struct log_ring
+{
+
+	struct log_ring *next;			/*!< Next ring of the list. */
+
+	uint32_t head __attribute__((aligned(64)));	/*!< Written by producer. */
+	uint32_t tail __attribute__((aligned(64)));	/*!< Written by consumer. */
+	uint64_t dropped;				/*!< Events dropped, ring was full. */
+
+	log_event_t events[LOG_RING_LEN];	/*!< Events of the ring. */
+
+} log_ring_t;
+
+#define LEN__LOG_RING sizeof(log_ring_t)
+
+/***************************************************************** FUNCTIONS */
+
+/*!
+ * \brief Starts the thread that formats and writes out the log events.
+ * 			Until it is started, events are formatted synchronously.
+ * \param level Most verbose level to be logged.
+ * \return EX_OK if everything was correct; otherwise < 0.
+ */
+int init_logger(const int level);
+
+/*!
+ * \brief Stops the logger thread, writing out all the pending events.
+ */
+void close_logger();
+
+/*!
+ * \brief Writes out all the events pending, from the calling thread.
+ */
+void flush_logger();
+
+/*!
+ * \brief Records a log event in the ring of the calling thread. The format
+ * 			must be a string literal, it is read later by the logger thread.
+ * \param level Level of the event.
+ * \param format Format of the message (printf syntax).
+ */
+void log_event(const int level, const char *format, ...)
+	__attribute__((format(printf, 2, 3)));
+
+/*!
+ * \brief Formats a log event.
+ * \param event The event to be formatted.
+ * \param buffer Buffer where the message is to be written.
+ * \param len Length of the buffer (B).
+ * \return Length of the message (B).
+ */
+int format_log_event(const log_event_t *event, char *buffer, const int len);
+
+/******************************************************************** MACROS */
+
+#define log_enabled(level) \
+			( ( (level) <= LOG_LEVEL_MAX ) && ( (level) <= __log_level ) )
+
+#define log_msg(level, ...) \
+			do { if ( log_enabled(level) ) log_event(level, __VA_ARGS__); \
+			} while(0)
 
 #define handle_sys_error(msg) \
-           	do { perror(msg); exit(EXIT_FAILURE); } while (0)
+           	do { flush_logger(); perror(msg); exit(EXIT_FAILURE); } while (0)
 
 #define handle_fd_error(fd, msg, ex_no) \
-           	do { perror(msg); close(fd); return(ex_no); } while (0)
-           	
+           	do { log_sys_error(msg); close(fd); return(ex_no); } while (0)
+
 #define log_sys_error(msg) \
-           	do { perror(msg); fprintf(stderr, "err# = %d\n", errno); } while (0)
-           	
+           	do { log_msg(	LOG_LEVEL_ERROR, "%s: %s\nerr# = %d\n", \
+           					msg, strerror(errno), errno	); } while (0)
+
 #define handle_app_error(...) \
-           	do { fprintf(stderr, __VA_ARGS__); exit(EXIT_FAILURE); } while (0)
+           	do { flush_logger(); fprintf(stderr, __VA_ARGS__); \
+           			exit(EXIT_FAILURE); } while (0)
 
 #define log_app_msg(...) \
-			do { fprintf(stdout, __VA_ARGS__); } while(0)
+			log_msg(LOG_LEVEL_INFO, __VA_ARGS__)
 
-#endif /* LOGGER_H_ */
+#define log_warning_msg(...) \
+			log_msg(LOG_LEVEL_WARNING, __VA_ARGS__)
 
+#define log_debug_msg(...) \
+			log_msg(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#endif /* LOGGER_H_ */
@@ -27,6 +27,9 @@
 #include "logger.h"
 #include "configuration.h"
 #include "ll_library/ll_socket.h"
+#include "ll_library/ll_fanout.h"
+#include "ll_library/ll_filter.h"
+#include "ll_library/ll_metrics.h"
 #include "ll_library/ieee8023_frame.h"
 
 /**************************************************** Application definitions */
@@ -53,6 +56,90 @@ int transmit_data(ll_socket_t *ll_socket)
 	return(EX_OK);
 }
 
+/* set_batch */
+int set_batch
+	(ll_socket_t *ll_socket, const bool is_transmitter, const int batch)
+{
+
+	if ( batch <= 1 )
+		{ return(EX_OK); }
+
+	#ifdef KERNEL_RING
+		log_app_msg("Kernel rings already work in batches, ignoring batch.\n");
+		return(EX_OK);
+	#else
+		if ( is_transmitter == true )
+			{ return(set_tx_batch_ll_socket(ll_socket, batch)); }
+		return(set_rx_batch_ll_socket(ll_socket, batch));
+	#endif
+
+}
+
+/* set_capture */
+int set_capture
+	(ll_socket_t *ll_socket, const configuration_t *cfg, const int worker)
+{
+
+	char path[CAPTURE_PATH_LEN];
+
+	// every worker of a fanout group writes its own file
+	if ( worker < 0 )
+		{ snprintf(path, CAPTURE_PATH_LEN, "%s", cfg->capture); }
+	else
+		{ snprintf(path, CAPTURE_PATH_LEN, "%s.w%d", cfg->capture, worker); }
+
+	return(set_capture_ll_socket(	ll_socket, path, cfg->capture_format,
+									(uint64_t)cfg->rotate_mbytes * 1024 * 1024,
+									cfg->rotate_secs	));
+
+}
+
+/* set_stats */
+int set_stats
+	(ll_socket_t *ll_socket, const configuration_t *cfg, const int worker)
+{
+
+	char name[STATS_NAME_LEN];
+
+	// every worker of a fanout group reports its own counters
+	if ( worker < 0 )
+		{ return(set_stats_reporter_ll_socket
+						(ll_socket, cfg->stats_interval, NULL)); }
+
+	snprintf(name, STATS_NAME_LEN, "%s.w%d", cfg->if_name, worker);
+	return(set_stats_reporter_ll_socket(ll_socket, cfg->stats_interval, name));
+
+}
+
+/* set_metrics */
+ll_metrics_server_t *set_metrics
+	(ll_socket_t *ll_socket, const configuration_t *cfg, const int worker)
+{
+
+	ll_metrics_server_t *server = NULL;
+	char path[METRICS_PATH_LEN];
+	char name[STATS_NAME_LEN];
+
+	// every worker of a fanout group is served by its own loop
+	if ( worker < 0 )
+	{
+		snprintf(path, METRICS_PATH_LEN, "%s", cfg->metrics);
+		snprintf(name, STATS_NAME_LEN, "%s", cfg->if_name);
+	}
+	else
+	{
+		snprintf(path, METRICS_PATH_LEN, "%s.w%d", cfg->metrics, worker);
+		snprintf(name, STATS_NAME_LEN, "%s.w%d", cfg->if_name, worker);
+	}
+
+	if ( ( server = init_ll_metrics_server(path, ll_socket, name) ) == NULL )
+		{ return(NULL); }
+	start_ll_metrics_server(server);
+
+	return(server);
+
+}
+
 /* receive_data */
 int receive_data(ll_socket_t *ll_socket)
 {
@@ -65,22 +152,102 @@ int main(int argc, char **argv)
 
 	configuration_t *cfg = NULL;
 	ll_socket_t *ll_socket = NULL;
+	ll_fanout_t *ll_fanout = NULL;
+	ll_backend_t *backend = NULL;
+	ll_metrics_server_t *metrics_server = NULL, **metrics = NULL;
 	
 	/* 1) Runtime configuration is read from the CLI (POSIX.2). */
 	cfg = create_configuration(argc, argv);
+
+	/* Messages are written out by the logger thread from now on. */
+	if ( init_logger( ( __verbose == true ) ? LOG_LEVEL_DEBUG
+											: LOG_LEVEL_INFO ) < 0 )
+		{ handle_app_error("Could not start logger.\n"); }
 	print_configuration(cfg);
 
-	/* 2) Link layer socket is open. */
-	if ( ( ll_socket = open_ll_socket
-						(	cfg->is_transmitter,
+	#ifdef KERNEL_RING
+	/* Every socket, workers included, maps an RX ring of this size. */
+	if ( set_rx_ring_size(	cfg->ring_block_kbytes << 10,
+							cfg->ring_blocks	) < 0 )
+		{ handle_app_error("Could not set RX ring size.\n"); }
+	#endif
+
+	/* Several receivers might share the interface through a fanout group. */
+	if ( cfg->no_workers > 1 )
+	{
+
+		if ( ( ll_fanout = open_ll_fanout
+							(	cfg->no_workers,
+								cfg->fanout_mode,
+								cfg->if_name,
+								cfg->lsap,
+								cfg->frame_type	)
+							) == NULL )
+			{ handle_app_error("Could not open ll_fanout.\n"); }
+
+		for ( int i = 0; i < ll_fanout->no_workers; i++ )
+		{
+			if ( set_batch(ll_fanout->workers[i], false, cfg->batch) < 0 )
+				{ handle_app_error("Could not set RX batch mode.\n"); }
+			if ( ( cfg->filter != NULL )
+					&& ( set_filter_ll_socket
+							(ll_fanout->workers[i], cfg->filter) < 0 ) )
+				{ handle_app_error("Could not set RX filter.\n"); }
+			if ( ( cfg->capture != NULL )
+					&& ( set_capture(ll_fanout->workers[i], cfg, i) < 0 ) )
+				{ handle_app_error("Could not set RX capture.\n"); }
+			if ( ( cfg->stats_interval > 0 )
+					&& ( set_stats(ll_fanout->workers[i], cfg, i) < 0 ) )
+				{ handle_app_error("Could not set statistics.\n"); }
+		}
+
+		if ( cfg->metrics != NULL )
+		{
+			metrics = (ll_metrics_server_t **)
+						calloc(ll_fanout->no_workers, sizeof(*metrics));
+			for ( int i = 0; i < ll_fanout->no_workers; i++ )
+			{
+				if ( ( metrics[i] = set_metrics
+								(ll_fanout->workers[i], cfg, i) ) == NULL )
+					{ handle_app_error("Could not set metrics server.\n"); }
+			}
+		}
+
+		log_app_msg("Setting up receiver mode with %d workers...\n"
+						, cfg->no_workers);
+		start_ll_fanout(ll_fanout);
+
+		for ( int i = 0; ( metrics != NULL ) && ( i < cfg->no_workers ); i++ )
+			{ close_ll_metrics_server(metrics[i]); }
+		free(metrics);
+
+		close_ll_fanout(ll_fanout);
+		log_app_msg("Sockets are closed.\n");
+		close_logger();
+
+		exit(EXIT_SUCCESS);
+
+	}
+
+	/* 2) Link layer socket is open, on top of a live interface or not. */
+	if ( ( cfg->backend != LL_BACKEND_PACKET )
+			&& ( ( backend = init_ll_backend
+								(	cfg->backend, cfg->backend_file,
+									cfg->capture_format,
+									get_frame_linktype(cfg->frame_type),
+									cfg->is_transmitter	) ) == NULL ) )
+		{ handle_app_error("Could not open backend.\n"); }
+
+	if ( ( ll_socket = open_ll_socket_backend
+						(	backend,
+							cfg->is_transmitter,
 							cfg->tx_delay,
 							cfg->if_name,
 							cfg->lsap,
 							cfg->frame_type	)
 						) == NULL )
 		{ handle_app_error("Could not open ll_socket.\n"); }
-	printf("descriptor %d. volvo de open_ll_socket \n",ll_socket->socket_fd);
-printf("socket aberto\n");
+
 	#ifdef KERNEL_RING
 		log_app_msg("TX socket open with fd = %d\n", ll_socket->tx_socket_fd);
 		log_app_msg("RX socket open with fd = %d\n", ll_socket->rx_socket_fd);
@@ -88,24 +255,74 @@ printf("socket aberto\n");
 		log_app_msg("Socket open with fd = %d\n", ll_socket->socket_fd);
 	#endif
 
-	/* 3) Set-up this programe either as a transmitter or a receiver. */
+	/* 3) Set-up this programe as a transmitter, a receiver or both. */
+	if ( ( cfg->is_transmitter == true ) && ( cfg->is_receiver == true )
+			&& ( set_duplex_ll_socket(ll_socket) < 0 ) )
+		{ handle_app_error("Could not set full-duplex mode.\n"); }
+
 	if ( cfg->is_transmitter == true )
 	{
 		log_app_msg("Setting up transmitter mode...\n");
 
+		if ( set_batch(ll_socket, true, cfg->batch) < 0 )
+			{ handle_app_error("Could not set TX batch mode.\n"); }
+
+		if ( ( cfg->tx_rate > 0 )
+				&& ( set_pacer_ll_socket(	ll_socket, cfg->tx_rate_unit,
+											cfg->tx_rate, cfg->tx_burst	) < 0 ) )
+			{ handle_app_error("Could not set TX rate.\n"); }
+
+		if ( ( cfg->replay != NULL )
+				&& ( set_replay_ll_socket(	ll_socket, cfg->replay,
+											cfg->replay_speed,
+											( cfg->batch > 1 ) ? cfg->batch
+													: REPLAY_BATCH_LEN	) < 0 ) )
+			{ handle_app_error("Could not set TX replay.\n"); }
+
+		if ( ( cfg->probe_mode == PROBE_MODE_PING )
+				&& ( set_probe_ll_socket(	ll_socket, PROBE_MODE_PING,
+											cfg->probe_count	) < 0 ) )
+			{ handle_app_error("Could not set latency probes.\n"); }
+
 	}
-	else
-	{print_eth_address(ll_socket->if_mac);
+
+	if ( cfg->is_receiver == true )
+	{
 		log_app_msg("Setting up receiver mode...\n");
+
+		if ( set_batch(ll_socket, false, cfg->batch) < 0 )
+			{ handle_app_error("Could not set RX batch mode.\n"); }
+
+		if ( ( cfg->filter != NULL )
+				&& ( set_filter_ll_socket(ll_socket, cfg->filter) < 0 ) )
+			{ handle_app_error("Could not set RX filter.\n"); }
+
+		if ( ( cfg->capture != NULL )
+				&& ( set_capture(ll_socket, cfg, -1) < 0 ) )
+			{ handle_app_error("Could not set RX capture.\n"); }
+
+		if ( ( cfg->probe_mode == PROBE_MODE_REFLECT )
+				&& ( set_probe_ll_socket
+						(ll_socket, PROBE_MODE_REFLECT, 0) < 0 ) )
+			{ handle_app_error("Could not set probe reflector.\n"); }
 	}
 
-	//exit(EXIT_SUCCESS);
-printf("entro en start_ll_socket\n");
+	if ( ( cfg->stats_interval > 0 )
+			&& ( set_stats(ll_socket, cfg, -1) < 0 ) )
+		{ handle_app_error("Could not set statistics.\n"); }
+
+	if ( ( cfg->metrics != NULL )
+			&& ( ( metrics_server = set_metrics(ll_socket, cfg, -1) ) == NULL ) )
+		{ handle_app_error("Could not set metrics server.\n"); }
+
 	start_ll_socket(ll_socket);
-printf("start\n");
+
 	// 4) sockets are closed before exiting application
+	if ( metrics_server != NULL )
+		{ close_ll_metrics_server(metrics_server); }
 	close_ll_socket(ll_socket);
 	log_app_msg("Socket is closed.\n");
+	close_logger();
 
 	exit(EXIT_SUCCESS);
 